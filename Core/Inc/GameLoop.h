@@ -0,0 +1,94 @@
+#ifndef __GAMELOOP_H
+#define __GAMELOOP_H
+#include <stdint.h>
+
+// Fixed-timestep game loop. The simulation advances in whole ticks of
+// 1/tickHz s counted from HAL_GetTick(), however long drawing takes, so a
+// game plays at the same speed (and, given the same input per tick, the
+// same way) whatever the draw load; rendering runs once per loop pass,
+// optionally capped to a frame rate, and can interpolate between ticks
+// with alpha(). Physics is Q16.16 fixed point, so it's exact and costs no
+// FPU.
+//
+//	GameLoop loop(60, 60);
+//	loop.begin();
+//	while (playing) {
+//		for (uint8_t n = loop.steps(); n; n--)
+//			simulate();				// one tick
+//		render(loop.alpha());
+//		loop.endFrame();
+//	}
+
+#if !defined(GAME_MAX_STEPS)
+ #define GAME_MAX_STEPS 4	// Ticks run per pass at most; the rest is dropped
+#endif
+
+// Q16.16 fixed point
+typedef int32_t q16_t;
+
+#define Q16_ONE		((q16_t)1 << 16)
+// Constant from a number literal, rounded; folded at compile time
+#define Q16(x)		((q16_t)((x) * 65536.0 + ((x) < 0 ? -0.5 : 0.5)))
+
+static inline q16_t q16FromInt(int32_t i) { return i * Q16_ONE; }
+// Floor to an integer
+static inline int32_t q16Int(q16_t q) { return q >> 16; }
+// Round to the nearest integer
+static inline int32_t q16Round(q16_t q) { return (q + (Q16_ONE >> 1)) >> 16; }
+static inline q16_t q16Mul(q16_t a, q16_t b) { return (q16_t)(((int64_t)a * b) >> 16); }
+static inline q16_t q16Div(q16_t a, q16_t b) { return (q16_t)(((int64_t)a << 16) / b); }
+// a + (b - a) * t, t in 0 .. Q16_ONE
+static inline q16_t q16Lerp(q16_t a, q16_t b, q16_t t) { return a + q16Mul(b - a, t); }
+
+// Body moving along one axis, in pixels and pixels per tick
+struct Q16Body {
+	q16_t pos;		// Position
+	q16_t vel;		// Velocity
+	q16_t prev;		// Position before the last step, for interpolation
+};
+
+// One tick of semi-implicit Euler: velocity first, then position
+static inline void q16Step(Q16Body &b, q16_t accel)
+{
+	b.prev = b.pos;
+	b.vel += accel;
+	b.pos += b.vel;
+}
+
+// Position between the last two steps, t = GameLoop::alpha()
+static inline q16_t q16At(const Q16Body &b, q16_t t) { return q16Lerp(b.prev, b.pos, t); }
+
+class GameLoop
+{
+public:
+	GameLoop(uint16_t tickHz, uint16_t fps = 0);
+
+	void begin();
+	uint8_t steps();
+	void endFrame();
+
+	// Fraction of a tick elapsed since the last one, for rendering
+	q16_t alpha() const { return (q16_t)(((int64_t)_acc << 16) / 1000); }
+
+	uint16_t tickHz() const { return _hz; }
+	uint16_t fps() const { return _fps; }
+	uint32_t ticks() const { return _ticks; }		// Simulation ticks run
+	uint32_t dropped() const { return _dropped; }	// Ticks skipped, see GAME_MAX_STEPS
+	uint32_t frames() const { return _frames; }		// Frames rendered
+	uint32_t late() const { return _late; }			// Frames over their slot
+	uint32_t frameMin() const { return _frames ? _min : 0; }	// Work per frame, ms
+	uint32_t frameMax() const { return _max; }
+	uint32_t frameAvg() const { return _frames ? _sum / _frames : 0; }
+
+private:
+	uint16_t _hz, _fps;
+	uint32_t _last;			// HAL_GetTick() the clock was last read
+	uint32_t _acc;			// Elapsed time not yet run, ms * _hz
+	uint32_t _start;		// HAL_GetTick() the frame started
+	uint32_t _next;			// HAL_GetTick() the current frame slot started
+	uint16_t _rem;			// Carry of 1000 % _fps ms
+	uint32_t _ticks, _dropped, _frames, _late;
+	uint32_t _min, _max, _sum;
+};
+
+#endif
@@ -8,9 +8,15 @@ extern "C" {
 
 	// this function determines the minimum of two numbers
 #define minimum(a,b)     (((a) < (b)) ? (a) : (b))
+
+	// Widest preview renderJPEGPreview() caches
+#define PREVIEW_MAX_W	80
 	
-	void jpegInfo(Adafruit_ILI9341 lcd);
-	void renderJPEG(Adafruit_ILI9341 lcd, int xpos, int ypos);
+	void jpegInfo(Adafruit_ILI9341 &lcd);
+	void renderJPEG(Adafruit_ILI9341 &lcd, int xpos, int ypos);
+	bool renderJPEGFit(Adafruit_ILI9341 &lcd, int x, int y, int w, int h);
+	bool renderJPEGPreview(Adafruit_ILI9341 &lcd, const char *name, int x, int y, int w, int h);
+	void sidecarName(char *out, const char *name, const char *ext);
 
 #ifdef __cplusplus
 }
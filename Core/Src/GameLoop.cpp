@@ -0,0 +1,70 @@
+#include "main.h"
+#include "GameLoop.h"
+
+// tickHz: simulation ticks per second. fps: frames rendered per second at
+// most, 0 to render on every pass.
+GameLoop::GameLoop(uint16_t tickHz, uint16_t fps)
+	: _hz(tickHz ? tickHz : 1), _fps(fps)
+{
+	begin();
+}
+
+// Restart the clock and the statistics, e.g. when a game starts
+void GameLoop::begin()
+{
+	_last = _start = _next = HAL_GetTick();
+	_acc = 0;
+	_rem = 0;
+	_ticks = _dropped = _frames = _late = 0;
+	_min = 0xFFFFFFFF;
+	_max = _sum = 0;
+}
+
+// Number of ticks to simulate now: the time since the last call in whole
+// ticks, remainder carried over. After a stall at most GAME_MAX_STEPS run
+// and the rest is dropped, so a slow frame can't snowball.
+uint8_t GameLoop::steps()
+{
+	uint32_t now = HAL_GetTick();
+	_acc += (now - _last) * _hz;
+	_last = now;
+
+	uint32_t n = _acc / 1000;
+	_acc -= n * 1000;
+	if (n > GAME_MAX_STEPS) {
+		_dropped += n - GAME_MAX_STEPS;
+		n = GAME_MAX_STEPS;
+	}
+	_ticks += n;
+	return (uint8_t)n;
+}
+
+// Close a frame: record how long its work took, then, with a frame rate
+// set, wait for the next frame slot. A late frame doesn't wait, and the
+// slots move on from now rather than rushing to catch up.
+void GameLoop::endFrame()
+{
+	uint32_t now = HAL_GetTick(), work = now - _start;
+	_frames++;
+	_sum += work;
+	if (work < _min)
+		_min = work;
+	if (work > _max)
+		_max = work;
+
+	if (_fps) {
+		_next += 1000 / _fps;
+		_rem += 1000 % _fps;
+		if (_rem >= _fps) {
+			_rem -= _fps;
+			_next++;
+		}
+		if ((int32_t)(_next - now) >= 0) {
+			while ((int32_t)(_next - HAL_GetTick()) > 0) ;
+		} else {
+			_late++;
+			_next = now;
+		}
+	}
+	_start = HAL_GetTick();
+}
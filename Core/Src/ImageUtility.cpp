@@ -1,37 +1,40 @@
 
 #include "main.h"
 #include "ImageUtility.h"
+#include <Adafruit_Scaler.h>
 #include "stm32f3xx_hal_def.h"
 extern void SPI_DMAHalfTransmitCplt(DMA_HandleTypeDef *hdma);
 static void SPI_DMATransmitCplt(DMA_HandleTypeDef *hdma);
 static void SPI_DMAReceiveCplt(DMA_HandleTypeDef *hdma);
 static void SPI_DMAError(DMA_HandleTypeDef *hdma);
 
-void jpegInfo(Adafruit_ILI9341 lcd) {
+void jpegInfo(Adafruit_ILI9341 &lcd) {
 	lcd.fillScreen(ILI9341_BLACK);
 	lcd.setCursor(0, 0);
 	lcd.setTextSize(2);
-	lcd.setTextColor(ILI9341_GREEN);
+	// Opaque on the black screen: same result, but each print() is one
+	// address window per line instead of a window per glyph dot
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
 	lcd.println("===============");
 	lcd.println("===============");
 	lcd.println("JPEG image info");
 	lcd.println("===============");
-	lcd.print("Width      :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.width);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("Height     :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.height);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("Components :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.comps);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("MCU / row  :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.MCUSPerRow);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("MCU / col  :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.MCUSPerCol);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("Scan type  :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.scanType);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("MCU width  :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.MCUWidth);
-	lcd.setTextColor(ILI9341_GREEN);
-	lcd.print("MCU height :"); lcd.setTextColor(ILI9341_YELLOW); lcd.println(JpegDec.MCUHeight);
-	lcd.setTextColor(ILI9341_GREEN);
+	lcd.print("Width      :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.width);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("Height     :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.height);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("Components :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.comps);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("MCU / row  :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.MCUSPerRow);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("MCU / col  :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.MCUSPerCol);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("Scan type  :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.scanType);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("MCU width  :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.MCUWidth);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+	lcd.print("MCU height :"); lcd.setTextColor(ILI9341_YELLOW, ILI9341_BLACK); lcd.println(JpegDec.MCUHeight);
+	lcd.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
 	lcd.println("===============");
 }
 
@@ -147,38 +150,30 @@ error :
 	return errorcode;
 }
 
-void renderJPEG(Adafruit_ILI9341 lcd, int xpos, int ypos) {
+void renderJPEG(Adafruit_ILI9341 &lcd, int xpos, int ypos) {
 
 	// retrieve infomration about the image
 	uint16_t *pImg;
-	uint16_t mcu_w = JpegDec.MCUWidth;
-	uint16_t mcu_h = JpegDec.MCUHeight;
-	uint32_t max_x = JpegDec.width;
-	uint32_t max_y = JpegDec.height;
-	uint32_t ofs_x = (lcd.width() - max_x) / 2; 
-	uint32_t ofs_y = (lcd.height() - max_y) / 2; 
+	int mcu_w = JpegDec.MCUWidth;
+	int mcu_h = JpegDec.MCUHeight;
+	int max_x = JpegDec.width;
+	int max_y = JpegDec.height;
+
+	// center images smaller than the screen; larger ones (decode them with
+	// JPEG_SCALE_FIT to avoid this) are drawn from their top left corner,
+	// or from -xpos, -ypos: JpegDec.setCrop() to match decodes only that part
+	int ofs_x = (lcd.width() - max_x) / 2;
+	int ofs_y = (lcd.height() - max_y) / 2;
 	if (ofs_x < 0) ofs_x = 0;
 	if (ofs_y < 0) ofs_y = 0;
 	xpos += ofs_x;
 	ypos += ofs_y;
 
-	// Jpeg images are draw as a set of image block (tiles) called Minimum Coding Units (MCUs)
-	// Typically these MCUs are 16x16 pixel blocks
-	// Determine the width and height of the right and bottom edge image blocks
-	uint32_t min_w = minimum(mcu_w, max_x % mcu_w);
-	uint32_t min_h = minimum(mcu_h, max_y % mcu_h);
-
-	// save the current image block size
-	uint32_t win_w = mcu_w;
-	uint32_t win_h = mcu_h;
-
-	// record the current time so we can measure how long it takes to draw an image
-	uint32_t drawTime = HAL_GetTick();
-
 	// save the coordinate of the right and bottom edges to assist image cropping
 	// to the screen size
-	max_x += xpos;
-	max_y += ypos;
+	max_x = minimum(max_x + xpos, (int)lcd.width());
+	max_y = minimum(max_y + ypos, (int)lcd.height());
+
 	lcd.startWrite();
 	// read each MCU block until there are no more
 	while(JpegDec.read()) {
@@ -190,41 +185,214 @@ void renderJPEG(Adafruit_ILI9341 lcd, int xpos, int ypos) {
 		int mcu_x = JpegDec.MCUx * mcu_w + xpos;
 		int mcu_y = JpegDec.MCUy * mcu_h + ypos;
 
-		// check if the image block size needs to be changed for the right and bottom edges
-		if(mcu_x + mcu_w <= max_x) win_w = mcu_w;
-		else win_w = min_w;
-		if (mcu_y + mcu_h <= max_y) win_h = mcu_h;
-		else win_h = min_h;
-
-		// calculate how many pixels must be drawn
-		uint32_t mcu_pixels = win_w * win_h;
-
-		// draw image block if it will fit on the screen
-		
-		if((mcu_x + win_w) <= ILI9341_WIDTH && (mcu_y + win_h) <= ILI9341_HEIGHT) {
-			// open a window onto the screen to paint the pixels into
-			//TFTscreen.setAddrWindow(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1);
-			
-			lcd.setAddrBlock(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1);
-			HAL_GPIO_WritePin(ILI9341_DC_GPIO_Port, ILI9341_DC_Pin, GPIO_PIN_SET);
-			// push all the image block pixels to the screen
-				if(SPI_Complete == 1)
-				{
-					SPI_Complete = 0;
-					HAL_SPI_Transmit_DMA(&ILI9341_SPI_PORT, (uint8_t*)(pImg), mcu_pixels * 2);
-					SPI_WaitForComplete();
-				}
-			//}
-			int dummy = 12;
-		}
-
-		// stop drawing blocks if the bottom of the screen has been reached
+		// stop once the bottom of the screen has been reached
 		// the abort function will close the file
-		else if((mcu_y + win_h) >= ILI9341_HEIGHT) JpegDec.abort();
+		if (mcu_y >= max_y) {
+			JpegDec.abort();
+			break;
+		}
 
+		// Jpeg images are draw as a set of image block (tiles) called Minimum Coding Units (MCUs)
+		// Typically these MCUs are 16x16 pixel blocks. Blocks at the edges of
+		// the image or the screen are cropped.
+		int cut_x = (mcu_x < 0) ? -mcu_x : 0;
+		int cut_y = (mcu_y < 0) ? -mcu_y : 0;
+		int win_w = minimum(mcu_w, max_x - mcu_x) - cut_x;
+		int win_h = minimum(mcu_h, max_y - mcu_y) - cut_y;
+		if (win_w <= 0 || win_h <= 0)
+			continue;
+
+		// cropped blocks are narrower than the MCU, close up the rows
+		// so the pixels are contiguous
+		if(win_w != mcu_w) {
+			uint16_t *cImg = pImg;
+			uint16_t *pRow = pImg + cut_y * mcu_w + cut_x;
+			for(int h = 0; h < win_h; h++) {
+				for(int w = 0; w < win_w; w++) *cImg++ = pRow[w];
+				pRow += mcu_w;
+			}
+		}
+		else pImg += cut_y * mcu_w;
+
+		mcu_x += cut_x;
+		mcu_y += cut_y;
+		lcd.setAddrBlock(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1);
+		// push all the image block pixels to the screen, native RGB565 in
+		// 16-bit frames; the copy lets the next MCU decode overlap the DMA
+		lcd.writePixels(pImg, win_w * win_h, false);
 	}
 	lcd.endWrite();
+}
+
+// Largest size with a pw x ph image's aspect that fits a w x h box
+static void fitSize(int pw, int ph, int w, int h, int &tw, int &th)
+{
+	tw = w;
+	th = (int32_t)ph * w / pw;
+	if (th > h) {
+		th = h;
+		tw = (int32_t)pw * h / ph;
+	}
+	if (tw < 1) tw = 1;
+	if (th < 1) th = 1;
+}
+
+// Scaler input for renderJPEGFit(): one MCU row of the decoded image, and
+// the scaler's two output rows. Static, since the heap is only 2 KB.
+#define FIT_STRIP_PIXELS	1024
+static uint16_t fitStrip[FIT_STRIP_PIXELS];
+static uint16_t fitWork[2 * ILI9341_TFTHEIGHT];
+
+// Draw the image JpegDec has started decoding scaled to fit the box, keeping
+// its aspect: for images still bigger than the screen at 1/8, and previews.
+// MCU rows wider than fitStrip (over 512 pixels at 1/8 with 16-row MCUs,
+// i.e. photos over 4096 wide) keep every 2nd, 4th... column so they fit.
+bool renderJPEGFit(Adafruit_ILI9341 &lcd, int x, int y, int w, int h)
+{
+	int pw = JpegDec.width, ph = JpegDec.height;
+	int mw = JpegDec.MCUWidth, mh = JpegDec.MCUHeight;
+	int cols = JpegDec.MCUSPerRow * mw, shift = 0;
+	while (((cols + (1 << shift) - 1) >> shift) * mh > FIT_STRIP_PIXELS)
+		shift++;
+	int stride = (cols + (1 << shift) - 1) >> shift;
+	int tw, th;
+	fitSize(pw, ph, w, h, tw, th);
+
+	Adafruit_Scaler scaler;
+	scaler.begin(&lcd, x + (w - tw) / 2, y + (h - th) / 2, (pw + (1 << shift) - 1) >> shift, ph, tw, th, SCALER_BILINEAR, fitWork);
+	int row = 0;
+	while (JpegDec.read()) {
+		uint16_t *src = JpegDec.pImage;
+		int x0 = JpegDec.MCUx * mw;
+		for (int i = (-x0) & ((1 << shift) - 1); i < mw; i += 1 << shift)
+			for (int j = 0; j < mh; j++)
+				fitStrip[j * stride + ((x0 + i) >> shift)] = src[j * mw + i];
+		if (JpegDec.MCUx == JpegDec.MCUSPerRow - 1)
+			for (int j = 0; j < mh && row < ph; j++, row++)
+				scaler.pushRow(fitStrip + j * stride);
+	}
+	return true;
+}
 
+// Sidecar file name of a photo: its 8.3 name with the extension ext
+void sidecarName(char *out, const char *name, const char *ext)
+{
+	const char *dot = strrchr(name, '.');
+	int n = dot ? dot - name : strlen(name);
+	if (n > 8)
+		n = 8;
+	memcpy(out, name, n);
+	strcpy(out + n, ext);
+}
 
+// Preview cache, a .JPV sidecar: this header, then the preview's pixels as
+// drawn, row by row. It's only used for the same JPEG (size and CRC of its
+// first PREVIEW_CRC_BYTES, which hold the tables and the start of the scan)
+// and the same box.
+#define PREVIEW_MAGIC		0x3156504AUL	// "JPV1"
+#define PREVIEW_CRC_BYTES	1024
+
+typedef struct {
+	uint32_t magic;
+	uint32_t fileSize;		// Of the JPEG
+	uint32_t crc;			// CRC-32 of the JPEG's first PREVIEW_CRC_BYTES
+	uint16_t boxW, boxH;	// Box the preview was fitted to
+	uint16_t w, h;			// Preview size, centred in the box
+} preview_header_t;
+
+// CRC-32 (IEEE) of a file's first bytes, from its current position
+static uint32_t fileCRC(File &file, uint32_t bytes)
+{
+	uint8_t buf[64];
+	uint32_t crc = 0;
+	while (bytes) {
+		int n = file.read(buf, bytes < sizeof(buf) ? bytes : sizeof(buf));
+		if (n <= 0)
+			break;
+		crc = jpegCRC32(crc, buf, n);
+		bytes -= n;
+	}
+	return crc;
+}
 
-}
\ No newline at end of file
+// Draw a preview from its cache. False if there's none for this JPEG and box.
+static bool drawCachedPreview(Adafruit_ILI9341 &lcd, const char *cache, const preview_header_t &want, int x, int y)
+{
+	preview_header_t header;
+	uint16_t row[PREVIEW_MAX_W];
+	File file = SD.open(cache, FILE_READ);
+	if (!file)
+		return false;
+	bool ok = file.read(&header, sizeof(header)) == sizeof(header) &&
+		header.magic == want.magic && header.fileSize == want.fileSize &&
+		header.crc == want.crc && header.boxW == want.boxW &&
+		header.boxH == want.boxH && header.w <= PREVIEW_MAX_W &&
+		file.size() == sizeof(header) + (uint32_t)header.w * header.h * 2;
+	if (ok) {
+		x += (header.boxW - header.w) / 2;
+		y += (header.boxH - header.h) / 2;
+		for (int j = 0; j < header.h && ok; j++) {
+			ok = file.read(row, header.w * 2) == header.w * 2;
+			lcd.drawRGBBitmap(x, y + j, row, header.w, 1);
+		}
+	}
+	file.close();
+	return ok;
+}
+
+// Save a preview just drawn, read back from the display
+static void savePreview(Adafruit_ILI9341 &lcd, const char *cache, const preview_header_t &header, int x, int y)
+{
+	uint16_t row[PREVIEW_MAX_W];
+	if (SD.exists(cache))
+		SD.remove(cache);
+	File file = SD.open(cache, FILE_WRITE);
+	if (!file)
+		return;
+	bool ok = file.write((const uint8_t *)&header, sizeof(header)) == sizeof(header);
+	x += (header.boxW - header.w) / 2;
+	y += (header.boxH - header.h) / 2;
+	for (int j = 0; j < header.h && ok; j++) {
+		lcd.readRect(x, y + j, header.w, 1, row);
+		ok = file.write((const uint8_t *)row, header.w * 2) == header.w * 2;
+	}
+	file.close();
+	if (!ok)
+		SD.remove(cache);
+}
+
+// Preview of a JPEG file fitted to a box (at most PREVIEW_MAX_W wide). The
+// first time it's decoded at 1/8 (DC only) and scaled, and the result is
+// cached next to the photo; after that it's read back from the cache, which
+// costs a few KB of SD reads instead of entropy decoding the whole file.
+bool renderJPEGPreview(Adafruit_ILI9341 &lcd, const char *name, int x, int y, int w, int h)
+{
+	preview_header_t header;
+	char cache[13];
+	File jpg = SD.open(name, FILE_READ);
+	if (!jpg)
+		return false;
+	header.magic = PREVIEW_MAGIC;
+	header.fileSize = jpg.size();
+	header.crc = fileCRC(jpg, PREVIEW_CRC_BYTES);
+	header.boxW = w;
+	header.boxH = h;
+	jpg.close();
+
+	sidecarName(cache, name, ".JPV");
+	if (w <= PREVIEW_MAX_W && drawCachedPreview(lcd, cache, header, x, y))
+		return true;
+
+	if (JpegDec.decodeSdFile(name, JPEG_SCALE_1_8) != 1)
+		return false;
+	int tw, th;
+	fitSize(JpegDec.width, JpegDec.height, w, h, tw, th);
+	if (!renderJPEGFit(lcd, x, y, w, h))
+		return false;
+	if (w <= PREVIEW_MAX_W) {
+		header.w = tw;
+		header.h = th;
+		savePreview(lcd, cache, header, x, y);
+	}
+	return true;
+}
@@ -27,6 +27,11 @@
 #include <JPEGDecoder.h>
 #include <Adafruit_GFX.h>
 #include <Adafruit_ILI9341.h>
+#include <Adafruit_ScrollConsole.h>
+#include <Adafruit_Widgets.h>
+#include <Adafruit_Brush.h>
+#include <Adafruit_Sprite.h>
+#include "GameLoop.h"
 #include <Adafruit_ImageReader.h>
 #include "ImageUtility.h"
 #include "XPT2046.h"
@@ -41,6 +46,8 @@ UART_HandleTypeDef huart5;
 
 Adafruit_ILI9341 Tft = Adafruit_ILI9341(0, 0);
 
+Adafruit_ScrollConsole console(&Tft);   // Boot log, mirrors UART_Printf
+
 TouchScreen ts = TouchScreen();
 
 Adafruit_ImageReader reader(SD);
@@ -61,21 +68,20 @@ static void MX_DMA_Init(void);
 ImageReturnCode stat;     // Status from image-reading functions
 
 Adafruit_GFX_Button btn_exit;
-Adafruit_GFX_Button btn_clear;
-Adafruit_GFX_Button btn_save;
-Adafruit_GFX_Button btn_load;
-Adafruit_GFX_Button btn_s1;
-Adafruit_GFX_Button btn_s2;
-Adafruit_GFX_Button btn_s3;
-Adafruit_GFX_Button btn_s4;
-Adafruit_GFX_Button buttons[10];
 
 uint8_t SPI_Complete = 1;
 void HAL_SPI_TxCpltCallback(SPI_HandleTypeDef *hspi) { 
 	SPI_Complete = 1;
+	Adafruit_SPITFT::dmaComplete(hspi);
+}
+void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) {
+	SPI_Complete = 1;
+	Adafruit_SPITFT::dmaComplete(hspi);
+}
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+	SPI_Complete = 1;
+	Adafruit_SPITFT::dmaComplete(hspi); // Display DMA reads end up here
 }
-void HAL_SPI_RxCpltCallback(SPI_HandleTypeDef *hspi) { SPI_Complete = 1; }
-void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) { SPI_Complete = 1; }
 
 // Parameters for the array of buttons
 const int xstartButton[] = { 8, 8, 8, 8, 8, 8, 8, 8, 8, 8 };                  // x-min for keypads
@@ -84,6 +90,67 @@ const int ystartButton[] = { 12, 36, 60, 84, 108, 132, 156, 180, 204, 228 };
 const int widthButton = 16;
 const int heightButton = 24;
 
+// Menus are retained widget trees: after the first paint, a state change
+// only repaints the widgets it touched (see Adafruit_Widgets.h)
+Adafruit_WidgetScreen screen(&Tft);
+
+Adafruit_Panel mainMenu(0, 0, 320, 240, ILI9341_WHITE);
+Adafruit_IconButton mainButtons[] = {
+	Adafruit_IconButton(&Tft, 12, 88, 64, 64, 1, image_data_Foto),
+	Adafruit_IconButton(&Tft, 89, 88, 64, 64, 2, image_data_Game),
+	Adafruit_IconButton(&Tft, 165, 88, 64, 64, 3, image_data_Paint),
+	Adafruit_IconButton(&Tft, 242, 88, 64, 64, 4, image_data_MP3)
+};
+
+// Palette button colors, indexed by button number
+const uint16_t paletteColor[10] = {
+	ILI9341_BLACK, ILI9341_GREENYELLOW, ILI9341_MAGENTA, ILI9341_CYAN, ILI9341_WHITE,
+	ILI9341_YELLOW, ILI9341_GREEN, ILI9341_MAROON, ILI9341_RED, ILI9341_BLUE
+};
+
+#define PALETTE_BUTTON(i) Adafruit_IconButton(&Tft, xstartButton[i] - widthButton / 2, \
+	ystartButton[i] - heightButton / 2, widthButton, heightButton, i, NULL, \
+	ILI9341_WHITE, paletteColor[i], ILI9341_DARKGREY)
+
+Adafruit_Panel paintMenuRoot(0, 0, 320, 240, ILI9341_BLACK);
+Adafruit_Panel paintPad(widthButton + 1, 0, ILI9341_WIDTH - (widthButton * 2) - 2, ILI9341_HEIGHT, ILI9341_BLACK);
+Adafruit_IconButton paletteButtons[10] = {
+	PALETTE_BUTTON(0), PALETTE_BUTTON(1), PALETTE_BUTTON(2), PALETTE_BUTTON(3), PALETTE_BUTTON(4),
+	PALETTE_BUTTON(5), PALETTE_BUTTON(6), PALETTE_BUTTON(7), PALETTE_BUTTON(8), PALETTE_BUTTON(9)
+};
+Adafruit_IconButton paintTools[] = {
+	Adafruit_IconButton(&Tft, 303, 2, 16, 16, 11, image_data_Cancel),
+	Adafruit_IconButton(&Tft, 303, 26, 16, 16, 12, image_data_Trash),
+	Adafruit_IconButton(&Tft, 303, 50, 16, 16, 13, image_data_Save),
+	Adafruit_IconButton(&Tft, 303, 74, 16, 16, 14, image_data_Load)
+};
+
+// Strokes join successive touch samples, clipped to the pad
+Adafruit_Brush brush(&Tft, 2, BRUSH_ROUND);
+
+// Link the menu widgets into their trees, once at startup
+void initMenus()
+{
+	for (int i = 0; i < 4; i++)
+		mainMenu.add(&mainButtons[i]);
+	paintMenuRoot.add(&paintPad);
+	for (int i = 0; i < 10; i++)
+		paintMenuRoot.add(&paletteButtons[i]);
+	for (int i = 0; i < 4; i++)
+		paintMenuRoot.add(&paintTools[i]);
+}
+
+// Show a menu tree, or repaint what changed in the one shown
+void showMenu(Adafruit_Widget *root)
+{
+	if (screen.root() != root)
+		screen.setRoot(root);
+	// Build the damaged area in the strip renderer, sent at endWrite()
+	Tft.setDeferred(true);
+	screen.update();
+	Tft.setDeferred(false);
+}
+
 uint8_t mode;
 
 
@@ -94,25 +161,85 @@ uint8_t mode;
 #define modePaint	3
 #define modeMP3		4
 
+// Startup sequencer. The display and the SD card are on separate SPI
+// buses, so their power-up delays (ILI9341 reset/sleep-out, SD ACMD41
+// polling) are run as state machines and overlapped; the first menu
+// frame goes out as soon as the panel is ready, while the card is still
+// coming up. Phase times are ms since bootStart.
+uint32_t bootStart;            // HAL_GetTick() when the sequencer started
+uint32_t bootTft, bootTouch;   // Display ready, touch configured
+uint32_t bootSd, bootFrame;    // Card mounted (or failed), first frame sent
+uint8_t sdState = SD_INIT_BUSY;
+
+// Print the breakdown once both the SD card and the first frame are done
+void bootReport()
+{
+	if (sdState == SD_INIT_BUSY || !bootFrame)
+		return;
+	UART_Printf("boot: tft %lu ms, touch %lu ms, first frame %lu ms, sd %lu ms (%s)\r\n",
+		bootTft, bootTouch, bootFrame, bootSd, sdState == SD_INIT_OK ? "ok" : "failed");
+}
+
+// Advance SD init by one step; cheap to call from UI loops
+void bootPollSd()
+{
+	if (sdState != SD_INIT_BUSY)
+		return;
+	sdState = SD.beginPoll();
+	if (sdState != SD_INIT_BUSY) {
+		bootSd = HAL_GetTick() - bootStart;
+		bootReport();
+	}
+}
+
+// Start everything, return as soon as the display can be drawn on
+void bootBegin()
+{
+	bootStart = HAL_GetTick();
+	Tft.beginStart();
+	SD.beginStart();
+	ts.init(3);
+	bootTouch = HAL_GetTick() - bootStart;
+	while (!Tft.beginPoll())
+		bootPollSd();
+	bootTft = HAL_GetTick() - bootStart;
+	Tft.setRotation(3);
+	// Photos decoded with JPEG_SCALE_FIT come out no bigger than the screen
+	JpegDec.setFitSize(Tft.width(), Tft.height());
+}
+
+// Block until the SD card is mounted. Modes need it (files, save/load),
+// so a failed card stops here with the error on screen as before.
+void bootWaitSd()
+{
+	while (sdState == SD_INIT_BUSY)
+		bootPollSd();
+	if (sdState == SD_INIT_FAIL) {
+		console.begin(0, 0, 1, ILI9341_GREEN, ILI9341_BLACK);
+		UART_Printf("SD initialization failed!\r\n");
+		while (1) ;
+	}
+}
+
 uint8_t modeSelMenu()
 {
 	mode = 0;
-	Tft.fillScreen(ILI9341_WHITE);
-	btn_s1.initButtonUL(&Tft, 12, 88, 64, 64, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	btn_s2.initButtonUL(&Tft, 89, 88, 64, 64, ILI9341_WHITE, ILI9341_GREEN, ILI9341_WHITE, "", 8);
-	btn_s3.initButtonUL(&Tft, 165, 88, 64, 64, ILI9341_WHITE, ILI9341_YELLOW, ILI9341_WHITE, "", 8);
-	btn_s4.initButtonUL(&Tft, 242, 88, 64, 64, ILI9341_WHITE, ILI9341_YELLOW, ILI9341_WHITE, "", 8);
-	
-	Tft.drawRGBBitmap(12, 88, (uint16_t *)image_data_Foto, 64, 64);
-	Tft.drawRGBBitmap(89, 88, (uint16_t *)image_data_Game, 64, 64);
-	Tft.drawRGBBitmap(165, 88, (uint16_t *)image_data_Paint, 64, 64);
-	Tft.drawRGBBitmap(242, 88, (uint16_t *)image_data_MP3, 64, 64);
+	// Whatever the last mode drew isn't retained, so this is a full paint
+	for (int i = 0; i < 4; i++)
+		mainButtons[i].setPressed(false);
+	screen.setRoot(NULL);
+	showMenu(&mainMenu);
+	if (!bootFrame) {
+		bootFrame = HAL_GetTick() - bootStart;
+		bootReport();
+	}
 	
 	int x, y;
 	
 	/* Infinite loop */
 	for (;;)
 	{
+		bootPollSd();
 		if (TouchPressed())
 		{
 			ts.read_coordinates(&x, &y);
@@ -120,6 +247,10 @@ uint8_t modeSelMenu()
 			userInput = getButtonNumber(x, y);
 			if (userInput >= 0)
 			{
+				// Press feedback repaints just the one icon
+				mainButtons[userInput - 1].setPressed(true);
+				showMenu(&mainMenu);
+				bootWaitSd();
 				switch (userInput)
 				{
 				case 1:
@@ -144,68 +275,47 @@ uint8_t modeSelMenu()
 
 void paintMenu()
 {
-	
-  
-	// Sets the coordinates and sizes of the keypad buttons, and sets all the values for the buttons' text
-	const int noRows = 4;
-	const int noColumns = 3;
-	Tft.fillScreen(ILI9341_BLACK);
-	int y = 0; 
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_BLACK, ILI9341_WHITE, "", 8);
-	
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_GREENYELLOW, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_MAGENTA, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_CYAN, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_WHITE, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_YELLOW, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_GREEN, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_MAROON, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_RED, ILI9341_WHITE, "", 8);
-	y++;
-	buttons[y].initButton(&Tft, xstartButton[y], ystartButton[y], widthButton, heightButton, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	
-
-	/// Draw the array of buttons
-	for(int i = 0 ; i < 10 ; i++) 
-	  buttons[i].drawButton();
-	
-	btn_exit.initButtonUL(&Tft, 303, 2, 16, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	btn_clear.initButtonUL(&Tft, 303, 26, 16, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	btn_save.initButtonUL(&Tft, 303, 50, 16, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	btn_load.initButtonUL(&Tft, 303, 74, 16, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	//btn_exit.drawButton();
-	Tft.drawRGBBitmap(303, 2, (uint16_t *)image_data_Cancel, 16, 16);
-	Tft.drawRGBBitmap(303, 26, (uint16_t *)image_data_Trash, 16, 16);
-	Tft.drawRGBBitmap(303, 50, (uint16_t *)image_data_Save, 16, 16);
-	Tft.drawRGBBitmap(303, 74, (uint16_t *)image_data_Load, 16, 16);
-
-	
+	paintPad.setColor(ILI9341_BLACK);
+	screen.setRoot(NULL);
+	showMenu(&paintMenuRoot);
 }
 
 void clearPad(uint16_t color)
 {
-	Tft.fillRect(widthButton + 1, 0, ILI9341_WIDTH - (widthButton * 2) - 2, ILI9341_HEIGHT, color);
+	paintPad.setColor(color);
+	paintPad.invalidate(); // Strokes aren't retained, clear even if same color
+	showMenu(&paintMenuRoot);
+}
+
+// Move the selection frame to another palette button
+void selectPalette(int n)
+{
+	for (int i = 0; i < 10; i++)
+		paletteButtons[i].setSelected(i == n);
+	showMenu(&paintMenuRoot);
 }
 
 void paint()
 {
 	mode = 3;
 	uint16_t currentColor = ILI9341_WHITE;
+	for (int i = 0; i < 10; i++)
+		paletteButtons[i].setSelected(paletteColor[i] == currentColor);
 	paintMenu();
+	const Adafruit_Rect &pad = paintPad.bounds();
+	brush.setClip(pad.x, pad.y, pad.w, pad.h);
+	brush.setColor(currentColor);
+	brush.up();
 	int x, y;
 	
 	/* Infinite loop */
 	for (;;)
 	{
-		if (TouchPressed())
+		if (!TouchPressed())
+		{
+			brush.up();
+		}
+		else
 		{
 			ts.read_coordinates(&x, &y);
 			
@@ -221,38 +331,14 @@ void paint()
 			
 			if (userInput >= 0)
 			{
+				if (userInput < 10)
+				{
+					currentColor = paletteColor[userInput];
+					brush.setColor(currentColor);
+					selectPalette(userInput);
+				}
 				switch (userInput)
 				{
-				case 9:
-					currentColor = ILI9341_BLUE;
-					break;
-				case 8:
-					currentColor = ILI9341_RED;
-					break;
-				case 7:
-					currentColor = ILI9341_MAROON;
-					break;
-				case 6:
-					currentColor = ILI9341_GREEN;
-					break;
-				case 5:
-					currentColor = ILI9341_YELLOW;
-					break;
-				case 4:
-					currentColor = ILI9341_WHITE;
-					break;
-				case 3:
-					currentColor = ILI9341_CYAN;
-					break;
-				case 2:
-					currentColor = ILI9341_MAGENTA;
-					break;
-				case 1:
-					currentColor = ILI9341_GREENYELLOW;
-					break;
-				case 0:
-					currentColor = ILI9341_BLACK;
-					break;
 				case 11:
 					return;
 					break;
@@ -272,10 +358,14 @@ void paint()
 			if (x > (widthButton + 2) && x < (ILI9341_WIDTH - widthButton - 3))
 			{
 				if (x >= 0 && y >= 0)
-					Tft.fillCircle(x, y, 2, currentColor);
+					brush.lineTo(x, y);
 			
 				//Tft.setPixel(x, 240 - y, currentColor);
 			}
+			else
+			{
+				brush.up();
+			}
 			//UART_Printf("raw_x = %i    raw_y = %i\r\n", x, y);
 			//HAL_Delay(5);
 		}	
@@ -316,10 +406,21 @@ int slideshowMenu()
 	return userInput;
 }
 
-void slideshow()
+// Show a JPEG full screen, reduced to fit if it's bigger
+void showPhoto(const char *name)
+{
+	if (JpegDec.decodeSdFile(name, JPEG_SCALE_FIT) != 1)
+		return;
+	// Still bigger at 1/8 (over 2560x1920): scale the rest of the way
+	if (JpegDec.width > Tft.width() || JpegDec.height > Tft.height())
+		renderJPEGFit(Tft, 0, 0, Tft.width(), Tft.height());
+	else
+		renderJPEG(Tft, 0, 0);
+}
+
+// Show every image on the card full screen in turn. Returns 11 if cancelled.
+int slideshowPlay()
 {
-	btn_exit.initButtonUL(&Tft, 303, 2, 16, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
-	mode = modeFoto;
 	File dir = SD.open("/");
 	dir.rewindDirectory();
 	Tft.fillScreen(ILI9341_BLACK);
@@ -337,188 +438,414 @@ void slideshow()
 			convertToUpperCase(ext);
 			String s(ext);
 			if (s == "JPG") {
-				JpegDec.decodeSdFile(entry);
-				renderJPEG(Tft, 0, 0);
-				if (slideshowMenu() == 11) return;
+				showPhoto(entry.name());
+				if (slideshowMenu() == 11) return 11;
 			}
 			if (s == "BMP")
 			{
 				reader.drawBMP(entry.name(), Tft, 0, 0);
-				if (slideshowMenu() == 11) return;
+				if (slideshowMenu() == 11) return 11;
 			}
 			Tft.fillScreen(ILI9341_BLACK);
 		}
 		entry.close();
 	}
+	return -1;
+}
+
+// Photo browser: a page of previews of the JPEGs on the card, decoded at 1/8
+// (DC only) the first time and then read from their .JPV caches (see
+// renderJPEGPreview()). Tap a preview to view the image full
+// screen, Next for the next page, Play for the slideshow.
+#define THUMB_COLS		4
+#define THUMB_ROWS		3
+#define THUMB_PAGE		(THUMB_COLS * THUMB_ROWS)
+#define THUMB_TOP		20		// Below the title bar
+#define THUMB_CELL_W	80
+#define THUMB_CELL_H	73
+#define THUMB_W			76		// Preview box, centred in the top of a cell
+#define THUMB_H			56
+
+// Define to log how long each full size view and index build take over UART
+//#define PHOTO_TIMING
+
+Adafruit_GFX_Button btn_play, btn_next;
+char thumbName[THUMB_PAGE][13];		// 8.3 names of the JPEGs on the page shown
+
+// True if the file name ends in .ext, in any case (ext in upper case)
+bool hasExtension(const char *name, const char *ext)
+{
+	const char *dot = strrchr(name, '.');
+	char buf[5];
+	if (!dot)
+		return false;
+	strncpy(buf, dot + 1, sizeof(buf) - 1);
+	buf[sizeof(buf) - 1] = 0;
+	convertToUpperCase(buf);
+	return strcmp(buf, ext) == 0;
+}
+
+// List the JPEGs of a page into thumbName[]. Returns how many there are on
+// the page; total is set to the number on the card.
+int thumbList(int page, int &total)
+{
+	int n = 0;
+	total = 0;
+	File dir = SD.open("/");
+	dir.rewindDirectory();
+	while (true) {
+		File entry = dir.openNextFile();
+		if (!entry)
+			break;
+		if (!entry.isDirectory() && hasExtension(entry.name(), "JPG")) {
+			if (total >= page * THUMB_PAGE && n < THUMB_PAGE) {
+				strncpy(thumbName[n], entry.name(), 12);
+				thumbName[n][12] = 0;
+				n++;
+			}
+			total++;
+		}
+		entry.close();
+	}
+	dir.close();
+	return n;
+}
+
+// Draw a page of the browser. Returns the number of previews on it.
+int thumbPage(int page, int &pages)
+{
+	int total;
+	int n = thumbList(page, total);
+	pages = (total + THUMB_PAGE - 1) / THUMB_PAGE;
+
+	Tft.fillScreen(ILI9341_BLACK);
+	btn_play.drawButton();
+	btn_next.drawButton();
+	Tft.drawRGBBitmap(303, 2, (uint16_t *)image_data_Cancel, 16, 16);
+	Tft.setTextSize(1);
+	Tft.setTextColor(ILI9341_WHITE, ILI9341_BLACK);
+	Tft.setCursor(120, 6);
+	Tft.print("Page ");
+	Tft.print(page + 1);
+	Tft.print("/");
+	Tft.print(pages ? pages : 1);
+
+	uint32_t start = HAL_GetTick();
+	for (int i = 0; i < n; i++) {
+		int cx = (i % THUMB_COLS) * THUMB_CELL_W;
+		int cy = THUMB_TOP + (i / THUMB_COLS) * THUMB_CELL_H;
+		if (!renderJPEGPreview(Tft, thumbName[i], cx + 2, cy + 2, THUMB_W, THUMB_H))
+			Tft.drawRect(cx + 2, cy + 2, THUMB_W, THUMB_H, ILI9341_DARKGREY);
+		Tft.setCursor(cx + 2, cy + THUMB_H + 6);
+		Tft.print(thumbName[i]);
+	}
+	UART_Printf("thumbs: page %d, %d previews in %lu ms\r\n", page + 1, n, HAL_GetTick() - start);
+	return n;
+}
+
+// Wait for a tap: press and release. Sets where it was pressed.
+void waitTap(int &x, int &y)
+{
+	while (TouchPressed()) ;
+	while (!TouchPressed()) ;
+	ts.read_coordinates(&x, &y);
+	while (TouchPressed()) ;
+}
+
+// Show the screen-sized part of a JPEG at full size from vx, vy. Only the
+// MCUs on screen are decoded, starting from the index's checkpoint for their
+// first row; the rest of those rows are just entropy decoded.
+void showPhotoAt(const char *name, const char *index, int vx, int vy)
+{
+#ifdef PHOTO_TIMING
+	uint32_t start = HAL_GetTick();
+#endif
+	JpegDec.setCrop(vx, vy, Tft.width(), Tft.height());
+	JpegDec.setIndexFile(index);
+	if (JpegDec.decodeSdFile(name) != 1)
+		return;
+	renderJPEG(Tft, -vx, -vy);
+#ifdef PHOTO_TIMING
+	UART_Printf("view: %d,%d in %lu ms\r\n", vx, vy, HAL_GetTick() - start);
+#endif
+}
+
+// Full screen view of a photo, fitted to the screen. Tap a photo bigger than
+// the screen to see it at full size around that point; then tap near an edge
+// to pan half a screen that way, or in the middle to go back.
+void viewPhoto(const char *name)
+{
+	int x, y;
+	int sw = Tft.width(), sh = Tft.height();
+
+	Tft.fillScreen(ILI9341_BLACK);
+	showPhoto(name);
+	waitTap(x, y);
+	uint8_t scale = JpegDec.decodedScale();
+	if (scale == JPEG_SCALE_1)
+		return;
+
+	// Where the tap was in the full size image (to within a pixel per scale
+	// step until it's decoded). Fitted photos are centred; the few still too
+	// big at 1/8 fill the screen's width or height.
+	int fw = JpegDec.width << scale, fh = JpegDec.height << scale;
+	int dw = JpegDec.width, dh = JpegDec.height;
+	if (dw > sw || dh > sh) {
+		dw = sw;
+		dh = (int32_t)fh * sw / fw;
+		if (dh > sh) {
+			dh = sh;
+			dw = (int32_t)fw * sh / fh;
+		}
+	}
+	int cx = (int32_t)(x - (sw - dw) / 2) * fw / dw;
+	int cy = (int32_t)(y - (sh - dh) / 2) * fh / dh;
+	int vx = cx - sw / 2, vy = cy - sh / 2;
+
+	// Indexed once, the first time it's viewed (an index that's up to date
+	// is kept), so panning costs the same anywhere in the photo
+	char index[13];
+	sidecarName(index, name, ".JIX");
+#ifdef PHOTO_TIMING
+	uint32_t start = HAL_GetTick();
+	if (JpegDec.indexSdFile(name, index) == 1)
+		UART_Printf("index: %s in %lu ms\r\n", index, HAL_GetTick() - start);
+#else
+	JpegDec.indexSdFile(name, index);
+#endif
+
+	Tft.fillScreen(ILI9341_BLACK);
+	for (;;) {
+		if (vx > fw - sw) vx = fw - sw;
+		if (vy > fh - sh) vy = fh - sh;
+		if (vx < 0) vx = 0;
+		if (vy < 0) vy = 0;
+		showPhotoAt(name, index, vx, vy);
+		fw = JpegDec.width;
+		fh = JpegDec.height;
+		waitTap(x, y);
+		if (x < sw / 3) vx -= sw / 2;
+		else if (x >= sw * 2 / 3) vx += sw / 2;
+		if (y < sh / 3) vy -= sh / 2;
+		else if (y >= sh * 2 / 3) vy += sh / 2;
+		if (x >= sw / 3 && x < sw * 2 / 3 && y >= sh / 3 && y < sh * 2 / 3)
+			return;
+	}
+}
+
+void slideshow()
+{
+	btn_exit.initButtonUL(&Tft, 303, 2, 16, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "", 8);
+	btn_play.initButtonUL(&Tft, 2, 2, 48, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "Play", 1);
+	btn_next.initButtonUL(&Tft, 54, 2, 48, 16, ILI9341_WHITE, ILI9341_BLUE, ILI9341_WHITE, "Next", 1);
+	mode = modeFoto;
+	int page = 0, pages;
+	int n = thumbPage(page, pages);
+	int x, y;
+	for (;;) {
+		waitTap(x, y);
+		if (getButtonNumber(x, y) == 11)
+			return;
+		if (btn_next.contains(x, y)) {
+			page = (page + 1 < pages) ? page + 1 : 0;
+		} else if (btn_play.contains(x, y)) {
+			Tft.fillScreen(ILI9341_BLACK);
+			if (slideshowPlay() == 11)
+				return;
+		} else if (y >= THUMB_TOP && x < THUMB_COLS * THUMB_CELL_W) {
+			int i = ((y - THUMB_TOP) / THUMB_CELL_H) * THUMB_COLS + x / THUMB_CELL_W;
+			if (i >= n)
+				continue;
+			viewPhoto(thumbName[i]);
+		} else {
+			continue;
+		}
+		n = thumbPage(page, pages);
+	}
 }
 
 
 #define BOXSIZE 40
 #define PENRADIUS 3
-int oldcolor, currentcolor, sc, v = 0, pv = 0, i = 0, j = 0;
-void bird(int n)
+
+// Game: the bird is a sprite pre-rendered from the primitives below and the
+// pipes are background drawn through the sprite layer, so a frame sends only
+// what moved, in one window per change (see Adafruit_Sprite.h). Physics runs
+// in fixed Q16 ticks (see GameLoop.h); speeds are per tick.
+#define GAME_TICK_HZ	60
+#define GAME_FPS	60
+#define GAME_GRAVITY	Q16(0.5)	// px / tick^2
+#define GAME_FLAP	Q16(-8)		// px / tick, set by a touch
+#define GAME_PIPE_V	Q16(-1)		// px / tick
+#define GAME_PIPE_X0	280			// Where a new pipe pair comes in
+#define GAME_SKY	ILI9341_CYAN
+#define GAME_PIPE	0xD78A
+#define BIRD_W		43				// Bounding box of bird() around its centre
+#define BIRD_H		37
+#define BIRD_CX		23
+#define BIRD_CY		18
+#define BIRD_KEY	ILI9341_MAGENTA	// Transparent, not used by the bird
+
+Adafruit_SpriteLayer layer(&Tft);
+uint16_t birdSave[BIRD_W * BIRD_H];	// Sky and pipes under the bird
+
+// Draw the bird centred on (x, y)
+void bird(Adafruit_GFX &gfx, int16_t x, int16_t y)
 {
-	Tft.fillCircle(Tft.width() / 3, Tft.height() / 2 - 45 + v, 18, ILI9341_YELLOW);
-	Tft.drawCircle(Tft.width() / 3, Tft.height() / 2 - 45 + v, 18, ILI9341_BLACK);
-	Tft.fillRect(Tft.width() / 3, Tft.height() / 2 - 40 + v, 20, 7, ILI9341_RED);
-	Tft.drawRect(Tft.width() / 3, Tft.height() / 2 - 40 + v, 20, 7, ILI9341_BLACK);
-	Tft.fillRect(Tft.width() / 3, Tft.height() / 2 - 37 + v, 20, 1, ILI9341_BLACK);
-	Tft.fillCircle(Tft.width() / 3 + 7, Tft.height() / 2 - 54 + v, 7, ILI9341_WHITE);
-	Tft.drawCircle(Tft.width() / 3 + 7, Tft.height() / 2 - 54 + v, 7, ILI9341_BLACK);
-	Tft.fillCircle(Tft.width() / 3 + 7, Tft.height() / 2 - 54 + v, 2, ILI9341_BLACK);
-	Tft.fillRect(Tft.width() / 3 - 23, Tft.height() / 2 - 45 + v, 18, 7, ILI9341_WHITE);
-	Tft.drawRect(Tft.width() / 3 - 23, Tft.height() / 2 - 45 + v, 18, 7, ILI9341_BLACK);
+	gfx.fillCircle(x, y, 18, ILI9341_YELLOW);
+	gfx.drawCircle(x, y, 18, ILI9341_BLACK);
+	gfx.fillRect(x, y + 5, 20, 7, ILI9341_RED);
+	gfx.drawRect(x, y + 5, 20, 7, ILI9341_BLACK);
+	gfx.fillRect(x, y + 8, 20, 1, ILI9341_BLACK);
+	gfx.fillCircle(x + 7, y - 9, 7, ILI9341_WHITE);
+	gfx.drawCircle(x + 7, y - 9, 7, ILI9341_BLACK);
+	gfx.fillCircle(x + 7, y - 9, 2, ILI9341_BLACK);
+	gfx.fillRect(x - 23, y, 18, 7, ILI9341_WHITE);
+	gfx.drawRect(x - 23, y, 18, 7, ILI9341_BLACK);
 }
-void birdcyan(int pv)
+
+// Both pipes at columns x .. x + w - 1, left of the bar excluded
+void pipes(int16_t x, int16_t w, uint16_t color)
 {
-	Tft.fillCircle(Tft.width() / 3, Tft.height() / 2 - 45 + pv, 18, ILI9341_CYAN);
-	Tft.drawCircle(Tft.width() / 3, Tft.height() / 2 - 45 + pv, 18, ILI9341_CYAN);
-	Tft.fillRect(Tft.width() / 3, Tft.height() / 2 - 40 + pv, 20, 7, ILI9341_CYAN);
-	Tft.drawRect(Tft.width() / 3, Tft.height() / 2 - 40 + pv, 20, 7, ILI9341_CYAN);
-	Tft.fillRect(Tft.width() / 3, Tft.height() / 2 - 37 + pv, 20, 1, ILI9341_CYAN);
-	Tft.fillCircle(Tft.width() / 3 + 7, Tft.height() / 2 - 54 + pv, 7, ILI9341_CYAN);
-	Tft.drawCircle(Tft.width() / 3 + 7, Tft.height() / 2 - 54 + pv, 7, ILI9341_CYAN);
-	Tft.fillCircle(Tft.width() / 3 + 7, Tft.height() / 2 - 54 + pv, 2, ILI9341_CYAN);
-	Tft.fillRect(Tft.width() / 3 - 23, Tft.height() / 2 - 45 + pv, 18, 7, ILI9341_CYAN);
-	Tft.drawRect(Tft.width() / 3 - 23, Tft.height() / 2 - 45 + pv, 18, 7, ILI9341_CYAN);
+	if (x < 20) {
+		w -= 20 - x;
+		x = 20;
+	}
+	layer.fillRect(x, 20, w, 50, color);
+	layer.fillRect(x, 165, w, 50, color);
 }
 
+// Bird offset v from its start height, pipe left edge x: over if the bird
+// leaves the screen or hits a pipe while passing it
+bool gameOver(int v, int x)
+{
+	return v >= 122 || v < -34 || (x < 106 && x > 70 && (57 + v < 73 || 93 + v > 165));
+}
 
-float a = 0.5;
 void Gameloop()
 {
-	while (true)
+	// Render the bird once, on the first game. The 3 KB of art can't come
+	// from the 2 KB heap, so the canvas draws into a static array.
+	static uint16_t birdPixels[BIRD_W * BIRD_H];
+	static GFXcanvas16 birdArt(BIRD_W, BIRD_H, birdPixels);
+	static Adafruit_Sprite birdSprite(birdArt.getBuffer(), BIRD_W, BIRD_H, BIRD_KEY, birdSave);
+	static bool rendered = false;
+	if (!rendered) {
+		birdArt.fillScreen(BIRD_KEY);
+		bird(birdArt, BIRD_CX, BIRD_CY);
+		layer.add(&birdSprite);
+		rendered = true;
+	}
+	int16_t birdX = Tft.width() / 3 - BIRD_CX, birdY = Tft.height() / 2 - 45 - BIRD_CY;
+
+	Q16Body fly = { 0, 0, 0 };
+	Q16Body pipe = { q16FromInt(GAME_PIPE_X0), 0, q16FromInt(GAME_PIPE_X0) };
+	int16_t shownX = GAME_PIPE_X0;
+	bool flap = false, over = false;
+
+	layer.fillScreen(GAME_SKY);
+	layer.fillRect(0, 0, 20, Tft.height(), GAME_PIPE);
+	pipes(shownX, 20, GAME_PIPE);
+	birdSprite.moveTo(birdX, birdY);
+	birdSprite.setVisible(true);
+	layer.update();
+	layer.resetStats();
+
+	GameLoop loop(GAME_TICK_HZ, GAME_FPS);
+	while (!over)
 	{
-	         
-		
-	
-
-
-
+		// A touch flaps on the next tick, held it keeps flapping
 		if (TouchPressed()) {
 			TSPoint p = ts.getPoint();
 			if (p.x > 0 && p.x<320 && p.y>0 && p.y < 240)
-			{
-
-				j = -8;
+				flap = true;
+		}
 
-			}
+		for (uint8_t n = loop.steps(); n && !over; n--) {
+			if (flap)
+				fly.vel = GAME_FLAP;
+			flap = false;
+			q16Step(fly, GAME_GRAVITY);
+			pipe.vel = GAME_PIPE_V;
+			q16Step(pipe, 0);
+			if (pipe.pos < q16FromInt(-2))
+				pipe.pos = pipe.prev = pipe.pos + q16FromInt(GAME_PIPE_X0 + 2);
+			over = gameOver(q16Round(fly.pos), q16Int(pipe.pos));
 		}
+		if (over)
+			break;
 
-		//for(int i=0;i<282;i++){
-
-  
-		Tft.fillRect(Tft.width() - 40 - (i * 2), 20, 20, 50, 0xD78A);
-		Tft.fillRect(Tft.width() - 40 - (i * 2), 165, 20, 50, 0xD78A);
-   
-		Tft.fillRect(Tft.width() - 20 - (i * 2), 20, 20, 50, ILI9341_CYAN);
-		Tft.fillRect(Tft.width() - 20 - (i * 2), 165, 20, 50, ILI9341_CYAN);
-   
-		//delay(1);
-		Tft.fillRect(0, 0, 20, Tft.height(), 0xD78A);
-		//for(int i1=0;i1<4;i1++){
-		 pv = v;
-		v = v + (4*a*j);
-		birdcyan(pv);
-		bird(v);
-		j++;
-		// }
-		  i++;
-   
-		//Serial.println(v);
-		//Serial.println(p.x);
-		//Serial.print(" \t    ");
-		//Serial.print(p.y);
-		  if(i == 141 &&(v <= 120 || v > -34 || (280 - (2*i)<106 && 280 - (2*i)>70 && 57 + v>73 && 93 + v < 165)))
-		  i = 0;
-		else if((v >= 122   || v < (-34) || (280 - (2*i)<106 && 280 - (2*i)>70 &&(57 + v<73 || 93 + v>165))  && i < 143))
-		{
-			Tft.fillScreen(ILI9341_CYAN);
-			Tft.setCursor(Tft.width() / 3 + 36, Tft.height() / 2);
-			Tft.setTextSize(3);
-			Tft.println("Game over");
-			//Serial.println("Game over");
-			i = 500;
+		// Draw where things are between the last two ticks. Pipes only
+		// change at their leading and trailing columns; a new pair comes
+		// in whole and the old one is cleared.
+		q16_t t = loop.alpha();
+		int16_t x = q16Round(q16At(pipe, t));
+		if (x > shownX) {
+			pipes(shownX, 20, GAME_SKY);
+			pipes(x, 20, GAME_PIPE);
+		}
+		else if (x < shownX) {
+			int16_t d = minimum(shownX - x, 20);
+			pipes(x, d, GAME_PIPE);
+			pipes(shownX + 20 - d, d, GAME_SKY);
 		}
-		else {}//a=0.4;
-		//}
+		shownX = x;
+		birdSprite.moveTo(birdX, birdY + q16Round(q16At(fly, t)));
+		layer.update();
+		layer.endFrame();
+		loop.endFrame();
+	}
+
+	UART_Printf("game: %lu ticks (%lu dropped), %lu frames (%lu late), work %lu/%lu/%lu ms min/avg/max, peak %lu of %lu SPI bytes/frame\r\n",
+		loop.ticks(), loop.dropped(), loop.frames(), loop.late(),
+		loop.frameMin(), loop.frameAvg(), loop.frameMax(),
+		layer.peakBytes(), Adafruit_SpriteLayer::budget(GAME_FPS));
+	birdSprite.setVisible(false);
+	layer.update();
+	layer.fillScreen(GAME_SKY);
+	Tft.setCursor(Tft.width() / 3 + 36, Tft.height() / 2);
+	Tft.setTextSize(3);
+	Tft.println("Game over");
+
+	// Back to the menu on a fresh touch
+	while (TouchPressed()) ;
+	while (!TouchPressed()) ;
+}
+
+// Paint area saved to / restored from buffer.bin: RGB565 rows, high byte
+// first as the panel takes them (the file format has always been
+// big-endian). Moved PAD_ROWS rows at a time, one RAMRD or RAMWR each.
+#define PAD_X	16
+#define PAD_W	288
+#define PAD_H	240
+#define PAD_ROWS	4
+uint16_t buffer[PAD_W * PAD_ROWS];
+
+// Native RGB565 <-> file byte order, in place
+static void swapPixels(uint16_t *p, uint32_t n)
+{
+	while (n--)
+	{
+		*p = (*p >> 8) | (*p << 8);
+		p++;
 	}
-  
 }
 
-char buffer[512];
 void save()
 {
 	if (SD.exists("buffer.bin"))
 	{
 		SD.remove("buffer.bin");
 	}
-	char buf[2];
 	File myFile = SD.open("buffer.bin", FILE_WRITE);
 	if (myFile) {
-
-		uint16_t mcu_w = 16;
-		uint16_t mcu_h = 16;
-		uint32_t max_x = 288;
-		uint32_t max_y = 240;
-		
-		uint32_t min_w = minimum(mcu_w, max_x % mcu_w);
-		uint32_t min_h = minimum(mcu_h, max_y % mcu_h);
-		
-		uint32_t win_w = mcu_w;
-		uint32_t win_h = mcu_h;
-		
-		max_x += 16;
-		max_y += 0;
-		
-		for (uint8_t y_block = 0; y_block < 185; y_block++)
+		for (int y = 0; y < PAD_H; y += PAD_ROWS)
 		{
-			for (uint8_t x_block = 0; x_block < 18; x_block++) {
-
-
-				// calculate where the image block should be drawn on the screen
-				int mcu_x = x_block * 16 + 16;
-				int mcu_y = y_block * 16 + 0;
-
-				// check if the image block size needs to be changed for the right and bottom edges
-				if(mcu_x + mcu_w <= max_x) win_w = mcu_w;
-				else win_w = min_w;
-				if (mcu_y + mcu_h <= max_y) win_h = mcu_h;
-				else win_h = min_h;
-
-				// calculate how many pixels must be drawn
-				uint32_t mcu_pixels = win_w * win_h;
-
-				// draw image block if it will fit on the screen
-		
-				if((mcu_x + win_w) <= ILI9341_WIDTH && (mcu_y + win_h) <= ILI9341_HEIGHT) {
-					// open a window onto the screen to paint the pixels into
-					//TFTscreen.setAddrWindow(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1);
-			
-					Tft.setAddrBlock(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1, 1);
-					Tft.readMemory(buffer, mcu_pixels);
-					uint16_t index = 0;
-					
-					while (mcu_pixels--)
-					{
-						uint16_t color = buffer[index++];
-						buf[0] = color & 0x00FF;
-						buf[1] = color >> 8 & 0x00FF;
-						myFile.write(buf, 2);
-					}
-				
-				}
-
-				// stop drawing blocks if the bottom of the screen has been reached
-				// the abort function will close the file
-				else if((mcu_y + win_h) >= ILI9341_HEIGHT) break;
-
-			}
+			Tft.readRect(PAD_X, y, PAD_W, PAD_ROWS, buffer);
+			swapPixels(buffer, PAD_W * PAD_ROWS);
+			myFile.write((const uint8_t *)buffer, sizeof(buffer));
 		}
 		
-		
-		
-		
 		// close the file:
 		myFile.close();
 		UART_Printf("done.");
@@ -527,77 +854,21 @@ void save()
 		// if the file didn't open, print an error:
 		UART_Printf("error opening test.txt");
 	}
-	
-	
-	
 }
 
 void load()
 {
 	File myFile = SD.open("buffer.bin", FILE_READ);
 	if (myFile) {
-		uint16_t mcu_w = 16;
-		uint16_t mcu_h = 16;
-		uint32_t max_x = 288;
-		uint32_t max_y = 240;
-		
-		uint32_t min_w = minimum(mcu_w, max_x % mcu_w);
-		uint32_t min_h = minimum(mcu_h, max_y % mcu_h);
-		
-		uint32_t win_w = mcu_w;
-		uint32_t win_h = mcu_h;
-		
-		max_x += 16;
-		max_y += 0;
 		Tft.startWrite();
-		for (uint8_t y_block = 0; y_block < 185; y_block++)
+		for (int y = 0; y < PAD_H; y += PAD_ROWS)
 		{
-			for (uint8_t x_block = 0; x_block < 18; x_block++) {
-
-
-				// calculate where the image block should be drawn on the screen
-				int mcu_x = x_block * 16 + 16;
-				int mcu_y = y_block * 16 + 0;
-
-				// check if the image block size needs to be changed for the right and bottom edges
-				if(mcu_x + mcu_w <= max_x) win_w = mcu_w;
-				else win_w = min_w;
-				if (mcu_y + mcu_h <= max_y) win_h = mcu_h;
-				else win_h = min_h;
-
-				// calculate how many pixels must be drawn
-				uint32_t mcu_pixels = win_w * win_h;
-
-				// draw image block if it will fit on the screen
-		
-				if((mcu_x + win_w) <= ILI9341_WIDTH && (mcu_y + win_h) <= ILI9341_HEIGHT) {
-					// open a window onto the screen to paint the pixels into
-					//TFTscreen.setAddrWindow(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1);
-			
-					myFile.read(buffer, mcu_pixels);
-					
-					Tft.setAddrBlock(mcu_x, mcu_y, mcu_x + win_w - 1, mcu_y + win_h - 1, 0);
-					
-					int i = 0;
-					while (mcu_pixels--) {
-						uint16_t co = buffer[i++]  + buffer[i++] << 8 & 0xFF00;
-						Tft.pushColor(co);
-						//Tft.spiWrite(buffer[i++]);
-						//Tft.WriteData((uint8_t*)buffer, mcu_pixels);
-					}
-					i += 1;  //dummy
-				}
-
-				// stop drawing blocks if the bottom of the screen has been reached
-				// the abort function will close the file
-				else if((mcu_y + win_h) >= ILI9341_HEIGHT) goto exit;
-
-			}
-			Tft.endWrite();
+			if (myFile.read(buffer, sizeof(buffer)) != sizeof(buffer)) break;
+			swapPixels(buffer, PAD_W * PAD_ROWS);
+			Tft.setAddrWindow(PAD_X, y, PAD_W, PAD_ROWS);
+			Tft.writePixels(buffer, PAD_W * PAD_ROWS);
 		}
-exit:		
-		
-		
+		Tft.endWrite();
 		
 		// close the file:
 		myFile.close();
@@ -630,17 +901,9 @@ int main(void)
 	MX_SPI3_Init();
 	MX_UART5_Init();
 	
-	Tft.begin();
-	Tft.setRotation(3);
-	ts.init(3);
+	bootBegin();
 	//End initialization
-	UART_Printf("Initializing SD card...");
-
-	if (!SD.begin(4)) {
-		UART_Printf("initialization failed!");
-		while (1) ;
-	}
-	UART_Printf("initialization done.");
+	initMenus();
 	while (1)
 	{
 		switch (modeSelMenu())
@@ -954,45 +1217,17 @@ void UART_Printf(const char* fmt, ...) {
 		(uint8_t*)buff,
 		strlen(buff),
 		HAL_MAX_DELAY);
+	console.print(buff);   // No-op unless the console is running
 	va_end(args);
 }
 
 // Gets which button was pressed.  If no button is pressed, -1 is returned.
 int getButtonNumber(int xInput, int yInput)
 {
-	if (mode == modeMain)
+	if (mode == modeMain || mode == modePaint)
 	{
-		if (btn_s1.isPressed(xInput, yInput)) {
-			return 1; // Signifies big button was pressed
-		}
-		if (btn_s2.isPressed(xInput, yInput)) {
-			return 2; // Signifies big button was pressed
-		}
-		if (btn_s3.isPressed(xInput, yInput)) {
-			return 3; // Signifies big button was pressed
-		}
-		if (btn_s4.isPressed(xInput, yInput)) {
-			return 4; // Signifies big button was pressed
-		}
-	}
-	if (mode == modePaint)
-	{
-		for (int i = 0; i < 10; i++) {
-			if (buttons[i].isPressed(xInput, yInput)) 
-				return i; // Returns the button number that was pressed
-		}
-		if (btn_exit.isPressed(xInput, yInput)) {
-			return 11; // Signifies big button was pressed
-		}
-		if (btn_clear.isPressed(xInput, yInput)) {
-			return 12; // Signifies big button was pressed
-		}
-		if (btn_save.isPressed(xInput, yInput)) {
-			return 13; // Signifies big button was pressed
-		}
-		if (btn_load.isPressed(xInput, yInput)) {
-			return 14; // Signifies big button was pressed
-		}
+		Adafruit_Widget *w = screen.hit(xInput, yInput);
+		return w ? w->id() : -1;
 	}
 	if (mode == modeFoto)
 	{
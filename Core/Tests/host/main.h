@@ -0,0 +1,9 @@
+#ifndef __MAIN_H
+#define __MAIN_H
+#include <stdint.h>
+
+// Stand-in for Core/Inc/main.h on a PC: the only HAL call the tested
+// sources make is HAL_GetTick(), which the test drives.
+uint32_t HAL_GetTick(void);
+
+#endif
@@ -0,0 +1,182 @@
+// GameLoop on a PC: the Q16.16 helpers against exact values, the tick
+// accounting against the clock, and a game's state after N ticks, which
+// must not depend on how long the frames took to draw.
+
+#include <stdio.h>
+#include <string.h>
+#include "GameLoop.h"
+
+#define TICKS	6000		// 100 s of game at 60 Hz
+
+static int failures = 0;
+
+#define CHECK(cond) \
+	do { \
+		if (!(cond)) { \
+			printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+			failures++; \
+		} \
+	} while (0)
+
+// Simulated clock; it moves on by fakeStep ms every read so the busy-wait
+// in endFrame() ends
+static uint32_t fakeTick, fakeStep;
+
+uint32_t HAL_GetTick(void)
+{
+	uint32_t t = fakeTick;
+	fakeTick += fakeStep;
+	return t;
+}
+
+static uint32_t seed;
+
+static uint32_t lcg(uint32_t n)
+{
+	seed = seed * 1103515245UL + 12345UL;
+	return (seed >> 16) % n;
+}
+
+static void testQ16()
+{
+	CHECK(Q16(0.5) == 32768);
+	CHECK(Q16(-8) == -524288);
+	CHECK(Q16(-0.25) == -16384);
+	CHECK(Q16(1.0 / 3) == 21845);
+	CHECK(q16FromInt(-3) == -3 * Q16_ONE);
+	CHECK(q16Int(Q16(2.75)) == 2);
+	CHECK(q16Int(Q16(-2.5)) == -3);
+	CHECK(q16Round(Q16(2.5)) == 3);
+	CHECK(q16Round(Q16(-2.5)) == -2);
+	CHECK(q16Round(Q16(-2.75)) == -3);
+	CHECK(q16Mul(Q16(1.5), Q16(-2.25)) == Q16(-3.375));
+	CHECK(q16Mul(Q16(150), Q16(-200)) == Q16(-30000));
+	CHECK(q16Div(Q16(3), Q16(-4)) == Q16(-0.75));
+	CHECK(q16Div(Q16(1), Q16(3)) == 21845);
+	CHECK(q16Lerp(Q16(-4), Q16(12), Q16(0.25)) == Q16(0));
+	CHECK(q16Lerp(Q16(5), Q16(9), 0) == Q16(5));
+	CHECK(q16Lerp(Q16(5), Q16(9), Q16_ONE) == Q16(9));
+
+	// Semi-implicit Euler: v += a, then x += v
+	Q16Body b = { Q16(10), Q16(-2), 0 };
+	q16Step(b, Q16(0.5));
+	CHECK(b.vel == Q16(-1.5) && b.pos == Q16(8.5) && b.prev == Q16(10));
+	CHECK(q16At(b, Q16(0.5)) == Q16(9.25));
+}
+
+// Every tick of elapsed time is run or counted as dropped, and alpha()
+// stays inside a tick
+static void testTicks(uint16_t hz, uint32_t maxGap)
+{
+	fakeTick = 5000;
+	fakeStep = 0;
+	seed = hz;
+	GameLoop loop(hz);
+	uint32_t run = 0;
+	bool alphaOk = true;
+	for (int i = 0; i < 20000; i++) {
+		fakeTick += lcg(maxGap + 1);
+		run += loop.steps();
+		if (loop.alpha() < 0 || loop.alpha() >= Q16_ONE)
+			alphaOk = false;
+	}
+	uint64_t due = (uint64_t)(fakeTick - 5000) * hz / 1000;
+	printf("%u Hz, 0-%u ms passes: %u ticks run, %u dropped, %llu due\n",
+		hz, maxGap, run, loop.dropped(), (unsigned long long)due);
+	CHECK(run == loop.ticks());
+	CHECK(run + loop.dropped() == due);
+	CHECK(alphaOk);
+}
+
+// A flappy body: a flap every 37 ticks, gravity, wrapping at the bottom.
+// Returns a hash of the position after every tick.
+static uint32_t play(GameLoop &loop, uint32_t drawMin, uint32_t drawMax,
+	uint32_t *trace)
+{
+	Q16Body fly = { 0, 0, 0 };
+	uint32_t t = 0, hash = 0;
+
+	fakeTick = 1000;
+	fakeStep = 1;
+	seed = drawMin * 1000 + drawMax;
+	loop.begin();
+	while (t < TICKS) {
+		for (uint8_t n = loop.steps(); n && t < TICKS; n--, t++) {
+			if (t % 37 == 0)
+				fly.vel = Q16(-8);
+			q16Step(fly, Q16(0.5));
+			if (fly.pos > Q16(100))
+				fly.pos -= Q16(200);
+			trace[t] = fly.pos;
+			hash = hash * 31 + fly.pos;
+		}
+		fakeTick += drawMin + lcg(drawMax - drawMin + 1);
+		loop.endFrame();
+	}
+	return hash;
+}
+
+static void testDeterminism()
+{
+	static uint32_t ref[TICKS], trace[TICKS];
+	static const struct { uint16_t fps; uint32_t lo, hi; } runs[] = {
+		{ 0, 1, 3 }, { 0, 5, 45 }, { 30, 2, 20 }, { 60, 10, 30 },
+		{ 0, 80, 120 },		// Stalls past GAME_MAX_STEPS ticks
+	};
+
+	GameLoop first(60);
+	uint32_t refHash = play(first, 0, 0, ref);
+	for (uint8_t i = 0; i < sizeof(runs) / sizeof(runs[0]); i++) {
+		GameLoop loop(60, runs[i].fps);
+		uint32_t hash = play(loop, runs[i].lo, runs[i].hi, trace);
+		printf("%2u fps cap, %3u-%3u ms frames: %5u frames, %4u dropped, "
+			"state %08x %s\n", runs[i].fps, runs[i].lo, runs[i].hi,
+			loop.frames(), loop.dropped(), hash,
+			memcmp(ref, trace, sizeof(ref)) ? "differs" : "same");
+		CHECK(hash == refHash);
+		CHECK(memcmp(ref, trace, sizeof(ref)) == 0);
+		CHECK((loop.dropped() != 0) == (runs[i].hi * 60 > GAME_MAX_STEPS * 1000));
+	}
+}
+
+// The cap paces frames without losing any when the work fits the slot
+static void testFrameCap()
+{
+	fakeTick = 0;
+	fakeStep = 1;
+	GameLoop loop(60, 30);
+	while (fakeTick < 3000) {
+		loop.steps();
+		fakeTick += 5;
+		loop.endFrame();
+	}
+	printf("30 fps cap, 5 ms frames: %u frames in 3 s, %u late, "
+		"work %u-%u ms\n", loop.frames(), loop.late(), loop.frameMin(),
+		loop.frameMax());
+	CHECK(loop.frames() >= 89 && loop.frames() <= 91);
+	CHECK(loop.late() == 0);
+
+	loop.begin();
+	uint32_t start = fakeTick;
+	while (fakeTick - start < 3000) {
+		loop.steps();
+		fakeTick += 50;
+		loop.endFrame();
+	}
+	printf("30 fps cap, 50 ms frames: %u frames, %u late\n", loop.frames(),
+		loop.late());
+	CHECK(loop.late() == loop.frames());
+}
+
+int main()
+{
+	testQ16();
+	testTicks(60, 20);
+	testTicks(60, 200);
+	testTicks(50, 7);
+	testTicks(1000, 3);
+	testDeterminism();
+	testFrameCap();
+	printf("test_gameloop: %s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
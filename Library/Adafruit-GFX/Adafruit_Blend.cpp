@@ -0,0 +1,139 @@
+/*!
+ * @file Adafruit_Blend.cpp
+ *
+ * RGB565 blend kernels. See Adafruit_Blend.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_Blend.h"
+
+// A pixel pair p0 | p1 << 16 splits into two words of three fields each,
+// spaced so a field times a (<= 32) can't reach the next one:
+//   even = w & BLEND_EVEN:         B0 0-4,  R0 11-15, G1 21-26
+//   odd  = (w >> 5) & BLEND_ODD:   G0 0-5,  B1 11-15, R1 22-26
+#define BLEND_EVEN 0x07E0F81FUL ///< Fields of a pair left in place
+#define BLEND_ODD  0x07C0F83FUL ///< Fields of a pair shifted down 5
+#define BLEND_AVG  0xF7DEF7DEUL ///< All but each field's lowest bit
+
+/*!
+    @brief   Round 8-bit alpha to the 0..32 weight the kernels use.
+    @param   alpha  0 (all background) to 255 (all foreground).
+    @return  Weight.
+*/
+static inline uint32_t blendWeight(uint8_t alpha) {
+    return ((uint32_t)alpha + 4) >> 3;
+}
+
+/*!
+    @brief   Load two pixels as one word, p[0] in the low half.
+    @param   p  Pixels; any 16-bit alignment.
+    @return  Pair.
+*/
+static inline uint32_t blendLoad(const uint16_t *p) {
+    uint32_t w;
+    memcpy(&w, p, 4); // One LDR on Cortex-M (unaligned is allowed)
+    return w;
+}
+
+/*!
+    @brief   Store a pair loaded with blendLoad().
+    @param   p  Pixels.
+    @param   w  Pair.
+*/
+static inline void blendStore(uint16_t *p, uint32_t w) {
+    memcpy(p, &w, 4);
+}
+
+/*!
+    @brief   Blend a pixel pair.
+    @param   f   Foreground pair.
+    @param   b   Background pair.
+    @param   a   Weight of f, 0..32.
+    @return  Blended pair.
+*/
+static inline uint32_t blendPair(uint32_t f, uint32_t b, uint32_t a) {
+    uint32_t na = 32 - a,
+             e  = (((f & BLEND_EVEN) * a +
+                    (b & BLEND_EVEN) * na) >> 5) & BLEND_EVEN,
+             o  = ((((f >> 5) & BLEND_ODD) * a +
+                    ((b >> 5) & BLEND_ODD) * na) >> 5) & BLEND_ODD;
+    return e | (o << 5);
+}
+
+/*!
+    @brief   Blend one pixel.
+    @param   fg     Foreground color.
+    @param   bg     Background color.
+    @param   alpha  Opacity of fg, 0..255.
+    @return  Blended color.
+*/
+uint16_t rgb565Blend(uint16_t fg, uint16_t bg, uint8_t alpha) {
+    return (uint16_t)blendPair(fg, bg, blendWeight(alpha));
+}
+
+/*!
+    @brief   Draw a row translucently over another: dst = src over dst.
+    @param   dst    Background pixels, overwritten with the result.
+    @param   src    Foreground pixels.
+    @param   n      Pixel count.
+    @param   alpha  Opacity of src, 0..255.
+*/
+void rgb565BlendRow(uint16_t *dst, const uint16_t *src, uint32_t n,
+  uint8_t alpha) {
+    uint32_t a = blendWeight(alpha);
+    for(; n >= 2; n -= 2, dst += 2, src += 2)
+        blendStore(dst, blendPair(blendLoad(src), blendLoad(dst), a));
+    if(n) *dst = (uint16_t)blendPair(*src, *dst, a);
+}
+
+/*!
+    @brief   Fade a row toward one color, e.g. to dim what's behind a
+             dialog. The color's share is multiplied out once per row.
+    @param   dst    Pixels, faded in place.
+    @param   n      Pixel count.
+    @param   color  Color faded to.
+    @param   alpha  Amount of color, 0..255.
+*/
+void rgb565FadeRow(uint16_t *dst, uint32_t n, uint16_t color,
+  uint8_t alpha) {
+    uint32_t a  = blendWeight(alpha), na = 32 - a,
+             c  = color | ((uint32_t)color << 16),
+             ce = (c & BLEND_EVEN) * a,
+             co = ((c >> 5) & BLEND_ODD) * a;
+    for(; n; ) {
+        uint32_t w = (n >= 2) ? blendLoad(dst) : *dst,
+                 e = (((w & BLEND_EVEN) * na + ce) >> 5) & BLEND_EVEN,
+                 o = ((((w >> 5) & BLEND_ODD) * na + co) >> 5) & BLEND_ODD;
+        w = e | (o << 5);
+        if(n >= 2) {
+            blendStore(dst, w);
+            dst += 2;
+            n   -= 2;
+        } else {
+            *dst = (uint16_t)w;
+            n    = 0;
+        }
+    }
+}
+
+/*!
+    @brief   50% mix of two rows, e.g. the middle frame of a cross-fade.
+             Each channel is (a + b) >> 1, computed without a multiply:
+             the shared bits plus half the differing ones, with each
+             field's lowest bit masked so nothing shifts into the field
+             below.
+    @param   dst  Result; may be a or b.
+    @param   a    First row.
+    @param   b    Second row.
+    @param   n    Pixel count.
+*/
+void rgb565AverageRow(uint16_t *dst, const uint16_t *a, const uint16_t *b,
+  uint32_t n) {
+    for(; n >= 2; n -= 2, dst += 2, a += 2, b += 2) {
+        uint32_t x = blendLoad(a), y = blendLoad(b);
+        blendStore(dst, (x & y) + (((x ^ y) & BLEND_AVG) >> 1));
+    }
+    if(n) *dst = (*a & *b) + (((*a ^ *b) & BLEND_AVG) >> 1);
+}
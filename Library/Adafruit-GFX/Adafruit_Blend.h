@@ -0,0 +1,32 @@
+/*!
+ * @file Adafruit_Blend.h
+ *
+ * RGB565 blend, fade-to-color and 50% average kernels for translucent
+ * overlays (dimming, cross-fades) on canvases and pixel rows. Rows are
+ * processed two pixels per 32-bit word: the six color fields of a pixel
+ * pair are split over two words with room for a product above each
+ * field, so a whole word is weighted with one multiply and nothing is
+ * unpacked to 8-bit channels.
+ *
+ * Pixels are native RGB565 (as drawn into a GFXcanvas16, not byte-swapped
+ * for the display). Blends weigh in 33 steps: alpha 0..255 is rounded to
+ * a = 0..32 and each channel is (fg * a + bg * (32 - a)) >> 5, so alpha 0
+ * gives bg and 255 gives fg exactly.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_BLEND_H_
+#define _ADAFRUIT_BLEND_H_
+
+#include <stdint.h>
+
+uint16_t rgb565Blend(uint16_t fg, uint16_t bg, uint8_t alpha);
+void     rgb565BlendRow(uint16_t *dst, const uint16_t *src, uint32_t n,
+           uint8_t alpha);
+void     rgb565FadeRow(uint16_t *dst, uint32_t n, uint16_t color,
+           uint8_t alpha);
+void     rgb565AverageRow(uint16_t *dst, const uint16_t *a,
+           const uint16_t *b, uint32_t n);
+
+#endif // _ADAFRUIT_BLEND_H_
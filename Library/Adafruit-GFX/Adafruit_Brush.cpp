@@ -0,0 +1,255 @@
+/*!
+ * @file Adafruit_Brush.cpp
+ *
+ * Stroke brush for freehand drawing. See Adafruit_Brush.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <stdlib.h>
+#include "Adafruit_Brush.h"
+
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define BRUSH_EMPTY_MIN  32767  ///< _xmin of a row with no span
+#define BRUSH_EMPTY_MAX -32768  ///< _xmax of a row with no span
+
+/*!
+    @brief  Adafruit_Brush constructor. Strokes are clipped to the display
+            until setClip() is called.
+    @param  gfx     Display to draw on.
+    @param  radius  Brush radius, see setSize().
+    @param  shape   BRUSH_ROUND, BRUSH_SQUARE or BRUSH_DIAMOND.
+    @param  color   Stroke color.
+*/
+Adafruit_Brush::Adafruit_Brush(Adafruit_GFX *gfx, uint8_t radius,
+  uint8_t shape, uint16_t color) :
+  _gfx(gfx), _x(0), _y(0), _cx0(0), _cy0(0), _cx1(0), _cy1(0), _top(0),
+  _lo(BRUSH_ROWS), _hi(-1), _color(color), _radius(0), _shape(shape),
+  _down(false), _clip(false), _joint(false), _jx(0), _jy(0) {
+    for(int16_t i=0; i<BRUSH_ROWS; i++) {
+        _xmin[i] = BRUSH_EMPTY_MIN;
+        _xmax[i] = BRUSH_EMPTY_MAX;
+    }
+    setSize(radius);
+}
+
+/*!
+    @brief  Set the brush radius. The brush covers 2 * radius + 1 rows.
+    @param  radius  Radius in pixels, 0 for a single pixel; clamped to
+                    BRUSH_MAX_RADIUS.
+*/
+void Adafruit_Brush::setSize(uint8_t radius) {
+    _radius = min(radius, BRUSH_MAX_RADIUS);
+    profile();
+}
+
+/*!
+    @brief  Set the brush shape.
+    @param  shape  BRUSH_ROUND, BRUSH_SQUARE or BRUSH_DIAMOND; anything
+                   else is treated as BRUSH_ROUND.
+*/
+void Adafruit_Brush::setShape(uint8_t shape) {
+    _shape = shape;
+    profile();
+}
+
+/*!
+    @brief  Confine strokes to a rectangle, e.g. the drawing area of a
+            paint screen.
+    @param  x  Left edge.
+    @param  y  Top edge.
+    @param  w  Width.
+    @param  h  Height.
+*/
+void Adafruit_Brush::setClip(int16_t x, int16_t y, int16_t w, int16_t h) {
+    _cx0  = x;
+    _cy0  = y;
+    _cx1  = x + w;
+    _cy1  = y + h;
+    _clip = true;
+}
+
+/*!
+    @brief  Remove the setClip() rectangle; strokes are clipped to the
+            display only.
+*/
+void Adafruit_Brush::clearClip(void) {
+    _clip = false;
+}
+
+/*!
+    @brief  Put the pen down: start a stroke with a single dab.
+    @param  x  Pen x.
+    @param  y  Pen y.
+*/
+void Adafruit_Brush::moveTo(int16_t x, int16_t y) {
+    _x    = x;
+    _y    = y;
+    _down = true;
+    _top  = y - _radius;
+    _joint = false;
+    _gfx->startWrite();
+    stamp(x, y);
+    flush();
+    _gfx->endWrite();
+}
+
+/*!
+    @brief  Continue the stroke to a new pen position, filling everything
+            the brush sweeps over on the way. The brush at the previous
+            position was drawn by the previous call and isn't sent again.
+            Starts a new stroke if the pen is up.
+    @param  x  Pen x.
+    @param  y  Pen y.
+*/
+void Adafruit_Brush::lineTo(int16_t x, int16_t y) {
+    if(!_down) {
+        moveTo(x, y);
+        return;
+    }
+
+    int16_t x0 = _x, y0 = _y;
+    _x = x;
+    _y = y;
+    if((x0 == x) && (y0 == y)) return;
+
+    // Stamp every pixel of the centre line (Bresenham). The table covers
+    // BRUSH_ROWS rows from _top, placed ahead of the pen in the direction
+    // it moves; a segment taller than that is flushed in parts.
+    int16_t dx = abs(x - x0), sx = (x0 < x) ? 1 : -1;
+    int16_t dy = -abs(y - y0), sy = (y0 < y) ? 1 : -1;
+    int16_t err = dx + dy, r = _radius;
+
+    _gfx->startWrite();
+    _jx    = x0;
+    _jy    = y0;
+    _joint = true;
+    _top = (sy > 0) ? y0 - r : y0 + r - BRUSH_ROWS + 1;
+    while((x0 != x) || (y0 != y)) {
+        int16_t e2 = 2 * err;
+        if(e2 >= dy) { err += dy; x0 += sx; }
+        if(e2 <= dx) { err += dx; y0 += sy; }
+        if((y0 - r < _top) || (y0 + r >= _top + BRUSH_ROWS)) {
+            flush();
+            _top = (sy > 0) ? y0 - r : y0 + r - BRUSH_ROWS + 1;
+        }
+        stamp(x0, y0);
+    }
+    flush();
+    _gfx->endWrite();
+}
+
+/*!
+    @brief  Build the half-width table of the brush shape: _hw[d] is how
+            far the brush reaches left and right of its centre on the row
+            d above or below it.
+*/
+void Adafruit_Brush::profile(void) {
+    int16_t r = _radius;
+    for(int16_t d=0; d<=r; d++) {
+        _hw[d] = (_shape == BRUSH_SQUARE) ? r :
+                 (_shape == BRUSH_DIAMOND) ? r - d : 0;
+    }
+    if((_shape == BRUSH_SQUARE) || (_shape == BRUSH_DIAMOND)) return;
+
+    // Round: the same midpoint walk as fillCircleHelper(), so a dab is
+    // exactly a fillCircle(). Column +-dx covers rows +-hh; widen every
+    // row it reaches.
+    int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r,
+            px = x, py = y;
+    while(x < y) {
+        if(f >= 0) {
+            y--;
+            ddF_y += 2;
+            f     += ddF_y;
+        }
+        x++;
+        ddF_x += 2;
+        f     += ddF_x;
+        if(x < (y + 1)) {
+            for(int16_t d=0; d<=y; d++) if(_hw[d] < x) _hw[d] = x;
+        }
+        if(y != py) {
+            for(int16_t d=0; d<=px; d++) if(_hw[d] < py) _hw[d] = py;
+            py = y;
+        }
+        px = x;
+    }
+}
+
+/*!
+    @brief  Add the brush at one centre position to the span table.
+    @param  x  Centre x.
+    @param  y  Centre y, within the rows the table covers.
+*/
+void Adafruit_Brush::stamp(int16_t x, int16_t y) {
+    int16_t r = _radius, row = y - r - _top;
+    for(int16_t d=-r; d<=r; d++, row++) {
+        uint8_t hw = _hw[abs(d)];
+        if(x - hw < _xmin[row]) _xmin[row] = x - hw;
+        if(x + hw > _xmax[row]) _xmax[row] = x + hw;
+    }
+    if(y - r - _top < _lo) _lo = y - r - _top;
+    if(y + r - _top > _hi) _hi = y + r - _top;
+}
+
+/*!
+    @brief  Draw the span table and empty it. Spans are clipped and
+            trimmed of what the brush at the joint (the previous pen
+            position) already painted, and runs of rows with the same span
+            go out as one rectangle.
+*/
+void Adafruit_Brush::flush(void) {
+    int16_t cx0 = 0, cy0 = 0,
+            cx1 = _gfx->width(), cy1 = _gfx->height();
+    if(_clip) {
+        cx0 = max(cx0, _cx0);
+        cy0 = max(cy0, _cy0);
+        cx1 = min(cx1, _cx1);
+        cy1 = min(cy1, _cy1);
+    }
+
+    int16_t runY = 0, runH = 0, runX0 = 0, runX1 = 0;
+    for(int16_t row=_lo; row<=_hi + 1; row++) {
+        int16_t a = 0, b = -1, y = _top + row;
+        if(row <= _hi) {
+            if((y >= cy0) && (y < cy1)) {
+                a = max(_xmin[row], cx0);
+                b = min(_xmax[row], cx1 - 1);
+            }
+            if(_joint && (abs(y - _jy) <= _radius) && (a <= b)) {
+                int16_t hw = _hw[abs(y - _jy)],
+                        ja = _jx - hw, jb = _jx + hw;
+                if((a >= ja) && (b <= jb))          b = a - 1;
+                else if((a >= ja) && (a <= jb + 1)) a = jb + 1;
+                else if((b <= jb) && (b >= ja - 1)) b = ja - 1;
+            }
+            _xmin[row] = BRUSH_EMPTY_MIN;
+            _xmax[row] = BRUSH_EMPTY_MAX;
+        }
+        if(runH && ((a > b) || (a != runX0) || (b != runX1))) {
+            if(runH == 1) _gfx->writeFastHLine(runX0, runY, runX1 - runX0 + 1,
+                            _color);
+            else          _gfx->writeFillRect(runX0, runY, runX1 - runX0 + 1,
+                            runH, _color);
+            runH = 0;
+        }
+        if(a <= b) {
+            if(!runH) {
+                runY  = y;
+                runX0 = a;
+                runX1 = b;
+            }
+            runH++;
+        }
+    }
+    _lo = BRUSH_ROWS;
+    _hi = -1;
+}
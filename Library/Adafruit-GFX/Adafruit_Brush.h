@@ -0,0 +1,97 @@
+/*!
+ * @file Adafruit_Brush.h
+ *
+ * Stroke brush for freehand drawing on any Adafruit_GFX display. Touch
+ * samples are joined by the line swept by the brush shape, so fast strokes
+ * stay continuous however far apart the samples are. Each segment is
+ * rasterized into a table of one span per scanline (the swept shape of a
+ * convex brush is convex) and flushed with runs of identical rows merged
+ * into rectangles, so a segment costs at most one address window per
+ * scanline and the straight middle of a vertical stroke a single one.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_BRUSH_H_
+#define _ADAFRUIT_BRUSH_H_
+
+#include "Adafruit_GFX.h"
+
+#if !defined(BRUSH_MAX_RADIUS)
+ #define BRUSH_MAX_RADIUS 15 ///< Largest brush radius setSize() accepts
+#endif
+
+#if !defined(BRUSH_ROWS)
+ #define BRUSH_ROWS 64 ///< Span table rows; taller segments flush in parts
+#endif
+
+#define BRUSH_ROUND   0 ///< Disc brush, same shape as fillCircle()
+#define BRUSH_SQUARE  1 ///< Square brush, 2 * radius + 1 wide
+#define BRUSH_DIAMOND 2 ///< Diamond (45 degree square) brush
+
+/*!
+  @brief  Brush that draws strokes from successive pen positions.
+*/
+class Adafruit_Brush {
+
+  public:
+
+    Adafruit_Brush(Adafruit_GFX *gfx, uint8_t radius = 2,
+      uint8_t shape = BRUSH_ROUND, uint16_t color = 0xFFFF);
+
+    void         setSize(uint8_t radius);
+    void         setShape(uint8_t shape);
+    void         setClip(int16_t x, int16_t y, int16_t w, int16_t h);
+    void         clearClip(void);
+    void         moveTo(int16_t x, int16_t y);
+    void         lineTo(int16_t x, int16_t y);
+
+    /*!
+        @brief   Set the stroke color.
+        @param   color  16-bit 5-6-5 color.
+    */
+    void         setColor(uint16_t color) { _color = color; }
+    /*!
+        @brief   Lift the pen; the next lineTo() starts a new stroke.
+    */
+    void         up(void) { _down = false; }
+    /*!
+        @brief   Query whether a stroke is in progress.
+        @return  true between moveTo() and up().
+    */
+    bool         down(void) const { return _down; }
+    /*!
+        @brief   Get the brush radius.
+        @return  Radius in pixels, 0 for a single pixel.
+    */
+    uint8_t      size(void) const { return _radius; }
+    /*!
+        @brief   Get the brush shape.
+        @return  BRUSH_ROUND, BRUSH_SQUARE or BRUSH_DIAMOND.
+    */
+    uint8_t      shape(void) const { return _shape; }
+
+  private:
+
+    void         profile(void);
+    void         stamp(int16_t x, int16_t y);
+    void         flush(void);
+
+    Adafruit_GFX *_gfx;                       ///< Display to draw on
+    int16_t  _x, _y;                          ///< Last pen position
+    int16_t  _cx0, _cy0, _cx1, _cy1;          ///< Clip, right/bottom excl.
+    int16_t  _top;                            ///< Screen row of table row 0
+    int16_t  _lo, _hi;                        ///< Rows in use, none if lo>hi
+    int16_t  _xmin[BRUSH_ROWS];               ///< Span start per row
+    int16_t  _xmax[BRUSH_ROWS];               ///< Span end (incl.) per row
+    uint8_t  _hw[BRUSH_MAX_RADIUS + 1];       ///< Half width at |dy|
+    uint16_t _color;                          ///< Stroke color
+    uint8_t  _radius;                         ///< Brush radius
+    uint8_t  _shape;                          ///< BRUSH_* shape
+    bool     _down;                           ///< Stroke in progress
+    bool     _clip;                           ///< Clip rectangle set
+    bool     _joint;                          ///< Skip what _jx, _jy painted
+    int16_t  _jx, _jy;                        ///< Joint: segment start
+};
+
+#endif // _ADAFRUIT_BRUSH_H_
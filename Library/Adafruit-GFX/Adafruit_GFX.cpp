@@ -86,10 +86,46 @@ inline uint8_t * pgm_read_bitmap_ptr(const GFXfont *gfxFont)
 #define min(a,b) (((a) < (b)) ? (a) : (b))
 #endif
 
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
 #ifndef _swap_int16_t
 #define _swap_int16_t(a, b) { int16_t t = a; a = b; b = t; }
 #endif
 
+/// Placement and clip box of the GFXfont glyph drawChar() is drawing
+struct GlyphClip {
+    int16_t gx, gy;              ///< Screen position of glyph pixel (0, 0)
+    int16_t cx0, cy0, cx1, cy1;  ///< Clip box, right/bottom exclusive
+    uint8_t sx, sy;              ///< Magnification
+};
+
+/**************************************************************************/
+/*!
+   @brief    Draw one run of set pixels of a GFXfont glyph as a single span
+             (sx * run wide, sy tall), clipped to the glyph's clip box.
+   @param    gfx    Display to draw on
+   @param    g      Glyph placement and clip
+   @param    x0     First glyph column of the run
+   @param    x1     Glyph column after the run
+   @param    yy     Glyph row
+   @param    color  16-bit 5-6-5 Color to draw with
+*/
+/**************************************************************************/
+static void glyphSpan(Adafruit_GFX *gfx, const GlyphClip &g, int16_t x0,
+  int16_t x1, int16_t yy, uint16_t color) {
+    int16_t px0 = g.gx + x0 * g.sx, px1 = g.gx + x1 * g.sx;
+    int16_t py0 = g.gy + yy * g.sy, py1 = py0 + g.sy;
+    if(px0 < g.cx0) px0 = g.cx0;
+    if(px1 > g.cx1) px1 = g.cx1;
+    if(py0 < g.cy0) py0 = g.cy0;
+    if(py1 > g.cy1) py1 = g.cy1;
+    if((px0 >= px1) || (py0 >= py1)) return;
+    if(py1 - py0 == 1) gfx->writeFastHLine(px0, py0, px1 - px0, color);
+    else               gfx->writeFillRect(px0, py0, px1 - px0, py1 - py0, color);
+}
+
 /**************************************************************************/
 /*!
    @brief    Instatiate a GFX context for graphics! Can only be done by a superclass
@@ -109,6 +145,8 @@ WIDTH(w), HEIGHT(h)
     wrap      = true;
     _cp437    = false;
     gfxFont   = NULL;
+    _textClip = false;
+    _textClipX0 = _textClipY0 = _textClipX1 = _textClipY1 = 0;
 }
 
 /**************************************************************************/
@@ -673,6 +711,393 @@ void Adafruit_GFX::fillTriangle(int16_t x0, int16_t y0,
     endWrite();
 }
 
+// POLYGONS, THICK LINES ---------------------------------------------------
+// Scanline filler with an active-edge table, shared by fillPolygon(),
+// drawThickLine() and drawPolyline(). Vertices are in 1/POLY_SUB pixel
+// units; pixel (x, y) covers [x, x+1) x [y, y+1) and is filled if its
+// centre is inside, so polygons sharing an edge don't overlap. Each
+// scanline becomes a list of spans, and runs of scanlines with the same
+// list go out as one writeFillRect() per span, so straight-sided parts cost
+// one window instead of one per row.
+
+#define POLY_SHIFT 4                 ///< log2 of POLY_SUB
+#define POLY_SUB   (1 << POLY_SHIFT) ///< Subpixel steps per pixel in vertices
+
+/// One non-horizontal polygon edge
+struct PolyEdge {
+    int32_t x;     ///< Crossing at current scanline centre, floor (subpixels)
+    int32_t e;     ///< Remainder of the crossing, 0 <= e < d
+    int32_t q, r;  ///< Per-scanline step of x: q + r / d
+    int32_t d;     ///< Edge height in subpixels
+    int16_t y0;    ///< First scanline crossed
+    int16_t y1;    ///< Scanline after the last one crossed
+    int8_t  dir;   ///< +1 if the edge runs down, -1 if up
+};
+
+/// A scanline crossing
+struct PolyCross {
+    int16_t x;     ///< First pixel whose centre is right of the crossing
+    int8_t  dir;   ///< Winding direction of the edge
+};
+
+// First scanline (or pixel) whose centre is at or after subpixel c
+static inline int16_t polyPixel(int32_t c) {
+    return (int16_t)((c - POLY_SUB / 2 + POLY_SUB - 1) >> POLY_SHIFT);
+}
+
+/**************************************************************************/
+/*!
+   @brief    Fill one or more closed contours.
+    @param    gfx       Display to draw on
+    @param    xy        Vertices as x, y pairs in subpixels
+    @param    ends      For each contour, index of the vertex after its last
+    @param    contours  Number of contours
+    @param    color     16-bit 5-6-5 Color to fill with
+    @param    rule      GFX_FILL_EVENODD or GFX_FILL_NONZERO
+*/
+/**************************************************************************/
+static void fillPath(Adafruit_GFX *gfx, const int32_t *xy,
+  const uint16_t *ends, uint16_t contours, uint16_t color, uint8_t rule) {
+    uint16_t n = contours ? ends[contours - 1] : 0;
+    if(n < 3) return;
+
+    // One allocation for edges, active list, crossings and two span lists
+    uint8_t *mem = (uint8_t *)malloc(n * (sizeof(PolyEdge) +
+      sizeof(PolyEdge *) + sizeof(PolyCross) + 4 * sizeof(int16_t)));
+    if(!mem) return;
+    PolyEdge  *edges  = (PolyEdge *)mem;
+    PolyEdge **active = (PolyEdge **)&edges[n];
+    PolyCross *cross  = (PolyCross *)&active[n];
+    int16_t   *spans  = (int16_t *)&cross[n];  // x0, x1 pairs
+    int16_t   *prev   = &spans[n * 2];
+    int16_t    height = gfx->height(), width = gfx->width();
+
+    // Edge table, sorted by first scanline
+    uint16_t ne = 0, first = 0;
+    int16_t  ymin = 32767, ymax = -32768;
+    for(uint16_t c=0; c<contours; c++) {
+        for(uint16_t i=first; i<ends[c]; i++) {
+            uint16_t j  = (i + 1 < ends[c]) ? i + 1 : first;
+            int32_t  xa = xy[i * 2], ya = xy[i * 2 + 1],
+                     xb = xy[j * 2], yb = xy[j * 2 + 1];
+            int8_t   dir = 1;
+            if(ya > yb) {
+                int32_t t = xa; xa = xb; xb = t;
+                t = ya; ya = yb; yb = t;
+                dir = -1;
+            }
+            int16_t y0 = polyPixel(ya), y1 = polyPixel(yb);
+            if(y0 < 0) y0 = 0;
+            if(y1 > height) y1 = height;
+            if(y0 >= y1) continue; // Horizontal, or no scanline centre
+
+            PolyEdge e;
+            int32_t dx = xb - xa, step = dx * POLY_SUB;
+            e.d   = yb - ya;
+            e.q   = step / e.d;
+            e.r   = step % e.d;
+            if(e.r < 0) { e.q--; e.r += e.d; } // Floor division
+            int64_t num = (int64_t)(y0 * POLY_SUB + POLY_SUB / 2 - ya) * dx;
+            int64_t q   = num / e.d, r = num % e.d;
+            if(r < 0) { q--; r += e.d; }
+            e.x   = xa + (int32_t)q;
+            e.e   = (int32_t)r;
+            e.y0  = y0;
+            e.y1  = y1;
+            e.dir = dir;
+
+            uint16_t k = ne++;
+            while(k && (edges[k - 1].y0 > y0)) { edges[k] = edges[k - 1]; k--; }
+            edges[k] = e;
+            if(y0 < ymin) ymin = y0;
+            if(y1 > ymax) ymax = y1;
+        }
+        first = ends[c];
+    }
+
+    uint16_t na = 0, next = 0, nprev = 0;
+    int16_t  prevY = 0, prevH = 0;
+    gfx->startWrite();
+    for(int16_t y=ymin; y<=ymax; y++) {
+        uint16_t ns = 0;
+        if(y < ymax) {
+            // Update the active-edge table: drop finished edges, add new
+            for(uint16_t i=0; i<na; ) {
+                if(active[i]->y1 <= y) active[i] = active[--na];
+                else                   i++;
+            }
+            while((next < ne) && (edges[next].y0 == y))
+                active[na++] = &edges[next++];
+
+            // Crossings, sorted by x (nearly sorted already row to row)
+            for(uint16_t i=0; i<na; i++) {
+                PolyEdge *e = active[i];
+                PolyCross c = { polyPixel(e->x + (e->e ? 1 : 0)), e->dir };
+                uint16_t k = i;
+                while(k && (cross[k - 1].x > c.x)) {
+                    cross[k] = cross[k - 1];
+                    k--;
+                }
+                cross[k] = c;
+                e->x += e->q;
+                e->e += e->r;
+                if(e->e >= e->d) { e->e -= e->d; e->x++; }
+            }
+
+            // Spans by fill rule, clipped, touching spans joined
+            int16_t wind = 0, x0 = 0;
+            for(uint16_t i=0; i<na; i++) {
+                int16_t w = (rule == GFX_FILL_NONZERO) ? wind + cross[i].dir
+                                                       : !wind;
+                if(!wind && w) x0 = cross[i].x;
+                if(wind && !w) {
+                    int16_t a = max(x0, 0), b = min(cross[i].x, width);
+                    if(a < b) {
+                        if(ns && (spans[ns * 2 - 1] >= a)) {
+                            spans[ns * 2 - 1] = max(spans[ns * 2 - 1], b);
+                        } else {
+                            spans[ns * 2]     = a;
+                            spans[ns * 2 + 1] = b;
+                            ns++;
+                        }
+                    }
+                }
+                wind = w;
+            }
+        }
+
+        // Extend the pending rows if this one is the same, else send them
+        if(prevH && (ns == nprev) && (y < ymax) &&
+           !memcmp(spans, prev, ns * 2 * sizeof(int16_t))) {
+            prevH++;
+            continue;
+        }
+        for(uint16_t i=0; i<nprev; i++) {
+            int16_t a = prev[i * 2], w = prev[i * 2 + 1] - a;
+            if(prevH == 1) gfx->writeFastHLine(a, prevY, w, color);
+            else           gfx->writeFillRect(a, prevY, w, prevH, color);
+        }
+        int16_t *t = prev; prev = spans; spans = t;
+        nprev = ns;
+        prevY = y;
+        prevH = 1;
+    }
+    gfx->endWrite();
+    free(mem);
+}
+
+/**************************************************************************/
+/*!
+   @brief    Make a contour's winding positive (clockwise on screen), so
+             contours combined with the nonzero rule add up instead of
+             cancelling.
+    @param    xy  Vertices as x, y pairs in subpixels
+    @param    n   Number of vertices
+*/
+/**************************************************************************/
+static void polyOrient(int32_t *xy, uint16_t n) {
+    int64_t area = 0;
+    for(uint16_t i=0; i<n; i++) {
+        uint16_t j = (i + 1 < n) ? i + 1 : 0;
+        area += (int64_t)xy[i * 2] * xy[j * 2 + 1] -
+                (int64_t)xy[j * 2] * xy[i * 2 + 1];
+    }
+    if(area >= 0) return;
+    for(uint16_t i=0, j=n-1; i<j; i++, j--) {
+        int32_t tx = xy[i * 2], ty = xy[i * 2 + 1];
+        xy[i * 2]     = xy[j * 2];
+        xy[i * 2 + 1] = xy[j * 2 + 1];
+        xy[j * 2]     = tx;
+        xy[j * 2 + 1] = ty;
+    }
+}
+
+/**************************************************************************/
+/*!
+   @brief    Half-width offset perpendicular to a line, in subpixels.
+    @param    dx  Line x extent, pixels
+    @param    dy  Line y extent, pixels
+    @param    w   Line width, pixels
+    @param    ox  Receives x offset
+    @param    oy  Receives y offset
+*/
+/**************************************************************************/
+static void polyNormal(int32_t dx, int32_t dy, uint8_t w,
+  int32_t *ox, int32_t *oy) {
+    if(!dx && !dy) dx = 1; // A dot: treat as horizontal
+    // Length in subpixels, integer square root
+    uint64_t sq  = (uint64_t)((int64_t)dx * dx + (int64_t)dy * dy) *
+                   (POLY_SUB * POLY_SUB);
+    uint64_t len = 0, bit = (uint64_t)1 << 62;
+    while(bit > sq) bit >>= 2;
+    while(bit) {
+        if(sq >= len + bit) { sq -= len + bit; len = (len >> 1) + bit; }
+        else                  len >>= 1;
+        bit >>= 2;
+    }
+    // (-dy, dx) / len * w / 2, rounded, in subpixels
+    int64_t s = (int64_t)w * POLY_SUB * POLY_SUB / 2;
+    int64_t nx = -dy * s, ny = dx * s, l = (int64_t)len;
+    *ox = (int32_t)((nx + ((nx < 0) ? -l : l) / 2) / l);
+    *oy = (int32_t)((ny + ((ny < 0) ? -l : l) / 2) / l);
+}
+
+/**************************************************************************/
+/*!
+   @brief    Move the ends of a thick line half a pixel outwards, so the
+             end pixels are covered whichever way the line runs (as with
+             drawLine()). A dot is stretched to a w x w square instead.
+    @param    ax  Start x, subpixels, updated
+    @param    ay  Start y, subpixels, updated
+    @param    bx  End x, subpixels, updated
+    @param    by  End y, subpixels, updated
+    @param    ox  Half-width offset x from polyNormal()
+    @param    oy  Half-width offset y from polyNormal()
+    @param    w   Line width, pixels
+    @param    dot true if start and end are the same pixel
+*/
+/**************************************************************************/
+static void polyCaps(int32_t *ax, int32_t *ay, int32_t *bx, int32_t *by,
+  int32_t ox, int32_t oy, uint8_t w, bool dot) {
+    // (oy, -ox) runs along the line, w / 2 pixels long
+    int32_t ex = dot ? oy : oy / w, ey = dot ? -ox : -ox / w;
+    *ax -= ex;
+    *ay -= ey;
+    *bx += ex;
+    *by += ey;
+}
+
+/**************************************************************************/
+/*!
+   @brief    Fill a polygon. Pixels whose centre lies inside are filled, so
+             integer vertices are pixel corners: the square (0,0) (10,0)
+             (10,10) (0,10) fills pixels 0..9 in both directions, and
+             polygons sharing an edge don't overlap. Spans are batched
+             across scanlines (see above), not drawn one per row.
+    @param    xy     Vertices as n x, y pairs
+    @param    n      Number of vertices, at least 3
+    @param    color  16-bit 5-6-5 Color to fill with
+    @param    rule   GFX_FILL_EVENODD (self-overlaps are holes) or
+                     GFX_FILL_NONZERO (self-overlaps are filled)
+*/
+/**************************************************************************/
+void Adafruit_GFX::fillPolygon(const int16_t *xy, uint16_t n, uint16_t color,
+  uint8_t rule) {
+    if(n < 3) return;
+    int32_t *v = (int32_t *)malloc(n * 2 * sizeof(int32_t));
+    if(!v) return;
+    for(uint16_t i=0; i<n*2; i++) v[i] = (int32_t)xy[i] * POLY_SUB;
+    fillPath(this, v, &n, 1, color, rule);
+    free(v);
+}
+
+/**************************************************************************/
+/*!
+   @brief    Draw a line of any width with square ends, as a filled
+             quadrilateral along the centre line, covering the end pixels
+             like drawLine() does.
+    @param    x0  Start point x coordinate
+    @param    y0  Start point y coordinate
+    @param    x1  End point x coordinate
+    @param    y1  End point y coordinate
+    @param    w   Width in pixels; 0 or 1 draws a normal 1-pixel line
+    @param    color 16-bit 5-6-5 Color to draw with
+*/
+/**************************************************************************/
+void Adafruit_GFX::drawThickLine(int16_t x0, int16_t y0, int16_t x1,
+  int16_t y1, uint8_t w, uint16_t color) {
+    if(w <= 1) {
+        drawLine(x0, y0, x1, y1, color);
+        return;
+    }
+    int32_t ox, oy, v[8];
+    int32_t ax = x0 * POLY_SUB + POLY_SUB / 2, ay = y0 * POLY_SUB + POLY_SUB / 2,
+            bx = x1 * POLY_SUB + POLY_SUB / 2, by = y1 * POLY_SUB + POLY_SUB / 2;
+    uint16_t end = 4;
+    polyNormal(x1 - x0, y1 - y0, w, &ox, &oy);
+    polyCaps(&ax, &ay, &bx, &by, ox, oy, w, (x0 == x1) && (y0 == y1));
+    v[0] = ax + ox; v[1] = ay + oy;
+    v[2] = bx + ox; v[3] = by + oy;
+    v[4] = bx - ox; v[5] = by - oy;
+    v[6] = ax - ox; v[7] = ay - oy;
+    fillPath(this, v, &end, 1, color, GFX_FILL_NONZERO);
+}
+
+/**************************************************************************/
+/*!
+   @brief    Draw connected line segments of any width. Segments are
+             joined with bevels and the whole path is filled in one pass
+             (nonzero rule), so overlapping parts are drawn only once.
+    @param    xy     Points as n x, y pairs
+    @param    n      Number of points
+    @param    w      Width in pixels; 0 or 1 draws normal 1-pixel lines
+    @param    color  16-bit 5-6-5 Color to draw with
+*/
+/**************************************************************************/
+void Adafruit_GFX::drawPolyline(const int16_t *xy, uint16_t n, uint8_t w,
+  uint16_t color) {
+    if(n < 2) {
+        if(n) drawThickLine(xy[0], xy[1], xy[0], xy[1], w, color);
+        return;
+    }
+    if(w <= 1) {
+        startWrite();
+        for(uint16_t i=1; i<n; i++)
+            writeLine(xy[i * 2 - 2], xy[i * 2 - 1], xy[i * 2], xy[i * 2 + 1],
+              color);
+        endWrite();
+        return;
+    }
+
+    // A quad per segment and two bevel triangles per joint
+    uint16_t  segs = n - 1, joints = n - 2;
+    uint16_t  maxc = segs + joints * 2;
+    int32_t  *v    = (int32_t *)malloc((segs * 4 + joints * 6) * 2 *
+                       sizeof(int32_t) + maxc * sizeof(uint16_t));
+    if(!v) return;
+    uint16_t *ends = (uint16_t *)&v[(segs * 4 + joints * 6) * 2];
+    uint16_t  nv = 0, nc = 0;
+    int32_t   pox = 0, poy = 0;
+    bool      havePrev = false;
+
+    for(uint16_t i=0; i<segs; i++) {
+        int16_t x0 = xy[i * 2], y0 = xy[i * 2 + 1],
+                x1 = xy[i * 2 + 2], y1 = xy[i * 2 + 3];
+        if((x0 == x1) && (y0 == y1) && (havePrev || (i < segs - 1)))
+            continue; // Zero length, unless it's the whole path
+        int32_t ox, oy;
+        int32_t ax = x0 * POLY_SUB + POLY_SUB / 2,
+                ay = y0 * POLY_SUB + POLY_SUB / 2,
+                bx = x1 * POLY_SUB + POLY_SUB / 2,
+                by = y1 * POLY_SUB + POLY_SUB / 2;
+        polyNormal(x1 - x0, y1 - y0, w, &ox, &oy);
+        if(havePrev) { // Bevel both sides; the inner one is covered anyway
+            int32_t *t = &v[nv * 2];
+            t[0] = ax; t[1] = ay; t[2] = ax + pox; t[3] = ay + poy;
+            t[4] = ax + ox; t[5] = ay + oy;
+            t[6] = ax; t[7] = ay; t[8] = ax - pox; t[9] = ay - poy;
+            t[10] = ax - ox; t[11] = ay - oy;
+            polyOrient(t, 3);
+            polyOrient(&t[6], 3);
+            nv += 3; ends[nc++] = nv;
+            nv += 3; ends[nc++] = nv;
+        }
+        polyCaps(&ax, &ay, &bx, &by, ox, oy, w, (x0 == x1) && (y0 == y1));
+        int32_t *q = &v[nv * 2];
+        q[0] = ax + ox; q[1] = ay + oy;
+        q[2] = bx + ox; q[3] = by + oy;
+        q[4] = bx - ox; q[5] = by - oy;
+        q[6] = ax - ox; q[7] = ay - oy;
+        polyOrient(q, 4);
+        nv += 4; ends[nc++] = nv;
+        pox = ox;
+        poy = oy;
+        havePrev = true;
+    }
+    fillPath(this, v, ends, nc, color, GFX_FILL_NONZERO);
+    free(v);
+}
+
 // BITMAP / XBITMAP / GRAYSCALE / RGB BITMAP FUNCTIONS ---------------------
 
 /**************************************************************************/
@@ -1119,47 +1544,94 @@ void Adafruit_GFX::drawChar(int16_t x, int16_t y, unsigned char c,
                  h  = pgm_read_byte(&glyph->height);
         int8_t   xo = pgm_read_byte(&glyph->xOffset),
                  yo = pgm_read_byte(&glyph->yOffset);
-        uint8_t  xx, yy, bits = 0, bit = 0;
-        int16_t  xo16 = 0, yo16 = 0;
 
-        if(size_x > 1 || size_y > 1) {
-            xo16 = xo;
-            yo16 = yo;
+        // Clip the glyph box against the screen and the text clip
+        // rectangle before touching any bits; glyphs entirely outside are
+        // skipped without a transaction.
+        GlyphClip g = { (int16_t)(x + xo * size_x), (int16_t)(y + yo * size_y),
+          0, 0, _width, _height, size_x, size_y };
+        if(_textClip) {
+            if(_textClipX0 > g.cx0) g.cx0 = _textClipX0;
+            if(_textClipY0 > g.cy0) g.cy0 = _textClipY0;
+            if(_textClipX1 < g.cx1) g.cx1 = _textClipX1;
+            if(_textClipY1 < g.cy1) g.cy1 = _textClipY1;
         }
+        if(!w || !h || (g.gx >= g.cx1) || (g.gy >= g.cy1) ||
+           (g.gx + w * size_x <= g.cx0) || (g.gy + h * size_y <= g.cy0) ||
+           (g.cx0 >= g.cx1) || (g.cy0 >= g.cy1))
+            return;
 
-        // Todo: Add character clipping here
-
-        // NOTE: THERE IS NO 'BACKGROUND' COLOR OPTION ON CUSTOM FONTS.
-        // THIS IS ON PURPOSE AND BY DESIGN.  The background color feature
-        // has typically been used with the 'classic' font to overwrite old
-        // screen contents with new data.  This ONLY works because the
-        // characters are a uniform size; it's not a sensible thing to do with
-        // proportionally-spaced fonts with glyphs of varying sizes (and that
-        // may overlap).  To replace previously-drawn text when using a custom
-        // font, use the getTextBounds() function to determine the smallest
-        // rectangle encompassing a string, erase the area with fillRect(),
-        // then draw new text.  This WILL infortunately 'blink' the text, but
-        // is unavoidable.  Drawing 'background' pixels will NOT fix this,
-        // only creates a new set of problems.  Have an idea to work around
-        // this (a canvas object type for MCUs that can afford the RAM and
-        // displays supporting setAddrWindow() and pushColors()), but haven't
-        // implemented this yet.
+        // Rows below the clip are never decoded
+        int16_t y0 = 0, y1 = h;
+        if(g.gy < g.cy0) y0 = (g.cy0 - g.gy) / size_y;
+        if(g.gy + h * size_y > g.cy1)
+            y1 = (g.cy1 - g.gy + size_y - 1) / size_y;
+
+        // Only set bits are drawn here; bg is ignored for custom fonts.
+        // Glyphs are proportional and may overlap their neighbours, so a
+        // per-glyph background box would clip the previous character.
+        // Displays derived from Adafruit_SPITFT render opaque text (print()
+        // with a background color) as whole-line runs instead, filling the
+        // line's box at the font's full height (see textRun()); elsewhere,
+        // erase the getTextBounds() rectangle before redrawing text.
 
         startWrite();
-        for(yy=0; yy<h; yy++) {
-            for(xx=0; xx<w; xx++) {
-                if(!(bit++ & 7)) {
-                    bits = pgm_read_byte(&bitmap[bo++]);
+        if(pgm_read_byte(&gfxFont->flags) & GFXFONT_RLE) {
+            // Run-length glyphs: each byte is a count of clear pixels (high
+            // nibble) then set pixels (low nibble), in the same row-major
+            // order as bitmap glyphs. Set runs are drawn directly as spans,
+            // split where they wrap to the next row and joined where a long
+            // run was split over several bytes.
+            int16_t xx = 0, yy = 0, run = -1;
+            while(yy < y1) {
+                uint8_t b = pgm_read_byte(&bitmap[bo++]);
+                if(b >> 4) {
+                    if(run >= 0) {
+                        if(yy >= y0) glyphSpan(this, g, run, xx, yy, color);
+                        run = -1;
+                    }
+                    xx += b >> 4;
+                    while(xx >= w) { xx -= w; yy++; }
+                }
+                for(uint8_t n = b & 0x0F; n && (yy < y1); ) {
+                    uint8_t span = min(n, w - xx);
+                    if(run < 0) run = xx;
+                    n  -= span;
+                    xx += span;
+                    if(xx >= w) {
+                        if(yy >= y0) glyphSpan(this, g, run, w, yy, color);
+                        run = -1;
+                        xx  = 0;
+                        yy++;
+                    }
                 }
-                if(bits & 0x80) {
-                    if(size_x == 1 && size_y == 1) {
-                        writePixel(x+xo+xx, y+yo+yy, color);
-                    } else {
-                        writeFillRect(x+(xo16+xx)*size_x, y+(yo16+yy)*size_y,
-                          size_x, size_y, color);
+            }
+        } else {
+            // Bitmap glyphs: rows cut off at the top are skipped by bit
+            // offset, the rest decoded into runs of set bits, each drawn as
+            // one span.
+            uint16_t bit = (uint16_t)y0 * w;
+            bo  += bit >> 3;
+            bit &= 7;
+            uint8_t bits = 0;
+            if(bit) bits = pgm_read_byte(&bitmap[bo++]) << bit;
+            for(int16_t yy=y0; yy<y1; yy++) {
+                int16_t run = -1;
+                for(int16_t xx=0; xx<=w; xx++) {
+                    bool on = false;
+                    if(xx < w) {
+                        if(!bit) bits = pgm_read_byte(&bitmap[bo++]);
+                        on  = bits & 0x80;
+                        bits <<= 1;
+                        bit = (bit + 1) & 7;
+                    }
+                    if(on) {
+                        if(run < 0) run = xx;
+                    } else if(run >= 0) {
+                        glyphSpan(this, g, run, xx, yy, color);
+                        run = -1;
                     }
                 }
-                bits <<= 1;
             }
         }
         endWrite();
@@ -1217,6 +1689,19 @@ size_t Adafruit_GFX::write(uint8_t c) {
 }
 
 
+/**************************************************************************/
+/*!
+    @brief   Read one column of a glyph in the built-in 'classic' font, for
+             subclasses that rasterize text themselves
+    @param   c  Font index (after any CP437 adjustment)
+    @param   i  Column, 0-4
+    @returns Column bits, LSB at the top
+*/
+/**************************************************************************/
+uint8_t Adafruit_GFX::classicFontColumn(unsigned char c, uint8_t i) const {
+    return pgm_read_byte(&font[c * 5 + i]);
+}
+
 /**************************************************************************/
 /*!
     @brief   Set text 'magnification' size. Each increase in s makes 1 pixel that much bigger.
@@ -1855,20 +2340,40 @@ void GFXcanvas8::writeFastHLine(int16_t x, int16_t y,
    @param    h   Display height, in pixels
 */
 /**************************************************************************/
-GFXcanvas16::GFXcanvas16(uint16_t w, uint16_t h) : Adafruit_GFX(w, h) {
+GFXcanvas16::GFXcanvas16(uint16_t w, uint16_t h) : Adafruit_GFX(w, h),
+  _ndirty(0), _ownBuffer(true), _lastDirty(0) {
+    setRotation(0);
     uint32_t bytes = w * h * 2;
     if((buffer = (uint16_t *)malloc(bytes))) {
         memset(buffer, 0, bytes);
+        dirtyRaw(0, 0, w, h); // Panel doesn't show the cleared canvas yet
     }
 }
 
+/**************************************************************************/
+/*!
+   @brief    Instatiate a GFX 16-bit canvas context on caller-provided
+             memory, e.g. a static array where the heap is too small. The
+             contents are left as they are and the canvas never frees it.
+   @param    w    Display width, in pixels
+   @param    h    Display height, in pixels
+   @param    buf  w * h pixels, valid for the life of the canvas
+*/
+/**************************************************************************/
+GFXcanvas16::GFXcanvas16(uint16_t w, uint16_t h, uint16_t *buf) :
+  Adafruit_GFX(w, h), buffer(buf), _ndirty(0), _ownBuffer(false),
+  _lastDirty(0) {
+    setRotation(0);
+    if(buffer) dirtyRaw(0, 0, w, h);
+}
+
 /**************************************************************************/
 /*!
    @brief    Delete the canvas, free memory
 */
 /**************************************************************************/
 GFXcanvas16::~GFXcanvas16(void) {
-    if(buffer) free(buffer);
+    if(buffer && _ownBuffer) free(buffer);
 }
 
 /**************************************************************************/
@@ -1883,28 +2388,145 @@ void GFXcanvas16::drawPixel(int16_t x, int16_t y, uint16_t color) {
     if(buffer) {
         if((x < 0) || (y < 0) || (x >= _width) || (y >= _height)) return;
 
-        int16_t t;
-        switch(rotation) {
-            case 1:
-                t = x;
-                x = WIDTH  - 1 - y;
-                y = t;
-                break;
-            case 2:
-                x = WIDTH  - 1 - x;
-                y = HEIGHT - 1 - y;
-                break;
-            case 3:
-                t = x;
-                x = y;
-                y = HEIGHT - 1 - t;
-                break;
+        // Rotation is mapped once in setRotation(), not switched per pixel
+        int16_t bx = _x0 + _xx * x + _xy * y,
+                by = _y0 + _yx * x + _yy * y;
+        buffer[bx + by * WIDTH] = color;
+
+        // Pixels mostly land in the same dirty rectangle as the last one
+        if(_lastDirty < _ndirty) {
+            const Adafruit_Rect &d = _dirty[_lastDirty];
+            if(((uint16_t)(bx - d.x) < (uint16_t)d.w) &&
+               ((uint16_t)(by - d.y) < (uint16_t)d.h)) return;
         }
+        dirtyRaw(bx, by, 1, 1);
+    }
+}
 
-        buffer[x + y * WIDTH] = color;
+/**************************************************************************/
+/*!
+    @brief  Set the drawing rotation, and work out once how drawing
+            coordinates map to the buffer so drawPixel() needn't switch
+            on it: buffer x = _x0 + _xx * x + _xy * y, likewise for y.
+    @param  r   0 thru 3 corresponding to 4 cardinal rotations
+*/
+/**************************************************************************/
+void GFXcanvas16::setRotation(uint8_t r) {
+    Adafruit_GFX::setRotation(r);
+    switch(rotation) {
+        case 0: // x, y
+            _x0 = 0;          _xx =  1; _xy =  0;
+            _y0 = 0;          _yx =  0; _yy =  1;
+            break;
+        case 1: // WIDTH - 1 - y, x
+            _x0 = WIDTH - 1;  _xx =  0; _xy = -1;
+            _y0 = 0;          _yx =  1; _yy =  0;
+            break;
+        case 2: // WIDTH - 1 - x, HEIGHT - 1 - y
+            _x0 = WIDTH - 1;  _xx = -1; _xy =  0;
+            _y0 = HEIGHT - 1; _yx =  0; _yy = -1;
+            break;
+        case 3: // y, HEIGHT - 1 - x
+            _x0 = 0;          _xx =  0; _xy =  1;
+            _y0 = HEIGHT - 1; _yx = -1; _yy =  0;
+            break;
     }
 }
 
+/**************************************************************************/
+/*!
+    @brief  Clip a rectangle to the canvas and map it from drawing
+            (rotated) coordinates to buffer coordinates. A negative width
+            or height extends left or up from x, y, as on Adafruit_SPITFT.
+    @param  x   Left edge, updated in place
+    @param  y   Top edge, updated in place
+    @param  w   Width, updated in place
+    @param  h   Height, updated in place
+    @returns    false if nothing is left after clipping
+*/
+/**************************************************************************/
+bool GFXcanvas16::bufferRect(int16_t &x, int16_t &y, int16_t &w,
+  int16_t &h) const {
+    if(w < 0) { x += w + 1; w = -w; }
+    if(h < 0) { y += h + 1; h = -h; }
+    if(x < 0) { w += x; x = 0; }
+    if(y < 0) { h += y; y = 0; }
+    if(x + w > _width)  w = _width  - x;
+    if(y + h > _height) h = _height - y;
+    if((w <= 0) || (h <= 0)) return false;
+
+    int16_t t;
+    switch(rotation) {
+        case 1:
+            t = x;
+            x = WIDTH  - y - h;
+            y = t;
+            _swap_int16_t(w, h);
+            break;
+        case 2:
+            x = WIDTH  - x - w;
+            y = HEIGHT - y - h;
+            break;
+        case 3:
+            t = x;
+            x = y;
+            y = HEIGHT - t - w;
+            _swap_int16_t(w, h);
+            break;
+    }
+    return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Fill a rectangle straight into the framebuffer, one row of
+            memory at a time whatever the rotation
+    @param  x   Top left corner x coordinate
+    @param  y   Top left corner y coordinate
+    @param  w   Width in pixels
+    @param  h   Height in pixels
+    @param  color 16-bit 5-6-5 Color to fill with
+*/
+/**************************************************************************/
+void GFXcanvas16::fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+  uint16_t color) {
+    if(!buffer || !bufferRect(x, y, w, h)) return;
+
+    uint16_t *row = buffer + y * WIDTH + x;
+    for(int16_t j=0; j<h; j++, row += WIDTH) {
+        for(int16_t i=0; i<w; i++) row[i] = color;
+    }
+    dirtyRaw(x, y, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Draw a perfectly vertical line into the framebuffer
+    @param  x   Top-most x coordinate
+    @param  y   Top-most y coordinate
+    @param  h   Height in pixels
+    @param  color 16-bit 5-6-5 Color to fill with
+*/
+/**************************************************************************/
+void GFXcanvas16::drawFastVLine(int16_t x, int16_t y, int16_t h,
+  uint16_t color) {
+    fillRect(x, y, 1, h, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Draw a perfectly horizontal line into the framebuffer
+    @param  x   Left-most x coordinate
+    @param  y   Left-most y coordinate
+    @param  w   Width in pixels
+    @param  color 16-bit 5-6-5 Color to fill with
+*/
+/**************************************************************************/
+void GFXcanvas16::drawFastHLine(int16_t x, int16_t y, int16_t w,
+  uint16_t color) {
+    fillRect(x, y, w, 1, color);
+}
+
 /**************************************************************************/
 /*!
     @brief  Fill the framebuffer completely with one color
@@ -1912,7 +2534,117 @@ void GFXcanvas16::drawPixel(int16_t x, int16_t y, uint16_t color) {
 */
 /**************************************************************************/
 void GFXcanvas16::fillScreen(uint16_t color) {
-	fillRect(0, 0, ILI9341_WIDTH, ILI9341_HEIGHT, color);
+    fillRect(0, 0, _width, _height, color);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Record a changed area for the next flush(), e.g. after
+            writing to getBuffer() directly. Drawing through the canvas
+            does this by itself.
+    @param  x   Left edge, drawing (rotated) coordinates
+    @param  y   Top edge
+    @param  w   Width in pixels
+    @param  h   Height in pixels
+*/
+/**************************************************************************/
+void GFXcanvas16::markDirty(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if(bufferRect(x, y, w, h)) dirtyRaw(x, y, w, h);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Forget the changed areas, e.g. once the panel has been
+            redrawn some other way
+*/
+/**************************************************************************/
+void GFXcanvas16::clearDirty(void) {
+    _ndirty = 0;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Add a clipped buffer-coordinate rectangle to the dirty list.
+            Rectangles that overlap or touch an entry are merged into it;
+            with the list full, the new one is merged into the entry that
+            grows least. Single pixels inside an entry (the common case
+            when drawing lines and text) return on the first test.
+    @param  x   Left edge
+    @param  y   Top edge
+    @param  w   Width, > 0
+    @param  h   Height, > 0
+*/
+/**************************************************************************/
+void GFXcanvas16::dirtyRaw(int16_t x, int16_t y, int16_t w, int16_t h) {
+    int16_t x1 = x + w, y1 = y + h; // Exclusive
+    for(;;) {
+        uint8_t i;
+        for(i=0; i<_ndirty; i++) {
+            const Adafruit_Rect &d = _dirty[i];
+            if((x >= d.x) && (y >= d.y) &&
+              (x1 <= d.x + d.w) && (y1 <= d.y + d.h)) {       // Covered
+                _lastDirty = i;
+                return;
+            }
+            if((x <= d.x + d.w) && (d.x <= x1) &&
+              (y <= d.y + d.h) && (d.y <= y1)) break;         // Touching
+        }
+        if(i == _ndirty) {
+            if(_ndirty < CANVAS_DIRTY_RECTS) break;
+            // List full: fold into the entry that grows least
+            uint32_t best = 0xFFFFFFFF;
+            for(uint8_t j=0; j<_ndirty; j++) {
+                const Adafruit_Rect &d = _dirty[j];
+                uint32_t cost =
+                  (uint32_t)(max(x1, d.x + d.w) - min(x, d.x)) *
+                  (max(y1, d.y + d.h) - min(y, d.y)) -
+                  (uint32_t)d.w * d.h;
+                if(cost < best) {
+                    best = cost;
+                    i    = j;
+                }
+            }
+        }
+        // Merge with entry i and retry, the union may touch others
+        const Adafruit_Rect &d = _dirty[i];
+        x  = min(x, d.x);
+        y  = min(y, d.y);
+        x1 = max(x1, d.x + d.w);
+        y1 = max(y1, d.y + d.h);
+        _dirty[i] = _dirty[--_ndirty];
+    }
+    _lastDirty = _ndirty;
+    Adafruit_Rect &n = _dirty[_ndirty++];
+    n.x = x;
+    n.y = y;
+    n.w = x1 - x;
+    n.h = y1 - y;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Send the areas changed since the last flush to a display and
+            clear the dirty list. The canvas is drawn with its buffer's
+            top-left corner at (x, y), as drawRGBBitmap(x, y, getBuffer(),
+            WIDTH, HEIGHT) would, but each dirty rectangle goes out as
+            its own address window straight from the buffer, so a small
+            change costs a small transfer. With setDeferred(true) the
+            rectangles are queued by reference: leave the canvas alone
+            until flushDeferred().
+    @param  tft Display to draw on
+    @param  x   Display x of the canvas' left edge
+    @param  y   Display y of the canvas' top edge
+*/
+/**************************************************************************/
+void GFXcanvas16::flush(Adafruit_SPITFT *tft, int16_t x, int16_t y) {
+    if(buffer) {
+        for(uint8_t i=0; i<_ndirty; i++) {
+            const Adafruit_Rect &d = _dirty[i];
+            tft->drawRGBBitmap(x + d.x, y + d.y, buffer + d.y * WIDTH + d.x,
+              d.w, d.h, WIDTH);
+        }
+    }
+    _ndirty = 0;
 }
 
 /**************************************************************************/
@@ -5,6 +5,23 @@
 #include "gfxfont.h"
 #include "Print.h"
 
+#define GFX_FILL_EVENODD 0 ///< fillPolygon(): overlapping parts are holes
+#define GFX_FILL_NONZERO 1 ///< fillPolygon(): overlapping parts are filled
+
+#if !defined(CANVAS_DIRTY_RECTS)
+ #define CANVAS_DIRTY_RECTS 4 ///< Dirty rectangles a GFXcanvas16 tracks
+#endif
+
+class Adafruit_SPITFT;
+
+/*!
+  @brief  Axis-aligned rectangle, upper-left corner and size.
+*/
+struct Adafruit_Rect {
+    int16_t x, y; ///< Upper-left corner
+    int16_t w, h; ///< Size, w or h <= 0 is empty
+};
+
 /// A generic graphics superclass that can handle all sorts of drawing. At a minimum you can subclass and provide drawPixel(). At a maximum you can do a ton of overriding to optimize. Used for any/all Adafruit displays!
 class Adafruit_GFX : public Print {
 
@@ -51,6 +68,11 @@ class Adafruit_GFX : public Print {
       uint16_t color),
     fillCircleHelper(int16_t x0, int16_t y0, int16_t r, uint8_t cornername,
       int16_t delta, uint16_t color),
+    fillPolygon(const int16_t *xy, uint16_t n, uint16_t color,
+      uint8_t rule = GFX_FILL_EVENODD),
+    drawThickLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+      uint8_t w, uint16_t color),
+    drawPolyline(const int16_t *xy, uint16_t n, uint8_t w, uint16_t color),
     drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
       int16_t w, int16_t h, uint16_t color),
     drawBitmap(int16_t x, int16_t y, const uint8_t bitmap[],
@@ -145,6 +167,33 @@ virtual void
   /**********************************************************************/
 	void setTextWrap(bool w) { wrap = w; }
 
+  /**********************************************************************/
+  /*!
+  @brief  Restrict custom-font (GFXfont) text to a rectangle. Glyphs are
+          clipped to it (and to the screen) before rasterizing, so text
+          outside costs nothing. Classic-font text is not affected.
+  @param  x  Left edge
+  @param  y  Top edge
+  @param  w  Width, <= 0 hides all custom-font text until cleared
+  @param  h  Height, <= 0 hides all custom-font text until cleared
+  */
+  /**********************************************************************/
+  void setTextClip(int16_t x, int16_t y, int16_t w, int16_t h) {
+    _textClipX0 = x;
+    _textClipY0 = y;
+    _textClipX1 = x + w;
+    _textClipY1 = y + h;
+    _textClip   = true;
+  }
+
+  /**********************************************************************/
+  /*!
+  @brief  Remove the setTextClip() rectangle; custom-font text is clipped
+          to the screen only.
+  */
+  /**********************************************************************/
+  void clearTextClip(void) { _textClip = false; }
+
   /**********************************************************************/
   /*!
     @brief  Enable (or disable) Code Page 437-compatible charset.
@@ -217,6 +266,8 @@ virtual void
   void
     charBounds(char c, int16_t *x, int16_t *y,
       int16_t *minx, int16_t *miny, int16_t *maxx, int16_t *maxy);
+  uint8_t
+    classicFontColumn(unsigned char c, uint8_t i) const;
   int16_t
     WIDTH,          ///< This is the 'raw' display width - never changes
     HEIGHT;         ///< This is the 'raw' display height - never changes
@@ -232,9 +283,15 @@ virtual void
     textsize_x,      ///< Desired magnification in X-axis of text to print()
     textsize_y,      ///< Desired magnification in Y-axis of text to print()
     rotation;       ///< Display rotation (0 thru 3)
+  int16_t
+    _textClipX0,    ///< Custom-font clip rectangle left edge
+    _textClipY0,    ///< Custom-font clip rectangle top edge
+    _textClipX1,    ///< Custom-font clip rectangle right edge (exclusive)
+    _textClipY1;    ///< Custom-font clip rectangle bottom edge (exclusive)
   bool
     wrap,           ///< If set, 'wrap' text at right edge of display
-    _cp437;         ///< If set, use correct CP437 charset (default is off)
+    _cp437,         ///< If set, use correct CP437 charset (default is off)
+    _textClip;      ///< If set, custom-font text is clipped to _textClip*
   GFXfont
     *gfxFont;       ///< Pointer to special font
 };
@@ -333,23 +390,58 @@ class GFXcanvas8 : public Adafruit_GFX {
 };
 
 
-///  A GFX 16-bit canvas context for graphics
+/// A GFX 16-bit canvas context for graphics. Drawing is tracked as a few
+/// dirty rectangles, so flush() only sends what changed since the last one.
 class GFXcanvas16 : public Adafruit_GFX {
  public:
   GFXcanvas16(uint16_t w, uint16_t h);
+  GFXcanvas16(uint16_t w, uint16_t h, uint16_t *buf);
   ~GFXcanvas16(void);
   void      drawPixel(int16_t x, int16_t y, uint16_t color),
+            drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color),
+            drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color),
+            fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+              uint16_t color),
             fillScreen(uint16_t color),
-            byteSwap(void);
+            setRotation(uint8_t r),
+            byteSwap(void),
+            markDirty(int16_t x, int16_t y, int16_t w, int16_t h),
+            clearDirty(void),
+            flush(Adafruit_SPITFT *tft, int16_t x = 0, int16_t y = 0);
   /**********************************************************************/
   /*!
-    @brief    Get a pointer to the internal buffer memory
+    @brief    Get a pointer to the internal buffer memory. Call markDirty()
+              after writing to it directly.
     @returns  A pointer to the allocated buffer
   */
   /**********************************************************************/
   uint16_t *getBuffer(void) const { return buffer; }
+  /**********************************************************************/
+  /*!
+    @brief    Get the number of dirty rectangles pending for flush()
+    @returns  0 to CANVAS_DIRTY_RECTS
+  */
+  /**********************************************************************/
+  uint8_t   dirtyCount(void) const { return _ndirty; }
+  /**********************************************************************/
+  /*!
+    @brief    Get one dirty rectangle, in buffer (rotation 0) coordinates
+    @param    i  Index, less than dirtyCount()
+    @returns  The rectangle
+  */
+  /**********************************************************************/
+  const Adafruit_Rect &dirtyRect(uint8_t i) const { return _dirty[i]; }
  private:
+  bool      bufferRect(int16_t &x, int16_t &y, int16_t &w, int16_t &h) const;
+  void      dirtyRaw(int16_t x, int16_t y, int16_t w, int16_t h);
   uint16_t *buffer;
+  Adafruit_Rect _dirty[CANVAS_DIRTY_RECTS]; ///< Changed areas, buffer coords
+  uint8_t   _ndirty;                        ///< Entries in _dirty
+  bool      _ownBuffer;   ///< buffer was malloc()ed, free it
+  uint8_t   _lastDirty;   ///< Entry the last pixel went into
+  int16_t   _x0, _y0;     ///< Buffer position of drawing (0, 0)
+  int8_t    _xx, _xy;     ///< Buffer x step per drawing x, y
+  int8_t    _yx, _yy;     ///< Buffer y step per drawing x, y
 };
 
 #endif // _ADAFRUIT_GFX_H
@@ -0,0 +1,348 @@
+/*!
+ * @file Adafruit_HALBus.cpp
+ *
+ * STM32 HAL backends for Adafruit_TFTBus. See Adafruit_HALBus.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include "Adafruit_HALBus.h"
+
+// Solid-fill line buffer used by fill(). Holds FILL_BUF_PIXELS copies of
+// the last fill color, in display (big-endian) byte order for 8-bit SPI
+// frames or native order for 16-bit frames, so a fill is a handful of
+// large transfers rather than one per pixel. Shared by all instances
+// (there's only one display SPI port) and kept out of the classes so
+// copying a display object doesn't drag the buffers along with it.
+static uint16_t fillBuf[FILL_BUF_PIXELS];
+static uint16_t fillBufColor = 0;     // Native-order color held in fillBuf
+static bool     fillBufValid = false; // false until first fill()
+
+// Ping-pong working buffers for non-blocking writePixels(). One is filled
+// by the CPU while the other is on the wire. The polled bus uses the first
+// one as scratch space for byte swapping when in 8-bit frame mode.
+static uint16_t pixelBuf[2][DMA_BUF_PIXELS];
+
+Adafruit_HALDMABus *Adafruit_HALDMABus::_active = NULL;
+
+// BLOCKING HAL BUS --------------------------------------------------------
+
+/*!
+    @brief  Adafruit_HALBus constructor.
+    @param  spi     HAL SPI handle, already initialized (MX_SPIx_Init()).
+    @param  csPort  GPIO port of the chip-select line.
+    @param  csPin   GPIO pin mask of the chip-select line.
+    @param  dcPort  GPIO port of the data/command line.
+    @param  dcPin   GPIO pin mask of the data/command line.
+*/
+Adafruit_HALBus::Adafruit_HALBus(SPI_HandleTypeDef *spi,
+  GPIO_TypeDef *csPort, uint16_t csPin, GPIO_TypeDef *dcPort, uint16_t dcPin) :
+  _spi(spi), _csPort(csPort), _dcPort(dcPort), _csPin(csPin), _dcPin(dcPin) {
+}
+
+/*!
+    @brief  Drive the chip-select line.
+    @param  high  true to deselect the display, false to select it.
+*/
+void Adafruit_HALBus::setCS(bool high) {
+    HAL_GPIO_WritePin(_csPort, _csPin, high ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/*!
+    @brief  Drive the data/command line.
+    @param  data  true for DATA mode, false for COMMAND mode.
+*/
+void Adafruit_HALBus::setDC(bool data) {
+    HAL_GPIO_WritePin(_dcPort, _dcPin, data ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/*!
+    @brief  Switch the SPI port (and its TX DMA channel, if any) between
+            8- and 16-bit frames. The data size can only change with the
+            peripheral disabled, so any transfer in flight is allowed to
+            finish first; the HAL transfer functions re-enable SPE. Does
+            nothing if the port is already in the requested mode, or if
+            USE_SPI_16BIT_PIXELS is not set.
+    @param  sixteen  true for 16-bit pixel frames, false for 8-bit
+                     command/parameter frames.
+*/
+void Adafruit_HALBus::frameSize(bool sixteen) {
+#if defined(USE_SPI_16BIT_PIXELS)
+    if(sixteen == (_spi->Init.DataSize == SPI_DATASIZE_16BIT)) return;
+    wait();
+    __HAL_SPI_DISABLE(_spi);
+    _spi->Init.DataSize = sixteen ? SPI_DATASIZE_16BIT : SPI_DATASIZE_8BIT;
+    MODIFY_REG(_spi->Instance->CR2, SPI_CR2_DS, _spi->Init.DataSize);
+    if(_spi->hdmatx) { // Channel is idle, safe to change element size
+        DMA_HandleTypeDef *dma = _spi->hdmatx;
+        dma->Init.PeriphDataAlignment =
+          sixteen ? DMA_PDATAALIGN_HALFWORD : DMA_PDATAALIGN_BYTE;
+        dma->Init.MemDataAlignment    =
+          sixteen ? DMA_MDATAALIGN_HALFWORD : DMA_MDATAALIGN_BYTE;
+        MODIFY_REG(dma->Instance->CCR, DMA_CCR_PSIZE | DMA_CCR_MSIZE,
+          dma->Init.PeriphDataAlignment | dma->Init.MemDataAlignment);
+    }
+#else
+    (void)sixteen;
+#endif
+}
+
+/*!
+    @brief  Push frames out the SPI port, polled.
+    @param  buf     Data, bytes or 16-bit words per current frame size.
+    @param  frames  Number of frames.
+    @param  block   Ignored, always blocks.
+*/
+void Adafruit_HALBus::transmit(uint8_t *buf, uint16_t frames, bool block) {
+    (void)block;
+    HAL_SPI_Transmit(_spi, buf, frames, HAL_MAX_DELAY);
+}
+
+/*!
+    @brief  Send raw bytes, in order, as 8-bit frames.
+    @param  data   Bytes to send.
+    @param  len    Number of bytes.
+    @param  block  If false (and the backend supports it) the call may
+                   return before the last chunk is out; 'data' must then
+                   stay untouched until wait() returns.
+*/
+void Adafruit_HALBus::write(const uint8_t *data, uint32_t len, bool block) {
+    frameSize(false);
+    // split data in chunks because HAL can't send more then 64K at once
+    while(len) {
+        uint16_t count = (len < 32768) ? len : 32768;
+        transmit((uint8_t *)data, count, block);
+        data += count;
+        len  -= count;
+    }
+}
+
+/*!
+    @brief  Send a burst of native-endian RGB565 pixels, blocking.
+    @param  colors  Pixel array.
+    @param  len     Number of pixels.
+    @param  block   Ignored, always blocks.
+*/
+void Adafruit_HALBus::writePixels(const uint16_t *colors, uint32_t len,
+  bool block) {
+    (void)block;
+#if defined(USE_SPI_16BIT_PIXELS)
+    frameSize(true); // SPI sends MSB first, no swap needed
+    while(len) {
+        uint16_t count = (len < 32768) ? len : 32768;
+        transmit((uint8_t *)colors, count, true);
+        colors += count;
+        len    -= count;
+    }
+#else
+    frameSize(false);
+    while(len) {
+        uint32_t count = (len < DMA_BUF_PIXELS) ? len : DMA_BUF_PIXELS;
+        for(uint32_t i=0; i<count; i++) {
+            pixelBuf[0][i] = __builtin_bswap16(*colors++);
+        }
+        transmit((uint8_t *)pixelBuf[0], count * 2, true);
+        len -= count;
+    }
+#endif
+}
+
+/*!
+    @brief  Send the same RGB565 pixel repeatedly from the fill line
+            buffer, which is only rebuilt when the color changes. A full
+            320x240 fill is 240 transfers rather than 76,800.
+    @param  color  Native-endian RGB565 color.
+    @param  len    Number of pixels.
+*/
+void Adafruit_HALBus::fill(uint16_t color, uint32_t len) {
+    if(!fillBufValid || (color != fillBufColor)) {
+        wait(); // fillBuf may still be going out from the last fill
+#if defined(USE_SPI_16BIT_PIXELS)
+        uint16_t wire = color;                    // SPI sends MSB first
+#else
+        uint16_t wire = __builtin_bswap16(color); // Big-endian bytes
+#endif
+        for(uint32_t i=0; i<FILL_BUF_PIXELS; i++) fillBuf[i] = wire;
+        fillBufColor = color;
+        fillBufValid = true;
+    }
+
+#if defined(USE_SPI_16BIT_PIXELS)
+    frameSize(true);
+    const uint16_t unit = 1; // Transfer sizes are in 16-bit frames
+#else
+    frameSize(false);
+    const uint16_t unit = 2; // Transfer sizes are in bytes
+#endif
+    while(len) {
+        uint32_t count = (len < FILL_BUF_PIXELS) ? len : FILL_BUF_PIXELS;
+        // fillBuf doesn't change between chunks, so no need to block
+        transmit((uint8_t *)fillBuf, count * unit, false);
+        len -= count;
+    }
+}
+
+/*!
+    @brief  Read raw bytes from the display in 8-bit frames.
+    @param  data  Destination buffer.
+    @param  len   Number of bytes.
+*/
+void Adafruit_HALBus::read(uint8_t *data, uint32_t len) {
+    frameSize(false);
+    while(len) {
+        uint16_t count = (len < 32768) ? len : 32768;
+        HAL_SPI_Receive(_spi, data, count, HAL_MAX_DELAY);
+        data += count;
+        len  -= count;
+    }
+}
+
+// DMA HAL BUS -------------------------------------------------------------
+
+/*!
+    @brief  Adafruit_HALDMABus constructor. The SPI handle's hdmatx must be
+            linked (HAL_SPI_MspInit() does this) and its IRQ enabled.
+    @param  spi     HAL SPI handle, already initialized (MX_SPIx_Init()).
+    @param  csPort  GPIO port of the chip-select line.
+    @param  csPin   GPIO pin mask of the chip-select line.
+    @param  dcPort  GPIO port of the data/command line.
+    @param  dcPin   GPIO pin mask of the data/command line.
+*/
+Adafruit_HALDMABus::Adafruit_HALDMABus(SPI_HandleTypeDef *spi,
+  GPIO_TypeDef *csPort, uint16_t csPin, GPIO_TypeDef *dcPort, uint16_t dcPin) :
+  Adafruit_HALBus(spi, csPort, csPin, dcPort, dcPin),
+  _busy(false), _bufIdx(0) {
+}
+
+/*!
+    @brief  Drive the chip-select line, once any DMA in flight is done.
+    @param  high  true to deselect the display, false to select it.
+*/
+void Adafruit_HALDMABus::setCS(bool high) {
+    wait(); // Don't deselect with pixels still on the wire
+    Adafruit_HALBus::setCS(high);
+}
+
+/*!
+    @brief  Drive the data/command line, once any DMA in flight is done.
+    @param  data  true for DATA mode, false for COMMAND mode.
+*/
+void Adafruit_HALDMABus::setDC(bool data) {
+    wait(); // DC must not change while pixel data is still going out
+    Adafruit_HALBus::setDC(data);
+}
+
+/*!
+    @brief  Read raw bytes, once any DMA in flight is done. Anything but a
+            very short read goes through the RX DMA channel, one transfer
+            per 32 KB, falling back on a polled read if the HAL refuses.
+            In full-duplex master mode the HAL clocks the buffer's own
+            contents out on MOSI meanwhile, which the display ignores.
+            Needs hdmarx linked and HAL_SPI_TxRxCpltCallback() forwarded
+            to complete().
+    @param  data  Destination buffer (MUST be DMA-reachable, not CCM).
+    @param  len   Number of bytes.
+*/
+void Adafruit_HALDMABus::read(uint8_t *data, uint32_t len) {
+    wait();
+    if((len < 16) || !_spi->hdmarx) {
+        Adafruit_HALBus::read(data, len);
+        return;
+    }
+    frameSize(false);
+    while(len) {
+        uint16_t count = (len < 32768) ? len : 32768;
+        _busy   = true;
+        _active = this;
+        if(HAL_SPI_Receive_DMA(_spi, data, count) != HAL_OK) {
+            _busy = false;
+            HAL_SPI_Receive(_spi, data, count, HAL_MAX_DELAY);
+        } else {
+            while(_busy);
+        }
+        data += count;
+        len  -= count;
+    }
+}
+
+/*!
+    @brief  Wait for the last DMA transfer to complete. Relies on
+            complete() being called from HAL_SPI_TxCpltCallback() (and
+            HAL_SPI_TxRxCpltCallback() for reads).
+*/
+void Adafruit_HALDMABus::wait(void) {
+    while(_busy);
+}
+
+/*!
+    @brief  DMA completion hook. The HAL only has one weak
+            HAL_SPI_TxCpltCallback() (and one HAL_SPI_TxRxCpltCallback(),
+            used by DMA reads) for all SPI ports, so the application owns
+            them and must forward both here; this clears the busy flag
+            that wait() and the next DMA transfer are waiting on.
+    @param  hspi  SPI handle passed to the HAL callback.
+*/
+void Adafruit_HALDMABus::complete(SPI_HandleTypeDef *hspi) {
+    if(_active && (_active->_spi == hspi)) _active->_busy = false;
+}
+
+/*!
+    @brief  Start a DMA transfer, first waiting for any prior transfer to
+            finish. Very short transfers are sent polled since the DMA
+            setup would cost more than it saves. Falls back on a polled
+            transfer if the HAL refuses the DMA request.
+    @param  buf     Data (MUST be in DMA-reachable RAM or flash, not CCM).
+    @param  frames  Number of frames (bytes or 16-bit words).
+    @param  block   If false, return as soon as the transfer is underway;
+                    'buf' must then stay untouched until wait() returns.
+*/
+void Adafruit_HALDMABus::transmit(uint8_t *buf, uint16_t frames, bool block) {
+    while(_busy);
+    if(frames < 16) {
+        HAL_SPI_Transmit(_spi, buf, frames, HAL_MAX_DELAY);
+        return;
+    }
+    _busy   = true;
+    _active = this;
+    if(HAL_SPI_Transmit_DMA(_spi, buf, frames) != HAL_OK) {
+        _busy = false;
+        HAL_SPI_Transmit(_spi, buf, frames, HAL_MAX_DELAY);
+    } else if(block) {
+        while(_busy);
+    }
+}
+
+/*!
+    @brief  Send a burst of native-endian RGB565 pixels through the two
+            ping-pong buffers: each chunk is copied (or byte-swapped, with
+            8-bit frames) into the idle buffer while the other one is
+            still going out, so 'colors' is free again on return.
+    @param  colors  Pixel array.
+    @param  len     Number of pixels.
+    @param  block   If true, wait for the last chunk before returning.
+*/
+void Adafruit_HALDMABus::writePixels(const uint16_t *colors, uint32_t len,
+  bool block) {
+#if defined(USE_SPI_16BIT_PIXELS)
+    frameSize(true);
+#else
+    frameSize(false);
+#endif
+    while(len) {
+        uint32_t count = (len < DMA_BUF_PIXELS) ? len : DMA_BUF_PIXELS;
+        uint16_t *dst  = pixelBuf[_bufIdx];
+#if defined(USE_SPI_16BIT_PIXELS)
+        memcpy(dst, colors, count * 2);
+        colors += count;
+        transmit((uint8_t *)dst, count, false);     // Count is in frames
+#else
+        for(uint32_t i=0; i<count; i++) {
+            dst[i] = __builtin_bswap16(*colors++);
+        }
+        transmit((uint8_t *)dst, count * 2, false);
+#endif
+        _bufIdx = 1 - _bufIdx; // Swap DMA pixel buffers
+        len    -= count;
+    }
+    if(block) wait(); // Wait for last chunk to complete
+}
@@ -0,0 +1,112 @@
+/*!
+ * @file Adafruit_HALBus.h
+ *
+ * STM32 HAL backends for Adafruit_TFTBus: a polled one built on
+ * HAL_SPI_Transmit() and a DMA one with ping-pong pixel buffers.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_HALBUS_H_
+#define _ADAFRUIT_HALBUS_H_
+
+#include "stm32f3xx_hal.h"
+#include "Adafruit_TFTBus.h"
+
+// HARDWARE CONFIG ---------------------------------------------------------
+
+// STM32 HAL DMA for bulk data (solid fills etc.). Needs hdmatx linked to
+// ILI9341_SPI_PORT (done in HAL_SPI_MspInit) and its channel IRQ enabled.
+// Comment out to fall back on polled HAL_SPI_Transmit() everywhere.
+#define USE_HAL_SPI_DMA             ///< If set, use HAL DMA for bulk writes
+
+#if defined(USE_SPI_DMA)
+ #undef USE_HAL_SPI_DMA              ///< SAMD DMA takes precedence
+#endif
+
+// Send RGB565 pixel data as 16-bit SPI frames. The SPI data size is
+// switched to 16 bits for the RAMWR data phase and back to 8 for commands
+// and parameters, so native (little-endian) pixel buffers go out in the
+// right byte order with no software swap. Comment out (or build with
+// -DUSE_SPI_8BIT_PIXELS, as the host tests do) for 8-bit frames.
+#if !defined(USE_SPI_8BIT_PIXELS)
+ #define USE_SPI_16BIT_PIXELS       ///< If set, pixel bursts use 16-bit SPI
+#endif
+
+#if !defined(FILL_BUF_PIXELS)
+ #define FILL_BUF_PIXELS 320         ///< fill() line buffer, pixels
+#endif
+#if !defined(DMA_BUF_PIXELS)
+ #define DMA_BUF_PIXELS  320         ///< Each of 2 writePixels() buffers
+#endif
+
+/*!
+  @brief  Blocking STM32 HAL SPI bus. Every transfer is complete when the
+          call returns.
+*/
+class Adafruit_HALBus : public Adafruit_TFTBus {
+
+  public:
+
+    Adafruit_HALBus(SPI_HandleTypeDef *spi,
+      GPIO_TypeDef *csPort, uint16_t csPin,
+      GPIO_TypeDef *dcPort, uint16_t dcPin);
+
+    void         setCS(bool high);
+    void         setDC(bool data);
+    void         write(const uint8_t *data, uint32_t len, bool block = true);
+    void         writePixels(const uint16_t *colors, uint32_t len,
+                   bool block = true);
+    void         fill(uint16_t color, uint32_t len);
+    void         read(uint8_t *data, uint32_t len);
+
+  protected:
+
+    // Switch the SPI (and TX DMA channel) between 8- and 16-bit frames.
+    void         frameSize(bool sixteen);
+    // Push 'frames' 8- or 16-bit frames (per current frameSize()).
+    // Polled here; the DMA subclass may return before completion if
+    // 'block' is false.
+    virtual void transmit(uint8_t *buf, uint16_t frames, bool block);
+
+    SPI_HandleTypeDef *_spi;       ///< HAL SPI handle
+    GPIO_TypeDef      *_csPort;    ///< Chip-select GPIO port
+    GPIO_TypeDef      *_dcPort;    ///< Data/command GPIO port
+    uint16_t           _csPin;     ///< Chip-select GPIO pin mask
+    uint16_t           _dcPin;     ///< Data/command GPIO pin mask
+};
+
+/*!
+  @brief  STM32 HAL SPI bus using the TX DMA channel linked to the SPI
+          handle. Pixel bursts are copied into one of two ping-pong
+          buffers while the other is on the wire, so callers can prepare
+          the next row during the transfer. The application must forward
+          HAL_SPI_TxCpltCallback() to complete().
+*/
+class Adafruit_HALDMABus : public Adafruit_HALBus {
+
+  public:
+
+    Adafruit_HALDMABus(SPI_HandleTypeDef *spi,
+      GPIO_TypeDef *csPort, uint16_t csPin,
+      GPIO_TypeDef *dcPort, uint16_t dcPin);
+
+    void         setCS(bool high);
+    void         setDC(bool data);
+    void         writePixels(const uint16_t *colors, uint32_t len,
+                   bool block = true);
+    void         read(uint8_t *data, uint32_t len);
+    void         wait(void);
+
+    static void  complete(SPI_HandleTypeDef *hspi);
+
+  protected:
+
+    void         transmit(uint8_t *buf, uint16_t frames, bool block);
+
+    volatile bool              _busy;   ///< DMA transfer in progress
+    uint8_t                    _bufIdx; ///< Next ping-pong buffer to fill
+    static Adafruit_HALDMABus *_active; ///< Bus that owns the last DMA
+};
+
+#endif // end _ADAFRUIT_HALBUS_H_
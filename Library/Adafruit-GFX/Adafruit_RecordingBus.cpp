@@ -0,0 +1,220 @@
+/*!
+ * @file Adafruit_RecordingBus.cpp
+ *
+ * Host-side recording backend for Adafruit_TFTBus. See
+ * Adafruit_RecordingBus.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Adafruit_RecordingBus.h"
+
+// ILI9341 commands understood by the recorder (same values as in
+// Adafruit_ILI9341.h, repeated so this file needs nothing but the bus).
+#define REC_CASET    0x2A ///< Column address set
+#define REC_PASET    0x2B ///< Page address set
+#define REC_RAMWR    0x2C ///< Memory write
+#define REC_RAMRD    0x2E ///< Memory read
+#define REC_MADCTL   0x36 ///< Memory access control
+#define REC_RAMWRC   0x3C ///< Memory write continue
+#define REC_RAMRDC   0x3E ///< Memory read continue
+
+/*!
+    @brief  Adafruit_RecordingBus constructor. Allocates a cleared
+            (black) framebuffer and sets the address window to all of it.
+    @param  w  Framebuffer width, i.e. column address range.
+    @param  h  Framebuffer height, i.e. page address range.
+*/
+Adafruit_RecordingBus::Adafruit_RecordingBus(uint16_t w, uint16_t h) :
+  _w(w), _h(h), _cs(true), _dc(true) {
+    _fb = (uint16_t *)calloc((uint32_t)w * h, sizeof(uint16_t));
+    _xs = _ys = _x = _y = 0;
+    _xe = w - 1;
+    _ye = h - 1;
+    _param = 0;
+    _cmd = 0;
+    _nparam = 0;
+    _madctl = 0;
+    _readPhase = 0;
+    _readColor = 0;
+    reset();
+}
+
+/*!
+    @brief  Adafruit_RecordingBus destructor. Frees the framebuffer.
+*/
+Adafruit_RecordingBus::~Adafruit_RecordingBus(void) {
+    if(_fb) free(_fb);
+}
+
+/*!
+    @brief  Clear all counters. The framebuffer and controller state are
+            left alone, so a test can draw a background, reset(), then
+            measure just the operation of interest.
+*/
+void Adafruit_RecordingBus::reset(void) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+/*!
+    @brief   Read back a pixel from the virtual framebuffer.
+    @param   x  Column.
+    @param   y  Page (row).
+    @return  Native RGB565 color, or 0 if out of range.
+*/
+uint16_t Adafruit_RecordingBus::getPixel(uint16_t x, uint16_t y) const {
+    if(!_fb || (x >= _w) || (y >= _h)) return 0;
+    return _fb[(uint32_t)y * _w + x];
+}
+
+/*!
+    @brief  Record a chip-select change.
+    @param  high  true to deselect the display, false to select it.
+*/
+void Adafruit_RecordingBus::setCS(bool high) {
+    if(high != _cs) _stats.csToggles++;
+    _cs = high;
+}
+
+/*!
+    @brief  Record a data/command change.
+    @param  data  true for DATA mode, false for COMMAND mode.
+*/
+void Adafruit_RecordingBus::setDC(bool data) {
+    if(data != _dc) _stats.dcToggles++;
+    _dc = data;
+}
+
+/*!
+    @brief  Store one pixel at the RAMWR cursor and advance it, wrapping
+            within the CASET/PASET window as the controller does. Pixels
+            falling outside the framebuffer are counted but dropped.
+    @param  color  Native RGB565 color.
+*/
+void Adafruit_RecordingBus::pixel(uint16_t color) {
+    if(_fb && (_x < _w) && (_y < _h)) _fb[(uint32_t)_y * _w + _x] = color;
+    _stats.pixels++;
+    if(++_x > _xe) {
+        _x = _xs;
+        if(++_y > _ye) _y = _ys;
+    }
+}
+
+/*!
+    @brief  Interpret one parameter/data byte for the current command.
+    @param  b  Byte received with DC high.
+*/
+void Adafruit_RecordingBus::dataByte(uint8_t b) {
+    _param = (_param << 8) | b;
+    _nparam++;
+    switch(_cmd) {
+      case REC_CASET:
+        if(_nparam == 2) _xs = _param;
+        else if(_nparam == 4) _xe = _param;
+        break;
+      case REC_PASET:
+        if(_nparam == 2) _ys = _param;
+        else if(_nparam == 4) _ye = _param;
+        break;
+      case REC_RAMWR:
+      case REC_RAMWRC:
+        if(!(_nparam & 1)) pixel(_param); // Big-endian byte pairs
+        break;
+      case REC_MADCTL:
+        if(_nparam == 1) _madctl = b;
+        break;
+    }
+}
+
+/*!
+    @brief  Record bytes. With DC low each byte is a command; with DC high
+            they're parameters or big-endian pixel data.
+    @param  data   Bytes sent.
+    @param  len    Number of bytes.
+    @param  block  Ignored; the recorder is always synchronous.
+*/
+void Adafruit_RecordingBus::write(const uint8_t *data, uint32_t len,
+  bool block) {
+    (void)block;
+    _stats.transactions++;
+    _stats.bytes += len;
+    while(len--) {
+        uint8_t b = *data++;
+        if(_dc) {
+            dataByte(b);
+            continue;
+        }
+        _stats.commands[b]++;
+        _cmd    = b;
+        _nparam = 0;
+        _param  = 0;
+        if((b == REC_RAMWR) || (b == REC_RAMRD)) {
+            _x = _xs;
+            _y = _ys;
+        }
+        if(b == REC_RAMRD) _readPhase = 0;
+    }
+}
+
+/*!
+    @brief  Record a burst of native RGB565 pixels.
+    @param  colors  Pixel array.
+    @param  len     Number of pixels.
+    @param  block   Ignored; the recorder is always synchronous.
+*/
+void Adafruit_RecordingBus::writePixels(const uint16_t *colors, uint32_t len,
+  bool block) {
+    (void)block;
+    _stats.transactions++;
+    _stats.bytes += len * 2;
+    while(len--) pixel(*colors++);
+}
+
+/*!
+    @brief  Record a solid fill.
+    @param  color  Native RGB565 color.
+    @param  len    Number of pixels.
+*/
+void Adafruit_RecordingBus::fill(uint16_t color, uint32_t len) {
+    _stats.transactions++;
+    _stats.bytes += len * 2;
+    while(len--) pixel(color);
+}
+
+/*!
+    @brief  Return bytes as the controller would. After RAMRD (or read
+            continue) that's one dummy byte then R, G, B per pixel in the
+            top 6 bits of each byte; anything else reads as zero.
+    @param  data  Destination buffer.
+    @param  len   Number of bytes.
+*/
+void Adafruit_RecordingBus::read(uint8_t *data, uint32_t len) {
+    _stats.transactions++;
+    _stats.bytes += len;
+    bool ram = (_cmd == REC_RAMRD) || (_cmd == REC_RAMRDC);
+    while(len--) {
+        uint8_t b = 0;
+        if(ram) {
+            if(_readPhase == 0) {      // Dummy byte
+                _readPhase = 1;
+            } else {
+                if(_readPhase == 1) _readColor = getPixel(_x, _y);
+                switch(_readPhase) {
+                  case 1: b = (_readColor >> 8) & 0xF8;  break;
+                  case 2: b = (_readColor >> 3) & 0xFC;  break;
+                  case 3: b = (_readColor << 3) & 0xF8;  break;
+                }
+                if(++_readPhase > 3) {
+                    _readPhase = 1;
+                    if(++_x > _xe) {
+                        _x = _xs;
+                        if(++_y > _ye) _y = _ys;
+                    }
+                }
+            }
+        }
+        *data++ = b;
+    }
+}
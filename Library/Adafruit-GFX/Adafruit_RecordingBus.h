@@ -0,0 +1,109 @@
+/*!
+ * @file Adafruit_RecordingBus.h
+ *
+ * Host-side Adafruit_TFTBus that emulates just enough of an ILI9341 to
+ * capture what the library draws, and counts what it costs on the wire.
+ * No HAL dependency: build it with the GFX sources on a PC and
+ * -DADAFRUIT_GFX_HOST (extras/host has the Makefile and tests), point a
+ * display at it with setBus(), then inspect getPixel() and the counters.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_RECORDINGBUS_H_
+#define _ADAFRUIT_RECORDINGBUS_H_
+
+#include "Adafruit_TFTBus.h"
+
+/*!
+  @brief  Wire-level statistics collected by Adafruit_RecordingBus.
+*/
+struct Adafruit_BusStats {
+    uint32_t bytes;          ///< Bytes on the wire (pixels count as 2)
+    uint32_t transactions;   ///< write/writePixels/fill/read calls
+    uint32_t dcToggles;      ///< Changes of the data/command line
+    uint32_t csToggles;      ///< Changes of the chip-select line
+    uint32_t pixels;         ///< Pixels written through RAMWR
+    uint32_t commands[256];  ///< Per-command-byte histogram
+    uint32_t elided[256];    ///< Commands the driver skipped (cache hits)
+};
+
+/*!
+  @brief  Recording display bus. Decodes CASET, PASET, RAMWR, memory write
+          continue and RAMRD into a virtual RGB565 framebuffer addressed
+          exactly as the controller's column/page registers are (so with
+          MADCTL row/column exchange set, width is the long side).
+          Everything else is counted and otherwise ignored.
+*/
+class Adafruit_RecordingBus : public Adafruit_TFTBus {
+
+  public:
+
+    Adafruit_RecordingBus(uint16_t w = 320, uint16_t h = 240);
+    ~Adafruit_RecordingBus(void);
+
+    void         setCS(bool high);
+    void         setDC(bool data);
+    void         write(const uint8_t *data, uint32_t len, bool block = true);
+    void         writePixels(const uint16_t *colors, uint32_t len,
+                   bool block = true);
+    void         fill(uint16_t color, uint32_t len);
+    void         read(uint8_t *data, uint32_t len);
+    /*!
+        @brief  Count a command the driver skipped.
+        @param  cmd  Command byte.
+    */
+    void         elided(uint8_t cmd) { _stats.elided[cmd]++; }
+
+    void         reset(void);
+    uint16_t     getPixel(uint16_t x, uint16_t y) const;
+
+    /*!
+        @brief   Get the counters accumulated since construction or the
+                 last reset().
+        @return  Reference to the statistics structure.
+    */
+    const Adafruit_BusStats &stats(void) const { return _stats; }
+    /*!
+        @brief   Get the virtual framebuffer (row-major, native RGB565).
+        @return  Pointer to width() * height() pixels, or NULL if the
+                 allocation failed.
+    */
+    uint16_t    *getBuffer(void) const { return _fb; }
+    /*!
+        @brief   Get framebuffer width (column address range).
+        @return  Width in pixels.
+    */
+    uint16_t     width(void) const { return _w; }
+    /*!
+        @brief   Get framebuffer height (page address range).
+        @return  Height in pixels.
+    */
+    uint16_t     height(void) const { return _h; }
+    /*!
+        @brief   Get the last MADCTL value written (not applied).
+        @return  MADCTL byte.
+    */
+    uint8_t      madctl(void) const { return _madctl; }
+
+  private:
+
+    void         dataByte(uint8_t b);
+    void         pixel(uint16_t color);
+
+    Adafruit_BusStats _stats;  ///< Wire statistics
+    uint16_t *_fb;             ///< Virtual framebuffer
+    uint16_t  _w, _h;          ///< Framebuffer size
+    uint16_t  _xs, _xe;        ///< CASET window
+    uint16_t  _ys, _ye;        ///< PASET window
+    uint16_t  _x, _y;          ///< RAMWR/RAMRD cursor
+    uint16_t  _param;          ///< Parameter word being assembled
+    uint8_t   _cmd;            ///< Last command byte
+    uint8_t   _nparam;         ///< Parameter bytes seen since command
+    uint8_t   _madctl;         ///< Last MADCTL value
+    uint8_t   _readPhase;      ///< RAMRD byte position (0 = dummy)
+    uint16_t  _readColor;      ///< RAMRD pixel being returned
+    bool      _cs, _dc;        ///< Current control line levels
+};
+
+#endif // end _ADAFRUIT_RECORDINGBUS_H_
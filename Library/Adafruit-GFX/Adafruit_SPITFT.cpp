@@ -33,8 +33,23 @@
 
 
 
+#include <stdlib.h>
+#include <string.h>
 #include "Adafruit_SPITFT.h"
 
+#if !defined(ADAFRUIT_GFX_HOST)
+ #include "Adafruit_HALBus.h"
+
+extern SPI_HandleTypeDef ILI9341_SPI_PORT;
+
+#define ILI9341_RES_Pin       GPIO_PIN_5
+#define ILI9341_RES_GPIO_Port GPIOC
+#define ILI9341_CS_Pin        GPIO_PIN_6
+#define ILI9341_CS_GPIO_Port  GPIOC
+#define ILI9341_DC_Pin        GPIO_PIN_4
+#define ILI9341_DC_GPIO_Port  GPIOC
+#endif
+
 #if defined(__AVR__)
 #if defined(__AVR_XMEGA__)  //only tested with __AVR_ATmega4809__
 #define AVR_WRITESPI(x) for(SPI0_DATA = (x); (!(SPI0_INTFLAGS & _BV(SPI_IF_bp))); )
@@ -97,6 +112,99 @@
 #define TFT_SOFT_SPI 1  ///< Display interface = software SPI
 #define TFT_PARALLEL 2  ///< Display interface = 8- or 16-bit parallel
 
+// Default transport for all instances: the ILI9341 SPI port and control
+// pins, through DMA if enabled. Use setBus() to substitute another backend
+// (e.g. Adafruit_RecordingBus on a host).
+#if defined(ADAFRUIT_GFX_HOST)
+static uint32_t hostMillis = 0; // Simulated clock, see tftMillis()
+#elif defined(USE_HAL_SPI_DMA)
+static Adafruit_HALDMABus halBus(&ILI9341_SPI_PORT,
+  ILI9341_CS_GPIO_Port, ILI9341_CS_Pin, ILI9341_DC_GPIO_Port, ILI9341_DC_Pin);
+#else
+static Adafruit_HALBus    halBus(&ILI9341_SPI_PORT,
+  ILI9341_CS_GPIO_Port, ILI9341_CS_Pin, ILI9341_DC_GPIO_Port, ILI9341_DC_Pin);
+#endif
+
+/*!
+    @brief   Transport used by newly constructed displays.
+    @return  Pointer to the default HAL (or HAL DMA) bus; NULL in a host
+             build, where there's no hardware to default to.
+*/
+Adafruit_TFTBus *Adafruit_SPITFT::defaultBus(void) {
+#if defined(ADAFRUIT_GFX_HOST)
+    return NULL;
+#else
+    return &halBus;
+#endif
+}
+
+/*!
+    @brief   Milliseconds since start-up, for the controller's delays.
+    @return  HAL_GetTick(); on a host a simulated clock that every read
+             moves on 1 ms, so polling for a delay always ends.
+*/
+uint32_t Adafruit_SPITFT::tftMillis(void) {
+#if defined(ADAFRUIT_GFX_HOST)
+    return hostMillis++;
+#else
+    return HAL_GetTick();
+#endif
+}
+
+/*!
+    @brief   Pulse the display's hardware reset line (nothing on a host).
+*/
+void Adafruit_SPITFT::Reset(void) {
+#if !defined(ADAFRUIT_GFX_HOST)
+    HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_RESET);
+    HAL_Delay(5);
+    HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_SET);
+#endif
+}
+
+// Display list entry for deferred rendering: a solid rectangle, or (with
+// DEFER_BITMAP set in w) a rectangle of pixels from the caller's bitmap,
+// whose pointer and pitch are kept in deferBitmaps[color]. Kept to 10
+// bytes since a text-heavy screen easily runs to hundreds of entries.
+typedef struct {
+    uint16_t x, y, w, h; // Preclipped, so never negative
+    uint16_t color;      // Fill color, or deferBitmaps[] slot
+} DeferOp;
+
+typedef struct {
+    const uint16_t *pixels; // Top-left pixel of the clipped rectangle
+    int16_t         stride; // Row pitch in pixels
+} DeferBitmap;
+
+#define DEFER_BITMAP  0x8000 ///< Flag in DeferOp.w: bitmap, not solid
+#define DEFER_BITMAPS 8      ///< Bitmap references per flush
+
+// Deferred rendering state. Like the bus buffers these are shared (one
+// display). With DEFER_STATIC the buffers are permanent, otherwise they're
+// only allocated while setDeferred(true) is in effect.
+#if defined(DEFER_STATIC)
+static DeferOp     deferOps[DEFER_LIST_LEN];
+static uint16_t    deferPixels[DEFER_STRIP_PIXELS];
+static uint8_t     deferBits[(DEFER_STRIP_PIXELS + 7) / 8];
+static DeferOp    *const deferList  = deferOps;
+static uint16_t   *const deferStrip = deferPixels;
+static uint8_t    *const deferMask  = deferBits;
+#else
+static DeferOp    *deferList   = NULL; // DEFER_LIST_LEN entries
+static uint16_t   *deferStrip  = NULL; // DEFER_STRIP_PIXELS pixels
+static uint8_t    *deferMask   = NULL; // Strip coverage, 1 bit per pixel
+#endif
+static uint16_t    deferCount  = 0;    // Entries in use
+static DeferBitmap deferBitmaps[DEFER_BITMAPS];
+static uint8_t     deferNumBitmaps = 0;
+
+// Mark n consecutive strip pixels, starting at index i, as covered.
+static void deferMaskSet(uint32_t i, int16_t n) {
+    while(n && (i & 7)) { deferMask[i >> 3] |= 1 << (i & 7); i++; n--; }
+    while(n >= 8)       { deferMask[i >> 3]  = 0xFF; i += 8; n -= 8; }
+    while(n-- > 0)      { deferMask[i >> 3] |= 1 << (i & 7); i++; }
+}
+
 
 // CONSTRUCTORS ------------------------------------------------------------
 
@@ -244,7 +352,13 @@ Adafruit_SPITFT::Adafruit_SPITFT(uint16_t w, uint16_t h, int8_t cs,
 }
 #else  // !ESP8266
 Adafruit_SPITFT::Adafruit_SPITFT(uint16_t w, uint16_t h, int8_t cs,
-	int8_t dc, int8_t rst) : Adafruit_SPITFT(w, h, &ILI9341_SPI_PORT, cs, dc, rst) {
+	int8_t dc, int8_t rst) : Adafruit_SPITFT(w, h,
+#if defined(ADAFRUIT_GFX_HOST)
+	(SPI_HandleTypeDef *)NULL,
+#else
+	&ILI9341_SPI_PORT,
+#endif
+	cs, dc, rst) {
     // This just invokes the hardware SPI constructor below,
     // passing the default SPI device (&SPI).
 }
@@ -541,12 +655,14 @@ void Adafruit_SPITFT::initSPI(uint32_t freq, uint8_t spiMode) {
 
     if(_rst >= 0) {
         // Toggle _rst low to reset
+#if !defined(ADAFRUIT_GFX_HOST)
         HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_SET);
 	    HAL_Delay(100);
 		HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_RESET);
 	    HAL_Delay(100);
 	    HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_SET);
 	    HAL_Delay(100);
+#endif
     }
 
 
@@ -556,9 +672,11 @@ void Adafruit_SPITFT::initSPI(uint32_t freq, uint8_t spiMode) {
     @brief  Call before issuing command(s) or data to display. Performs
             chip-select (if required) and starts an SPI transaction (if
             using hardware SPI and transactions are supported). Required
-            for all display types; not an SPI-specific function.
+            for all display types; not an SPI-specific function. In
+            deferred mode calls nest, and only the outermost one selects.
 */
 void Adafruit_SPITFT::startWrite(void) {
+    if(_deferring && _writeDepth++) return; // Already selected
     SPI_BEGIN_TRANSACTION();
     if(_cs >= 0) SPI_CS_LOW();
 }
@@ -567,11 +685,21 @@ void Adafruit_SPITFT::startWrite(void) {
     @brief  Call after issuing command(s) or data to display. Performs
             chip-deselect (if required) and ends an SPI transaction (if
             using hardware SPI and transactions are supported). Required
-            for all display types; not an SPI-specific function.
+            for all display types; not an SPI-specific function. In
+            deferred mode the outermost call flushes the display list.
 */
 void Adafruit_SPITFT::endWrite(void) {
-    if(_cs >= 0) SPI_CS_HIGH();
+    if(_deferring) {
+        if(_writeDepth > 1) {   // Not the outermost endWrite() yet
+            _writeDepth--;
+            return;
+        }
+        flushDeferred();        // Rasterize and send the display list
+        _writeDepth = 0;
+    }
+    if(_cs >= 0) SPI_CS_HIGH(); // Bus waits for pending pixels first
     SPI_END_TRANSACTION();
+    _lastCommand = 0x00;        // Don't assume RAMWR survives deselect
 }
 
 
@@ -592,6 +720,10 @@ void Adafruit_SPITFT::endWrite(void) {
 */
 void Adafruit_SPITFT::writePixel(int16_t x, int16_t y, uint16_t color) {
     if((x >= 0) && (x < _width) && (y >= 0) && (y < _height)) {
+        if(_deferring) {
+            deferRect(x, y, 1, 1, color);
+            return;
+        }
         setAddrWindow(x, y, 1, 1);
         SPI_WRITE16(color);
     }
@@ -629,6 +761,7 @@ void Adafruit_SPITFT::writePixels(uint16_t *colors, uint32_t len,
   bool block, bool bigEndian) {
 
     if(!len) return; // Avoid 0-byte transfers
+    _dataCount += len * 2;
 
 #if defined(ESP32) // ESP32 has a special SPI pixel-writing function...
     if(connection == TFT_HARD_SPI) {
@@ -721,18 +854,20 @@ void Adafruit_SPITFT::writePixels(uint16_t *colors, uint32_t len,
     }
 #endif // end USE_SPI_DMA
 
-    // All other cases (bitbang SPI or non-DMA hard SPI or parallel),
-    // use a loop with the normal 16-bit data write function:
-    while(len--) {
-        SPI_WRITE16(*colors++);
-    }
+    // All other cases go through the bus backend, which takes care of any
+    // byte swapping, SPI frame size and DMA itself:
+    SPI_DC_HIGH();
+    if(bigEndian) bus->write((uint8_t *)colors, len * 2, block);
+    else          bus->writePixels(colors, len, block);
 }
 
 /*!
     @brief  Wait for the last DMA transfer in a prior non-blocking
             writePixels() call to complete. This does nothing if DMA
             is not enabled, and is not needed if blocking writePixels()
-            was used (as is the default case).
+            was used (as is the default case). With USE_HAL_SPI_DMA this
+            relies on dmaComplete() being called from the application's
+            HAL_SPI_TxCpltCallback(); with any other bus it's bus->wait().
 */
 void Adafruit_SPITFT::dmaWait(void) {
 #if defined(USE_SPI_DMA)
@@ -745,19 +880,31 @@ void Adafruit_SPITFT::dmaWait(void) {
         pinPeripheral(tft8._wr, PIO_OUTPUT); // Switch WR back to GPIO
     }
  #endif // end __SAMD51__ || _SAMD21_
+#else
+    bus->wait();
+#endif
+}
+
+/*!
+    @brief  DMA completion hook. The HAL only has one weak
+            HAL_SPI_TxCpltCallback() for all SPI ports, so the application
+            owns it and must forward it here; this is passed on to
+            Adafruit_HALDMABus::complete() to clear the busy flag that
+            dmaWait() and the next DMA transfer are waiting on.
+    @param  hspi  SPI handle passed to HAL_SPI_TxCpltCallback().
+*/
+void Adafruit_SPITFT::dmaComplete(SPI_HandleTypeDef *hspi) {
+#if defined(ADAFRUIT_GFX_HOST)
+    (void)hspi;
+#else
+    Adafruit_HALDMABus::complete(hspi);
 #endif
 }
 
 void Adafruit_SPITFT::WriteData(uint8_t* buff, size_t buff_size) {
-	HAL_GPIO_WritePin(ILI9341_DC_GPIO_Port, ILI9341_DC_Pin, GPIO_PIN_SET);
-
-	// split data in small chunks because HAL can't send more then 64K at once
-	while(buff_size > 0) {
-		uint16_t chunk_size = buff_size > 32768 ? 32768 : buff_size;
-		HAL_SPI_Transmit(&ILI9341_SPI_PORT, buff, chunk_size, HAL_MAX_DELAY);
-		buff += chunk_size;
-		buff_size -= chunk_size;
-	}
+	SPI_DC_HIGH();
+	bus->write(buff, buff_size);
+	_dataCount += buff_size;
 }
 
 /*!
@@ -765,23 +912,16 @@ void Adafruit_SPITFT::WriteData(uint8_t* buff, size_t buff_size) {
             contained; should follow startWrite() and setAddrWindow() calls.
     @param  color  16-bit pixel color in '565' RGB format.
     @param  len    Number of pixels to draw.
+    @note   Handed to the bus as a single fill; the HAL backends stream it
+            from a line buffer rather than pixel by pixel.
 */
 void Adafruit_SPITFT::writeColor(uint16_t color, uint32_t len) {
 
     if(!len) return; // Avoid 0-byte transfers
 
-    uint8_t hi = color >> 8, lo = color;
-
-        while(len--) {
- 
-	        uint8_t data[] = { color >> 8, color & 0xFF };
-	        WriteData(data, sizeof(data));
-	        
-
-
-        }
-
-    
+    SPI_DC_HIGH();
+    bus->fill(color, len);
+    _dataCount += len * 2;
 }
 
 /*!
@@ -916,6 +1056,10 @@ void inline Adafruit_SPITFT::writeFastVLine(int16_t x, int16_t y, int16_t h,
 */
 inline void Adafruit_SPITFT::writeFillRectPreclipped(int16_t x, int16_t y,
   int16_t w, int16_t h, uint16_t color) {
+    if(_deferring) {
+        deferRect(x, y, w, h, color);
+        return;
+    }
     setAddrWindow(x, y, w, h);
     writeColor(color, (uint32_t)w * h);
 }
@@ -943,8 +1087,12 @@ void Adafruit_SPITFT::drawPixel(int16_t x, int16_t y, uint16_t color) {
     if((x >= 0) && (x < _width) && (y >= 0) && (y < _height)) {
         // THEN set up transaction (if needed) and draw...
         startWrite();
-        setAddrWindow(x, y, 1, 1);
-        SPI_WRITE16(color);
+        if(_deferring) {
+            deferRect(x, y, 1, 1, color);
+        } else {
+            setAddrWindow(x, y, 1, 1);
+            SPI_WRITE16(color);
+        }
         endWrite();
     }
 }
@@ -1103,9 +1251,11 @@ void Adafruit_SPITFT::pushColor(uint16_t color) {
     @param  pcolors  Pointer to 16-bit array of pixel values.
     @param  w        Width of bitmap in pixels.
     @param  h        Height of bitmap in pixels.
+    @param  stride   Pixels from one bitmap row to the next, for drawing
+                     part of a larger image; 0 (default) for w.
 */
 void Adafruit_SPITFT::drawRGBBitmap(int16_t x, int16_t y,
-  uint16_t *pcolors, int16_t w, int16_t h) {
+  uint16_t *pcolors, int16_t w, int16_t h, int16_t stride) {
 
     int16_t x2, y2; // Lower-right coord
     if(( x             >= _width ) ||      // Off-edge right
@@ -1113,8 +1263,8 @@ void Adafruit_SPITFT::drawRGBBitmap(int16_t x, int16_t y,
        ((x2 = (x+w-1)) <  0      ) ||      // " left
        ((y2 = (y+h-1)) <  0)     ) return; // " bottom
 
-    int16_t bx1=0, by1=0, // Clipped top-left within bitmap
-            saveW=w;      // Save original bitmap width value
+    int16_t bx1=0, by1=0,           // Clipped top-left within bitmap
+            saveW=stride ? stride : w; // Bitmap row pitch
     if(x < 0) { // Clip left
         w  +=  x;
         bx1 = -x;
@@ -1130,12 +1280,468 @@ void Adafruit_SPITFT::drawRGBBitmap(int16_t x, int16_t y,
 
     pcolors += by1 * saveW + bx1; // Offset bitmap ptr to clipped top-left
     startWrite();
+    if(_deferring) { // Referenced, not copied: see setDeferred()
+        deferRect(x, y, w, h, 0, pcolors, saveW);
+        endWrite();
+        return;
+    }
     setAddrWindow(x, y, w, h); // Clipped area
     while(h--) { // For each (clipped) scanline...
-      writePixels(pcolors, w); // Push one (clipped) row
+      // Non-blocking: next row is swapped while this one goes out
+      writePixels(pcolors, w, false); // Push one (clipped) row
       pcolors += saveW; // Advance pointer by one full (unclipped) line
     }
+    endWrite(); // Waits for the last row
+}
+
+
+// -------------------------------------------------------------------------
+// Opaque text runs. With a background color every glyph is a solid cell,
+// so a whole line of text is one rectangle: rasterize it a pixel row at a
+// time and send it as one address window, instead of the per-pixel (size
+// 1) or per-dot-rectangle (size 2+) windows of drawChar().
+
+static uint16_t textRow[TEXT_RUN_PIXELS]; // One rasterized pixel row
+
+/*!
+    @brief   Print hook. Transparent text (setTextColor(c)) goes through
+             Adafruit_GFX::write() a character at a time as before; opaque
+             text is split at newlines and handed to textRun().
+    @param   buffer  Characters to print.
+    @param   size    Number of characters.
+    @return  Number of characters consumed (always size).
+*/
+size_t Adafruit_SPITFT::write(const uint8_t *buffer, size_t size) {
+    if(textcolor == textbgcolor) return Print::write(buffer, size);
+
+    startWrite();
+    size_t i = 0;
+    while(i < size) {
+        uint8_t c = buffer[i];
+        if((c == '\n') || (c == '\r')) {
+            Adafruit_GFX::write(c);
+            i++;
+            continue;
+        }
+        size_t n = 1;
+        while((i + n < size) && (n < 0xFFFF) &&
+          (buffer[i + n] != '\n') && (buffer[i + n] != '\r')) n++;
+        i += textRun(&buffer[i], n);
+    }
     endWrite();
+    return size;
+}
+
+/*!
+    @brief   Draw as much of a run of printable characters as fits on the
+             current text line, opaque, with one address window. Wrapping
+             follows Adafruit_GFX::write(). GFXfont runs are as tall as the
+             font's tallest glyph extent, so consecutive runs line up.
+             Runs wider than TEXT_RUN_PIXELS stop at the last character
+             that fits and the rest goes in the next run. If the run's box
+             isn't entirely on screen the characters are drawn one at a
+             time instead, over the box's background. Needs startWrite().
+    @param   s  Characters, no '\n' or '\r'.
+    @param   n  Number of characters, at least 1.
+    @return  Number of characters consumed, at least 1.
+*/
+uint16_t Adafruit_SPITFT::textRun(const uint8_t *s, uint16_t n) {
+    int16_t  sx = textsize_x, sy = textsize_y;
+    int16_t  x0, x1, top, rows;      // Run box; rows in font units
+    int16_t  asc = 0;                // GFXfont: top row rel. to baseline
+    uint16_t count;
+
+    if(!gfxFont) {
+        int16_t cw = 6 * sx;
+        if(wrap && ((cursor_x + cw) > _width)) { // As in Adafruit_GFX::write()
+            cursor_x  = 0;
+            cursor_y += 8 * sy;
+        }
+        count = n;
+        if(wrap && (cursor_x + (int32_t)count * cw > _width)) {
+            int16_t fit = (_width - cursor_x) / cw;
+            count = (fit > 0) ? fit : 1;
+        }
+        if((int32_t)count * cw > TEXT_RUN_PIXELS) {
+            count = (TEXT_RUN_PIXELS >= cw) ? TEXT_RUN_PIXELS / cw : 1;
+        }
+        x0   = cursor_x;
+        x1   = cursor_x + count * cw;
+        top  = cursor_y;
+        rows = 8;
+    } else {
+        uint8_t  first = gfxFont->first, last = gfxFont->last;
+        int16_t  pen   = cursor_x;
+        if(gfxFont->glyph != _runGlyphs) {
+            // Vertical extent of the whole font, so every run is the same
+            // height. Only scanned when the font changes; keyed on the
+            // glyph table rather than the GFXfont so a font struct that
+            // is refilled in place (e.g. built in RAM) is noticed.
+            int16_t a = 0x7FFF, d = 0;
+            for(uint16_t g=0; g<=(uint16_t)(last - first); g++) {
+                GFXglyph *glyph = &gfxFont->glyph[g];
+                if(!glyph->width || !glyph->height) continue;
+                if(glyph->yOffset < a) a = glyph->yOffset;
+                if(glyph->yOffset + glyph->height > d) {
+                    d = glyph->yOffset + glyph->height;
+                }
+            }
+            if(a > d) a = d; // No bitmaps at all
+            _runGlyphs  = gfxFont->glyph;
+            _runAsc     = a;
+            _runDesc    = d;
+            _runAdvance = gfxFont->yAdvance;
+        }
+        asc = _runAsc;
+        x0 = x1 = cursor_x;
+        for(count=0; count<n; count++) {
+            uint8_t c = s[count];
+            if((c < first) || (c > last)) continue; // Skipped, as in write()
+            GFXglyph *glyph = &gfxFont->glyph[c - first];
+            int16_t   gx0   = x0, gx1 = x1;
+            if(glyph->width && glyph->height) {
+                int16_t xo = glyph->xOffset;
+                if(wrap && ((pen + sx * (xo + glyph->width)) > _width)) {
+                    if(count) break;   // Next run starts the new line
+                    cursor_x  = pen = x0 = x1 = gx0 = gx1 = 0;
+                    cursor_y += sy * _runAdvance;
+                }
+                if(pen + xo * sx < gx0) gx0 = pen + xo * sx;
+                if(pen + (xo + glyph->width) * sx > gx1) {
+                    gx1 = pen + (xo + glyph->width) * sx;
+                }
+            }
+            if(pen + glyph->xAdvance * sx > gx1) {
+                gx1 = pen + glyph->xAdvance * sx;
+            }
+            if(count && ((gx1 - gx0) > TEXT_RUN_PIXELS)) break; // Row full
+            pen += glyph->xAdvance * sx;
+            x0   = gx0;
+            x1   = gx1;
+        }
+        top  = cursor_y + asc * sy;
+        rows = _runDesc - asc;
+    }
+
+    if((x0 < 0) || (x1 > _width) || (top < 0) || (top + rows * sy > _height)
+      || ((x1 - x0) > TEXT_RUN_PIXELS) || (rows <= 0)) {
+        // Adafruit_GFX::write() only sets a GFXfont's glyph bits: lay the
+        // box's background first, as the run would (writeFillRect() clips)
+        if(gfxFont && (rows > 0)) {
+            writeFillRect(x0, top, x1 - x0, rows * sy, textbgcolor);
+        }
+        for(uint16_t i=0; i<count; i++) Adafruit_GFX::write(s[i]);
+        return count;
+    }
+
+    int16_t  w  = x1 - x0;
+    uint16_t fg = textcolor, bg = textbgcolor;
+    setAddrWindow(x0, top, w, rows * sy);
+    for(int16_t r=0; r<rows; r++) {
+        if(!gfxFont) {
+            uint16_t *p = textRow;
+            for(uint16_t i=0; i<count; i++) {
+                unsigned char c = s[i];
+                if(!_cp437 && (c >= 176)) c++; // 'Classic' charset behavior
+                for(uint8_t col=0; col<5; col++) {
+                    uint16_t color =
+                      ((classicFontColumn(c, col) >> r) & 1) ? fg : bg;
+                    for(int16_t k=0; k<sx; k++) *p++ = color;
+                }
+                for(int16_t k=0; k<sx; k++) *p++ = bg; // Spacing column
+            }
+        } else {
+            uint8_t  first = gfxFont->first, last = gfxFont->last;
+            int16_t  fy    = asc + r, pen = cursor_x - x0;
+            for(int16_t k=0; k<w; k++) textRow[k] = bg;
+            for(uint16_t i=0; i<count; i++) {
+                uint8_t c = s[i];
+                if((c < first) || (c > last)) continue;
+                GFXglyph *glyph = &gfxFont->glyph[c - first];
+                int16_t   gy    = fy - glyph->yOffset;
+                if((gy >= 0) && (gy < glyph->height)) {
+                    const uint8_t *bitmap = gfxFont->bitmap +
+                      glyph->bitmapOffset;
+                    uint16_t bit = gy * glyph->width; // Bits are packed
+                    uint16_t *p  = &textRow[pen + glyph->xOffset * sx];
+                    if(gfxFont->flags & GFXFONT_RLE) {
+                        // Walk the runs up to this row, fill its set runs
+                        uint16_t end = bit + glyph->width, pos = 0;
+                        while(pos < end) {
+                            uint8_t  b   = *bitmap++;
+                            uint16_t on0 = pos + (b >> 4);
+                            pos = on0 + (b & 0x0F);
+                            for(uint16_t q = (on0 > bit) ? on0 : bit;
+                              (q < pos) && (q < end); q++) {
+                                for(int16_t k=0; k<sx; k++)
+                                    p[(q - bit) * sx + k] = fg;
+                            }
+                        }
+                    } else {
+                        for(uint8_t gx=0; gx<glyph->width; gx++, bit++,
+                          p+=sx) {
+                            if(bitmap[bit >> 3] & (0x80 >> (bit & 7))) {
+                                for(int16_t k=0; k<sx; k++) p[k] = fg;
+                            }
+                        }
+                    }
+                }
+                pen += glyph->xAdvance * sx;
+            }
+        }
+        for(int16_t k=0; k<sy; k++) writePixels(textRow, w, false);
+    }
+
+    if(!gfxFont) {
+        cursor_x = x1;
+    } else {
+        for(uint16_t i=0; i<count; i++) {
+            uint8_t c = s[i];
+            if((c >= gfxFont->first) && (c <= gfxFont->last)) {
+                cursor_x += gfxFont->glyph[c - gfxFont->first].xAdvance * sx;
+            }
+        }
+    }
+    return count;
+}
+
+
+// -------------------------------------------------------------------------
+// Deferred rendering. Instead of each writeFastHLine()/writePixel() from a
+// composite primitive becoming its own address window and SPI burst, the
+// clipped rectangles are recorded in a display list and rasterized into a
+// RAM strip, which then goes out as one window + one burst per strip.
+
+/*!
+    @brief   Enable or disable deferred (strip-buffer) rendering. While
+             enabled, drawing between the outermost startWrite() and
+             endWrite() is recorded, then rasterized at that endWrite();
+             self-contained primitives (fillRect() etc.) outside any
+             startWrite() are each flushed on their own, so wrap a whole
+             screen in startWrite()/endWrite() to get the full benefit.
+             Any command sent in the meantime (setAddrWindow(),
+             setRotation()...) flushes the list first, so raw pixel pushes
+             stay in order. drawRGBBitmap() records a reference to the
+             caller's pixels, which must stay valid until the flush.
+    @param   on  true to enable, false to flush and release the buffers
+                 (kept with DEFER_STATIC).
+    @return  false if the strip or display list couldn't be allocated
+             (deferred mode stays off), otherwise true.
+*/
+bool Adafruit_SPITFT::setDeferred(bool on) {
+    if(on) {
+#if !defined(DEFER_STATIC)
+        if(!deferList) {
+            deferList  = (DeferOp *)malloc(DEFER_LIST_LEN * sizeof(DeferOp));
+            deferStrip = (uint16_t *)malloc(DEFER_STRIP_PIXELS * 2);
+            deferMask  = (uint8_t *)malloc((DEFER_STRIP_PIXELS + 7) / 8);
+            if(!deferList || !deferStrip || !deferMask) {
+                free(deferList);
+                free(deferStrip);
+                free(deferMask);
+                deferList  = NULL;
+                deferStrip = NULL;
+                deferMask  = NULL;
+                return false;
+            }
+        }
+#endif
+        if(!_deferring) {
+            deferCount      = 0;
+            deferNumBitmaps = 0;
+            _writeDepth = 0;
+            _deferring  = true;
+        }
+    } else if(_deferring) {
+        flushDeferred();
+        _deferring  = false;
+        _writeDepth = 0;
+#if !defined(DEFER_STATIC)
+        free(deferList);
+        free(deferStrip);
+        free(deferMask);
+        deferList  = NULL;
+        deferStrip = NULL;
+        deferMask  = NULL;
+#endif
+    }
+    return true;
+}
+
+/*!
+    @brief  Add a preclipped rectangle to the display list, merging it into
+            the previous entry where it simply extends a solid run (e.g.
+            consecutive writePixel() calls down a glyph column). Flushes
+            first if the list is full.
+    @param  x       Left edge, on screen.
+    @param  y       Top edge, on screen.
+    @param  w       Width, > 0 and on screen.
+    @param  h       Height, > 0 and on screen.
+    @param  color   Fill color (if bitmap is NULL).
+    @param  bitmap  Pixels for the top-left corner, or NULL for solid.
+    @param  stride  Bitmap row pitch in pixels.
+*/
+void Adafruit_SPITFT::deferRect(int16_t x, int16_t y, int16_t w, int16_t h,
+  uint16_t color, const uint16_t *bitmap, int16_t stride) {
+    _lastCommand = 0x00; // A pending op ends any open RAMWR stream
+
+    if(deferCount && !bitmap) {
+        DeferOp *p = &deferList[deferCount - 1];
+        if(!(p->w & DEFER_BITMAP) && (p->color == color)) {
+            if((p->y == y) && (p->h == h) && (p->x + p->w == x)) {
+                p->w += w;
+                return;
+            }
+            if((p->x == x) && (p->w == w) && (p->y + p->h == y)) {
+                p->h += h;
+                return;
+            }
+        }
+    }
+
+    if((deferCount >= DEFER_LIST_LEN) ||
+      (bitmap && (deferNumBitmaps >= DEFER_BITMAPS))) flushDeferred();
+
+    DeferOp *op = &deferList[deferCount++];
+    op->x       = x;
+    op->y       = y;
+    op->w       = w;
+    op->h       = h;
+    op->color   = color;
+    if(bitmap) {
+        deferBitmaps[deferNumBitmaps].pixels = bitmap;
+        deferBitmaps[deferNumBitmaps].stride = stride;
+        op->w      |= DEFER_BITMAP;
+        op->color   = deferNumBitmaps++;
+    }
+}
+
+/*!
+    @brief  Rasterize and send everything in the display list, then empty
+            it. Called automatically at the outermost endWrite() and when
+            the list fills up; user code only needs it to force pixels out
+            mid-transaction. Does nothing if deferred mode is off.
+*/
+void Adafruit_SPITFT::flushDeferred(void) {
+    if(!_deferring || !deferCount) return;
+
+    int16_t x0 = 0x7FFF, y0 = 0x7FFF, x1 = -1, y1 = -1;
+    for(uint16_t i=0; i<deferCount; i++) {
+        DeferOp *op = &deferList[i];
+        int16_t  w  = op->w & ~DEFER_BITMAP;
+        if(op->x < x0)             x0 = op->x;
+        if(op->y < y0)             y0 = op->y;
+        if(op->x + w - 1 > x1)     x1 = op->x + w - 1;
+        if(op->y + op->h - 1 > y1) y1 = op->y + op->h - 1;
+    }
+
+    bool own   = !_writeDepth;   // Not inside startWrite()? Select here.
+    _deferring = false;          // Below this, drawing goes to the bus
+    if(own) startWrite();
+
+    // Strips are as tall as the buffer allows at the list's width, so a
+    // narrow dialog gets far fewer than 16-line strips would give it.
+    int16_t lines = DEFER_STRIP_PIXELS / (x1 - x0 + 1);
+    for(int16_t sy = y0; sy <= y1; sy += lines) {
+        int16_t sh = y1 - sy + 1;
+        flushStrip(x0, x1, sy, (sh < lines) ? sh : lines);
+    }
+
+    if(own) endWrite();
+    deferCount      = 0;
+    deferNumBitmaps = 0;
+    _deferring      = true;
+    invalidateAddrWindow(); // The strips left it on the last one
+}
+
+/*!
+    @brief  Rasterize one strip of the display list and send it. If every
+            pixel of the strip's rectangle was drawn, it's a single window
+            and burst. Otherwise the untouched pixels can't be sent (the
+            screen contents there are unknown), so whichever is fewer is
+            used: one window per covered run, or replaying the strip's
+            list entries directly.
+    @param  x0  Left column of the list's bounding box.
+    @param  x1  Right column of the list's bounding box.
+    @param  sy  Top row of the strip.
+    @param  sh  Strip height; (x1 - x0 + 1) * sh <= DEFER_STRIP_PIXELS.
+*/
+void Adafruit_SPITFT::flushStrip(int16_t x0, int16_t x1, int16_t sy,
+  int16_t sh) {
+    int16_t  bw   = x1 - x0 + 1, sy2 = sy + sh - 1;
+    uint32_t npix = (uint32_t)bw * sh;
+    uint16_t nops = 0;
+
+    memset(deferMask, 0, (npix + 7) / 8);
+    for(uint16_t i=0; i<deferCount; i++) { // In order: later ops overdraw
+        DeferOp *op  = &deferList[i];
+        int16_t  w   = op->w & ~DEFER_BITMAP;
+        int16_t  ry0 = (op->y > sy) ? op->y : sy;
+        int16_t  ry1 = op->y + op->h - 1;
+        if(ry1 > sy2) ry1 = sy2;
+        if(ry0 > ry1) continue;
+        nops++;
+        for(int16_t r=ry0; r<=ry1; r++) {
+            uint32_t  o = (uint32_t)(r - sy) * bw + (op->x - x0);
+            uint16_t *d = &deferStrip[o];
+            if(op->w & DEFER_BITMAP) {
+                DeferBitmap *b = &deferBitmaps[op->color];
+                memcpy(d, b->pixels + (int32_t)(r - op->y) * b->stride, w * 2);
+            } else {
+                for(int16_t c=0; c<w; c++) d[c] = op->color;
+            }
+            deferMaskSet(o, w);
+        }
+    }
+    if(!nops) return;
+
+    uint32_t covered = 0, runs = 0;
+    for(uint32_t i=0; i<npix; i++) {
+        if(deferMask[i >> 3] & (1 << (i & 7))) {
+            covered++;
+            if(!(i % bw) || !(deferMask[(i-1) >> 3] & (1 << ((i-1) & 7))))
+                runs++;
+        }
+    }
+
+    if(covered == npix) {                  // Solid strip: one burst
+        setAddrWindow(x0, sy, bw, sh);
+        writePixels(deferStrip, npix, false);
+    } else if(runs <= nops) {              // Send covered runs only
+        for(int16_t r=0; r<sh; r++) {
+            uint32_t row = (uint32_t)r * bw;
+            for(int16_t c=0; c<bw; ) {
+                uint32_t i = row + c;
+                if(!(deferMask[i >> 3] & (1 << (i & 7)))) { c++; continue; }
+                int16_t n = 1;
+                while((c + n < bw) &&
+                  (deferMask[(i+n) >> 3] & (1 << ((i+n) & 7)))) n++;
+                setAddrWindow(x0 + c, sy + r, n, 1);
+                writePixels(&deferStrip[i], n, false);
+                c += n;
+            }
+        }
+    } else {                               // Sparse: replay the ops
+        for(uint16_t i=0; i<deferCount; i++) {
+            DeferOp *op  = &deferList[i];
+            int16_t  w   = op->w & ~DEFER_BITMAP;
+            int16_t  ry0 = (op->y > sy) ? op->y : sy;
+            int16_t  ry1 = op->y + op->h - 1;
+            if(ry1 > sy2) ry1 = sy2;
+            if(ry0 > ry1) continue;
+            if(op->w & DEFER_BITMAP) {
+                DeferBitmap *b = &deferBitmaps[op->color];
+                setAddrWindow(op->x, ry0, w, ry1 - ry0 + 1);
+                for(int16_t r=ry0; r<=ry1; r++) {
+                    writePixels((uint16_t *)b->pixels +
+                      (int32_t)(r - op->y) * b->stride, w, false);
+                }
+            } else {
+                writeFillRectPreclipped(op->x, ry0, w, ry1 - ry0 + 1,
+                  op->color);
+            }
+        }
+    }
 }
 
 
@@ -1297,8 +1903,8 @@ inline void Adafruit_SPITFT::SPI_END_TRANSACTION(void) {
 */
 void Adafruit_SPITFT::spiWrite(uint8_t b) {
 
-       
-		HAL_SPI_Transmit(&ILI9341_SPI_PORT, &b, sizeof(b), HAL_MAX_DELAY);
+		bus->write(&b, 1);
+		_dataCount++;
 }
 
 /*!
@@ -1310,9 +1916,10 @@ void Adafruit_SPITFT::spiWrite(uint8_t b) {
     @param  cmd  8-bit command to write.
 */
 void Adafruit_SPITFT::writeCommand(uint8_t cmd) {
-    SPI_DC_LOW();
-    spiWrite(cmd);
-    SPI_DC_HIGH();
+    if(_deferring && deferCount) flushDeferred(); // Keep drawing in order
+    bus->command(cmd); // Bus holds DC until pending pixel data is out
+    _lastCommand = cmd;
+    _dataCount   = 0;
 }
 
 /*!
@@ -1326,9 +1933,9 @@ void Adafruit_SPITFT::writeCommand(uint8_t cmd) {
              not supported by the MCU architecture).
 */
 uint8_t Adafruit_SPITFT::spiRead(void) {
-	uint8_t buff[2];
-	HAL_SPI_Receive(&ILI9341_SPI_PORT, buff, 1, HAL_MAX_DELAY);
-	return buff[0];
+	uint8_t b;
+	bus->read(&b, 1);
+	return b;
 }
 
 
@@ -21,15 +21,12 @@
 #define _ADAFRUIT_SPITFT_H_
 
 #include "Adafruit_GFX.h"
+#include "Adafruit_TFTBus.h"
 
-extern SPI_HandleTypeDef ILI9341_SPI_PORT;
-
-#define ILI9341_RES_Pin       GPIO_PIN_5
-#define ILI9341_RES_GPIO_Port GPIOC
-#define ILI9341_CS_Pin        GPIO_PIN_6
-#define ILI9341_CS_GPIO_Port  GPIOC
-#define ILI9341_DC_Pin        GPIO_PIN_4
-#define ILI9341_DC_GPIO_Port  GPIOC
+// The HAL stays out of this header so the library also builds on a PC
+// (-DADAFRUIT_GFX_HOST, see extras/host): only the SPI handle type is
+// needed here, and the HAL bus backends and control pins are in the .cpp.
+typedef struct __SPI_HandleTypeDef SPI_HandleTypeDef;
 
 // HARDWARE CONFIG ---------------------------------------------------------
 
@@ -63,6 +60,44 @@ typedef volatile  ADAGFX_PORT_t* PORTreg_t; ///< PORT register type
  #include <Adafruit_ZeroDMA.h>
 #endif
 
+// STM32 HAL transport options (USE_HAL_SPI_DMA, USE_SPI_16BIT_PIXELS,
+// buffer sizes) now live with the bus backends in Adafruit_HALBus.h.
+// A host build has no default bus: call setBus() before begin().
+
+// Deferred (strip-buffer) rendering, see setDeferred(). The strip takes
+// DEFER_STRIP_PIXELS*2 bytes (plus 1/8 that for a coverage mask) and the
+// display list DEFER_LIST_LEN*10 bytes. With DEFER_STATIC they are static
+// arrays, which is the default on the board: its heap is only 2 KB, so
+// they're sized to fit the RAM budget instead (320x8 strip, 192 entries,
+// ~7.2 KB). Otherwise nothing is allocated until deferred mode is enabled
+// (320x16 strip, 512 entries, ~15.6 KB). A list that fills up is flushed
+// early, which still works but loses the background, so the rest of that
+// screen falls back to smaller bursts.
+#if !defined(ADAFRUIT_GFX_HOST) && !defined(DEFER_HEAP)
+ #define DEFER_STATIC                  ///< Static strip and display list
+#endif
+#if defined(DEFER_STATIC)
+ #if !defined(DEFER_STRIP_PIXELS)
+  #define DEFER_STRIP_PIXELS (320 * 8) ///< Strip buffer size, pixels
+ #endif
+ #if !defined(DEFER_LIST_LEN)
+  #define DEFER_LIST_LEN     192       ///< Display list entries per flush
+ #endif
+#endif
+#if !defined(DEFER_STRIP_PIXELS)
+ #define DEFER_STRIP_PIXELS (320 * 16) ///< Strip buffer size, pixels
+#endif
+#if !defined(DEFER_LIST_LEN)
+ #define DEFER_LIST_LEN     512        ///< Display list entries per flush
+#endif
+
+// Opaque text (print() with a background color) is rasterized one pixel
+// row at a time into a static buffer of this many pixels and sent as one
+// address window per text line. Runs wider than this are drawn per glyph.
+#if !defined(TEXT_RUN_PIXELS)
+ #define TEXT_RUN_PIXELS    320        ///< Text run row buffer, pixels
+#endif
+
 // This is kind of a kludge. Needed a way to disambiguate the software SPI
 // and parallel constructors via their argument lists. Originally tried a
 // bool as the first argument to the parallel constructor (specifying 8-bit
@@ -154,6 +189,12 @@ class Adafruit_SPITFT : public Adafruit_GFX {
     */
     virtual void setAddrWindow(
                    uint16_t x, uint16_t y, uint16_t w, uint16_t h) = 0;
+    /*!
+        @brief  Forget any address window the subclass has cached, so the
+                next setAddrWindow() programs it in full. Called after a
+                deferred flush has moved the window behind its back.
+    */
+    virtual void invalidateAddrWindow(void) { }
 
     // Remaining functions do not need to be declared in subclasses
     // unless they wish to provide hardware-specific optimizations.
@@ -200,6 +241,23 @@ class Adafruit_SPITFT : public Adafruit_GFX {
     // Another new function, companion to the new non-blocking
     // writePixels() variant.
     void dmaWait(void);
+    // STM32 HAL: call from HAL_SPI_TxCpltCallback() so dmaWait() works.
+    static void  dmaComplete(SPI_HandleTypeDef *hspi);
+    // Swap the transport the display talks through (e.g. a recording bus
+    // for host-side testing). The bus must outlive the display object.
+    void         setBus(Adafruit_TFTBus *b) { bus = b; }
+    /*!
+        @brief   Get the transport currently in use.
+        @return  Pointer to the active Adafruit_TFTBus.
+    */
+    Adafruit_TFTBus *getBus(void) const { return bus; }
+    // Deferred rendering: record primitives, rasterize them into a RAM
+    // strip at the outermost endWrite(). Returns false if out of memory.
+    bool         setDeferred(bool on);
+    void         flushDeferred(void);
+    // Print hook: opaque text goes out in whole-line runs, see textRun().
+    size_t       write(const uint8_t *buffer, size_t size);
+    using        Print::write;
 
 
     // These functions are similar to the 'write' functions above, but with
@@ -220,7 +278,8 @@ class Adafruit_SPITFT : public Adafruit_GFX {
 	void		 pushColors(uint16_t *data, uint8_t len);
     using        Adafruit_GFX::drawRGBBitmap; // Check base class first
     void         drawRGBBitmap(int16_t x, int16_t y,
-                   uint16_t *pcolors, int16_t w, int16_t h);
+                   uint16_t *pcolors, int16_t w, int16_t h,
+                   int16_t stride = 0);
 
     void         invertDisplay(bool i);
     uint16_t     color565(uint8_t r, uint8_t g, uint8_t b);
@@ -255,7 +314,7 @@ class Adafruit_SPITFT : public Adafruit_GFX {
                 connection is parallel.
     */
     void SPI_CS_HIGH(void) {
-	    HAL_GPIO_WritePin(ILI9341_CS_GPIO_Port, ILI9341_CS_Pin, GPIO_PIN_SET);
+        bus->setCS(true);
     }
 
     /*!
@@ -265,28 +324,27 @@ class Adafruit_SPITFT : public Adafruit_GFX {
                 connection is parallel.
     */
     void SPI_CS_LOW(void) {
-		HAL_GPIO_WritePin(ILI9341_CS_GPIO_Port, ILI9341_CS_Pin, GPIO_PIN_RESET);
+        bus->setCS(false);
     }
 
     /*!
         @brief  Set the data/command line HIGH (data mode).
     */
     void SPI_DC_HIGH(void) {
-	    HAL_GPIO_WritePin(ILI9341_DC_GPIO_Port, ILI9341_DC_Pin, GPIO_PIN_SET);
+        bus->setDC(true);
     }
 
     /*!
         @brief  Set the data/command line LOW (command mode).
     */
     void SPI_DC_LOW(void) {
-	    HAL_GPIO_WritePin(ILI9341_DC_GPIO_Port, ILI9341_DC_Pin, GPIO_PIN_RESET);
+        bus->setDC(false);
     }
 	
-	void Reset() {
-		HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_RESET);
-		HAL_Delay(5);
-		HAL_GPIO_WritePin(ILI9341_RES_GPIO_Port, ILI9341_RES_Pin, GPIO_PIN_SET);
-	}
+	void Reset();
+
+    // Millisecond clock: HAL_GetTick() on the board, simulated on a host
+    static uint32_t tftMillis(void);
 
   protected:
 
@@ -305,6 +363,15 @@ class Adafruit_SPITFT : public Adafruit_GFX {
     inline void  TFT_RD_HIGH(void);   // Parallel interface read high
     inline void  TFT_RD_LOW(void);    // Parallel interface read low
 
+    static Adafruit_TFTBus *defaultBus(void);
+
+    void         deferRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                   uint16_t color, const uint16_t *bitmap = NULL,
+                   int16_t stride = 0);
+    void         flushStrip(int16_t x0, int16_t x1, int16_t sy,
+                   int16_t sh);
+    uint16_t     textRun(const uint8_t *s, uint16_t n);
+
     // CLASS INSTANCE VARIABLES --------------------------------------------
 
     // Here be dragons! There's a big union of three structures here --
@@ -439,6 +506,18 @@ class Adafruit_SPITFT : public Adafruit_GFX {
     int8_t        _rst;            ///< Reset pin # (or -1)
     int8_t        _cs;             ///< Chip select pin # (or -1)
     int8_t        _dc;             ///< Data/command pin #
+    Adafruit_TFTBus *bus = defaultBus(); ///< Transport (SPI, DMA, recorder)
+    // Where the controller is in its current command, so drivers can tell
+    // whether a RAMWR stream is still open and how far its cursor got.
+    uint32_t      _dataCount   = 0; ///< Data bytes since last writeCommand()
+    uint8_t       _lastCommand = 0; ///< Last command byte (0 after endWrite)
+    bool          _deferring   = false; ///< Recording into the display list
+    uint8_t       _writeDepth  = 0;     ///< startWrite() nesting (deferred)
+    // Line metrics of the last GFXfont printed opaque, see textRun()
+    const GFXglyph *_runGlyphs = NULL;  ///< Glyph table they belong to
+    int16_t       _runAsc      = 0;     ///< Top of tallest glyph (yOffset)
+    int16_t       _runDesc     = 0;     ///< Bottom of lowest glyph
+    uint8_t       _runAdvance  = 0;     ///< Font yAdvance
 
     int16_t       _xstart   = 0;   ///< Internal framebuffer X offset
     int16_t       _ystart   = 0;   ///< Internal framebuffer Y offset
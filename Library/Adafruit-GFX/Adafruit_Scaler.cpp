@@ -0,0 +1,180 @@
+/*!
+ * @file Adafruit_Scaler.cpp
+ *
+ * Streaming RGB565 image scaler. See Adafruit_Scaler.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_Scaler.h"
+#include "Adafruit_Blend.h"
+
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+/*!
+    @brief   Adafruit_Scaler constructor. Nothing is drawn until begin().
+*/
+Adafruit_Scaler::Adafruit_Scaler(void) : _tft(NULL), _work(NULL),
+  _x(0), _y(0), _cx(0), _cw(0), _srcW(0), _srcH(0), _dstW(0), _dstH(0),
+  _stepX(0), _stepY(0), _inY(0), _outY(0), _endY(0),
+  _mode(SCALER_NEAREST) {
+}
+
+/*!
+    @brief   Start scaling an image. Only the part of the output rectangle
+             on the display is computed and drawn.
+    @param   tft   Display to draw to.
+    @param   x     Left edge of the output on the display; may be
+                   negative.
+    @param   y     Top edge of the output; may be negative.
+    @param   srcW  Source width: pixels per pushRow().
+    @param   srcH  Source height: rows to push.
+    @param   dstW  Output width.
+    @param   dstH  Output height.
+    @param   mode  SCALER_NEAREST or SCALER_BILINEAR.
+    @param   work  Working buffer of 2 * dstW pixels (2 * the visible
+                   width is enough), kept until the last row is pushed.
+    @return  true if any of the output is visible, false if there's
+             nothing to draw (pushRow() then does nothing).
+*/
+bool Adafruit_Scaler::begin(Adafruit_SPITFT *tft, int16_t x, int16_t y,
+  uint16_t srcW, uint16_t srcH, uint16_t dstW, uint16_t dstH,
+  uint8_t mode, uint16_t *work) {
+    _tft   = tft;
+    _work  = work;
+    _x     = x;
+    _y     = y;
+    _srcW  = srcW;
+    _srcH  = srcH;
+    _dstW  = dstW;
+    _dstH  = dstH;
+    _mode  = mode;
+    _inY   = 0;
+    _outY  = 0;
+    _endY  = 0;
+    if(!tft || !work || !srcW || !srcH || !dstW || !dstH) return false;
+
+    // Clip the output rectangle to the display
+    int32_t x0 = max((int32_t)x, 0),
+            y0 = max((int32_t)y, 0),
+            x1 = min((int32_t)x + dstW, (int32_t)tft->width()),
+            y1 = min((int32_t)y + dstH, (int32_t)tft->height());
+    if((x0 >= x1) || (y0 >= y1)) return false;
+    _cx   = x0 - x;
+    _cw   = x1 - x0;
+    _outY = y0 - y;
+    _endY = y1 - y;
+
+    _stepX = ((uint32_t)srcW << 16) / dstW;
+    _stepY = ((uint32_t)srcH << 16) / dstH;
+    return true;
+}
+
+/*!
+    @brief   Push the next source row, top to bottom. Output rows that
+             depend on nothing further are drawn before it returns.
+    @param   row  srcW pixels, native RGB565. May be NULL if skipNext()
+                  was true.
+*/
+void Adafruit_Scaler::pushRow(const uint16_t *row) {
+    if(_inY >= _srcH) return;
+    uint16_t r = _inY++;
+    if(_outY >= _endY) return;
+
+    // Every pending output row ends on row r or later, so r is needed
+    // as soon as the next one starts on or before it. Rows alternate
+    // between the two work rows; an output row spans at most two
+    // consecutive ones.
+    if(firstRow(_outY) <= r) resample(row, _work + (r & 1) * _cw);
+    while((_outY < _endY) && (lastRow(_outY) <= r)) emit(_outY++);
+}
+
+/*!
+    @brief   Source position of an output row's center.
+    @param   oy  Output row.
+    @return  Source row in 16.16 fixed point: for SCALER_BILINEAR, from
+             the center of row 0, clamped at 0.
+*/
+uint32_t Adafruit_Scaler::rowPos(uint16_t oy) const {
+    uint32_t s = oy * _stepY + (_stepY >> 1);
+    if(_mode == SCALER_NEAREST) return s;
+    return (s < 0x8000) ? 0 : s - 0x8000;
+}
+
+/*!
+    @brief   First source row an output row is computed from.
+    @param   oy  Output row.
+    @return  Source row.
+*/
+uint16_t Adafruit_Scaler::firstRow(uint16_t oy) const {
+    return rowPos(oy) >> 16;
+}
+
+/*!
+    @brief   Last source row an output row is computed from.
+    @param   oy  Output row.
+    @return  Source row: firstRow(), or the one below it for a bilinear
+             row between two.
+*/
+uint16_t Adafruit_Scaler::lastRow(uint16_t oy) const {
+    uint32_t s  = rowPos(oy);
+    uint16_t r0 = s >> 16;
+    if((_mode == SCALER_NEAREST) || !(s & 0xFFFF) || (r0 + 1 >= _srcH))
+        return r0;
+    return r0 + 1;
+}
+
+/*!
+    @brief   Scale a source row horizontally, visible columns only.
+    @param   row  srcW source pixels.
+    @param   dst  _cw output pixels.
+*/
+void Adafruit_Scaler::resample(const uint16_t *row, uint16_t *dst) {
+    uint32_t s = _cx * _stepX + (_stepX >> 1);
+    if(_mode == SCALER_NEAREST) {
+        for(int16_t i=0; i<_cw; i++, s += _stepX) dst[i] = row[s >> 16];
+        return;
+    }
+    uint16_t last = _srcW - 1;
+    for(int16_t i=0; i<_cw; i++, s += _stepX) {
+        uint32_t p  = (s < 0x8000) ? 0 : s - 0x8000;
+        uint16_t x0 = p >> 16;
+        dst[i] = (x0 >= last) ? row[last] :
+          rgb565Blend(row[x0 + 1], row[x0], (p >> 8) & 0xFF);
+    }
+}
+
+/*!
+    @brief   Draw one output row from the work rows. A bilinear row
+             between two source rows is blended SCALER_CHUNK pixels at a
+             time into a stack buffer on its way out.
+    @param   oy  Output row.
+*/
+void Adafruit_Scaler::emit(uint16_t oy) {
+    uint16_t r0 = firstRow(oy), r1 = lastRow(oy);
+    uint16_t *a = _work + (r0 & 1) * _cw;
+
+    _tft->startWrite();
+    _tft->setAddrWindow(_x + _cx, _y + oy, _cw, 1);
+    if(r1 == r0) {
+        _tft->writePixels(a, _cw);
+    } else {
+        uint16_t *b = _work + (r1 & 1) * _cw,
+                  buf[SCALER_CHUNK];
+        uint8_t   f = (rowPos(oy) >> 8) & 0xFF;
+        for(int16_t k=0; k<_cw; k+=SCALER_CHUNK) {
+            int16_t n = min(_cw - k, SCALER_CHUNK);
+            memcpy(buf, a + k, n * 2);
+            rgb565BlendRow(buf, b + k, n, f);
+            _tft->writePixels(buf, n);
+        }
+    }
+    _tft->endWrite();
+}
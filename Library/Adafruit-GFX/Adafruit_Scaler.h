@@ -0,0 +1,93 @@
+/*!
+ * @file Adafruit_Scaler.h
+ *
+ * Streaming RGB565 image scaler. Source rows are pushed top to bottom (from
+ * a canvas, a decoded MCU strip, a BMP file row...) and the scaled image
+ * goes straight to an Adafruit_SPITFT as each output row becomes
+ * computable, so an image of any size can be drawn at any size without a
+ * frame buffer: the only working memory is two rows of the visible output
+ * width, supplied by the caller.
+ *
+ * Source and output coordinates are stepped in 16.16 fixed point with
+ * pixel centers aligned, as in most image libraries. SCALER_NEAREST picks
+ * the source pixel under each output pixel's center. SCALER_BILINEAR mixes
+ * the four around it with Adafruit_Blend's kernels (33 weight steps); it
+ * is a 2x2 filter, so reductions well beyond 2:1 alias much like nearest
+ * and are better decoded small to begin with.
+ *
+ *   uint16_t work[2 * 160];
+ *   Adafruit_Scaler s;
+ *   if(s.begin(&tft, 0, 0, 640, 480, 160, 120, SCALER_BILINEAR, work))
+ *       for(y=0; y<480; y++) s.pushRow(row(y));
+ *
+ * Source rows no output row depends on (most of them in a big reduction)
+ * are accepted and skipped without being resampled.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_SCALER_H_
+#define _ADAFRUIT_SCALER_H_
+
+#include "Adafruit_SPITFT.h"
+
+#if !defined(SCALER_CHUNK)
+ #define SCALER_CHUNK 64 ///< Pixels blended on the stack per write, bilinear
+#endif
+
+#define SCALER_NEAREST  0 ///< Nearest-neighbour: sharp, no filtering
+#define SCALER_BILINEAR 1 ///< Bilinear: smooth
+
+/*!
+  @brief  Row-at-a-time image scaler drawing to an Adafruit_SPITFT.
+*/
+class Adafruit_Scaler {
+
+  public:
+
+    Adafruit_Scaler(void);
+
+    bool         begin(Adafruit_SPITFT *tft, int16_t x, int16_t y,
+                   uint16_t srcW, uint16_t srcH, uint16_t dstW,
+                   uint16_t dstH, uint8_t mode, uint16_t *work);
+    void         pushRow(const uint16_t *row);
+
+    /*!
+        @brief   Query whether the next pushRow() can be skipped: no output
+                 row depends on it. Lets a source that has to decode its
+                 rows save the work; skipped rows must still be pushed
+                 (NULL is fine) to keep the count.
+        @return  true if the next row's pixels won't be read.
+    */
+    bool         skipNext(void) const {
+                   return (_inY >= _srcH) || (_outY >= _endY) ||
+                     (firstRow(_outY) > _inY);
+                 }
+    /*!
+        @brief   Query completion.
+        @return  true once every visible output row has been drawn.
+    */
+    bool         done(void) const { return _outY >= _endY; }
+
+  private:
+
+    uint32_t     rowPos(uint16_t oy) const;
+    uint16_t     firstRow(uint16_t oy) const;
+    uint16_t     lastRow(uint16_t oy) const;
+    void         resample(const uint16_t *row, uint16_t *dst);
+    void         emit(uint16_t oy);
+
+    Adafruit_SPITFT *_tft;   ///< Output display
+    uint16_t     *_work;     ///< Two resampled rows, _cw pixels each
+    int16_t      _x, _y;     ///< Output position on the display
+    int16_t      _cx, _cw;   ///< Visible output columns: first, count
+    uint16_t     _srcW, _srcH, _dstW, _dstH;
+    uint32_t     _stepX;     ///< Source columns per output column, 16.16
+    uint32_t     _stepY;     ///< Source rows per output row, 16.16
+    uint16_t     _inY;       ///< Source rows pushed
+    uint16_t     _outY;      ///< Next output row to draw
+    uint16_t     _endY;      ///< Output row past the last visible one
+    uint8_t      _mode;      ///< SCALER_NEAREST or SCALER_BILINEAR
+};
+
+#endif // _ADAFRUIT_SCALER_H_
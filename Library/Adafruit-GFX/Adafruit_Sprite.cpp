@@ -0,0 +1,419 @@
+/*!
+ * @file Adafruit_Sprite.cpp
+ *
+ * Color-keyed sprites and their compositor. See Adafruit_Sprite.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_Sprite.h"
+
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define SPRITE_WINDOW_BYTES 11 ///< CASET, PASET and RAMWR/RAMRD with args
+
+/*!
+    @brief   Intersection of two rectangles.
+    @param   a  First rectangle.
+    @param   b  Second rectangle.
+    @return  Overlap, w or h <= 0 if there is none.
+*/
+static Adafruit_Rect rectClip(const Adafruit_Rect &a, const Adafruit_Rect &b) {
+    Adafruit_Rect r;
+    r.x = max(a.x, b.x);
+    r.y = max(a.y, b.y);
+    r.w = min(a.x + a.w, b.x + b.w) - r.x;
+    r.h = min(a.y + a.h, b.y + b.h) - r.y;
+    return r;
+}
+
+/*!
+    @brief   Adafruit_Sprite constructor. The sprite starts hidden at 0, 0.
+    @param   pixels  w * h RGB565 pixels, row-major. Not copied.
+    @param   w       Width.
+    @param   h       Height.
+    @param   key     Color drawn as transparent.
+    @param   save    Caller-owned buffer of w * h pixels for the background
+                     under the sprite.
+*/
+Adafruit_Sprite::Adafruit_Sprite(const uint16_t *pixels, int16_t w,
+  int16_t h, uint16_t key, uint16_t *save) :
+  _pixels(pixels), _save(save), _w(w), _h(h), _key(key), _x(0), _y(0),
+  _sx(0), _sy(0), _visible(false), _shown(false) {
+}
+
+/*!
+    @brief   Move the sprite; the panel changes at the next update().
+    @param   x  Left edge, may be partly or wholly off screen.
+    @param   y  Top edge.
+*/
+void Adafruit_Sprite::moveTo(int16_t x, int16_t y) {
+    _x = x;
+    _y = y;
+}
+
+/*!
+    @brief   Show or hide the sprite at the next update().
+    @param   visible  true to show.
+*/
+void Adafruit_Sprite::setVisible(bool visible) {
+    _visible = visible;
+}
+
+/*!
+    @brief   Adafruit_SpriteLayer constructor.
+    @param   tft  Display the sprites are on.
+*/
+Adafruit_SpriteLayer::Adafruit_SpriteLayer(Adafruit_ILI9341 *tft) :
+  _tft(tft), _nsprite(0), _bytes(0), _frameBytes(0), _peakBytes(0) {
+}
+
+/*!
+    @brief   Put a sprite under this layer's control.
+    @param   s  Sprite; ignored once SPRITE_MAX sprites have been added.
+*/
+void Adafruit_SpriteLayer::add(Adafruit_Sprite *s) {
+    if(_nsprite < SPRITE_MAX) _sprite[_nsprite++] = s;
+}
+
+/*!
+    @brief   Fill a background rectangle. The saved backgrounds of the
+             sprites it overlaps are filled too, and those sprites are
+             painted back over it in the same address window.
+    @param   x      Left edge.
+    @param   y      Top edge.
+    @param   w      Width.
+    @param   h      Height.
+    @param   color  RGB565 color.
+*/
+void Adafruit_SpriteLayer::fillRect(int16_t x, int16_t y, int16_t w,
+  int16_t h, uint16_t color) {
+    Adafruit_Rect all = { 0, 0, _tft->width(), _tft->height() };
+    Adafruit_Rect r   = { x, y, w, h };
+    r = rectClip(r, all);
+    if((r.w <= 0) || (r.h <= 0)) return;
+
+    bool covered = false;
+    for(uint8_t i=0; i<_nsprite; i++) {
+        Adafruit_Sprite *s = _sprite[i];
+        if(!s->_shown) continue;
+        Adafruit_Rect b = { s->_sx, s->_sy, s->_w, s->_h };
+        b = rectClip(b, r);
+        if((b.w <= 0) || (b.h <= 0)) continue;
+        for(int16_t yy=b.y; yy<b.y + b.h; yy++) {
+            uint16_t *d = s->_save + (yy - s->_sy) * s->_w + (b.x - s->_sx);
+            for(int16_t n=0; n<b.w; n++) d[n] = color;
+        }
+        covered = true;
+    }
+
+    if(!covered) {
+        _tft->fillRect(r.x, r.y, r.w, r.h, color);
+        _bytes += SPRITE_WINDOW_BYTES + 2UL * r.w * r.h;
+        return;
+    }
+
+    // Composite a band of rows at a time into one window
+    int16_t band = SPRITE_WORK_PIXELS / r.w;
+    window(r);
+    for(int16_t yy=r.y; yy<r.y + r.h; yy+=band) {
+        int16_t  rows = min(band, r.y + r.h - yy);
+        uint32_t n    = (uint32_t)rows * r.w;
+        for(uint32_t k=0; k<n; k++) _work[k] = color;
+        overlayAll(r, yy, rows);
+        pixels(n);
+    }
+    _tft->endWrite();
+}
+
+/*!
+    @brief   Fill the whole background, see fillRect().
+    @param   color  RGB565 color.
+*/
+void Adafruit_SpriteLayer::fillScreen(uint16_t color) {
+    fillRect(0, 0, _tft->width(), _tft->height(), color);
+}
+
+/*!
+    @brief   Bring the panel up to date with every sprite's position and
+             visibility. A moved sprite costs one read-back of the
+             background it's about to cover and one write window over its
+             old and new rectangles (two windows, restore then draw, if
+             they're too far apart for SPRITE_WORK_PIXELS).
+*/
+void Adafruit_SpriteLayer::update(void) {
+    for(uint8_t i=0; i<_nsprite; i++) {
+        Adafruit_Sprite *s = _sprite[i];
+        if(s->_shown) {
+            if(!s->_visible) {
+                restore(s);
+            } else if((s->_x != s->_sx) || (s->_y != s->_sy)) {
+                if(!move(s)) {
+                    restore(s);
+                    show(s);
+                }
+            }
+        } else if(s->_visible) {
+            show(s);
+        }
+    }
+}
+
+/*!
+    @brief   End a frame: close its byte count for frameBytes() and
+             peakBytes().
+*/
+void Adafruit_SpriteLayer::endFrame(void) {
+    _frameBytes = _bytes;
+    if(_bytes > _peakBytes) _peakBytes = _bytes;
+    _bytes = 0;
+}
+
+/*!
+    @brief   Clear frameBytes(), peakBytes() and the frame being counted.
+*/
+void Adafruit_SpriteLayer::resetStats(void) {
+    _bytes      = 0;
+    _frameBytes = 0;
+    _peakBytes  = 0;
+}
+
+/*!
+    @brief   Draw a hidden sprite: save the background under it, then send
+             it composited over that background, with any other sprites
+             there, in one window.
+    @param   s  Sprite.
+*/
+void Adafruit_SpriteLayer::show(Adafruit_Sprite *s) {
+    Adafruit_Rect all = { 0, 0, _tft->width(), _tft->height() };
+    Adafruit_Rect n   = { s->_x, s->_y, s->_w, s->_h };
+    n = rectClip(n, all);
+    s->_sx    = s->_x;
+    s->_sy    = s->_y;
+    s->_shown = true;
+    if((n.w <= 0) || (n.h <= 0)) return; // Off screen, nothing to save
+
+    uint16_t *save = s->_save + (n.y - s->_sy) * s->_w + (n.x - s->_sx);
+    if(n.w == s->_w) {
+        readBack(n.x, n.y, n.w, n.h, save);
+    } else {
+        for(int16_t r=0; r<n.h; r++, save += s->_w)
+            readBack(n.x, n.y + r, n.w, 1, save);
+    }
+    underlay(s, n, s->_save + (n.y - s->_sy) * s->_w + (n.x - s->_sx),
+      s->_w);
+
+    int16_t band = SPRITE_WORK_PIXELS / n.w;
+    window(n);
+    for(int16_t y=n.y; y<n.y + n.h; y+=band) {
+        int16_t rows = min(band, n.y + n.h - y);
+        for(int16_t r=0; r<rows; r++) {
+            memcpy(_work + r * n.w, s->_save + (y + r - s->_sy) * s->_w +
+              (n.x - s->_sx), n.w * 2);
+        }
+        overlayAll(n, y, rows);
+        pixels((uint32_t)rows * n.w);
+    }
+    _tft->endWrite();
+}
+
+/*!
+    @brief   Remove a shown sprite by putting its saved background back,
+             with any other sprites there painted over it.
+    @param   s  Sprite.
+*/
+void Adafruit_SpriteLayer::restore(Adafruit_Sprite *s) {
+    Adafruit_Rect all = { 0, 0, _tft->width(), _tft->height() };
+    Adafruit_Rect o   = { s->_sx, s->_sy, s->_w, s->_h };
+    o = rectClip(o, all);
+    s->_shown = false;
+    if((o.w <= 0) || (o.h <= 0)) return;
+
+    int16_t band = SPRITE_WORK_PIXELS / o.w;
+    window(o);
+    for(int16_t y=o.y; y<o.y + o.h; y+=band) {
+        int16_t rows = min(band, o.y + o.h - y);
+        for(int16_t r=0; r<rows; r++) {
+            memcpy(_work + r * o.w, s->_save + (y + r - s->_sy) * s->_w +
+              (o.x - s->_sx), o.w * 2);
+        }
+        overlayAll(o, y, rows);
+        pixels((uint32_t)rows * o.w);
+    }
+    _tft->endWrite();
+}
+
+/*!
+    @brief   Move a shown sprite in one window. The background of the
+             bounding box of the old and new rectangles is assembled in
+             the work buffer: the old rectangle from the saved background,
+             everything else read back from the panel, with other sprites
+             there replaced by their saved backgrounds. The new saved
+             background is cut from it, the sprites drawn over it, and the
+             box sent.
+    @param   s  Sprite.
+    @return  false, with nothing done, if the box doesn't fit the work
+             buffer or either rectangle is off screen.
+*/
+bool Adafruit_SpriteLayer::move(Adafruit_Sprite *s) {
+    Adafruit_Rect all = { 0, 0, _tft->width(), _tft->height() };
+    Adafruit_Rect o   = { s->_sx, s->_sy, s->_w, s->_h };
+    Adafruit_Rect n   = { s->_x, s->_y, s->_w, s->_h };
+    o = rectClip(o, all);
+    n = rectClip(n, all);
+    if((o.w <= 0) || (o.h <= 0) || (n.w <= 0) || (n.h <= 0)) return false;
+
+    Adafruit_Rect u;
+    u.x = min(o.x, n.x);
+    u.y = min(o.y, n.y);
+    u.w = max(o.x + o.w, n.x + n.w) - u.x;
+    u.h = max(o.y + o.h, n.y + n.h) - u.y;
+    int16_t  left  = o.x - u.x,                // Columns beside o, in
+             right = u.x + u.w - (o.x + o.w);  // o's rows
+    uint32_t box   = (uint32_t)u.w * u.h;
+    if(box + (uint32_t)max(left, right) * o.h > SPRITE_WORK_PIXELS)
+        return false;
+
+    // Background: rows above and below o, full width...
+    int16_t  top = o.y - u.y, bottom = o.y + o.h;
+    readBack(u.x, u.y, u.w, top, _work);
+    readBack(u.x, bottom, u.w, u.y + u.h - bottom,
+      _work + (bottom - u.y) * u.w);
+    // ...columns beside o, via the end of the buffer...
+    uint16_t *tail = _work + box;
+    if(left) {
+        readBack(u.x, o.y, left, o.h, tail);
+        for(int16_t r=0; r<o.h; r++) memcpy(_work + (top + r) * u.w,
+          tail + r * left, left * 2);
+    }
+    if(right) {
+        readBack(o.x + o.w, o.y, right, o.h, tail);
+        for(int16_t r=0; r<o.h; r++) memcpy(_work + (top + r) * u.w +
+          (o.x + o.w - u.x), tail + r * right, right * 2);
+    }
+    // ...o itself from the old saved background, and what's under any
+    // other sprites in the box from theirs
+    for(int16_t r=0; r<o.h; r++) {
+        memcpy(_work + (top + r) * u.w + left, s->_save +
+          (o.y + r - s->_sy) * s->_w + (o.x - s->_sx), o.w * 2);
+    }
+    underlay(s, u, _work, u.w);
+
+    s->_sx = s->_x;
+    s->_sy = s->_y;
+    for(int16_t r=0; r<n.h; r++) {
+        memcpy(s->_save + (n.y + r - s->_sy) * s->_w + (n.x - s->_sx),
+          _work + (n.y - u.y + r) * u.w + (n.x - u.x), n.w * 2);
+    }
+    overlayAll(u, u.y, u.h);
+
+    window(u);
+    pixels(box);
+    _tft->endWrite();
+    return true;
+}
+
+/*!
+    @brief   Draw a sprite's opaque pixels into a band of rows of a
+             rectangle held in the work buffer.
+    @param   s     Sprite.
+    @param   sx    Sprite left edge.
+    @param   sy    Sprite top edge.
+    @param   r     Rectangle the buffer holds, r.w pixels per row.
+    @param   y     Screen row of the first buffer row.
+    @param   rows  Rows in the buffer.
+*/
+void Adafruit_SpriteLayer::overlay(const Adafruit_Sprite *s, int16_t sx,
+  int16_t sy, const Adafruit_Rect &r, int16_t y, int16_t rows) {
+    int16_t x0 = max(r.x, sx), x1 = min(r.x + r.w, sx + s->_w),
+            y0 = max(y, sy),   y1 = min(y + rows, sy + s->_h);
+    for(int16_t yy=y0; yy<y1; yy++) {
+        const uint16_t *src = s->_pixels + (yy - sy) * s->_w + (x0 - sx);
+        uint16_t       *dst = _work + (yy - y) * r.w + (x0 - r.x);
+        for(int16_t n=x1 - x0; n>0; n--, src++, dst++) {
+            if(*src != s->_key) *dst = *src;
+        }
+    }
+}
+
+/*!
+    @brief   Draw every shown sprite, in add() order, into a band of rows
+             of a rectangle held in the work buffer.
+    @param   r     Rectangle the buffer holds, r.w pixels per row.
+    @param   y     Screen row of the first buffer row.
+    @param   rows  Rows in the buffer.
+*/
+void Adafruit_SpriteLayer::overlayAll(const Adafruit_Rect &r, int16_t y,
+  int16_t rows) {
+    for(uint8_t i=0; i<_nsprite; i++) {
+        const Adafruit_Sprite *s = _sprite[i];
+        if(s->_shown) overlay(s, s->_sx, s->_sy, r, y, rows);
+    }
+}
+
+/*!
+    @brief   Replace what the other shown sprites cover in a rectangle read
+             back from the panel with the background saved under them, so
+             the rectangle holds background only.
+    @param   s      Sprite the rectangle is for, skipped.
+    @param   r      On-screen rectangle.
+    @param   dest   Its top-left pixel.
+    @param   pitch  Row pitch of dest, pixels.
+*/
+void Adafruit_SpriteLayer::underlay(const Adafruit_Sprite *s,
+  const Adafruit_Rect &r, uint16_t *dest, int16_t pitch) {
+    for(uint8_t i=0; i<_nsprite; i++) {
+        const Adafruit_Sprite *t = _sprite[i];
+        if((t == s) || !t->_shown) continue;
+        Adafruit_Rect b = { t->_sx, t->_sy, t->_w, t->_h };
+        b = rectClip(b, r);
+        if((b.w <= 0) || (b.h <= 0)) continue;
+        for(int16_t y=b.y; y<b.y + b.h; y++) {
+            memcpy(dest + (y - r.y) * pitch + (b.x - r.x), t->_save +
+              (y - t->_sy) * t->_w + (b.x - t->_sx), b.w * 2);
+        }
+    }
+}
+
+/*!
+    @brief   Read a rectangle of the panel, counting the bytes.
+    @param   x     Left edge (on screen).
+    @param   y     Top edge.
+    @param   w     Width, nothing is read if <= 0.
+    @param   h     Height, nothing is read if <= 0.
+    @param   dest  w * h pixels.
+*/
+void Adafruit_SpriteLayer::readBack(int16_t x, int16_t y, int16_t w,
+  int16_t h, uint16_t *dest) {
+    if((w <= 0) || (h <= 0)) return;
+    _tft->readRect(x, y, w, h, dest);
+    _bytes += SPRITE_WINDOW_BYTES + 1 + 3UL * w * h; // Dummy byte, RGB666
+}
+
+/*!
+    @brief   Open a write window, counting the bytes. Ended by the
+             caller's endWrite().
+    @param   r  On-screen rectangle.
+*/
+void Adafruit_SpriteLayer::window(const Adafruit_Rect &r) {
+    _tft->startWrite();
+    _tft->setAddrWindow(r.x, r.y, r.w, r.h);
+    _bytes += SPRITE_WINDOW_BYTES;
+}
+
+/*!
+    @brief   Send pixels from the start of the work buffer, counting the
+             bytes. Waits for the transfer, so the buffer can be reused.
+    @param   n  Pixel count.
+*/
+void Adafruit_SpriteLayer::pixels(uint32_t n) {
+    _tft->writePixels(_work, n);
+    _bytes += 2 * n;
+}
@@ -0,0 +1,157 @@
+/*!
+ * @file Adafruit_Sprite.h
+ *
+ * Color-keyed sprites over an ILI9341 background, for simple games. Each
+ * sprite is a pre-rendered RGB565 bitmap in which one key color is
+ * transparent, plus a caller-owned buffer holding the background it
+ * covers. An Adafruit_SpriteLayer composites moves in RAM: the background
+ * uncovered at the old position comes from that buffer, the one about to
+ * be covered is read back from the panel, and the union of the old and new
+ * rectangles goes out in one address window, so a sprite never disappears
+ * between frames and nothing is drawn twice.
+ *
+ * Background drawing must go through the layer while sprites are shown
+ * (fillRect(), fillScreen()): it keeps the saved backgrounds current and
+ * paints the sprites back on top in the same window. Sprites may
+ * overlap: each one's saved background holds background only (what the
+ * panel shows under other sprites comes from their saved backgrounds),
+ * and every change repaints the sprites it touches in add() order, so
+ * later sprites are on top.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_SPRITE_H_
+#define _ADAFRUIT_SPRITE_H_
+
+#include "Adafruit_GFX.h"
+#include "Adafruit_ILI9341.h"
+
+#if !defined(SPRITE_MAX)
+ #define SPRITE_MAX 8 ///< Sprites one layer can hold
+#endif
+
+#if !defined(SPRITE_WORK_PIXELS)
+ #define SPRITE_WORK_PIXELS 3072 ///< Compositing buffer; bigger moves take two windows
+#endif
+
+#if !defined(SPRITE_SPI_HZ)
+ #define SPRITE_SPI_HZ 16000000 ///< Display SPI clock, for budget()
+#endif
+
+/*!
+  @brief  One sprite: bitmap, transparent key color, position and the
+          background saved under it.
+*/
+class Adafruit_Sprite {
+
+  public:
+
+    Adafruit_Sprite(const uint16_t *pixels, int16_t w, int16_t h,
+      uint16_t key, uint16_t *save);
+
+    void         moveTo(int16_t x, int16_t y);
+    void         setVisible(bool visible);
+
+    /*!
+        @brief   Get the x position set by moveTo().
+        @return  Left edge.
+    */
+    int16_t      x(void) const { return _x; }
+    /*!
+        @brief   Get the y position set by moveTo().
+        @return  Top edge.
+    */
+    int16_t      y(void) const { return _y; }
+    /*!
+        @brief   Get the bitmap width.
+        @return  Width in pixels.
+    */
+    int16_t      width(void) const { return _w; }
+    /*!
+        @brief   Get the bitmap height.
+        @return  Height in pixels.
+    */
+    int16_t      height(void) const { return _h; }
+    /*!
+        @brief   Query visibility.
+        @return  true if the sprite is (or will be, at the next update())
+                 on the panel.
+    */
+    bool         visible(void) const { return _visible; }
+
+  private:
+
+    friend class Adafruit_SpriteLayer;
+
+    const uint16_t *_pixels;  ///< w*h RGB565 pixels, key is transparent
+    uint16_t       *_save;    ///< w*h background under the shown sprite
+    int16_t         _w, _h;   ///< Bitmap size
+    uint16_t        _key;     ///< Transparent color
+    int16_t         _x, _y;   ///< Position wanted
+    int16_t         _sx, _sy; ///< Position on the panel, if _shown
+    bool            _visible; ///< Wanted on the panel
+    bool            _shown;   ///< On the panel, _save is valid
+};
+
+/*!
+  @brief  Compositor for the sprites on one display, with an SPI byte
+          count per frame.
+*/
+class Adafruit_SpriteLayer {
+
+  public:
+
+    Adafruit_SpriteLayer(Adafruit_ILI9341 *tft);
+
+    void         add(Adafruit_Sprite *s);
+    void         fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                   uint16_t color);
+    void         fillScreen(uint16_t color);
+    void         update(void);
+    void         endFrame(void);
+    void         resetStats(void);
+
+    /*!
+        @brief   SPI bytes sent and received in the last frame (between
+                 the last two endFrame() calls). An upper bound: address
+                 window commands the controller already has are skipped.
+        @return  Bytes.
+    */
+    uint32_t     frameBytes(void) const { return _frameBytes; }
+    /*!
+        @brief   Largest frameBytes() since resetStats().
+        @return  Bytes.
+    */
+    uint32_t     peakBytes(void) const { return _peakBytes; }
+    /*!
+        @brief   SPI bytes one frame can move at SPRITE_SPI_HZ.
+        @param   fps  Frame rate.
+        @return  Bytes per frame.
+    */
+    static uint32_t budget(uint16_t fps) { return SPRITE_SPI_HZ / 8 / fps; }
+
+  private:
+
+    void         show(Adafruit_Sprite *s);
+    void         restore(Adafruit_Sprite *s);
+    bool         move(Adafruit_Sprite *s);
+    void         overlay(const Adafruit_Sprite *s, int16_t sx, int16_t sy,
+                   const Adafruit_Rect &r, int16_t y, int16_t rows);
+    void         overlayAll(const Adafruit_Rect &r, int16_t y, int16_t rows);
+    void         underlay(const Adafruit_Sprite *s, const Adafruit_Rect &r,
+                   uint16_t *dest, int16_t pitch);
+    void         readBack(int16_t x, int16_t y, int16_t w, int16_t h,
+                   uint16_t *dest);
+    void         window(const Adafruit_Rect &r);
+    void         pixels(uint32_t n);
+
+    Adafruit_ILI9341 *_tft;                      ///< Display
+    Adafruit_Sprite  *_sprite[SPRITE_MAX];       ///< Sprites, in add() order
+    uint8_t           _nsprite;                  ///< Entries in _sprite
+    uint32_t          _bytes;                    ///< Bytes this frame so far
+    uint32_t          _frameBytes, _peakBytes;   ///< See frameBytes(), peakBytes()
+    uint16_t          _work[SPRITE_WORK_PIXELS]; ///< Compositing buffer
+};
+
+#endif // _ADAFRUIT_SPRITE_H_
@@ -0,0 +1,107 @@
+/*!
+ * @file Adafruit_TFTBus.h
+ *
+ * Transport interface between Adafruit_SPITFT and the wire. The display
+ * class only ever talks to an Adafruit_TFTBus; backends decide how bytes
+ * and pixels actually get out (polled HAL SPI, HAL DMA, or a host-side
+ * recorder that emulates the controller for testing without a board).
+ *
+ * This header is deliberately free of any HAL includes so host backends
+ * can use it on their own.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_TFTBUS_H_
+#define _ADAFRUIT_TFTBUS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*!
+  @brief  Abstract display bus. Implementations must keep the control
+          lines (CS, DC) steady while a non-blocking transfer is in
+          flight, i.e. setCS(), setDC() and read() wait for completion
+          themselves.
+*/
+class Adafruit_TFTBus {
+
+  public:
+
+    virtual ~Adafruit_TFTBus(void) {}
+
+    /*!
+        @brief  Drive the chip-select line.
+        @param  high  true to deselect the display, false to select it.
+    */
+    virtual void setCS(bool high) = 0;
+
+    /*!
+        @brief  Drive the data/command line.
+        @param  data  true for DATA mode, false for COMMAND mode.
+    */
+    virtual void setDC(bool data) = 0;
+
+    /*!
+        @brief  Send raw bytes, in order, as 8-bit frames.
+        @param  data   Bytes to send.
+        @param  len    Number of bytes.
+        @param  block  If false the call may return while the transfer is
+                       still running; 'data' must then stay untouched until
+                       wait() returns.
+    */
+    virtual void write(const uint8_t *data, uint32_t len,
+                   bool block = true) = 0;
+
+    /*!
+        @brief  Send a burst of native-endian RGB565 pixels. The backend
+                does whatever byte swapping or frame sizing the wire needs.
+        @param  colors  Pixel array.
+        @param  len     Number of pixels.
+        @param  block   If false the call may return while the last part
+                        is still going out. Backends copy before returning
+                        when non-blocking, so 'colors' may be reused.
+    */
+    virtual void writePixels(const uint16_t *colors, uint32_t len,
+                   bool block = true) = 0;
+
+    /*!
+        @brief  Send the same RGB565 pixel repeatedly (solid fills).
+        @param  color  Native-endian RGB565 color.
+        @param  len    Number of pixels.
+    */
+    virtual void fill(uint16_t color, uint32_t len) = 0;
+
+    /*!
+        @brief  Read raw bytes from the display.
+        @param  data  Destination buffer.
+        @param  len   Number of bytes.
+    */
+    virtual void read(uint8_t *data, uint32_t len) = 0;
+
+    /*!
+        @brief  Wait for any non-blocking transfer to complete. Default is a
+                no-op for backends that are always synchronous.
+    */
+    virtual void wait(void) {}
+
+    /*!
+        @brief  Note a command the driver decided not to send because the
+                controller was already in the right state (address window
+                cache). Nothing goes on the wire; backends may count it.
+        @param  cmd  Command byte that was skipped.
+    */
+    virtual void elided(uint8_t cmd) { (void)cmd; }
+
+    /*!
+        @brief  Send a single command byte: DC low, byte, DC back high.
+        @param  cmd  Command byte.
+    */
+    void command(uint8_t cmd) {
+        setDC(false);
+        write(&cmd, 1);
+        setDC(true);
+    }
+};
+
+#endif // end _ADAFRUIT_TFTBUS_H_
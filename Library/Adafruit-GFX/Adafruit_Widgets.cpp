@@ -0,0 +1,491 @@
+/*!
+ * @file Adafruit_Widgets.cpp
+ *
+ * Retained-mode widgets with damage tracking. See Adafruit_Widgets.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_Widgets.h"
+
+#ifndef min
+#define min(a,b) (((a) < (b)) ? (a) : (b))
+#endif
+
+#ifndef max
+#define max(a,b) (((a) > (b)) ? (a) : (b))
+#endif
+
+// Rectangle helpers -------------------------------------------------------
+
+// True if a and b share at least one pixel
+static bool rectsOverlap(const Adafruit_Rect &a, const Adafruit_Rect &b) {
+    return (a.x < b.x + b.w) && (b.x < a.x + a.w) &&
+           (a.y < b.y + b.h) && (b.y < a.y + a.h);
+}
+
+// True if inner lies entirely within outer
+static bool rectContains(const Adafruit_Rect &outer,
+  const Adafruit_Rect &inner) {
+    return (inner.x >= outer.x) && (inner.y >= outer.y) &&
+           (inner.x + inner.w <= outer.x + outer.w) &&
+           (inner.y + inner.h <= outer.y + outer.h);
+}
+
+// Bounding box of a and b
+static Adafruit_Rect rectUnion(const Adafruit_Rect &a,
+  const Adafruit_Rect &b) {
+    Adafruit_Rect r;
+    int16_t x1 = max(a.x + a.w, b.x + b.w), y1 = max(a.y + a.h, b.y + b.h);
+    r.x = min(a.x, b.x);
+    r.y = min(a.y, b.y);
+    r.w = x1 - r.x;
+    r.h = y1 - r.y;
+    return r;
+}
+
+// Overlap of a and b; w or h <= 0 if none
+static Adafruit_Rect rectIntersect(const Adafruit_Rect &a,
+  const Adafruit_Rect &b) {
+    Adafruit_Rect r;
+    int16_t x1 = min(a.x + a.w, b.x + b.w), y1 = min(a.y + a.h, b.y + b.h);
+    r.x = max(a.x, b.x);
+    r.y = max(a.y, b.y);
+    r.w = x1 - r.x;
+    r.h = y1 - r.y;
+    return r;
+}
+
+static uint32_t rectArea(const Adafruit_Rect &r) {
+    return (uint32_t)r.w * r.h;
+}
+
+
+// WIDGET ------------------------------------------------------------------
+
+/*!
+    @brief  Adafruit_Widget constructor.
+    @param  x   Left edge, screen coordinates.
+    @param  y   Top edge, screen coordinates.
+    @param  w   Width.
+    @param  h   Height.
+    @param  id  Value returned by id() for hit testing, -1 for none.
+*/
+Adafruit_Widget::Adafruit_Widget(int16_t x, int16_t y, int16_t w, int16_t h,
+  int16_t id) : _id(id), _visible(true), _screen(NULL), _child(NULL),
+  _next(NULL) {
+    _bounds.x = x;
+    _bounds.y = y;
+    _bounds.w = w;
+    _bounds.h = h;
+}
+
+/*!
+    @brief  Append a child, painted on top of this widget and any children
+            added before it. Children are expected to lie inside their
+            parent. A widget can only be in one tree.
+    @param  child  Widget to add.
+*/
+void Adafruit_Widget::add(Adafruit_Widget *child) {
+    Adafruit_Widget **link = &_child;
+    while(*link) link = &(*link)->_next;
+    *link        = child;
+    child->_next = NULL;
+    child->attach(_screen);
+    child->invalidate();
+}
+
+/*!
+    @brief  Show or hide the widget and its children. Hiding damages its
+            bounds so whatever is underneath gets repainted.
+    @param  visible  true to show.
+*/
+void Adafruit_Widget::setVisible(bool visible) {
+    if(visible == _visible) return;
+    _visible = visible;
+    invalidate();
+}
+
+/*!
+    @brief  Mark the widget's bounds for repainting on the next update().
+            Does nothing while the widget isn't on a screen.
+*/
+void Adafruit_Widget::invalidate(void) {
+    if(_screen) _screen->damage(_bounds);
+}
+
+/*!
+    @brief  Set the screen of this widget and its whole subtree.
+    @param  screen  Screen, or NULL when the tree is taken off one.
+*/
+void Adafruit_Widget::attach(Adafruit_WidgetScreen *screen) {
+    _screen = screen;
+    for(Adafruit_Widget *c = _child; c; c = c->_next) c->attach(screen);
+}
+
+
+// PANEL -------------------------------------------------------------------
+
+/*!
+    @brief  Adafruit_Panel constructor.
+    @param  x      Left edge.
+    @param  y      Top edge.
+    @param  w      Width.
+    @param  h      Height.
+    @param  color  Fill color.
+    @param  id     Hit-test id, -1 for none.
+*/
+Adafruit_Panel::Adafruit_Panel(int16_t x, int16_t y, int16_t w, int16_t h,
+  uint16_t color, int16_t id) : Adafruit_Widget(x, y, w, h, id),
+  _color(color) {
+}
+
+/*!
+    @brief  Change the fill color. The whole panel (children included) is
+            repainted on the next update().
+    @param  color  RGB565 color.
+*/
+void Adafruit_Panel::setColor(uint16_t color) {
+    if(color == _color) return;
+    _color = color;
+    invalidate();
+}
+
+/*!
+    @brief  Fill the part of the panel inside the clip rectangle.
+    @param  gfx   Display.
+    @param  clip  Damaged region.
+*/
+void Adafruit_Panel::draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip) {
+    Adafruit_Rect r = rectIntersect(_bounds, clip);
+    if((r.w > 0) && (r.h > 0)) gfx->fillRect(r.x, r.y, r.w, r.h, _color);
+}
+
+
+// LABEL -------------------------------------------------------------------
+
+/*!
+    @brief  Adafruit_Label constructor.
+    @param  x     Left edge.
+    @param  y     Top edge.
+    @param  w     Width; text beyond it is cut off at a whole character.
+    @param  h     Height.
+    @param  text  NUL-terminated string, kept by pointer.
+    @param  fg    Text color.
+    @param  bg    Background color.
+    @param  size  Text magnification.
+*/
+Adafruit_Label::Adafruit_Label(int16_t x, int16_t y, int16_t w, int16_t h,
+  const char *text, uint16_t fg, uint16_t bg, uint8_t size) :
+  Adafruit_Widget(x, y, w, h), _text(text), _fg(fg), _bg(bg),
+  _size(size ? size : 1) {
+}
+
+/*!
+    @brief  Change the text. Call again after editing a string in place so
+            the label is repainted.
+    @param  text  NUL-terminated string, kept by pointer.
+*/
+void Adafruit_Label::setText(const char *text) {
+    _text = text;
+    invalidate();
+}
+
+/*!
+    @brief  Change the colors.
+    @param  fg  Text color.
+    @param  bg  Background color.
+*/
+void Adafruit_Label::setColors(uint16_t fg, uint16_t bg) {
+    if((fg == _fg) && (bg == _bg)) return;
+    _fg = fg;
+    _bg = bg;
+    invalidate();
+}
+
+/*!
+    @brief  Paint the label: opaque text cells, then background for the
+            rest of the bounds, so no pixel is written twice.
+    @param  gfx   Display.
+    @param  clip  Ignored, the label is always painted whole.
+*/
+void Adafruit_Label::draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip) {
+    (void)clip;
+    int16_t cw = 6 * _size, ch = 8 * _size;
+    int16_t n  = _text ? strlen(_text) : 0;
+    if(n > _bounds.w / cw) n = _bounds.w / cw;
+    if(ch > _bounds.h) n = 0;
+
+    int16_t tw = n * cw, th = n ? ch : 0;
+    for(int16_t i=0; i<n; i++) {
+        gfx->drawChar(_bounds.x + i * cw, _bounds.y, _text[i], _fg, _bg,
+          _size);
+    }
+    if(th && (tw < _bounds.w)) {
+        gfx->fillRect(_bounds.x + tw, _bounds.y, _bounds.w - tw, th, _bg);
+    }
+    if(th < _bounds.h) {
+        gfx->fillRect(_bounds.x, _bounds.y + th, _bounds.w, _bounds.h - th,
+          _bg);
+    }
+}
+
+
+// ICON BUTTON -------------------------------------------------------------
+
+/*!
+    @brief  Adafruit_IconButton constructor.
+    @param  gfx        Display the underlying Adafruit_GFX_Button draws on.
+    @param  x          Left edge.
+    @param  y          Top edge.
+    @param  w          Width (and icon width).
+    @param  h          Height (and icon height).
+    @param  id         Hit-test id.
+    @param  icon       w*h RGB565 pixels, or NULL for a plain button.
+    @param  outline    Button outline color.
+    @param  fill       Button fill color.
+    @param  highlight  Color of the selected/pressed frame.
+*/
+Adafruit_IconButton::Adafruit_IconButton(Adafruit_GFX *gfx, int16_t x,
+  int16_t y, int16_t w, int16_t h, int16_t id, const uint16_t *icon,
+  uint16_t outline, uint16_t fill, uint16_t highlight) :
+  Adafruit_Widget(x, y, w, h, id), _icon(icon), _highlight(highlight),
+  _pressed(false), _selected(false) {
+    _button.initButtonUL(gfx, x, y, w, h, outline, fill, outline,
+      (char *)"", 1);
+    // Adafruit_GFX_Button leaves its state uninitialized and press() only
+    // shifts currstate into laststate: the second call clears laststate
+    // too, so justPressed()/justReleased() start out false.
+    _button.press(false);
+    _button.press(false);
+}
+
+/*!
+    @brief  Set the pressed state, also fed to the GFX button's press() for
+            justPressed()/justReleased(). Repaints only on a change.
+    @param  pressed  true while touched.
+*/
+void Adafruit_IconButton::setPressed(bool pressed) {
+    _button.press(pressed);
+    if(pressed == _pressed) return;
+    _pressed = pressed;
+    invalidate();
+}
+
+/*!
+    @brief  Set the selected state. Repaints only on a change.
+    @param  selected  true to draw the highlight frame.
+*/
+void Adafruit_IconButton::setSelected(bool selected) {
+    if(selected == _selected) return;
+    _selected = selected;
+    invalidate();
+}
+
+/*!
+    @brief  Paint the button.
+    @param  gfx   Display.
+    @param  clip  Ignored, the button is always painted whole.
+*/
+void Adafruit_IconButton::draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip) {
+    (void)clip;
+    int16_t x = _bounds.x, y = _bounds.y, w = _bounds.w, h = _bounds.h;
+    if(_icon) {
+        gfx->drawRGBBitmap(x, y, (uint16_t *)_icon, w, h);
+        if(_pressed || _selected) {
+            gfx->drawRect(x, y, w, h, _highlight);
+            gfx->drawRect(x + 1, y + 1, w - 2, h - 2, _highlight);
+        }
+    } else {
+        _button.drawButton(_pressed);
+        if(_selected && (w > 4) && (h > 4)) {
+            int16_t r = min(w, h) / 4 - 2;
+            gfx->drawRoundRect(x + 2, y + 2, w - 4, h - 4, max(r, 0),
+              _highlight);
+        }
+    }
+}
+
+
+// SCREEN ------------------------------------------------------------------
+
+/*!
+    @brief  Adafruit_WidgetScreen constructor.
+    @param  gfx  Display to paint on.
+*/
+Adafruit_WidgetScreen::Adafruit_WidgetScreen(Adafruit_GFX *gfx) :
+  _gfx(gfx), _root(NULL), _ndamage(0), _painted(0) {
+}
+
+/*!
+    @brief  Show a different tree. The previous one is detached (its
+            changes stop generating damage) and the whole display is
+            damaged, since nothing on it belongs to the new tree yet.
+    @param  root  Tree to show, or NULL.
+*/
+void Adafruit_WidgetScreen::setRoot(Adafruit_Widget *root) {
+    if(_root) _root->attach(NULL);
+    _root    = root;
+    _ndamage = 0;
+    if(!root) return;
+    root->attach(this);
+    Adafruit_Rect all = { 0, 0, _gfx->width(), _gfx->height() };
+    damage(all);
+}
+
+/*!
+    @brief  Add a region to repaint on the next update(). It is clipped to
+            the display and merged with any overlapping damage; when the
+            list is full it's merged with whichever entry grows least.
+    @param  r  Region, screen coordinates.
+*/
+void Adafruit_WidgetScreen::damage(const Adafruit_Rect &r) {
+    Adafruit_Rect all = { 0, 0, _gfx->width(), _gfx->height() };
+    Adafruit_Rect n   = rectIntersect(r, all);
+    if((n.w <= 0) || (n.h <= 0)) return;
+
+    for(;;) {
+        uint8_t i;
+        for(i=0; i<_ndamage; i++) {
+            if(rectContains(_damage[i], n)) return; // Already covered
+            if(rectsOverlap(_damage[i], n)) break;
+        }
+        if(i == _ndamage) {
+            if(_ndamage < WIDGET_DAMAGE_RECTS) break;
+            // List full: fold into the entry that grows least
+            uint32_t best = 0xFFFFFFFF;
+            for(uint8_t j=0; j<_ndamage; j++) {
+                uint32_t cost = rectArea(rectUnion(_damage[j], n)) -
+                  rectArea(_damage[j]);
+                if(cost < best) {
+                    best = cost;
+                    i    = j;
+                }
+            }
+        }
+        // Merge with entry i and retry, the union may overlap others
+        n = rectUnion(_damage[i], n);
+        _damage[i] = _damage[--_ndamage];
+    }
+    _damage[_ndamage++] = n;
+}
+
+/*!
+    @brief   Merge overlapping damage entries.
+    @return  true if anything was merged.
+*/
+bool Adafruit_WidgetScreen::coalesce(void) {
+    bool merged = false;
+    for(uint8_t i=0; i<_ndamage; i++) {
+        for(uint8_t j=i+1; j<_ndamage; ) {
+            if(rectsOverlap(_damage[i], _damage[j])) {
+                _damage[i] = rectUnion(_damage[i], _damage[j]);
+                _damage[j] = _damage[--_ndamage];
+                merged     = true;
+                j          = i + 1; // Grown entry may now hit earlier ones
+            } else {
+                j++;
+            }
+        }
+    }
+    return merged;
+}
+
+/*!
+    @brief   Extend a damage region over every visible widget that can't
+             be partly repainted and is only partly inside it.
+    @param   r  Region, updated in place.
+    @param   w  First widget of a sibling list.
+    @return  true if r grew.
+*/
+bool Adafruit_WidgetScreen::grow(Adafruit_Rect &r, Adafruit_Widget *w) {
+    bool grew = false;
+    for(; w; w = w->_next) {
+        if(!w->_visible || !rectsOverlap(r, w->_bounds)) continue;
+        if(!w->clips() && !rectContains(r, w->_bounds)) {
+            r    = rectUnion(r, w->_bounds);
+            grew = true;
+        }
+        if(grow(r, w->_child)) grew = true;
+    }
+    return grew;
+}
+
+/*!
+    @brief  Paint, back to front, every visible widget in a sibling list
+            (and its children) that intersects a region.
+    @param  w  First widget of the list.
+    @param  r  Region being repainted.
+*/
+void Adafruit_WidgetScreen::paint(Adafruit_Widget *w, const Adafruit_Rect &r) {
+    for(; w; w = w->_next) {
+        if(!w->_visible || !rectsOverlap(r, w->_bounds)) continue;
+        w->draw(_gfx, r);
+        paint(w->_child, r);
+    }
+}
+
+/*!
+    @brief   Repaint all damage in one startWrite()/endWrite() pass. Regions
+             are first grown to whole widgets where needed and re-merged,
+             so no pixel is painted from two regions.
+    @return  true if anything was painted.
+*/
+bool Adafruit_WidgetScreen::update(void) {
+    _painted = 0;
+    if(!_root || !_ndamage) {
+        _ndamage = 0;
+        return false;
+    }
+
+    bool changed;
+    do {
+        changed = false;
+        for(uint8_t i=0; i<_ndamage; i++) {
+            while(grow(_damage[i], _root)) changed = true;
+        }
+        if(coalesce()) changed = true;
+    } while(changed);
+
+    _gfx->startWrite();
+    for(uint8_t i=0; i<_ndamage; i++) {
+        paint(_root, _damage[i]);
+        _painted += rectArea(_damage[i]);
+    }
+    _gfx->endWrite();
+    _ndamage = 0;
+    return true;
+}
+
+/*!
+    @brief   Find the topmost visible widget with an id at a point.
+    @param   w  First widget of a sibling list.
+    @param   x  Screen x.
+    @param   y  Screen y.
+    @return  Widget, or NULL.
+*/
+Adafruit_Widget *Adafruit_WidgetScreen::hitList(Adafruit_Widget *w,
+  int16_t x, int16_t y) {
+    Adafruit_Widget *found = NULL;
+    for(; w; w = w->_next) {
+        const Adafruit_Rect &b = w->_bounds;
+        if(!w->_visible || (x < b.x) || (y < b.y) ||
+          (x >= b.x + b.w) || (y >= b.y + b.h)) continue;
+        Adafruit_Widget *c = hitList(w->_child, x, y);
+        if(c) found = c;
+        else if(w->_id >= 0) found = w;
+    }
+    return found;
+}
+
+/*!
+    @brief   Hit test, typically with touch coordinates.
+    @param   x  Screen x.
+    @param   y  Screen y.
+    @return  Topmost visible widget with an id (>= 0) containing the
+             point, or NULL.
+*/
+Adafruit_Widget *Adafruit_WidgetScreen::hit(int16_t x, int16_t y) const {
+    return hitList(_root, x, y);
+}
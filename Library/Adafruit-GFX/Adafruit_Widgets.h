@@ -0,0 +1,229 @@
+/*!
+ * @file Adafruit_Widgets.h
+ *
+ * Small retained-mode widget layer for Adafruit_GFX displays: panels,
+ * labels and icon buttons (built on Adafruit_GFX_Button) in a tree owned
+ * by an Adafruit_WidgetScreen. Changing a widget only records its bounds
+ * as damage; update() then repaints just the damaged regions, all inside
+ * one startWrite()/endWrite() pass, so a state change costs SPI traffic in
+ * proportion to what changed rather than a full-screen redraw. On an
+ * Adafruit_SPITFT with setDeferred(true) that pass goes out as strips.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_WIDGETS_H_
+#define _ADAFRUIT_WIDGETS_H_
+
+#include "Adafruit_GFX.h"
+
+#if !defined(WIDGET_DAMAGE_RECTS)
+ #define WIDGET_DAMAGE_RECTS 8 ///< Damage rectangles kept between updates
+#endif
+
+class Adafruit_WidgetScreen;
+
+/*!
+  @brief  Base widget: bounds, visibility, an optional id for hit testing
+          and links into the tree. Children are painted after (on top of)
+          their parent, later siblings on top of earlier ones.
+*/
+class Adafruit_Widget {
+
+  public:
+
+    Adafruit_Widget(int16_t x, int16_t y, int16_t w, int16_t h,
+      int16_t id = -1);
+    virtual ~Adafruit_Widget(void) { }
+
+    void         add(Adafruit_Widget *child);
+    void         setVisible(bool visible);
+    void         invalidate(void);
+
+    /*!
+        @brief   Paint the widget. Widgets for which clips() is false must
+                 paint all of their bounds; update() makes sure the damage
+                 region covers them first.
+        @param   gfx   Display to draw on.
+        @param   clip  Damaged region being repainted.
+    */
+    virtual void draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip) = 0;
+    /*!
+        @brief   Whether draw() honors the clip rectangle. Such widgets can
+                 be partly repainted; others are repainted whole.
+        @return  false unless a subclass says otherwise.
+    */
+    virtual bool clips(void) const { return false; }
+
+    /*!
+        @brief   Get the widget's screen rectangle.
+        @return  Bounds.
+    */
+    const Adafruit_Rect &bounds(void) const { return _bounds; }
+    /*!
+        @brief   Get the id given at construction.
+        @return  Id, -1 for widgets that don't take touches.
+    */
+    int16_t      id(void) const { return _id; }
+    /*!
+        @brief   Query visibility.
+        @return  true if the widget (and its children) are painted.
+    */
+    bool         visible(void) const { return _visible; }
+
+  protected:
+
+    Adafruit_Rect          _bounds;  ///< Screen rectangle
+    int16_t                _id;      ///< Hit-test id, -1 for none
+    bool                   _visible; ///< Painted and hit-tested if set
+
+  private:
+
+    friend class Adafruit_WidgetScreen;
+
+    void         attach(Adafruit_WidgetScreen *screen);
+
+    Adafruit_WidgetScreen *_screen;  ///< Screen showing this tree, or NULL
+    Adafruit_Widget       *_child;   ///< First child
+    Adafruit_Widget       *_next;    ///< Next sibling
+};
+
+/*!
+  @brief  Solid rectangle, usually a background or container for other
+          widgets. Repaints only the damaged part of itself.
+*/
+class Adafruit_Panel : public Adafruit_Widget {
+
+  public:
+
+    Adafruit_Panel(int16_t x, int16_t y, int16_t w, int16_t h,
+      uint16_t color, int16_t id = -1);
+
+    void         setColor(uint16_t color);
+    void         draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip);
+    /*!
+        @brief   A panel paints any sub-rectangle of itself.
+        @return  true.
+    */
+    bool         clips(void) const { return true; }
+    /*!
+        @brief   Get the fill color.
+        @return  RGB565 color.
+    */
+    uint16_t     color(void) const { return _color; }
+
+  private:
+
+    uint16_t     _color;  ///< Fill color
+};
+
+/*!
+  @brief  One line of opaque classic-font text. The string is not copied.
+*/
+class Adafruit_Label : public Adafruit_Widget {
+
+  public:
+
+    Adafruit_Label(int16_t x, int16_t y, int16_t w, int16_t h,
+      const char *text, uint16_t fg, uint16_t bg, uint8_t size = 1);
+
+    void         setText(const char *text);
+    void         setColors(uint16_t fg, uint16_t bg);
+    void         draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip);
+
+  private:
+
+    const char  *_text;     ///< Caller-owned string
+    uint16_t     _fg, _bg;  ///< Text and background colors
+    uint8_t      _size;     ///< Text magnification
+};
+
+/*!
+  @brief  Adafruit_GFX_Button with an optional RGB565 icon and
+          pressed/selected state. Without an icon it's drawn as the usual
+          rounded button; with one, the icon fills the bounds. Pressed
+          draws the button inverted (icons get a frame); selected adds an
+          inner frame in the highlight color.
+*/
+class Adafruit_IconButton : public Adafruit_Widget {
+
+  public:
+
+    Adafruit_IconButton(Adafruit_GFX *gfx, int16_t x, int16_t y,
+      int16_t w, int16_t h, int16_t id, const uint16_t *icon = NULL,
+      uint16_t outline = 0xFFFF, uint16_t fill = 0x0000,
+      uint16_t highlight = 0xF800);
+
+    void         setPressed(bool pressed);
+    void         setSelected(bool selected);
+    void         draw(Adafruit_GFX *gfx, const Adafruit_Rect &clip);
+
+    /*!
+        @brief   Query the pressed state.
+        @return  true if pressed.
+    */
+    bool         pressed(void) const { return _pressed; }
+    /*!
+        @brief   Query the selected state.
+        @return  true if selected.
+    */
+    bool         selected(void) const { return _selected; }
+    /*!
+        @brief   Get the underlying GFX button (for label, colors and its
+                 press()/justPressed() edge tracking).
+        @return  Reference to the button.
+    */
+    Adafruit_GFX_Button &button(void) { return _button; }
+
+  private:
+
+    Adafruit_GFX_Button _button;    ///< Drawing and state of a plain button
+    const uint16_t     *_icon;      ///< w*h RGB565 pixels, or NULL
+    uint16_t            _highlight; ///< Selected/pressed frame color
+    bool                _pressed;   ///< Drawn inverted
+    bool                _selected;  ///< Drawn with a highlight frame
+};
+
+/*!
+  @brief  Root of a widget tree on one display. Keeps the damage list and
+          repaints it on update().
+*/
+class Adafruit_WidgetScreen {
+
+  public:
+
+    Adafruit_WidgetScreen(Adafruit_GFX *gfx);
+
+    void             setRoot(Adafruit_Widget *root);
+    void             damage(const Adafruit_Rect &r);
+    bool             update(void);
+    Adafruit_Widget *hit(int16_t x, int16_t y) const;
+
+    /*!
+        @brief   Get the tree being shown.
+        @return  Root widget, or NULL.
+    */
+    Adafruit_Widget *root(void) const { return _root; }
+    /*!
+        @brief   Number of pixels painted by the last update() (damage
+                 area after growing it to whole widgets).
+        @return  Pixel count.
+    */
+    uint32_t         painted(void) const { return _painted; }
+
+  private:
+
+    static bool      grow(Adafruit_Rect &r, Adafruit_Widget *w);
+    static Adafruit_Widget *hitList(Adafruit_Widget *w, int16_t x,
+                       int16_t y);
+    void             paint(Adafruit_Widget *w, const Adafruit_Rect &r);
+    bool             coalesce(void);
+
+    Adafruit_GFX    *_gfx;                         ///< Display
+    Adafruit_Widget *_root;                        ///< Tree being shown
+    Adafruit_Rect    _damage[WIDGET_DAMAGE_RECTS]; ///< Pending damage
+    uint8_t          _ndamage;                     ///< Entries in _damage
+    uint32_t         _painted;                     ///< See painted()
+};
+
+#endif // _ADAFRUIT_WIDGETS_H_
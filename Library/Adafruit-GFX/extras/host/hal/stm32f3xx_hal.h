@@ -0,0 +1,88 @@
+/*!
+ * @file stm32f3xx_hal.h
+ *
+ * Fake STM32 HAL for the host tests: just the types, macros and SPI/GPIO
+ * calls that Adafruit_HALBus.cpp uses. fake_hal.cpp implements them by
+ * logging every frame that would go out on MOSI, together with the level
+ * of the data/command line, so a test can check the exact byte stream and
+ * the number of HAL transfers behind it. Not for the firmware build.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _FAKE_STM32F3XX_HAL_H_
+#define _FAKE_STM32F3XX_HAL_H_
+
+#include <stdint.h>
+#include <string.h>
+
+typedef enum { HAL_OK = 0, HAL_ERROR, HAL_BUSY, HAL_TIMEOUT } HAL_StatusTypeDef;
+typedef enum { GPIO_PIN_RESET = 0, GPIO_PIN_SET } GPIO_PinState;
+
+typedef struct { uint32_t ODR; } GPIO_TypeDef;
+typedef struct { uint32_t CR1, CR2; } SPI_TypeDef;
+typedef struct { uint32_t CCR; } DMA_Channel_TypeDef;
+typedef struct { uint32_t DataSize; } SPI_InitTypeDef;
+typedef struct {
+    uint32_t PeriphDataAlignment, MemDataAlignment;
+} DMA_InitTypeDef;
+typedef struct __DMA_HandleTypeDef {
+    DMA_Channel_TypeDef *Instance;
+    DMA_InitTypeDef      Init;
+} DMA_HandleTypeDef;
+typedef struct __SPI_HandleTypeDef {
+    SPI_TypeDef       *Instance;
+    SPI_InitTypeDef    Init;
+    DMA_HandleTypeDef *hdmatx, *hdmarx;
+} SPI_HandleTypeDef;
+
+#define HAL_MAX_DELAY           0xFFFFFFFFU
+#define SPI_DATASIZE_8BIT       0x0700U
+#define SPI_DATASIZE_16BIT      0x0F00U
+#define SPI_CR2_DS              0x0F00U
+#define SPI_CR1_SPE             0x0040U
+#define DMA_PDATAALIGN_BYTE     0x0000U
+#define DMA_PDATAALIGN_HALFWORD 0x0100U
+#define DMA_MDATAALIGN_BYTE     0x0000U
+#define DMA_MDATAALIGN_HALFWORD 0x0400U
+#define DMA_CCR_PSIZE           0x0300U
+#define DMA_CCR_MSIZE           0x0C00U
+
+#define __HAL_SPI_DISABLE(h)    ((h)->Instance->CR1 &= ~SPI_CR1_SPE)
+#define MODIFY_REG(REG, CLEARMASK, SETMASK) \
+  ((REG) = (((REG) & ~(CLEARMASK)) | (SETMASK)))
+
+HAL_StatusTypeDef HAL_SPI_Transmit(SPI_HandleTypeDef *hspi, uint8_t *pData,
+  uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Receive(SPI_HandleTypeDef *hspi, uint8_t *pData,
+  uint16_t Size, uint32_t Timeout);
+HAL_StatusTypeDef HAL_SPI_Transmit_DMA(SPI_HandleTypeDef *hspi,
+  uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_SPI_Receive_DMA(SPI_HandleTypeDef *hspi,
+  uint8_t *pData, uint16_t Size);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin,
+  GPIO_PinState PinState);
+
+// HOST TEST HOOKS ---------------------------------------------------------
+
+/*!
+  @brief  What the fake SPI port has sent since fakeHALReset(). Each wire
+          entry is one byte, with bit 8 set if the DC line (fakeDCPort /
+          fakeDCPin) was high, i.e. it was data rather than a command.
+*/
+typedef struct {
+    uint16_t *wire;         ///< Captured bytes (NULL to count only)
+    uint32_t  capacity;     ///< Entries 'wire' can hold
+    uint32_t  bytes;        ///< Bytes sent (also past capacity)
+    uint32_t  transfers;    ///< HAL transmit calls, polled or DMA
+    uint32_t  dmaTransfers; ///< ...of which through the DMA functions
+    uint32_t  frames16;     ///< ...of which in 16-bit frame mode
+} FakeSPILog;
+
+extern FakeSPILog    fakeSPI;
+extern GPIO_TypeDef *fakeDCPort;
+extern uint16_t      fakeDCPin;
+
+void fakeHALReset(void);
+
+#endif // _FAKE_STM32F3XX_HAL_H_
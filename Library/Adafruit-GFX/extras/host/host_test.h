@@ -0,0 +1,63 @@
+/*!
+ * @file host_test.h
+ *
+ * Minimal helpers shared by the host tests: a CHECK() that counts
+ * failures instead of aborting, a monotonic clock for the benchmarks and
+ * a display wired to an Adafruit_RecordingBus in the firmware's rotation.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+#include <stdio.h>
+#include <time.h>
+#include "Adafruit_ILI9341.h"
+#include "Adafruit_RecordingBus.h"
+
+static int testFailures = 0; ///< CHECK() failures so far
+
+/*!
+  @brief  Report (and count) a failed condition, then carry on.
+*/
+#define CHECK(cond)                                                      \
+  do {                                                                   \
+    if(!(cond)) {                                                        \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);            \
+      testFailures++;                                                    \
+    }                                                                    \
+  } while(0)
+
+/*!
+    @brief   Seconds on a monotonic clock, for the benchmarks.
+    @return  Time in seconds.
+*/
+static inline double testSeconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/*!
+    @brief   Bring up a display on a bus, landscape as in the firmware.
+    @param   tft  Display.
+    @param   bus  Bus to route it through.
+*/
+static inline void testBegin(Adafruit_ILI9341 &tft, Adafruit_TFTBus &bus) {
+    tft.setBus(&bus);
+    tft.begin();
+    tft.setRotation(3);
+}
+
+/*!
+    @brief   Print the verdict for main() to return.
+    @param   name  Test name.
+    @return  Process exit status, 0 if every CHECK() held.
+*/
+static inline int testResult(const char *name) {
+    printf("%s: %s\n", name, testFailures ? "FAILED" : "ok");
+    return testFailures ? 1 : 0;
+}
+
+#endif // _HOST_TEST_H_
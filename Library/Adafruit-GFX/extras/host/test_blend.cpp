@@ -0,0 +1,163 @@
+/*!
+ * @file test_blend.cpp
+ *
+ * Adafruit_Blend's two-pixel kernels against a scalar reference that
+ * splits every pixel into channels, as Adafruit_Blend.h defines them: a
+ * sweep of the single-pixel blend over foregrounds, backgrounds and all
+ * alphas, then the row kernels over odd lengths and both 16-bit
+ * alignments, which must leave pixels outside the row alone. Then prints
+ * the throughput of each kernel and its reference on a 320-pixel row.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_Blend.h"
+#include "host_test.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define ROW_MAX 1003 ///< Longest row tested, plus slack around it
+
+static uint32_t seed = 1; ///< testRand() state
+
+/*!
+    @brief   Deterministic pseudo-random number.
+    @return  16 random bits.
+*/
+static uint16_t testRand(void) {
+    seed = seed * 1103515245UL + 12345UL;
+    return seed >> 16;
+}
+
+/*!
+    @brief   Per-channel blend, as documented in Adafruit_Blend.h.
+    @param   fg     Foreground pixel.
+    @param   bg     Background pixel.
+    @param   alpha  0 (bg) to 255 (fg).
+    @return  Blended pixel.
+*/
+static uint16_t refBlend(uint16_t fg, uint16_t bg, uint8_t alpha) {
+    uint16_t a = (alpha + 4) >> 3;
+    uint16_t r = (((fg >> 11) & 31) * a + ((bg >> 11) & 31) * (32 - a)) >> 5;
+    uint16_t g = (((fg >> 5) & 63) * a + ((bg >> 5) & 63) * (32 - a)) >> 5;
+    uint16_t b = ((fg & 31) * a + (bg & 31) * (32 - a)) >> 5;
+    return (r << 11) | (g << 5) | b;
+}
+
+/*!
+    @brief   Per-channel 50% average, rounding down.
+    @param   x  First pixel.
+    @param   y  Second pixel.
+    @return  Average.
+*/
+static uint16_t refAverage(uint16_t x, uint16_t y) {
+    return ((((x >> 11) + (y >> 11)) >> 1) << 11) |
+           (((((x >> 5) & 63) + ((y >> 5) & 63)) >> 1) << 5) |
+           (((x & 31) + (y & 31)) >> 1);
+}
+
+// Reference rows; kept out of line so the benchmark times a real loop
+
+__attribute__((noinline)) static void refBlendRow(uint16_t *dst,
+  const uint16_t *src, uint32_t n, uint8_t alpha) {
+    for(uint32_t i=0; i<n; i++) dst[i] = refBlend(src[i], dst[i], alpha);
+}
+
+__attribute__((noinline)) static void refFadeRow(uint16_t *dst, uint32_t n,
+  uint16_t color, uint8_t alpha) {
+    for(uint32_t i=0; i<n; i++) dst[i] = refBlend(color, dst[i], alpha);
+}
+
+__attribute__((noinline)) static void refAverageRow(uint16_t *dst,
+  const uint16_t *a, const uint16_t *b, uint32_t n) {
+    for(uint32_t i=0; i<n; i++) dst[i] = refAverage(a[i], b[i]);
+}
+
+/*!
+    @brief   A clock for the benchmark: CPU cycles where the host has a
+             time-stamp counter, nanoseconds elsewhere.
+    @return  Current count.
+*/
+static inline double benchClock(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return (double)__rdtsc();
+#else
+    return testSeconds() * 1e9;
+#endif
+}
+
+int main(void) {
+    uint32_t bad = 0;
+    for(uint16_t alpha=0; alpha<256; alpha++) {
+        for(uint8_t i=0; i<64; i++) {
+            uint16_t bg = testRand();
+            for(uint32_t fg=alpha & 7; fg<65536; fg+=7) {
+                if(rgb565Blend(fg, bg, alpha) != refBlend(fg, bg, alpha))
+                    bad++;
+            }
+        }
+    }
+    printf("single pixel: %u mismatches over 256 alphas\n", bad);
+    CHECK(bad == 0);
+    CHECK(rgb565Blend(0x1234, 0xBEEF, 0) == 0xBEEF);
+    CHECK(rgb565Blend(0x1234, 0xBEEF, 255) == 0x1234);
+
+    static uint16_t src[ROW_MAX], other[ROW_MAX], dst[ROW_MAX], ref[ROW_MAX];
+    uint32_t badBlend = 0, badFade = 0, badAverage = 0;
+    for(int k=0; k<3000; k++) {
+        uint32_t n     = testRand() % (ROW_MAX - 2);
+        uint8_t  d     = testRand() & 1, s = testRand() & 1;
+        uint8_t  alpha = testRand();
+        uint16_t color = testRand();
+        for(int i=0; i<ROW_MAX; i++) {
+            src[i]   = testRand();
+            other[i] = testRand();
+            dst[i]   = ref[i] = testRand();
+        }
+        rgb565BlendRow(dst + d, src + s, n, alpha);
+        refBlendRow(ref + d, src + s, n, alpha);
+        if(memcmp(dst, ref, sizeof(dst))) badBlend++;
+        rgb565FadeRow(dst + d, n, color, alpha);
+        refFadeRow(ref + d, n, color, alpha);
+        if(memcmp(dst, ref, sizeof(dst))) badFade++;
+        rgb565AverageRow(dst + d, src + s, other + (s ^ 1), n);
+        refAverageRow(ref + d, src + s, other + (s ^ 1), n);
+        if(memcmp(dst, ref, sizeof(dst))) badAverage++;
+        memcpy(dst, ref, sizeof(dst)); // Keep going after a mismatch
+    }
+    printf("3000 rows, 0-1000 pixels, any alignment: %u blend, %u fade, "
+      "%u average mismatches\n", badBlend, badFade, badAverage);
+    CHECK(badBlend == 0);
+    CHECK(badFade == 0);
+    CHECK(badAverage == 0);
+
+    // Throughput on a screen-width row
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "pixels/cycle";
+#else
+    const char *unit = "pixels/ns";
+#endif
+    const uint32_t n = 320, reps = 20000;
+    double t, rate[6];
+#define BENCH(slot, stmt)                                       \
+    t = benchClock();                                           \
+    for(uint32_t r=0; r<reps; r++) {                            \
+        stmt;                                                   \
+        __asm__ volatile("" : : "r"(dst) : "memory");           \
+    }                                                           \
+    rate[slot] = (double)n * reps / (benchClock() - t)
+    BENCH(0, refBlendRow(dst, src, n, 100));
+    BENCH(1, rgb565BlendRow(dst, src, n, 100));
+    BENCH(2, refFadeRow(dst, n, 0, 100));
+    BENCH(3, rgb565FadeRow(dst, n, 0, 100));
+    BENCH(4, refAverageRow(dst, dst, src, n));
+    BENCH(5, rgb565AverageRow(dst, dst, src, n));
+#undef BENCH
+    printf("%s, reference / kernel: blend %.2f / %.2f, fade %.2f / %.2f, "
+      "average %.2f / %.2f\n", unit, rate[0], rate[1], rate[2], rate[3],
+      rate[4], rate[5]);
+
+    return testResult("test_blend");
+}
@@ -0,0 +1,222 @@
+/*!
+ * @file test_brush.cpp
+ *
+ * Adafruit_Brush against dense stamping on a GFXcanvas16: a round dab must
+ * be a fillCircle() at every radius, and random multi-segment strokes (all
+ * shapes, clipped, with segments taller than the span table) must cover
+ * exactly the pixels of the brush stamped at every pixel of each segment's
+ * Bresenham line. Counts the pixels each segment sends to check the joint
+ * trim in flush(): never less than what's newly covered, and for one-pixel
+ * horizontal steps exactly that. Reports the wire cost of a fast swipe
+ * against dense dabs on the recording bus.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "Adafruit_Brush.h"
+#include "host_test.h"
+
+#define CANVAS_W 160
+#define CANVAS_H 120
+
+/*!
+  @brief  Canvas that counts the pixels sent through the write functions
+          the brush uses (clipped, as the canvas draws them).
+*/
+class CountingCanvas : public GFXcanvas16 {
+ public:
+  CountingCanvas(uint16_t w, uint16_t h) : GFXcanvas16(w, h), sent(0) { }
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+    uint16_t color) {
+      int16_t x1 = x + w, y1 = y + h;
+      if(x1 > _width)  x1 = _width;
+      if(y1 > _height) y1 = _height;
+      if(x < 0) x = 0;
+      if(y < 0) y = 0;
+      if((x >= x1) || (y >= y1)) return;
+      sent += (uint32_t)(x1 - x) * (y1 - y);
+      GFXcanvas16::writeFillRect(x, y, x1 - x, y1 - y, color);
+  }
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+      writeFillRect(x, y, w, 1, color);
+  }
+  uint32_t sent; ///< Pixels sent so far
+};
+
+static CountingCanvas canvas(CANVAS_W, CANVAS_H);
+static GFXcanvas16    ref(CANVAS_W, CANVAS_H);
+static uint32_t       seed = 1; ///< randomInt() state
+
+// Small LCG so the cases don't depend on the C library's rand()
+static int16_t randomInt(int16_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (int16_t)((seed >> 16) % n);
+}
+
+// One dab of the brush shape, drawn with the plain primitives
+static void dab(Adafruit_GFX &g, int16_t x, int16_t y, uint8_t r,
+  uint8_t shape) {
+    if(shape == BRUSH_SQUARE) {
+        g.fillRect(x - r, y - r, 2 * r + 1, 2 * r + 1, 0xFFFF);
+    } else if(shape == BRUSH_DIAMOND) {
+        for(int16_t d=-r; d<=r; d++) {
+            int16_t hw = r - abs(d);
+            g.drawFastHLine(x - hw, y + d, 2 * hw + 1, 0xFFFF);
+        }
+    } else {
+        g.fillCircle(x, y, r, 0xFFFF);
+    }
+}
+
+// Dabs at every pixel of the Bresenham line, as drawLine() would visit
+static void denseLine(Adafruit_GFX &g, int16_t x0, int16_t y0, int16_t x1,
+  int16_t y1, uint8_t r, uint8_t shape) {
+    int16_t dx = abs(x1 - x0), sx = (x0 < x1) ? 1 : -1;
+    int16_t dy = -abs(y1 - y0), sy = (y0 < y1) ? 1 : -1;
+    int16_t err = dx + dy;
+    dab(g, x0, y0, r, shape);
+    while((x0 != x1) || (y0 != y1)) {
+        int16_t e2 = 2 * err;
+        if(e2 >= dy) { err += dy; x0 += sx; }
+        if(e2 <= dx) { err += dx; y0 += sy; }
+        dab(g, x0, y0, r, shape);
+    }
+}
+
+// Covered pixels in a canvas
+static uint32_t covered(const GFXcanvas16 &g) {
+    const uint16_t *p = g.getBuffer();
+    uint32_t        n = 0;
+    for(int i=0; i<CANVAS_W * CANVAS_H; i++) n += (p[i] != 0);
+    return n;
+}
+
+static void testDabs(void) {
+    uint32_t bad = 0;
+    for(uint8_t r=0; r<=BRUSH_MAX_RADIUS; r++) {
+        Adafruit_Brush brush(&canvas, r, BRUSH_ROUND);
+        canvas.fillScreen(0);
+        ref.fillScreen(0);
+        brush.moveTo(70, 60);
+        ref.fillCircle(70, 60, r, 0xFFFF);
+        if(memcmp(canvas.getBuffer(), ref.getBuffer(),
+          CANVAS_W * CANVAS_H * 2)) bad++;
+    }
+    printf("round dabs, r 0-%d: %u differ from fillCircle()\n",
+      BRUSH_MAX_RADIUS, bad);
+    CHECK(bad == 0);
+}
+
+static void testStrokes(void) {
+    uint32_t bad = 0, under = 0, steps = 0, inexact = 0;
+    uint64_t sent = 0, added = 0;
+    for(int k=0; k<3000; k++) {
+        uint8_t r = randomInt(8), shape = randomInt(3);
+        Adafruit_Brush brush(&canvas, r, shape);
+        int16_t cx = randomInt(40), cy = randomInt(30),
+                cw = 40 + randomInt(CANVAS_W - 40 - cx),
+                ch = 30 + randomInt(CANVAS_H - 30 - cy);
+        bool    clip = k & 1;
+        if(clip) brush.setClip(cx, cy, cw, ch);
+        canvas.fillScreen(0);
+        ref.fillScreen(0);
+
+        // Slow strokes step a pixel or two, fast ones jump (some further
+        // than BRUSH_ROWS), horizontal ones step one way by one pixel
+        uint8_t kind = randomInt(3);
+        int16_t way  = randomInt(2) ? 1 : -1;
+        int16_t x = randomInt(CANVAS_W), y = randomInt(CANVAS_H);
+        brush.moveTo(x, y);
+        dab(ref, x, y, r, shape);
+        for(int s=1 + randomInt(12); s>0; s--) {
+            int16_t nx = x, ny = y;
+            if(kind == 0) {
+                nx += randomInt(5) - 2;
+                ny += randomInt(5) - 2;
+            } else if(kind == 1) {
+                nx  = randomInt(CANVAS_W + 40) - 20;
+                ny  = randomInt(CANVAS_H + 200) - 100;
+            } else {
+                nx += way;
+            }
+            uint32_t before = covered(canvas), was = canvas.sent;
+            brush.lineTo(nx, ny);
+            uint32_t newly = covered(canvas) - before,
+                     n     = canvas.sent - was;
+            sent  += n;
+            added += newly;
+            if(n < newly) under++;
+            if((kind == 2) && (ny == y)) {
+                steps++;
+                if(n != newly) inexact++;
+            }
+            denseLine(ref, x, y, nx, ny, r, shape);
+            x = nx;
+            y = ny;
+        }
+
+        // The brush must match dense stamping inside the clip and leave
+        // everything outside it alone
+        const uint16_t *a = canvas.getBuffer(), *b = ref.getBuffer();
+        for(int16_t py=0; py<CANVAS_H; py++) {
+            for(int16_t px=0; px<CANVAS_W; px++, a++, b++) {
+                bool in = !clip || ((px >= cx) && (px < cx + cw) &&
+                  (py >= cy) && (py < cy + ch));
+                if(*a != (in ? *b : 0)) bad++;
+            }
+        }
+    }
+    printf("3000 strokes, 3 shapes, r 0-7, half clipped: %u pixels differ "
+      "from dense stamping\n", bad);
+    printf("joint trim: %llu pixels sent for %llu newly covered, %u segments "
+      "sent less, %u of %u one-pixel sideways steps not exact\n",
+      (unsigned long long)sent, (unsigned long long)added, under, inexact,
+      steps);
+    CHECK(bad == 0);
+    CHECK(under == 0);
+    CHECK(steps > 1000);
+    CHECK(inexact == 0);
+}
+
+// A fast swipe on the ILI9341: brush against a dab at every line pixel
+static void testBus(void) {
+    static Adafruit_RecordingBus rec;
+    static Adafruit_ILI9341      tft(-1, -1);
+    static int16_t               pts[40 * 2];
+    testBegin(tft, rec);
+    for(int i=0; i<40; i++) {
+        pts[i * 2]     = 20 + i * 7;
+        pts[i * 2 + 1] = 120 + ((i * 37) % 90) - 45;
+    }
+    static const uint8_t radii[] = { 2, 5, 8 };
+    for(uint8_t k=0; k<3; k++) {
+        uint8_t r = radii[k];
+        rec.reset();
+        tft.startWrite();
+        for(int i=1; i<40; i++) {
+            denseLine(tft, pts[i * 2 - 2], pts[i * 2 - 1], pts[i * 2],
+              pts[i * 2 + 1], r, BRUSH_ROUND);
+        }
+        tft.endWrite();
+        Adafruit_BusStats dense = rec.stats();
+        rec.reset();
+        Adafruit_Brush brush(&tft, r);
+        brush.moveTo(pts[0], pts[1]);
+        for(int i=1; i<40; i++) brush.lineTo(pts[i * 2], pts[i * 2 + 1]);
+        Adafruit_BusStats b = rec.stats();
+        printf("swipe r=%u: dense dabs %u bytes / %u transactions, brush %u "
+          "/ %u\n", r, dense.bytes, dense.transactions, b.bytes,
+          b.transactions);
+        CHECK(b.bytes < dense.bytes);
+        CHECK(b.transactions < dense.transactions);
+    }
+}
+
+int main(void) {
+    testDabs();
+    testStrokes();
+    testBus();
+    return testResult("test_brush");
+}
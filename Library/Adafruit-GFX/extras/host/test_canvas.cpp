@@ -0,0 +1,174 @@
+/*!
+ * @file test_canvas.cpp
+ *
+ * GFXcanvas16 in all four rotations: a mix of primitives must leave the
+ * same buffer as a pixel-only reference canvas that maps every pixel
+ * through the rotation switch, every changed pixel must lie inside a
+ * dirty rectangle, and flush() must leave the panel as a full blit does.
+ * A canvas over a caller's array must match one on the heap. Also times drawPixel() per rotation.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+
+#define CANVAS_W 200
+#define CANVAS_H 150
+
+/*!
+  @brief  Reference canvas: only drawPixel(), rotation switched per pixel.
+*/
+class RefCanvas : public Adafruit_GFX {
+ public:
+  RefCanvas(int16_t w, int16_t h) : Adafruit_GFX(w, h) {
+      buffer = (uint16_t *)calloc(w * h, 2);
+  }
+  ~RefCanvas(void) { free(buffer); }
+  void drawPixel(int16_t x, int16_t y, uint16_t color) {
+      if((x < 0) || (y < 0) || (x >= _width) || (y >= _height)) return;
+      int16_t t;
+      switch(rotation) {
+          case 1: t = x; x = WIDTH  - 1 - y; y = t;                 break;
+          case 2: x = WIDTH  - 1 - x; y = HEIGHT - 1 - y;            break;
+          case 3: t = x; x = y;              y = HEIGHT - 1 - t;    break;
+      }
+      buffer[x + y * WIDTH] = color;
+  }
+  uint16_t *buffer; ///< Rotation 0 pixels
+};
+
+static uint32_t seed;
+
+// Small LCG so the cases don't depend on the C library's rand()
+static int16_t randomInt(int16_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (int16_t)((seed >> 16) % n);
+}
+
+// A reproducible mix of primitives, partly off the canvas
+static void draw(Adafruit_GFX &g, uint32_t s) {
+    seed = s;
+    for(int i=0; i<40; i++) {
+        int16_t  x = randomInt(360) - 20, y = randomInt(360) - 20,
+                 w = 1 + randomInt(80),   h = 1 + randomInt(80);
+        uint16_t c = randomInt(0x7FFF) * 2 + 1;
+        switch(randomInt(6)) {
+            case 0: g.fillRect(x, y, w, h, c);                   break;
+            case 1: g.drawLine(x, y, x + w, y + h, c);           break;
+            case 2: g.fillCircle(x, y, w / 4, c);                break;
+            case 3: g.setCursor(x, y);
+                    g.setTextColor(c, ~c);
+                    g.print("Hi 12");                            break;
+            case 4: g.drawFastHLine(x, y, w, c);
+                    g.drawFastVLine(x, y, h, c);                 break;
+            case 5: g.drawPixel(x, y, c);                        break;
+        }
+    }
+}
+
+int main(void) {
+    static uint16_t snap[CANVAS_W * CANVAS_H];
+    uint32_t differ = 0, outside = 0;
+
+    for(uint8_t r=0; r<4; r++) {
+        for(uint32_t s=1; s<=50; s++) {
+            GFXcanvas16 c(CANVAS_W, CANVAS_H);
+            RefCanvas   ref(CANVAS_W, CANVAS_H);
+            c.setRotation(r);
+            ref.setRotation(r);
+            draw(c, s);
+            draw(ref, s);
+            if(memcmp(c.getBuffer(), ref.buffer, sizeof(snap))) differ++;
+
+            memcpy(snap, c.getBuffer(), sizeof(snap));
+            c.clearDirty();
+            draw(c, s + 1000);
+            for(int16_t y=0; y<CANVAS_H; y++) {
+                for(int16_t x=0; x<CANVAS_W; x++) {
+                    if(snap[y * CANVAS_W + x] == c.getBuffer()[y * CANVAS_W + x])
+                        continue;
+                    bool in = false;
+                    for(uint8_t i=0; i<c.dirtyCount(); i++) {
+                        const Adafruit_Rect &d = c.dirtyRect(i);
+                        if((x >= d.x) && (y >= d.y) &&
+                           (x < d.x + d.w) && (y < d.y + d.h)) in = true;
+                    }
+                    if(!in) outside++;
+                }
+            }
+        }
+    }
+    printf("4 rotations x 50 mixes: %u buffers differ from reference, "
+      "%u changed pixels outside dirty rectangles\n", differ, outside);
+    CHECK(differ == 0);
+    CHECK(outside == 0);
+
+    // Sprite and counter animation: flush() vs blitting the whole canvas
+    Adafruit_RecordingBus ra, rb;
+    Adafruit_ILI9341      ta(-1, -1), tb(-1, -1);
+    testBegin(ta, ra);
+    testBegin(tb, rb);
+    GFXcanvas16 c(320, 240);
+    c.fillScreen(ILI9341_BLUE);
+    c.flush(&ta);
+    tb.drawRGBBitmap(0, 0, c.getBuffer(), 320, 240);
+    uint32_t flushBytes = 0, blitBytes = 0;
+    int16_t  sx = 10;
+    for(int f=0; f<60; f++) {
+        char buf[16];
+        c.fillRect(sx, 100, 16, 16, ILI9341_BLUE);
+        sx += 3;
+        c.fillRect(sx, 100, 16, 16, ILI9341_RED);
+        c.setCursor(4, 8);
+        c.setTextColor(ILI9341_BLACK, ILI9341_WHITE);
+        snprintf(buf, sizeof(buf), "frame %3d", f);
+        c.print(buf);
+        ra.reset();
+        c.flush(&ta);
+        flushBytes += ra.stats().bytes;
+        rb.reset();
+        tb.drawRGBBitmap(0, 0, c.getBuffer(), 320, 240);
+        blitBytes += rb.stats().bytes;
+    }
+    printf("60 frames: flush %u bytes, full blit %u bytes\n", flushBytes,
+      blitBytes);
+    CHECK(memcmp(ra.getBuffer(), rb.getBuffer(), 320 * 240 * 2) == 0);
+    CHECK(flushBytes * 10 < blitBytes);
+
+    // A canvas over a static array draws the same as a malloc()ed one and
+    // leaves the array to its owner
+    static uint16_t ext[CANVAS_W * CANVAS_H];
+    {
+        GFXcanvas16 e(CANVAS_W, CANVAS_H, ext);
+        GFXcanvas16 h(CANVAS_W, CANVAS_H);
+        CHECK(e.getBuffer() == ext);
+        CHECK(e.dirtyCount() == 1);
+        e.fillScreen(0);
+        e.setRotation(1);
+        h.setRotation(1);
+        draw(e, 7);
+        draw(h, 7);
+        CHECK(memcmp(ext, h.getBuffer(), sizeof(ext)) == 0);
+    }
+    ext[0] ^= 1; // Still ours after the canvas is gone
+
+    // drawPixel() cost, all rotations
+    GFXcanvas16 p(288, 240);
+    for(uint8_t r=0; r<4; r++) {
+        p.setRotation(r);
+        p.clearDirty();
+        double t0 = testSeconds();
+        for(int k=0; k<20; k++) {
+            for(int16_t y=0; y<p.height(); y++) {
+                for(int16_t x=0; x<p.width(); x++) p.drawPixel(x, y, x ^ y ^ k);
+            }
+        }
+        printf("drawPixel, rotation %d: %.1f ns/pixel\n", r,
+          (testSeconds() - t0) * 1e9 / (20.0 * 288 * 240));
+        CHECK(p.dirtyCount() == 1);
+    }
+
+    return testResult("test_canvas");
+}
@@ -0,0 +1,201 @@
+/*!
+ * @file test_console.cpp
+ *
+ * Adafruit_ScrollConsole on the recording bus, in all four rotations and a
+ * few areas and text sizes. The bus also keeps the VSCRDEF and VSCRSADD
+ * parameters, so after every line and every flush() the test rebuilds what
+ * the panel shows (panel memory read through the scroll area from
+ * VSCRSADD, wrapping inside it) and compares it with the text the console
+ * was given: the newest lines at the bottom of the area once it has
+ * filled, long lines wrapped, nothing outside the area touched. Each line
+ * must cost one RAMWR of a line of pixels, the display's rotation must be
+ * restored, and end() must give the whole panel back unscrolled.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_ScrollConsole.h"
+#include "host_test.h"
+
+#define PANEL_W   ILI9341_TFTWIDTH  // Memory columns in portrait
+#define PANEL_H   ILI9341_TFTHEIGHT // Memory rows: the scroll axis
+#define BACKDROP  0x1234
+#define FG        ILI9341_YELLOW
+#define BG        ILI9341_NAVY
+#define MAX_LINES 40                // Text lines remembered
+#define MAX_COLS  40
+
+/*!
+  @brief  Recording bus that also keeps the scroll registers.
+*/
+class ScrollBus : public Adafruit_RecordingBus {
+ public:
+  ScrollBus(void) : Adafruit_RecordingBus(PANEL_W, PANEL_H), top(0),
+    height(PANEL_H), bottom(0), start(0), _data(true), _cmd(0), _n(0) { }
+  void setDC(bool data) {
+      _data = data;
+      Adafruit_RecordingBus::setDC(data);
+  }
+  void write(const uint8_t *data, uint32_t len, bool block = true) {
+      for(uint32_t i=0; i<len; i++) {
+          if(!_data) {
+              _cmd = data[i];
+              _n   = 0;
+              continue;
+          }
+          if(_n < sizeof(_p)) _p[_n++] = data[i];
+          if((_cmd == ILI9341_VSCRDEF) && (_n == 6)) {
+              top    = (_p[0] << 8) | _p[1];
+              height = (_p[2] << 8) | _p[3];
+              bottom = (_p[4] << 8) | _p[5];
+          } else if((_cmd == ILI9341_VSCRSADD) && (_n == 2)) {
+              start = (_p[0] << 8) | _p[1];
+          }
+      }
+      Adafruit_RecordingBus::write(data, len, block);
+  }
+  uint16_t top, height, bottom, start; ///< VSCRDEF and VSCRSADD
+ private:
+  bool     _data;
+  uint8_t  _cmd, _n, _p[6];
+};
+
+static ScrollBus             rec;
+static Adafruit_ILI9341      tft(-1, -1);
+static GFXcanvas16           expect(PANEL_W, PANEL_H); // Drawing rotation
+static char                  text[MAX_LINES][MAX_COLS + 1]; // Ring of lines
+static uint32_t              done;                     // Lines completed
+static char                  cur[MAX_COLS + 1];        // Line being typed
+static uint16_t              curLen;
+static uint32_t              seed = 1; ///< testRand() state
+
+/*!
+    @brief   Deterministic pseudo-random number.
+    @param   n  Range.
+    @return  0 to n - 1.
+*/
+static uint32_t testRand(uint32_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (seed >> 16) % n;
+}
+
+// Model of the console's input: complete lines and the one being typed
+static void type(Adafruit_ScrollConsole &con, char c) {
+    con.write(c);
+    if(c == '\n') {
+        cur[curLen] = 0;
+        strcpy(text[done++ % MAX_LINES], cur);
+        curLen = 0;
+    } else if(c != '\r') {
+        if(curLen >= con.columns()) {
+            cur[curLen] = 0;
+            strcpy(text[done++ % MAX_LINES], cur);
+            curLen = 0;
+        }
+        cur[curLen++] = c;
+    }
+}
+
+// Panel rows that differ from the console's text: the last lines()
+// lines (and the typed one if it was flushed), oldest at the top. The
+// panel shows memory row m at display row d inside the scroll area, with
+// m running on from VSCRSADD and wrapping; in rotation 2 drawing rows run
+// bottom to top through memory.
+static uint32_t differences(Adafruit_ScrollConsole &con, int16_t y0,
+  uint8_t size, uint8_t rot, bool partial) {
+    uint16_t lineH = 8 * size, area = con.lines() * lineH;
+    uint32_t shown = done + partial, first = 0;
+    if(shown > con.lines()) first = shown - con.lines();
+    expect.fillScreen(BACKDROP);
+    expect.fillRect(0, y0, PANEL_W, area, BG);
+    for(uint32_t l=first; l<shown; l++) {
+        const char *s = (l < done) ? text[l % MAX_LINES] : cur;
+        uint16_t    n = (l < done) ? strlen(s) : curLen;
+        for(uint16_t i=0; i<n; i++) {
+            expect.drawChar(i * 6 * size, y0 + (l - first) * lineH, s[i], FG,
+              BG, size);
+        }
+    }
+
+    const uint16_t *fb  = rec.getBuffer(), *e = expect.getBuffer();
+    uint32_t        bad = 0;
+    for(int16_t y=0; y<PANEL_H; y++) {
+        int16_t d = (rot == 0) ? y : PANEL_H - 1 - y, m = d;
+        if((d >= rec.top) && (d < rec.top + rec.height)) {
+            m = rec.top + (rec.start - rec.top + d - rec.top) % rec.height;
+        }
+        int16_t page = (rot == 0) ? m : PANEL_H - 1 - m;
+        bad += memcmp(&fb[page * PANEL_W], &e[y * PANEL_W], PANEL_W * 2) != 0;
+    }
+    return bad;
+}
+
+static void testConsole(uint8_t rotation, int16_t y0, int16_t h,
+  uint8_t size) {
+    Adafruit_ScrollConsole con(&tft);
+    uint8_t  rot = rotation & 2;
+    uint16_t *fb = rec.getBuffer();
+    for(uint32_t i=0; i<PANEL_W * PANEL_H; i++) fb[i] = BACKDROP;
+    tft.setRotation(rotation);
+    done   = 0;
+    curLen = 0;
+    CHECK(con.begin(y0, h, size, FG, BG));
+    uint16_t lineH = 8 * size, area = con.lines() * lineH;
+    CHECK(rec.height == area);
+    CHECK(rec.top + rec.height + rec.bottom == PANEL_H);
+    CHECK(rec.top == ((rot == 0) ? y0 : PANEL_H - y0 - area));
+
+    uint32_t bad = 0, costly = 0, outside = 0, rotated = 0, starts = 0;
+    uint16_t last = rec.start;
+    for(int k=0; k<120; k++) {
+        // Lines of any length, some longer than the console is wide
+        uint16_t n = testRand(con.columns() * 2 + 2);
+        for(uint16_t i=0; i<n; i++) {
+            type(con, testRand(6) ? ' ' + testRand(95) : '\r');
+        }
+        if(!testRand(4)) {
+            con.flush();
+            bad += differences(con, y0, size, rot, curLen > 0);
+        }
+        rec.reset();
+        type(con, '\n');
+        costly += (rec.stats().pixels != PANEL_W * lineH) ||
+          (rec.stats().commands[ILI9341_RAMWR] != 1);
+        rotated += tft.getRotation() != rotation;
+        outside += (rec.start < rec.top) ||
+          (rec.start >= rec.top + rec.height);
+        starts  += rec.start != last;
+        last     = rec.start;
+        bad     += differences(con, y0, size, rot, false);
+    }
+    printf("rotation %u, rows %d-%d, size %u: %u lines of %u, VSCRSADD %u-%u "
+      "moved %u times, %u rows wrong, %u lines not one RAMWR, %u outside "
+      "the area\n", rotation, y0, y0 + area - 1, size, con.lines(),
+      con.columns(), rec.top, rec.top + area - 1, starts, bad, costly,
+      outside);
+    CHECK(bad == 0);
+    CHECK(costly == 0);
+    CHECK(rotated == 0);
+    CHECK(outside == 0);
+    CHECK(starts + con.lines() >= 120);
+
+    con.end();
+    CHECK((rec.top == 0) && (rec.height == PANEL_H) && (rec.bottom == 0));
+    CHECK(rec.start == 0);
+}
+
+int main(void) {
+    testBegin(tft, rec);
+    for(uint8_t rotation=0; rotation<4; rotation++) {
+        testConsole(rotation, 0, 0, 1);
+        testConsole(rotation, 37, 150, 2);
+        testConsole(rotation, 100, 200, 3);
+    }
+
+    // Too small for two lines
+    Adafruit_ScrollConsole con(&tft);
+    CHECK(!con.begin(310, 0, 1));
+    CHECK(con.lines() == 0);
+    return testResult("test_console");
+}
@@ -0,0 +1,152 @@
+/*!
+ * @file test_deferred.cpp
+ *
+ * Deferred (strip-buffer) rendering against immediate mode: the same
+ * screens drawn both ways must leave the same framebuffer, and a screen
+ * wrapped in one startWrite()/endWrite() must cost fewer bus bytes and
+ * transactions deferred. Covers a menu-like screen, a list long enough to
+ * flush early, address windows opened mid-list (opaque text runs) and the
+ * cached window after a flush. Built twice: heap buffers with the default
+ * sizes, and DEFER_STATIC with the firmware's.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "host_test.h"
+
+#define PROGMEM // Fonts are plain const data here, as in the firmware
+#include "Fonts/FreeSans9pt7b.h"
+
+#define SCREEN_PIXELS (320 * 240)
+
+static Adafruit_RecordingBus rec;
+static Adafruit_ILI9341      tft(-1, -1);
+static uint16_t              direct[SCREEN_PIXELS], deferred[SCREEN_PIXELS];
+static uint16_t              icon[24 * 24];
+
+// A menu: backdrop, framed buttons with icons and labels, a title bar
+// in opaque text and some round decoration
+static void menuScreen(void) {
+    tft.fillScreen(0x2104);
+    tft.fillRect(0, 0, 320, 24, ILI9341_NAVY);
+    tft.setFont(NULL);
+    tft.setTextSize(2);
+    tft.setTextColor(ILI9341_WHITE, ILI9341_NAVY);
+    tft.setCursor(4, 4);
+    tft.print("Painter");
+    for(int i=0; i<4; i++) {
+        int16_t x = 10 + (i & 1) * 155, y = 40 + (i >> 1) * 95;
+        tft.fillRoundRect(x, y, 145, 85, 8, ILI9341_DARKGREY);
+        tft.drawRoundRect(x, y, 145, 85, 8, ILI9341_WHITE);
+        tft.drawRGBBitmap(x + 8, y + 8, icon, 24, 24);
+        tft.setFont(&FreeSans9pt7b);
+        tft.setTextSize(1);
+        tft.setTextColor(ILI9341_YELLOW);
+        tft.setCursor(x + 40, y + 26);
+        tft.print("Button");
+        tft.print(i);
+    }
+    tft.setFont(NULL);
+    tft.fillCircle(300, 220, 12, ILI9341_RED);
+    tft.drawLine(0, 239, 319, 30, ILI9341_GREEN);
+    for(int i=0; i<50; i++) tft.drawPixel(5 + i * 6, 232, ILI9341_CYAN);
+}
+
+// Enough separate pixels to fill the display list several times over
+static void speckleScreen(void) {
+    uint32_t seed = 7;
+    tft.fillRect(40, 30, 240, 180, ILI9341_BLACK);
+    for(int i=0; i<3000; i++) {
+        seed = seed * 1103515245UL + 12345UL;
+        tft.drawPixel(40 + (seed >> 8) % 240, 30 + (seed >> 20) % 180,
+          seed >> 16);
+    }
+}
+
+// Opaque text, a full-screen fill, then the same text again: the text's
+// address window is opened while the fill is still in the list
+static void textOverFill(void) {
+    tft.setFont(NULL);
+    tft.setTextSize(1);
+    tft.setTextColor(ILI9341_WHITE, ILI9341_BLUE);
+    tft.setCursor(10, 10);
+    tft.print("HELLO");
+    tft.fillScreen(ILI9341_BLACK);
+    tft.setCursor(10, 10);
+    tft.print("HELLO");
+}
+
+// Draw a screen immediately, then deferred inside one transaction from
+// the same starting framebuffer, and compare pixels and bus cost
+static void compare(const char *name, void (*screen)(void), bool cheaper) {
+    tft.fillScreen(0x1234);
+    rec.reset();
+    tft.startWrite();
+    screen();
+    tft.endWrite();
+    Adafruit_BusStats a = rec.stats();
+    memcpy(direct, rec.getBuffer(), sizeof(direct));
+
+    tft.fillScreen(0x1234);
+    CHECK(tft.setDeferred(true));
+    rec.reset();
+    tft.startWrite();
+    screen();
+    tft.endWrite();
+    Adafruit_BusStats b = rec.stats();
+    CHECK(tft.setDeferred(false));
+    memcpy(deferred, rec.getBuffer(), sizeof(deferred));
+
+    uint32_t bad = 0, first = SCREEN_PIXELS;
+    for(uint32_t i=0; i<SCREEN_PIXELS; i++) {
+        if(direct[i] != deferred[i]) {
+            if(!bad) first = i;
+            bad++;
+        }
+    }
+    printf("%-14s direct %7u bytes %5u transactions, deferred %7u bytes "
+      "%5u transactions, %u pixels differ", name, a.bytes, a.transactions,
+      b.bytes, b.transactions, bad);
+    if(bad) printf(" (first at row %u)", first / 320);
+    printf("\n");
+    CHECK(bad == 0);
+    if(cheaper) {
+        CHECK(b.bytes < a.bytes);
+        CHECK(b.transactions < a.transactions);
+    }
+}
+
+int main(void) {
+    testBegin(tft, rec);
+    for(int i=0; i<24 * 24; i++) icon[i] = (i * 37) ^ (i << 7);
+    printf("strip %d pixels, list %d entries%s\n", DEFER_STRIP_PIXELS,
+      DEFER_LIST_LEN,
+#if defined(DEFER_STATIC)
+      ", static"
+#else
+      ", heap"
+#endif
+    );
+
+    compare("menu",         menuScreen,    true);
+    compare("speckle",      speckleScreen, false);
+    compare("text on fill", textOverFill,  false);
+
+    // A window the driver cached before a flush must be sent again after
+    // it: the strips moved the controller's window
+    tft.fillScreen(0x1234);
+    CHECK(tft.setDeferred(true));
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 8, 8);
+    tft.writeColor(ILI9341_RED, 64);
+    tft.fillRect(100, 100, 50, 50, ILI9341_GREEN);
+    tft.setAddrWindow(0, 0, 8, 8);
+    tft.writeColor(ILI9341_BLUE, 64);
+    tft.endWrite();
+    CHECK(tft.setDeferred(false));
+    CHECK(rec.getPixel(0, 0) == ILI9341_BLUE);
+    CHECK(rec.getPixel(7, 7) == ILI9341_BLUE);
+
+    return testResult("test_deferred");
+}
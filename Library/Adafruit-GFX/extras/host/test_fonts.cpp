@@ -0,0 +1,285 @@
+/*!
+ * @file test_fonts.cpp
+ *
+ * Run-length (GFXFONT_RLE) glyphs against bitmap glyphs for every bundled
+ * FreeFont. Each font is re-encoded in memory with the fontconvert -r
+ * encoder, which prints the per-font flash size table (glyph data bytes as
+ * bitmaps and as runs); the 18pt and 24pt fonts, the sizes worth
+ * converting, must shrink. For those, random glyphs (sizes 1-3, clipped,
+ * partly off screen) must render pixel-identical from both forms on a
+ * canvas, and a text line must produce the same framebuffer and the same
+ * bus bytes on the ILI9341, transparent and opaque.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "host_test.h"
+
+#define PROGMEM // Fonts are plain const data here, as in the firmware
+#include "Fonts/FreeMono9pt7b.h"
+#include "Fonts/FreeMonoBold9pt7b.h"
+#include "Fonts/FreeMonoBoldOblique9pt7b.h"
+#include "Fonts/FreeMonoOblique9pt7b.h"
+#include "Fonts/FreeSans9pt7b.h"
+#include "Fonts/FreeSansBold9pt7b.h"
+#include "Fonts/FreeSansBoldOblique9pt7b.h"
+#include "Fonts/FreeSansOblique9pt7b.h"
+#include "Fonts/FreeSerif9pt7b.h"
+#include "Fonts/FreeSerifBold9pt7b.h"
+#include "Fonts/FreeSerifBoldItalic9pt7b.h"
+#include "Fonts/FreeSerifItalic9pt7b.h"
+#include "Fonts/FreeMono12pt7b.h"
+#include "Fonts/FreeMonoBold12pt7b.h"
+#include "Fonts/FreeMonoBoldOblique12pt7b.h"
+#include "Fonts/FreeMonoOblique12pt7b.h"
+#include "Fonts/FreeSans12pt7b.h"
+#include "Fonts/FreeSansBold12pt7b.h"
+#include "Fonts/FreeSansBoldOblique12pt7b.h"
+#include "Fonts/FreeSansOblique12pt7b.h"
+#include "Fonts/FreeSerif12pt7b.h"
+#include "Fonts/FreeSerifBold12pt7b.h"
+#include "Fonts/FreeSerifBoldItalic12pt7b.h"
+#include "Fonts/FreeSerifItalic12pt7b.h"
+#include "Fonts/FreeMono18pt7b.h"
+#include "Fonts/FreeMonoBold18pt7b.h"
+#include "Fonts/FreeMonoBoldOblique18pt7b.h"
+#include "Fonts/FreeMonoOblique18pt7b.h"
+#include "Fonts/FreeSans18pt7b.h"
+#include "Fonts/FreeSansBold18pt7b.h"
+#include "Fonts/FreeSansBoldOblique18pt7b.h"
+#include "Fonts/FreeSansOblique18pt7b.h"
+#include "Fonts/FreeSerif18pt7b.h"
+#include "Fonts/FreeSerifBold18pt7b.h"
+#include "Fonts/FreeSerifBoldItalic18pt7b.h"
+#include "Fonts/FreeSerifItalic18pt7b.h"
+#include "Fonts/FreeMono24pt7b.h"
+#include "Fonts/FreeMonoBold24pt7b.h"
+#include "Fonts/FreeMonoBoldOblique24pt7b.h"
+#include "Fonts/FreeMonoOblique24pt7b.h"
+#include "Fonts/FreeSans24pt7b.h"
+#include "Fonts/FreeSansBold24pt7b.h"
+#include "Fonts/FreeSansBoldOblique24pt7b.h"
+#include "Fonts/FreeSansOblique24pt7b.h"
+#include "Fonts/FreeSerif24pt7b.h"
+#include "Fonts/FreeSerifBold24pt7b.h"
+#include "Fonts/FreeSerifBoldItalic24pt7b.h"
+#include "Fonts/FreeSerifItalic24pt7b.h"
+
+#define GLYPH_CASES 2000 // Random glyphs per converted font
+
+#define FONT(f) { #f, &f }
+static const struct { const char *name; const GFXfont *font; } fonts[] = {
+  FONT(FreeMono9pt7b),
+  FONT(FreeMonoBold9pt7b),
+  FONT(FreeMonoBoldOblique9pt7b),
+  FONT(FreeMonoOblique9pt7b),
+  FONT(FreeSans9pt7b),
+  FONT(FreeSansBold9pt7b),
+  FONT(FreeSansBoldOblique9pt7b),
+  FONT(FreeSansOblique9pt7b),
+  FONT(FreeSerif9pt7b),
+  FONT(FreeSerifBold9pt7b),
+  FONT(FreeSerifBoldItalic9pt7b),
+  FONT(FreeSerifItalic9pt7b),
+  FONT(FreeMono12pt7b),
+  FONT(FreeMonoBold12pt7b),
+  FONT(FreeMonoBoldOblique12pt7b),
+  FONT(FreeMonoOblique12pt7b),
+  FONT(FreeSans12pt7b),
+  FONT(FreeSansBold12pt7b),
+  FONT(FreeSansBoldOblique12pt7b),
+  FONT(FreeSansOblique12pt7b),
+  FONT(FreeSerif12pt7b),
+  FONT(FreeSerifBold12pt7b),
+  FONT(FreeSerifBoldItalic12pt7b),
+  FONT(FreeSerifItalic12pt7b),
+  FONT(FreeMono18pt7b),
+  FONT(FreeMonoBold18pt7b),
+  FONT(FreeMonoBoldOblique18pt7b),
+  FONT(FreeMonoOblique18pt7b),
+  FONT(FreeSans18pt7b),
+  FONT(FreeSansBold18pt7b),
+  FONT(FreeSansBoldOblique18pt7b),
+  FONT(FreeSansOblique18pt7b),
+  FONT(FreeSerif18pt7b),
+  FONT(FreeSerifBold18pt7b),
+  FONT(FreeSerifBoldItalic18pt7b),
+  FONT(FreeSerifItalic18pt7b),
+  FONT(FreeMono24pt7b),
+  FONT(FreeMonoBold24pt7b),
+  FONT(FreeMonoBoldOblique24pt7b),
+  FONT(FreeMonoOblique24pt7b),
+  FONT(FreeSans24pt7b),
+  FONT(FreeSansBold24pt7b),
+  FONT(FreeSansBoldOblique24pt7b),
+  FONT(FreeSansOblique24pt7b),
+  FONT(FreeSerif24pt7b),
+  FONT(FreeSerifBold24pt7b),
+  FONT(FreeSerifBoldItalic24pt7b),
+  FONT(FreeSerifItalic24pt7b)
+};
+#define NUM_FONTS (sizeof(fonts) / sizeof(fonts[0]))
+
+// RUN-LENGTH ENCODER, as enrun()/endrun() in fontconvert.c ---------------
+
+static uint8_t *rleOut;
+static uint32_t rleLen;
+static uint8_t  runOff, runOn;
+
+static void enrun(uint8_t value) {
+    if(value) {
+        if(runOn == 15) { // Set run full, start a new byte
+            rleOut[rleLen++] = (runOff << 4) | runOn;
+            runOff = runOn = 0;
+        }
+        runOn++;
+    } else {
+        if(runOn || (runOff == 15)) { // Clear run after a set run, or full
+            rleOut[rleLen++] = (runOff << 4) | runOn;
+            runOff = runOn = 0;
+        }
+        runOff++;
+    }
+}
+
+static void endrun(void) {
+    if(runOff || runOn) rleOut[rleLen++] = (runOff << 4) | runOn;
+    runOff = runOn = 0;
+}
+
+/*!
+    @brief   Re-encode a bitmap GFXfont with run-length glyphs.
+    @param   src      Bitmap font.
+    @param   dst      Font structure to fill in (glyphs and runs are
+                      malloc()ed and never freed).
+    @param   rawSize  Returns the bitmap glyph data size in bytes.
+    @return  Run-length glyph data size in bytes.
+*/
+static uint32_t rleFont(const GFXfont *src, GFXfont *dst, uint32_t *rawSize) {
+    uint16_t  n      = src->last - src->first + 1;
+    GFXglyph *glyphs = (GFXglyph *)malloc(n * sizeof(GFXglyph));
+    uint32_t  raw    = 0;
+    for(uint16_t g=0; g<n; g++) {
+        raw += (src->glyph[g].width * src->glyph[g].height + 7) / 8;
+    }
+    rleOut = (uint8_t *)malloc(raw * 2 + n); // Worst case: a byte per pixel
+    rleLen = 0;                               // pair, plus one per glyph
+    for(uint16_t g=0; g<n; g++) {
+        const GFXglyph *s    = &src->glyph[g];
+        const uint8_t  *bits = src->bitmap + s->bitmapOffset;
+        glyphs[g] = *s;
+        glyphs[g].bitmapOffset = rleLen;
+        for(uint16_t i=0; i<s->width * s->height; i++) {
+            enrun(bits[i >> 3] & (0x80 >> (i & 7)));
+        }
+        endrun();
+    }
+    *dst        = *src;
+    dst->bitmap = rleOut;
+    dst->glyph  = glyphs;
+    dst->flags  = GFXFONT_RLE;
+    *rawSize    = raw;
+    return rleLen;
+}
+
+static uint32_t seed = 2;
+
+// Small LCG so the cases don't depend on the C library's rand()
+static int16_t randomInt(int16_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (int16_t)((seed >> 16) % n);
+}
+
+// Draw the same random glyphs from both forms, count differing images
+static uint32_t glyphParity(const GFXfont *bits, const GFXfont *runs) {
+    static GFXcanvas16 a(320, 240), b(320, 240);
+    uint32_t bad = 0;
+    a.setFont(bits);
+    b.setFont(runs);
+    for(int i=0; i<GLYPH_CASES; i++) {
+        uint8_t sx = 1 + randomInt(3), sy = 1 + randomInt(3);
+        if(i % 3) sx = sy = 1;
+        int16_t x = randomInt(400) - 40, y = randomInt(320) - 40;
+        unsigned char ch = 32 + randomInt(95);
+        a.fillScreen(0);
+        b.fillScreen(0);
+        if(randomInt(2)) {
+            int16_t cx = randomInt(320) - 20, cy = randomInt(240) - 20,
+                    cw = randomInt(200) - 10, chh = randomInt(200) - 10;
+            a.setTextClip(cx, cy, cw, chh);
+            b.setTextClip(cx, cy, cw, chh);
+        } else {
+            a.clearTextClip();
+            b.clearTextClip();
+        }
+        a.drawChar(x, y, ch, 0xF81F, 0, sx, sy);
+        b.drawChar(x, y, ch, 0xF81F, 0, sx, sy);
+        if(memcmp(a.getBuffer(), b.getBuffer(), 320 * 240 * 2)) bad++;
+    }
+    return bad;
+}
+
+// Print a line from both forms on the display, transparent and opaque
+static uint32_t textParity(const GFXfont *bits, const GFXfont *runs) {
+    static Adafruit_RecordingBus r1, r2;
+    static Adafruit_ILI9341      t1(-1, -1), t2(-1, -1);
+    static bool                  begun = false;
+    uint32_t bad = 0;
+    if(!begun) {
+        testBegin(t1, r1);
+        testBegin(t2, r2);
+        begun = true;
+    }
+    t1.setFont(bits);
+    t2.setFont(runs);
+    for(uint8_t size=1; size<=2; size++) {
+        for(int opaque=0; opaque<2; opaque++) {
+            t1.fillScreen(0);
+            t2.fillScreen(0);
+            t1.setTextSize(size);
+            t2.setTextSize(size);
+            if(opaque) {
+                t1.setTextColor(0xFFFF, 0x001F);
+                t2.setTextColor(0xFFFF, 0x001F);
+            } else {
+                t1.setTextColor(0xFFFF);
+                t2.setTextColor(0xFFFF);
+            }
+            t1.setCursor(3, 100);
+            t2.setCursor(3, 100);
+            r1.reset();
+            r2.reset();
+            t1.print("The quick brown fox");
+            t2.print("The quick brown fox");
+            if(memcmp(r1.getBuffer(), r2.getBuffer(), 320 * 240 * 2) ||
+               (r1.stats().bytes != r2.stats().bytes)) bad++;
+        }
+    }
+    return bad;
+}
+
+int main(void) {
+    printf("%-28s %8s %8s %7s\n", "glyph data, bytes", "bitmap", "runs",
+      "change");
+    for(unsigned f=0; f<NUM_FONTS; f++) {
+        GFXfont  rle;
+        uint32_t raw, runs = rleFont(fonts[f].font, &rle, &raw);
+        printf("%-28s %8u %8u %+6.0f%%\n", fonts[f].name, raw, runs,
+          100.0 * runs / raw - 100.0);
+
+        // -r only pays off from 18pt up; 9pt and 12pt stay as bitmaps
+        if(!strstr(fonts[f].name, "18pt") && !strstr(fonts[f].name, "24pt"))
+            continue;
+        CHECK(runs < raw);
+        uint32_t glyphs = glyphParity(fonts[f].font, &rle),
+                 lines  = textParity(fonts[f].font, &rle);
+        if(glyphs || lines) {
+            printf("  %u glyph and %u text mismatches\n", glyphs, lines);
+        }
+        CHECK(glyphs == 0);
+        CHECK(lines == 0);
+    }
+    return testResult("test_fonts");
+}
@@ -0,0 +1,140 @@
+/*!
+ * @file test_glyphs.cpp
+ *
+ * Golden-image test of the span-based GFXfont rasterizer: random glyphs,
+ * positions (partly off screen), text sizes and clip rectangles are drawn
+ * with drawChar() into one canvas and with the original bit-at-a-time
+ * loop (kept below as the reference) into another; the two must be
+ * pixel-identical. Also reports what a line of text costs on the bus and
+ * checks that glyphs entirely off screen cost nothing.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "host_test.h"
+
+#define PROGMEM // Fonts are plain const data here, as in the firmware
+#include "Fonts/FreeSans9pt7b.h"
+#include "Fonts/FreeSerifBoldItalic18pt7b.h"
+#include "Fonts/FreeMono24pt7b.h"
+
+#define CASES 20000
+
+static const GFXfont *fonts[] = {
+  &FreeSans9pt7b, &FreeSerifBoldItalic18pt7b, &FreeMono24pt7b
+};
+
+static uint32_t seed = 1;
+
+// Small LCG so the cases don't depend on the C library's rand()
+static int16_t randomInt(int16_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (int16_t)((seed >> 16) % n);
+}
+
+// The custom-font loop of drawChar() before the span rasterizer: one
+// pixel (size 1) or size_x*size_y block per set bit, clipped per pixel.
+static void referenceChar(GFXcanvas16 &c, const GFXfont *f, int16_t x,
+  int16_t y, unsigned char ch, uint16_t color, uint8_t size_x,
+  uint8_t size_y, int16_t cx0, int16_t cy0, int16_t cx1, int16_t cy1) {
+    const GFXglyph *glyph  = &f->glyph[ch - f->first];
+    const uint8_t  *bitmap = f->bitmap;
+    uint16_t bo = glyph->bitmapOffset;
+    uint8_t  w  = glyph->width, h = glyph->height;
+    int8_t   xo = glyph->xOffset, yo = glyph->yOffset;
+    uint8_t  xx, yy, bits = 0, bit = 0;
+    int16_t  xo16 = 0, yo16 = 0;
+
+    if(size_x > 1 || size_y > 1) {
+        xo16 = xo;
+        yo16 = yo;
+    }
+    for(yy=0; yy<h; yy++) {
+        for(xx=0; xx<w; xx++) {
+            if(!(bit++ & 7)) bits = bitmap[bo++];
+            if(bits & 0x80) {
+                int16_t px, py, pw = size_x, ph = size_y;
+                if(size_x == 1 && size_y == 1) {
+                    px = x + xo + xx;
+                    py = y + yo + yy;
+                } else {
+                    px = x + (xo16 + xx) * size_x;
+                    py = y + (yo16 + yy) * size_y;
+                }
+                for(int16_t j=py; j<py+ph; j++) {
+                    for(int16_t i=px; i<px+pw; i++) {
+                        if((i >= cx0) && (i < cx1) && (j >= cy0) && (j < cy1))
+                            c.drawPixel(i, j, color);
+                    }
+                }
+            }
+            bits <<= 1;
+        }
+    }
+}
+
+int main(void) {
+    static GFXcanvas16 ref(320, 240), out(320, 240);
+    CHECK(ref.getBuffer() && out.getBuffer());
+    uint32_t bad = 0;
+
+    for(int i=0; i<CASES; i++) {
+        const GFXfont *f = fonts[i % 3];
+        uint8_t  sx = 1 + randomInt(3), sy = 1 + randomInt(3);
+        if(i & 1) sx = sy = 1;
+        int16_t  x  = randomInt(400) - 40, y = randomInt(320) - 40;
+        unsigned char ch = 33 + randomInt(94);
+        bool     clip = randomInt(2);
+        int16_t  cx = randomInt(320) - 20, cy = randomInt(240) - 20,
+                 cw = randomInt(200) - 10, chh = randomInt(200) - 10;
+
+        ref.fillScreen(0);
+        out.fillScreen(0);
+        if(clip) out.setTextClip(cx, cy, cw, chh);
+        else     out.clearTextClip();
+        out.setFont(f);
+        out.drawChar(x, y, ch, 0xF81F, 0, sx, sy);
+
+        int16_t x0 = 0, y0 = 0, x1 = 320, y1 = 240;
+        if(clip) {
+            if(cx > x0)       x0 = cx;
+            if(cy > y0)       y0 = cy;
+            if(cx + cw < x1)  x1 = cx + cw;
+            if(cy + chh < y1) y1 = cy + chh;
+        }
+        referenceChar(ref, f, x, y, ch, 0xF81F, sx, sy, x0, y0, x1, y1);
+        if(memcmp(ref.getBuffer(), out.getBuffer(), 320 * 240 * 2)) {
+            if(bad++ < 5) {
+                printf("mismatch: case %d '%c' at %d,%d size %dx%d\n",
+                  i, ch, x, y, sx, sy);
+            }
+        }
+    }
+    printf("golden: %d cases, %u mismatches\n", CASES, bad);
+    CHECK(bad == 0);
+
+    Adafruit_RecordingBus rec;
+    Adafruit_ILI9341      tft(-1, -1);
+    testBegin(tft, rec);
+    const char *s = "The quick brown fox jumps";
+    for(int f=0; f<3; f++) {
+        tft.setFont(fonts[f]);
+        for(uint8_t size=1; size<=2; size++) {
+            tft.setTextSize(size);
+            tft.setCursor(0, 60);
+            rec.reset();
+            tft.print(s);
+            printf("font %d size %d: %u bytes, %u transactions\n", f, size,
+              rec.stats().bytes, rec.stats().transactions);
+        }
+    }
+    tft.setFont(&FreeSans9pt7b);
+    tft.setTextSize(1);
+    tft.setCursor(0, -30); // Whole line above the screen
+    rec.reset();
+    tft.print(s);
+    CHECK(rec.stats().bytes == 0);
+
+    return testResult("test_glyphs");
+}
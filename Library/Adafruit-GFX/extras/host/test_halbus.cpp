@@ -0,0 +1,127 @@
+/*!
+ * @file test_halbus.cpp
+ *
+ * Wire-level tests of the STM32 HAL bus backends against the fake HAL in
+ * hal/, for the polled and the DMA bus:
+ *  - solid fills stream the byte-swapped color from the line buffer, in
+ *    one HAL transfer per FILL_BUF_PIXELS rather than one per pixel;
+ *  - native pixel bursts and pre-swapped (bigEndian) bursts put exactly
+ *    the big-endian byte stream of the 8-bit path on the wire.
+ * Built twice by the Makefile, with 16-bit pixel frames (the default)
+ * and with -DUSE_SPI_8BIT_PIXELS; both builds print the same "wire"
+ * checksum over everything sent, which `make check` compares.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include "host_test.h"
+#include "Adafruit_HALBus.h"
+
+#define WIRE_SIZE 160000 // One full frame plus commands
+
+static uint16_t wire[WIRE_SIZE];
+static uint16_t pixels[320 * 240];
+static uint16_t swapped[320 * 240];
+static uint32_t wireHash = 2166136261UL; // FNV-1a over all captured bytes
+
+// Fold everything captured since the last fakeHALReset() into wireHash
+static void hashWire(void) {
+    for(uint32_t i=0; i<fakeSPI.bytes; i++) {
+        wireHash = (wireHash ^ wire[i]) * 16777619UL;
+    }
+}
+
+// Number of data bytes that follow the last RAMWR (0x2C) command
+static uint32_t ramwrData(uint32_t *start) {
+    uint32_t i = fakeSPI.bytes;
+    while(i && (wire[i - 1] != ILI9341_RAMWR)) i--;
+    *start = i;
+    return fakeSPI.bytes - i;
+}
+
+// Check the RAMWR data phase is 'n' big-endian pixels, all data (DC high)
+static void checkPixels(const uint16_t *expect, uint32_t n, bool solid) {
+    uint32_t start, len = ramwrData(&start);
+    CHECK(len == n * 2);
+    uint32_t bad = 0;
+    for(uint32_t i=0; (i<n) && (start + 2 * i + 1 < fakeSPI.bytes); i++) {
+        uint16_t c = solid ? expect[0] : expect[i];
+        if((wire[start + 2 * i]     != (0x100 | (c >> 8))) ||
+           (wire[start + 2 * i + 1] != (0x100 | (c & 0xFF)))) bad++;
+    }
+    CHECK(bad == 0);
+}
+
+static void run(const char *name, Adafruit_HALBus &bus) {
+    Adafruit_ILI9341 tft(-1, -1);
+    fakeHALReset();
+    testBegin(tft, bus);
+    hashWire();
+
+    // Full-screen fill: 76,800 pixels from the line buffer
+    uint16_t color = 0xF81F;
+    fakeHALReset();
+    tft.fillScreen(color);
+    checkPixels(&color, 320 * 240, true);
+    printf("%s fillScreen: %u bytes, %u HAL transfers\n", name,
+      fakeSPI.bytes, fakeSPI.transfers);
+    CHECK(fakeSPI.transfers <= 320 * 240 / FILL_BUF_PIXELS + 16);
+    hashWire();
+
+    // A small fill: one chunk, whatever the color was before
+    color = 0x1234;
+    fakeHALReset();
+    tft.fillRect(10, 20, 100, 3, color);
+    checkPixels(&color, 300, true);
+    printf("%s fillRect 100x3: %u bytes, %u HAL transfers\n", name,
+      fakeSPI.bytes, fakeSPI.transfers);
+    CHECK(fakeSPI.transfers <= 16);
+    hashWire();
+
+    // Native-endian pixel burst
+    fakeHALReset();
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(pixels, 320 * 240);
+    tft.endWrite();
+    checkPixels(pixels, 320 * 240, false);
+    printf("%s writePixels: %u bytes, %u HAL transfers (%u DMA, %u in "
+      "16-bit frames)\n", name, fakeSPI.bytes, fakeSPI.transfers,
+      fakeSPI.dmaTransfers, fakeSPI.frames16);
+    hashWire();
+
+    // The same image already in display byte order
+    fakeHALReset();
+    tft.startWrite();
+    tft.setAddrWindow(0, 0, 320, 240);
+    tft.writePixels(swapped, 320 * 240, true, true);
+    tft.endWrite();
+    checkPixels(pixels, 320 * 240, false);
+    hashWire();
+}
+
+int main(void) {
+    for(int i=0; i<320 * 240; i++) {
+        pixels[i]  = (uint16_t)(i * 2654435761UL >> 16);
+        swapped[i] = __builtin_bswap16(pixels[i]);
+    }
+
+    static GPIO_TypeDef        port;
+    static SPI_TypeDef         spiRegs;
+    static DMA_Channel_TypeDef dmaRegs;
+    static DMA_HandleTypeDef   dmaTx = { &dmaRegs, { 0, 0 } };
+    static SPI_HandleTypeDef   spi   = { &spiRegs, { SPI_DATASIZE_8BIT },
+                                         &dmaTx, NULL };
+    fakeSPI.wire     = wire;
+    fakeSPI.capacity = WIRE_SIZE;
+    fakeDCPort       = &port;
+    fakeDCPin        = 0x0010;
+
+    Adafruit_HALBus    polled(&spi, &port, 0x0020, &port, 0x0010);
+    Adafruit_HALDMABus dma(&spi, &port, 0x0020, &port, 0x0010);
+    run("polled", polled);
+    run("dma", dma);
+
+    printf("wire %08x\n", wireHash);
+    return testResult("test_halbus");
+}
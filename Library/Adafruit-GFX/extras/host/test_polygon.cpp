@@ -0,0 +1,225 @@
+/*!
+ * @file test_polygon.cpp
+ *
+ * The scanline polygon filler against brute force on a GFXcanvas16:
+ * random polygons, partly off the canvas, filled by both rules must cover
+ * exactly the pixels whose centre is inside (a centre on an edge counts as
+ * right of it, as in the filler). Thick lines must cover every pixel well
+ * inside their ideal rectangle (the centre line, w wide, half a pixel
+ * longer at each end) and nothing well outside it; polylines every pixel
+ * of their centre line and nothing outside the segments' rectangles and
+ * the joints' bevels (within w / 2 of the joint). Also reports bus
+ * transactions for a few shapes on the recording bus.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "host_test.h"
+
+#define CANVAS_W 160
+#define CANVAS_H 120
+#define MARGIN   0.1 ///< Pixels either side of an ideal boundary not checked
+
+static GFXcanvas16 canvas(CANVAS_W, CANVAS_H);
+static uint32_t    seed = 1; ///< randomInt() state
+
+// Small LCG so the cases don't depend on the C library's rand()
+static int16_t randomInt(int16_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (int16_t)((seed >> 16) % n);
+}
+
+// Is pixel (px, py)'s centre inside the polygon? Exact, in half pixels:
+// an edge counts on the scanlines whose centre is in [top, bottom) and
+// crosses a centre at or left of it.
+static bool inside(const int16_t *xy, uint16_t n, int16_t px, int16_t py,
+  uint8_t rule) {
+    int64_t cx = 2 * px + 1, cy = 2 * py + 1;
+    int     wind = 0, count = 0;
+    for(uint16_t i=0; i<n; i++) {
+        uint16_t j  = (i + 1 < n) ? i + 1 : 0;
+        int64_t  xa = 2 * xy[i * 2], ya = 2 * xy[i * 2 + 1],
+                 xb = 2 * xy[j * 2], yb = 2 * xy[j * 2 + 1];
+        int      dir = 1;
+        if(ya > yb) {
+            int64_t t = xa; xa = xb; xb = t;
+            t = ya; ya = yb; yb = t;
+            dir = -1;
+        }
+        if((cy < ya) || (cy >= yb)) continue;
+        // Crossing x = xa + (cy - ya) * (xb - xa) / (yb - ya) <= cx
+        if(xa * (yb - ya) + (cy - ya) * (xb - xa) <= cx * (yb - ya)) {
+            wind += dir;
+            count++;
+        }
+    }
+    return (rule == GFX_FILL_NONZERO) ? (wind != 0) : (count & 1);
+}
+
+static void testPolygons(void) {
+    static int16_t xy[22];
+    uint32_t bad = 0, filled = 0;
+    for(int k=0; k<3000; k++) {
+        uint16_t n    = 3 + randomInt(9);
+        uint8_t  rule = k & 1;
+        for(uint16_t i=0; i<n; i++) {
+            xy[i * 2]     = randomInt(CANVAS_W + 40) - 20;
+            xy[i * 2 + 1] = randomInt(CANVAS_H + 40) - 20;
+        }
+        canvas.fillScreen(0);
+        canvas.fillPolygon(xy, n, 0xFFFF, rule);
+        const uint16_t *p = canvas.getBuffer();
+        for(int16_t y=0; y<CANVAS_H; y++) {
+            for(int16_t x=0; x<CANVAS_W; x++, p++) {
+                bool in = inside(xy, n, x, y, rule);
+                filled += in;
+                if(in != (*p == 0xFFFF)) bad++;
+            }
+        }
+    }
+    printf("3000 polygons, 3-11 vertices, both rules: %u mismatches over "
+      "%u filled pixels\n", bad, filled);
+    CHECK(bad == 0);
+}
+
+// Position of pixel (px, py)'s centre relative to a line: t along it from
+// (x0, y0), in pixels, and s across it; len is the line's length
+static void lineCoords(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+  int16_t px, int16_t py, double *t, double *s, double *len) {
+    double dx = x1 - x0, dy = y1 - y0;
+    *len = sqrt(dx * dx + dy * dy);
+    double ux = *len ? dx / *len : 1, uy = *len ? dy / *len : 0;
+    double cx = px - x0, cy = py - y0; // Vertices are pixel centres
+    *t = cx * ux + cy * uy;
+    *s = cy * ux - cx * uy;
+}
+
+static void testThickLines(void) {
+    uint32_t missing = 0, extra = 0, boundary = 0, total = 0;
+    for(int k=0; k<500; k++) {
+        int16_t x0 = randomInt(CANVAS_W + 20) - 10,
+                y0 = randomInt(CANVAS_H + 20) - 10,
+                x1 = randomInt(CANVAS_W + 20) - 10,
+                y1 = randomInt(CANVAS_H + 20) - 10;
+        uint8_t w  = 2 + randomInt(12);
+        if(k % 50 == 0) { x1 = x0; y1 = y0; } // A dot: a w x w square
+        canvas.fillScreen(0);
+        canvas.drawThickLine(x0, y0, x1, y1, w, 0xFFFF);
+        const uint16_t *p = canvas.getBuffer();
+        for(int16_t y=0; y<CANVAS_H; y++) {
+            for(int16_t x=0; x<CANVAS_W; x++, p++) {
+                double t, s, len, h = w / 2.0;
+                lineCoords(x0, y0, x1, y1, x, y, &t, &s, &len);
+                double ext = len ? 0.5 : h; // Cap past each end
+                double d   = fmax(fabs(s) - h,
+                  fmax(-ext - t, t - (len + ext)));
+                bool   on  = *p == 0xFFFF;
+                if(d < -MARGIN)     { total++; missing += !on; }
+                else if(d > MARGIN) { extra += on; }
+                else                { boundary += on; }
+            }
+        }
+    }
+    printf("500 thick lines, w 2-13: %u of %u inner pixels missing, %u "
+      "outer pixels drawn, %u drawn within %.1f px of the boundary\n",
+      missing, total, extra, boundary, MARGIN);
+    CHECK(missing == 0);
+    CHECK(extra == 0);
+
+    // w <= 1 is drawLine()
+    static uint16_t line[CANVAS_W * CANVAS_H];
+    canvas.fillScreen(0);
+    canvas.drawLine(3, 100, 150, 7, 0xFFFF);
+    memcpy(line, canvas.getBuffer(), sizeof(line));
+    canvas.fillScreen(0);
+    canvas.drawThickLine(3, 100, 150, 7, 1, 0xFFFF);
+    CHECK(memcmp(line, canvas.getBuffer(), sizeof(line)) == 0);
+}
+
+static void testPolylines(void) {
+    static uint16_t centre[CANVAS_W * CANVAS_H];
+    static int16_t  xy[16];
+    uint32_t missing = 0, extra = 0;
+    for(int k=0; k<300; k++) {
+        uint16_t n = 2 + randomInt(7);
+        uint8_t  w = 2 + randomInt(10);
+        for(uint16_t i=0; i<n; i++) {
+            xy[i * 2]     = randomInt(CANVAS_W + 20) - 10;
+            xy[i * 2 + 1] = randomInt(CANVAS_H + 20) - 10;
+        }
+        if(k % 30 == 0) { xy[2] = xy[0]; xy[3] = xy[1]; } // Zero length
+        canvas.fillScreen(0);
+        for(uint16_t i=1; i<n; i++) {
+            canvas.drawLine(xy[i * 2 - 2], xy[i * 2 - 1], xy[i * 2],
+              xy[i * 2 + 1], 0xFFFF);
+        }
+        memcpy(centre, canvas.getBuffer(), sizeof(centre));
+        canvas.fillScreen(0);
+        canvas.drawPolyline(xy, n, w, 0xFFFF);
+        const uint16_t *p = canvas.getBuffer();
+        for(int16_t y=0; y<CANVAS_H; y++) {
+            for(int16_t x=0; x<CANVAS_W; x++, p++) {
+                bool on = *p == 0xFFFF;
+                if(centre[y * CANVAS_W + x] && !on) missing++;
+                if(!on) continue;
+                // Distance to the nearest segment's ideal rectangle
+                double d = 1e9;
+                for(uint16_t i=1; i<n; i++) {
+                    double t, s, len;
+                    lineCoords(xy[i * 2 - 2], xy[i * 2 - 1], xy[i * 2],
+                      xy[i * 2 + 1], x, y, &t, &s, &len);
+                    double ext = len ? 0.5 : w / 2.0;
+                    d = fmin(d, fmax(fabs(s) - w / 2.0,
+                      fmax(-ext - t, t - (len + ext))));
+                    if(i < n - 1) { // Bevel: within w / 2 of the joint
+                        d = fmin(d, hypot(x - xy[i * 2], y - xy[i * 2 + 1])
+                          - w / 2.0);
+                    }
+                }
+                if(d > MARGIN) extra++;
+            }
+        }
+    }
+    printf("300 polylines, 2-8 points, w 2-11: %u centre-line pixels "
+      "missing, %u pixels drawn outside the segments and joints\n",
+      missing, extra);
+    CHECK(missing == 0);
+    CHECK(extra == 0);
+}
+
+// Transactions on the ILI9341 for a few shapes
+static void testBus(void) {
+    static Adafruit_RecordingBus rec;
+    static Adafruit_ILI9341      tft(-1, -1);
+    testBegin(tft, rec);
+    static const int16_t square[] = { 80, 50, 240, 50, 240, 190, 80, 190 },
+                         tri[]    = { 20, 220, 160, 10, 300, 200 };
+    uint32_t t[4];
+    rec.reset();
+    tft.fillPolygon(square, 4, ILI9341_RED);
+    t[0] = rec.stats().transactions;
+    rec.reset();
+    tft.drawThickLine(100, 20, 100, 220, 6, ILI9341_RED);
+    t[1] = rec.stats().transactions;
+    rec.reset();
+    tft.fillPolygon(tri, 3, ILI9341_RED);
+    t[2] = rec.stats().transactions;
+    rec.reset();
+    tft.fillTriangle(20, 220, 160, 10, 300, 200, ILI9341_RED);
+    t[3] = rec.stats().transactions;
+    printf("transactions: 160x140 square %u, 200 px vertical w6 line %u, "
+      "triangle %u (fillTriangle() %u)\n", t[0], t[1], t[2], t[3]);
+    CHECK(t[0] <= 8);
+    CHECK(t[1] <= 8);
+    CHECK(t[2] <= t[3]);
+}
+
+int main(void) {
+    testPolygons();
+    testThickLines();
+    testPolylines();
+    testBus();
+    return testResult("test_polygon");
+}
@@ -0,0 +1,65 @@
+/*!
+ * @file test_readrect.cpp
+ *
+ * Adafruit_ILI9341::readRect() against the recording bus: the 288x240
+ * paint area read back through RAMRD must match what was drawn, and the
+ * block readback is benchmarked in pixels/second and bus transactions
+ * against the old three ReadData8() calls per pixel.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include "host_test.h"
+
+#define AREA_X 16  // Paint area, as in the firmware's save()
+#define AREA_W 288
+#define AREA_H 240
+#define REPS   20
+
+int main(void) {
+    Adafruit_RecordingBus rec;
+    Adafruit_ILI9341      tft(-1, -1);
+    testBegin(tft, rec);
+    for(int y=0; y<240; y++) {
+        for(int x=0; x<320; x++) tft.drawPixel(x, y, (x * 37 + y * 101));
+    }
+
+    static uint16_t out[AREA_W * AREA_H];
+    rec.reset();
+    double t0 = testSeconds();
+    for(int r=0; r<REPS; r++) tft.readRect(AREA_X, 0, AREA_W, AREA_H, out);
+    double t1 = testSeconds();
+    uint32_t trans = rec.stats().transactions / REPS;
+
+    uint32_t bad = 0;
+    for(int y=0; y<AREA_H; y++) {
+        for(int x=0; x<AREA_W; x++) {
+            if(out[y * AREA_W + x] != rec.getPixel(x + AREA_X, y)) bad++;
+        }
+    }
+    CHECK(bad == 0);
+    CHECK(trans < AREA_H * 2);
+
+    // Reference: one ReadData8() per color byte, packed with color565()
+    static uint16_t ref[AREA_W * AREA_H];
+    rec.reset();
+    double t2 = testSeconds();
+    for(int r=0; r<REPS; r++) {
+        tft.setAddrBlock(AREA_X, 0, AREA_X + AREA_W - 1, AREA_H - 1, 1);
+        for(int i=0; i<AREA_W * AREA_H; i++) {
+            uint8_t R = tft.ReadData8(), G = tft.ReadData8(),
+                    B = tft.ReadData8();
+            ref[i] = tft.color565(R, G, B);
+        }
+        tft.endWrite();
+    }
+    double t3 = testSeconds();
+    CHECK(memcmp(out, ref, sizeof(out)) == 0);
+
+    printf("readRect: %.1f Mpix/s, %u bus transactions/frame\n",
+      AREA_W * AREA_H * REPS / (t1 - t0) / 1e6, trans);
+    printf("per-byte: %.1f Mpix/s, %u bus transactions/frame\n",
+      AREA_W * AREA_H * REPS / (t3 - t2) / 1e6,
+      rec.stats().transactions / REPS);
+    return testResult("test_readrect");
+}
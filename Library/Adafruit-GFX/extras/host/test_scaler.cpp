@@ -0,0 +1,186 @@
+/*!
+ * @file test_scaler.cpp
+ *
+ * Adafruit_Scaler on the recording bus against a floating-point reference
+ * of the same sampling (pixel centers aligned; bilinear clamped at the
+ * edges, per channel). Random sizes in both directions, output rectangles
+ * partly or wholly off the display at negative and positive origins,
+ * enlargements with fewer source rows than output rows. Half the cases
+ * push NULL for every row skipNext() allows, which must not change the
+ * image and must skip rows in big reductions. Nothing outside the visible
+ * output rectangle may be drawn.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "Adafruit_Scaler.h"
+#include "host_test.h"
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+#define SRC_MAX  400
+#define BACKDROP 0x0821 // Not a test image pixel: their green is even
+#define EPSILON  0.01   // Fixed point rounds positions down by less
+
+static Adafruit_RecordingBus rec;
+static Adafruit_ILI9341      tft(-1, -1);
+static uint16_t              src[SRC_MAX * SRC_MAX];
+static uint16_t              work[2 * SCREEN_W];
+static uint32_t              seed = 1; ///< testRand() state
+
+/*!
+    @brief   Deterministic pseudo-random number.
+    @param   n  Range.
+    @return  0 to n - 1.
+*/
+static uint32_t testRand(uint32_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (seed >> 16) % n;
+}
+
+// Channel c (0 red, 1 green, 2 blue) of a pixel
+static int channel(uint16_t p, int c) {
+    return (c == 0) ? p >> 11 : (c == 1) ? (p >> 5) & 63 : p & 31;
+}
+
+// Source position of output pixel o's center, as a real number; bilinear
+// positions are from the center of pixel 0, clamped at 0
+static double position(int o, int srcN, int dstN, uint8_t mode) {
+    double s = (o + 0.5) * srcN / dstN;
+    if(mode == SCALER_NEAREST) return s;
+    return (s < 0.5) ? 0 : s - 0.5;
+}
+
+// Nearest: is p one of the pixels at or just left of position s?
+static bool nearestOk(int srcW, double sx, double sy, uint16_t p) {
+    int x = (int)sx, y = (int)sy;
+    for(int dy=0; dy<=((y > 0) && (sy - y < EPSILON)); dy++) {
+        for(int dx=0; dx<=((x > 0) && (sx - x < EPSILON)); dx++) {
+            if(src[(y - dy) * srcW + x - dx] == p) return true;
+        }
+    }
+    return false;
+}
+
+// Bilinear: worst channel error of p as a fraction of what the scaler may
+// lose: in each direction a weight rounded to 32 steps (off by up to 5/256
+// of the channel's range) and a truncated result, plus the fixed-point
+// position (off by EPSILON)
+static double bilinearError(int srcW, int srcH, double sx, double sy,
+  uint16_t p) {
+    int    x0 = (int)sx, y0 = (int)sy;
+    int    x1 = (x0 + 1 < srcW) ? x0 + 1 : srcW - 1,
+           y1 = (y0 + 1 < srcH) ? y0 + 1 : srcH - 1;
+    if(x0 >= srcW) x0 = x1 = srcW - 1;
+    if(y0 >= srcH) y0 = y1 = srcH - 1;
+    double fx = sx - (int)sx, fy = sy - (int)sy, worst = 0;
+    for(int c=0; c<3; c++) {
+        double a = channel(src[y0 * srcW + x0], c) * (1 - fx) +
+                   channel(src[y0 * srcW + x1], c) * fx;
+        double b = channel(src[y1 * srcW + x0], c) * (1 - fx) +
+                   channel(src[y1 * srcW + x1], c) * fx;
+        double range = (c == 1) ? 63 : 31,
+               bound = 2 * (1 + range * 5 / 256) + range * EPSILON;
+        worst = fmax(worst, fabs(a * (1 - fy) + b * fy - channel(p, c)) /
+          bound);
+    }
+    return worst;
+}
+
+int main(void) {
+    testBegin(tft, rec);
+    uint32_t bad = 0, outside = 0, unfinished = 0, cases[2] = { 0, 0 },
+             skipped = 0, bigSkipped = 0, bigCases = 0, enlarged = 0;
+    double   worst = 0;
+    for(int k=0; k<2000; k++) {
+        uint8_t  mode = k & 1;
+        bool     skip = k & 2;
+        uint16_t srcW = 1 + testRand(SRC_MAX), srcH = 1 + testRand(SRC_MAX),
+                 dstW, dstH;
+        switch(testRand(3)) {
+          case 0:  // Reduction, up to 1/8
+            dstW = 1 + srcW / (1 + testRand(8));
+            dstH = 1 + srcH / (1 + testRand(8));
+            break;
+          case 1:  // Enlargement, up to 4x
+            srcW = 1 + srcW / 4;
+            srcH = 1 + srcH / 4;
+            dstW = srcW + testRand(3 * srcW + 1);
+            dstH = srcH + 1 + testRand(3 * srcH + 1);
+            break;
+          default: // Anything
+            dstW = 1 + testRand(SRC_MAX);
+            dstH = 1 + testRand(SRC_MAX);
+        }
+        int16_t x = (int16_t)testRand(SCREEN_W + 100) - 50 - dstW / 2,
+                y = (int16_t)testRand(SCREEN_H + 100) - 50 - dstH / 2;
+        if(k % 10 == 0) { x = -(int16_t)dstW - 5; } // Wholly off screen
+        for(int i=0; i<srcW * srcH; i++) src[i] = testRand(0x10000) & ~0x20;
+
+        tft.fillScreen(BACKDROP);
+        Adafruit_Scaler s;
+        bool visible = s.begin(&tft, x, y, srcW, srcH, dstW, dstH, mode,
+          work);
+        uint32_t skips = 0;
+        for(uint16_t r=0; r<srcH; r++) {
+            if(skip && s.skipNext()) {
+                s.pushRow(NULL);
+                skips++;
+            } else {
+                s.pushRow(src + r * srcW);
+            }
+        }
+        if(visible && !s.done()) unfinished++;
+        skipped += skips;
+        if(skip && visible && (srcH >= 4 * dstH)) {
+            bigCases++;
+            bigSkipped += skips > 0;
+        }
+        enlarged += srcH < dstH;
+        cases[visible]++;
+
+        const uint16_t *fb = rec.getBuffer();
+        for(int16_t py=0; py<SCREEN_H; py++) {
+            for(int16_t px=0; px<SCREEN_W; px++) {
+                uint16_t p  = fb[py * SCREEN_W + px];
+                int      ox = px - x, oy = py - y;
+                if((ox < 0) || (ox >= dstW) || (oy < 0) || (oy >= dstH)) {
+                    outside += p != BACKDROP;
+                    continue;
+                }
+                double sx = position(ox, srcW, dstW, mode),
+                       sy = position(oy, srcH, dstH, mode);
+                if(mode == SCALER_NEAREST) {
+                    bad += !nearestOk(srcW, sx, sy, p);
+                } else {
+                    double e = bilinearError(srcW, srcH, sx, sy, p);
+                    worst = fmax(worst, e);
+                    bad += e > 1;
+                }
+            }
+        }
+    }
+    printf("2000 images, 1-%d px, %u drawn, %u off screen, %u enlarged "
+      "vertically: %u pixels wrong, %u drawn outside, %u unfinished\n",
+      SRC_MAX, cases[1], cases[0], enlarged, bad, outside, unfinished);
+    printf("bilinear: worst channel error %.0f%% of the bound; skipNext(): %u rows "
+      "skipped, %u of %u 4:1+ reductions skipped some\n", worst * 100, skipped,
+      bigSkipped, bigCases);
+    CHECK(bad == 0);
+    CHECK(outside == 0);
+    CHECK(unfinished == 0);
+    CHECK(cases[0] > 100);
+    CHECK(enlarged > 500);
+    CHECK(bigCases > 20);
+    CHECK(bigSkipped == bigCases);
+
+    // Nothing to draw
+    Adafruit_Scaler s;
+    CHECK(!s.begin(&tft, 0, 0, 0, 10, 10, 10, SCALER_NEAREST, work));
+    CHECK(!s.begin(&tft, SCREEN_W, 0, 10, 10, 10, 10, SCALER_NEAREST, work));
+    CHECK(s.skipNext());
+
+    return testResult("test_scaler");
+}
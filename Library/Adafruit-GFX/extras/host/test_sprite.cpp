@@ -0,0 +1,239 @@
+/*!
+ * @file test_sprite.cpp
+ *
+ * Adafruit_SpriteLayer on the recording bus, checked frame by frame
+ * against a model: a copy of the background, drawn with the same fills,
+ * with the shown sprites painted over it in add() order. First the game's
+ * bird over its pipes for 1500 frames (reporting bytes and transactions
+ * per frame, and checking the layer's byte count never undercounts the
+ * wire), then overlapping sprites wandering, jumping, going partly off
+ * screen and being hidden and shown over a changing background.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "Adafruit_Sprite.h"
+#include "host_test.h"
+
+#define SCREEN_W 320
+#define SCREEN_H 240
+#define SKY      ILI9341_CYAN
+#define PIPE     0xD78A
+#define KEY      ILI9341_MAGENTA // Transparent, not used by any art
+#define BIRD_W   43              // As in the firmware's Gameloop()
+#define BIRD_H   37
+
+static Adafruit_RecordingBus rec;
+static Adafruit_ILI9341      tft(-1, -1);
+static Adafruit_SpriteLayer  layer(&tft);
+static uint16_t              model[SCREEN_W * SCREEN_H];  // Background
+static uint16_t              expect[SCREEN_W * SCREEN_H]; // Plus sprites
+static Adafruit_Sprite      *added[SPRITE_MAX];           // add() order
+static uint8_t               nadded = 0;
+static uint32_t              seed = 1; ///< testRand() state
+
+/*!
+    @brief   Deterministic pseudo-random number.
+    @param   n  Range.
+    @return  0 to n - 1.
+*/
+static uint32_t testRand(uint32_t n) {
+    seed = seed * 1103515245UL + 12345UL;
+    return (seed >> 16) % n;
+}
+
+// Fill the background through the layer and in the model
+static void fill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t c) {
+    layer.fillRect(x, y, w, h, c);
+    for(int16_t r=y; r<y + h; r++) {
+        for(int16_t k=x; k<x + w; k++) {
+            if((r >= 0) && (r < SCREEN_H) && (k >= 0) && (k < SCREEN_W))
+                model[r * SCREEN_W + k] = c;
+        }
+    }
+}
+
+static void add(Adafruit_Sprite *s) {
+    layer.add(s);
+    added[nadded++] = s;
+}
+
+// Pixels of the panel that differ from the model with the visible sprites
+// painted over it
+static uint32_t differences(const uint16_t *const *art) {
+    memcpy(expect, model, sizeof(expect));
+    for(uint8_t i=0; i<nadded; i++) {
+        Adafruit_Sprite *s = added[i];
+        if(!s->visible()) continue;
+        for(int16_t r=0; r<s->height(); r++) {
+            for(int16_t k=0; k<s->width(); k++) {
+                int16_t  x = s->x() + k, y = s->y() + r;
+                uint16_t c = art[i][r * s->width() + k];
+                if((c != KEY) && (x >= 0) && (x < SCREEN_W) && (y >= 0) &&
+                  (y < SCREEN_H)) expect[y * SCREEN_W + x] = c;
+            }
+        }
+    }
+    const uint16_t *fb  = rec.getBuffer();
+    uint32_t        bad = 0;
+    for(uint32_t i=0; i<SCREEN_W * SCREEN_H; i++) bad += fb[i] != expect[i];
+    return bad;
+}
+
+// The firmware's bird
+static void bird(Adafruit_GFX &gfx, int16_t x, int16_t y) {
+    gfx.fillCircle(x, y, 18, ILI9341_YELLOW);
+    gfx.drawCircle(x, y, 18, ILI9341_BLACK);
+    gfx.fillRect(x, y + 5, 20, 7, ILI9341_RED);
+    gfx.drawRect(x, y + 5, 20, 7, ILI9341_BLACK);
+    gfx.fillRect(x, y + 8, 20, 1, ILI9341_BLACK);
+    gfx.fillCircle(x + 7, y - 9, 7, ILI9341_WHITE);
+    gfx.drawCircle(x + 7, y - 9, 7, ILI9341_BLACK);
+    gfx.fillCircle(x + 7, y - 9, 2, ILI9341_BLACK);
+    gfx.fillRect(x - 23, y, 18, 7, ILI9341_WHITE);
+    gfx.drawRect(x - 23, y, 18, 7, ILI9341_BLACK);
+}
+
+// Both pipes at columns x .. x + w - 1, left of the bar excluded
+static void pipes(int16_t x, int16_t w, uint16_t color) {
+    if(x < 20) {
+        w -= 20 - x;
+        x  = 20;
+    }
+    if(w > 0) {
+        fill(x, 20, w, 50, color);
+        fill(x, 165, w, 50, color);
+    }
+}
+
+// The game's frames, one physics tick each, with random flaps that keep
+// the bird on screen
+static void game(void) {
+    static uint16_t    birdPixels[BIRD_W * BIRD_H], birdSave[BIRD_W * BIRD_H];
+    static GFXcanvas16 art(BIRD_W, BIRD_H, birdPixels);
+    art.fillScreen(KEY);
+    bird(art, 23, 18);
+    static Adafruit_Sprite birdSprite(birdPixels, BIRD_W, BIRD_H, KEY,
+      birdSave);
+    const uint16_t *arts[] = { birdPixels };
+    add(&birdSprite);
+
+    int16_t birdX = SCREEN_W / 3 - 23, birdY = SCREEN_H / 2 - 45 - 18;
+    int32_t pos = 0, vel = 0; // Q16.16, as GameLoop's bodies
+    int16_t pipeX = 280;
+    fill(0, 0, SCREEN_W, SCREEN_H, SKY);
+    fill(0, 0, 20, SCREEN_H, PIPE);
+    pipes(pipeX, 20, PIPE);
+    birdSprite.moveTo(birdX, birdY);
+    birdSprite.setVisible(true);
+    layer.update();
+    layer.resetStats();
+
+    uint32_t bad = 0, under = 0, frames = 1500;
+    uint64_t bytes = 0, transactions = 0, estimate = 0;
+    for(uint32_t f=0; f<frames; f++) {
+        rec.reset();
+        if((pos > 40 * 65536) || ((pos > -20 * 65536) && !testRand(25)))
+            vel = -8 * 65536;
+        vel += 32768;
+        pos += vel;
+        int16_t x = pipeX - 1;
+        if(x < -2) x += 282;
+        if(x > pipeX) {       // A new pair comes in whole
+            pipes(pipeX, 20, SKY);
+            pipes(x, 20, PIPE);
+        } else {              // One column each side
+            pipes(x, 1, PIPE);
+            pipes(x + 20, 1, SKY);
+        }
+        pipeX = x;
+        birdSprite.moveTo(birdX, birdY + (pos >> 16));
+        layer.update();
+        layer.endFrame();
+        bytes        += rec.stats().bytes;
+        transactions += rec.stats().transactions;
+        estimate     += layer.frameBytes();
+        if(layer.frameBytes() < rec.stats().bytes) under++;
+        bad += differences(arts);
+    }
+    printf("game, %u frames: %llu bytes/frame (layer counts %llu, peak "
+      "%u), %.1f transactions/frame, %u frames undercounted, %u pixels "
+      "differ\n", frames, (unsigned long long)(bytes / frames),
+      (unsigned long long)(estimate / frames), layer.peakBytes(),
+      (double)transactions / frames, under, bad);
+    CHECK(bad == 0);
+    CHECK(under == 0);
+    CHECK(layer.peakBytes() < Adafruit_SpriteLayer::budget(60));
+
+    birdSprite.setVisible(false);
+    layer.update();
+    CHECK(differences(arts) == 0);
+}
+
+// Sprites crowding the same corner of the screen, with holes of key color
+static void crowd(void) {
+    static const struct { int16_t w, h; } size[] = {
+      { 30, 20 }, { 25, 25 }, { 40, 12 }, { 16, 34 }
+    };
+    const uint8_t    count = sizeof(size) / sizeof(size[0]);
+    static uint16_t  pix[4][40 * 40], save[4][40 * 40];
+    const uint16_t  *arts[4];
+    Adafruit_Sprite *sprite[4];
+    for(uint8_t i=0; i<count; i++) {
+        for(int k=0; k<size[i].w * size[i].h; k++) {
+            pix[i][k] = ((k * 7 + i * 3) % 11 < 3) ? KEY :
+              (uint16_t)(0x1111 * (i + 1) + k);
+        }
+        arts[i]   = pix[i];
+        sprite[i] = new Adafruit_Sprite(pix[i], size[i].w, size[i].h, KEY,
+          save[i]);
+        sprite[i]->moveTo(testRand(100), testRand(80));
+        sprite[i]->setVisible(true);
+        add(sprite[i]);
+    }
+    const uint16_t *all[SPRITE_MAX] = { NULL }; // Bird first, hidden
+    for(uint8_t i=0; i<count; i++) all[nadded - count + i] = arts[i];
+
+    for(int k=0; k<40; k++) {
+        fill(testRand(SCREEN_W), testRand(SCREEN_H), 1 + testRand(120),
+          1 + testRand(100), testRand(0x10000));
+    }
+    layer.update();
+
+    uint32_t bad = 0, frames = 1000;
+    for(uint32_t f=0; f<frames; f++) {
+        for(uint8_t i=0; i<count; i++) {
+            Adafruit_Sprite *s = sprite[i];
+            uint32_t what = testRand(40);
+            if(!what) {                // Jump, maybe partly off screen
+                s->moveTo((int16_t)testRand(160) - 30,
+                  (int16_t)testRand(140) - 30);
+            } else if(what == 1) {     // Hide or show
+                s->setVisible(!s->visible());
+            } else {                   // Wander, mostly over the others
+                int16_t x = s->x() + (int16_t)testRand(7) - 3;
+                int16_t y = s->y() + (int16_t)testRand(7) - 3;
+                if((x < -20) || (x > 120)) x = 50;
+                if((y < -20) || (y > 100)) y = 40;
+                s->moveTo(x, y);
+            }
+        }
+        if(!testRand(10)) {            // Background under the sprites
+            fill((int16_t)testRand(140) - 10, (int16_t)testRand(120) - 10,
+              1 + testRand(60), 1 + testRand(60), testRand(0x10000));
+        }
+        layer.update();
+        bad += differences(all);
+    }
+    printf("%u overlapping sprites, %u frames: %u pixels differ\n", count,
+      frames, bad);
+    CHECK(bad == 0);
+}
+
+int main(void) {
+    testBegin(tft, rec);
+    game();
+    crowd();
+    return testResult("test_sprite");
+}
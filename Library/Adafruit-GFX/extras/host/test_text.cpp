@@ -0,0 +1,167 @@
+/*!
+ * @file test_text.cpp
+ *
+ * Opaque text runs against per-glyph drawChar(): the same lines printed
+ * with a background color through print() (one window and burst per text
+ * line) and through Adafruit_GFX::write() (glyph by glyph) must give the
+ * same pixels, for the classic font and across GFXfont changes. Reports
+ * bus bytes and transactions per character for both. Lines partly off
+ * screen must match the same line on screen, shifted, and every line must
+ * be opaque over its whole box. Built twice: test_text_narrow has a
+ * TEXT_RUN_PIXELS too small for the lines, so runs are split.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include <string.h>
+#include "host_test.h"
+
+#define PROGMEM // Fonts are plain const data here, as in the firmware
+#include "Fonts/FreeSans9pt7b.h"
+#include "Fonts/FreeSerif12pt7b.h"
+
+#define SCREEN_PIXELS (320 * 240)
+#define BACKDROP      0x1234
+
+static const char *lines[] = {
+  "===============", "JPEG image info", "Width      :320",
+  "Height     :240", "Components :3",    "MCU / row  :20"
+};
+
+static Adafruit_RecordingBus rec;
+static Adafruit_ILI9341      tft(-1, -1);
+static uint16_t              glyphShot[SCREEN_PIXELS], runShot[SCREEN_PIXELS];
+
+// Print all lines, through the run renderer or glyph by glyph, then
+// report the wire cost per character and take a screenshot.
+static void render(bool runs, uint8_t size, const GFXfont *font,
+  uint16_t *shot, uint32_t *bytes, uint32_t *transactions) {
+    tft.fillScreen(BACKDROP);
+    tft.setFont(font);
+    tft.setTextSize(size);
+    tft.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+    tft.setCursor(0, font ? 20 : 0);
+    rec.reset();
+    uint32_t chars = 0;
+    for(unsigned l=0; l<sizeof(lines) / sizeof(lines[0]); l++) {
+        const char *s = lines[l];
+        chars += strlen(s);
+        if(runs) {
+            tft.println(s);
+        } else {
+            for(const char *p=s; *p; p++) tft.Adafruit_GFX::write(*p);
+            tft.Adafruit_GFX::write('\n');
+        }
+    }
+    *bytes        = rec.stats().bytes;
+    *transactions = rec.stats().transactions;
+    printf("  %s: %.1f bytes/char, %.2f transactions/char\n",
+      runs ? "run  " : "glyph", (double)*bytes / chars,
+      (double)*transactions / chars);
+    memcpy(shot, rec.getBuffer(), SCREEN_PIXELS * 2);
+}
+
+// Non-backdrop pixels that should be: inside the bounding box of what
+// was drawn, every pixel is the text color or its background
+static uint32_t holes(const uint16_t *shot) {
+    int16_t x0 = 320, y0 = 240, x1 = -1, y1 = -1;
+    for(int16_t y=0; y<240; y++) {
+        for(int16_t x=0; x<320; x++) {
+            if(shot[y * 320 + x] == BACKDROP) continue;
+            if(x < x0) x0 = x;
+            if(x > x1) x1 = x;
+            if(y < y0) y0 = y;
+            if(y > y1) y1 = y;
+        }
+    }
+    uint32_t n = 0;
+    for(int16_t y=y0; y<=y1; y++) {
+        for(int16_t x=x0; x<=x1; x++) n += shot[y * 320 + x] == BACKDROP;
+    }
+    return n;
+}
+
+// One line without wrapping at (x, y), screenshot in shot
+static void line(const GFXfont *font, uint8_t size, int16_t x, int16_t y,
+  uint16_t *shot) {
+    tft.fillScreen(BACKDROP);
+    tft.setFont(font);
+    tft.setTextSize(size);
+    tft.setTextWrap(false);
+    tft.setTextColor(ILI9341_GREEN, ILI9341_BLACK);
+    tft.setCursor(x, y);
+    tft.print("Clip: Wq|gj,0123");
+    tft.setTextWrap(true);
+    memcpy(shot, rec.getBuffer(), SCREEN_PIXELS * 2);
+}
+
+// The line near the top left, then moved partly off each edge: what was
+// on screen both times must be the same pixels, and all of it opaque
+static void clipped(const GFXfont *font, uint8_t size, const char *name) {
+    static const int16_t shift[][2] = {
+      { 220, 0 }, { -60, 0 }, { 0, -95 }, { 0, 100 }, { -40, -100 }
+    };
+    int16_t  y   = font ? 100 : 95;
+    uint32_t bad = 0, gaps;
+    line(font, size, 10, y, glyphShot);
+    gaps = holes(glyphShot);
+    for(unsigned k=0; k<sizeof(shift) / sizeof(shift[0]); k++) {
+        int16_t dx = shift[k][0], dy = shift[k][1];
+        line(font, size, 10 + dx, y + dy, runShot);
+        gaps += holes(runShot);
+        for(int16_t py=0; py<240; py++) {
+            for(int16_t px=0; px<320; px++) {
+                int16_t ox = px - dx, oy = py - dy;
+                if((ox < 0) || (ox >= 320) || (oy < 0) || (oy >= 240))
+                    continue; // Not on screen the first time
+                bad += runShot[py * 320 + px] != glyphShot[oy * 320 + ox];
+            }
+        }
+    }
+    printf("%s, size %u, partly off screen: %u pixels differ, %u holes in "
+      "the background\n", name, size, bad, gaps);
+    CHECK(bad == 0);
+    CHECK(gaps == 0);
+}
+
+int main(void) {
+    uint32_t gb, gt, rb, rt;
+    testBegin(tft, rec);
+
+    for(uint8_t size=1; size<=3; size++) {
+        printf("classic font, size %d\n", size);
+        render(false, size, NULL, glyphShot, &gb, &gt);
+        render(true,  size, NULL, runShot,   &rb, &rt);
+        CHECK(memcmp(glyphShot, runShot, sizeof(runShot)) == 0);
+        CHECK(rt < gt);
+    }
+
+    // The glyph path only paints set bits of a GFXfont, the run is opaque
+    // over each line's box: every set pixel must still agree. Switching
+    // fonts (and back) must pick up each font's own line metrics.
+    static const struct { const char *name; const GFXfont *font; } fonts[] = {
+      { "FreeSans9pt7b",   &FreeSans9pt7b   },
+      { "FreeSerif12pt7b", &FreeSerif12pt7b },
+      { "FreeSans9pt7b",   &FreeSans9pt7b   }
+    };
+    for(unsigned f=0; f<sizeof(fonts) / sizeof(fonts[0]); f++) {
+        printf("%s, size 1\n", fonts[f].name);
+        render(false, 1, fonts[f].font, glyphShot, &gb, &gt);
+        render(true,  1, fonts[f].font, runShot,   &rb, &rt);
+        uint32_t bad = 0;
+        for(int i=0; i<SCREEN_PIXELS; i++) {
+            if((glyphShot[i] != BACKDROP) && (glyphShot[i] != runShot[i]))
+                bad++;
+        }
+        CHECK(bad == 0);
+        CHECK(rt < gt);
+    }
+
+    printf("runs up to %d pixels\n", TEXT_RUN_PIXELS);
+    clipped(NULL, 1, "classic font");
+    clipped(NULL, 2, "classic font");
+    clipped(&FreeSans9pt7b, 1, "FreeSans9pt7b");
+    clipped(&FreeSerif12pt7b, 2, "FreeSerif12pt7b");
+
+    return testResult("test_text");
+}
@@ -28,29 +28,67 @@ See notes at end for glyph nomenclature & other tidbits.
 
 #define DPI 141 // Approximate res. of Adafruit 2.8" TFT
 
+int bytesOut = 0; // Bytes written to the bitmap table so far
+
+// Write one byte to the bitmap table, formatted 12 to a line
+void enbyte(uint8_t value) {
+	static uint8_t row = 0, firstCall = 1;
+	if(!firstCall) { // Format output table nicely
+		if(++row >= 12) {        // Last entry on line?
+			printf(",\n  "); //   Newline format output
+			row = 0;         //   Reset row counter
+		} else {                 // Not end of line
+			printf(", ");    //   Simple comma delim
+		}
+	}
+	printf("0x%02X", value); // Write byte value
+	firstCall = 0;           // Formatting flag
+	bytesOut++;
+}
+
 // Accumulate bits for output, with periodic hexadecimal byte write
 void enbit(uint8_t value) {
-	static uint8_t row = 0, sum = 0, bit = 0x80, firstCall = 1;
+	static uint8_t sum = 0, bit = 0x80;
 	if(value) sum |= bit;    // Set bit if needed
 	if(!(bit >>= 1)) {       // Advance to next bit, end of byte reached?
-		if(!firstCall) { // Format output table nicely
-			if(++row >= 12) {        // Last entry on line?
-				printf(",\n  "); //   Newline format output
-				row = 0;         //   Reset row counter
-			} else {                 // Not end of line
-				printf(", ");    //   Simple comma delim
-			}
+		enbyte(sum);     // Write byte value
+		sum       = 0;   // Clear for next byte
+		bit       = 0x80; // Reset bit counter
+	}
+}
+
+// Accumulate pixels as run-length bytes (GFXFONT_RLE): high nibble is a
+// count of clear pixels, low nibble the count of set pixels that follow.
+// Runs longer than 15 are split over several bytes.
+static uint8_t runOff = 0, runOn = 0;
+
+void enrun(uint8_t value) {
+	if(value) {
+		if(runOn == 15) { // Set run full, start a new byte
+			enbyte((runOff << 4) | runOn);
+			runOff = runOn = 0;
 		}
-		printf("0x%02X", sum); // Write byte value
-		sum       = 0;         // Clear for next byte
-		bit       = 0x80;      // Reset bit counter
-		firstCall = 0;         // Formatting flag
+		runOn++;
+	} else {
+		if(runOn || (runOff == 15)) { // Clear run after a set run, or full
+			enbyte((runOff << 4) | runOn);
+			runOff = runOn = 0;
+		}
+		runOff++;
 	}
 }
 
+// Flush the last run of a glyph; every pixel, including trailing clear
+// ones, is covered so the decoder knows where the glyph ends
+void endrun(void) {
+	if(runOff || runOn) enbyte((runOff << 4) | runOn);
+	runOff = runOn = 0;
+}
+
 int main(int argc, char *argv[]) {
 	int                i, j, err, size, first=' ', last='~',
-	                   bitmapOffset = 0, x, y, byte;
+	                   bitmapOffset = 0, x, y, byte, rle = 0,
+	                   rawBytes = 0;
 	char              *fontName, c, *ptr;
 	FT_Library         library;
 	FT_Face            face;
@@ -61,15 +99,22 @@ int main(int argc, char *argv[]) {
 	uint8_t            bit;
 
 	// Parse command line.  Valid syntaxes are:
-	//   fontconvert [filename] [size]
-	//   fontconvert [filename] [size] [last char]
-	//   fontconvert [filename] [size] [first char] [last char]
+	//   fontconvert [-r] [filename] [size]
+	//   fontconvert [-r] [filename] [size] [last char]
+	//   fontconvert [-r] [filename] [size] [first char] [last char]
 	// Unless overridden, default first and last chars are
-	// ' ' (space) and '~', respectively
+	// ' ' (space) and '~', respectively.  -r writes run-length coded
+	// glyphs (GFXFONT_RLE), which are smaller for larger sizes.
+
+	if((argc > 1) && !strcmp(argv[1], "-r")) {
+		rle = 1;
+		argv++;
+		argc--;
+	}
 
 	if(argc < 3) {
-		fprintf(stderr, "Usage: %s fontfile size [first] [last]\n",
-		  argv[0]);
+		fprintf(stderr,
+		  "Usage: %s [-r] fontfile size [first] [last]\n", argv[0]);
 		return 1;
 	}
 
@@ -190,18 +235,28 @@ int main(int argc, char *argv[]) {
 			for(x=0;x < bitmap->width; x++) {
 				byte = x / 8;
 				bit  = 0x80 >> (x & 7);
-				enbit(bitmap->buffer[
-				  y * bitmap->pitch + byte] & bit);
+				if(rle) {
+					enrun(bitmap->buffer[
+					  y * bitmap->pitch + byte] & bit);
+				} else {
+					enbit(bitmap->buffer[
+					  y * bitmap->pitch + byte] & bit);
+				}
 			}
 		}
 
-		// Pad end of char bitmap to next byte boundary if needed
-		int n = (bitmap->width * bitmap->rows) & 7;
-		if(n) { // Pixel count not an even multiple of 8?
-			n = 8 - n; // # bits to next multiple
-			while(n--) enbit(0);
+		if(rle) {
+			endrun();
+		} else {
+			// Pad end of char bitmap to next byte boundary if needed
+			int n = (bitmap->width * bitmap->rows) & 7;
+			if(n) { // Pixel count not an even multiple of 8?
+				n = 8 - n; // # bits to next multiple
+				while(n--) enbit(0);
+			}
 		}
-		bitmapOffset += (bitmap->width * bitmap->rows + 7) / 8;
+		rawBytes    += (bitmap->width * bitmap->rows + 7) / 8;
+		bitmapOffset = bytesOut;
 
 		FT_Done_Glyph(glyph);
 	}
@@ -236,14 +291,19 @@ int main(int argc, char *argv[]) {
 	printf("  (GFXglyph *)%sGlyphs,\n", fontName);
 	if (face->size->metrics.height == 0) {
       // No face height info, assume fixed width and get from a glyph.
-		printf("  0x%02X, 0x%02X, %d };\n\n",
-			first, last, table[0].height);
+		printf("  0x%02X, 0x%02X, %d%s };\n\n",
+			first, last, table[0].height, rle ? ", GFXFONT_RLE" : "");
 	} else {
-		printf("  0x%02X, 0x%02X, %ld };\n\n",
-			first, last, face->size->metrics.height >> 6);
+		printf("  0x%02X, 0x%02X, %ld%s };\n\n",
+			first, last, face->size->metrics.height >> 6,
+			rle ? ", GFXFONT_RLE" : "");
 	}
 	printf("// Approx. %d bytes\n",
 	  bitmapOffset + (last - first + 1) * 7 + 7);
+	if(rle) {
+		printf("// Run-length glyphs %d bytes, as bitmaps %d bytes\n",
+		  bitmapOffset, rawBytes);
+	}
 	// Size estimate is based on AVR struct and pointer sizes;
 	// actual size may vary.
 
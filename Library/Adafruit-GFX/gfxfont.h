@@ -6,7 +6,9 @@
 
 #ifndef _GFXFONT_H_
 #define _GFXFONT_H_
-#include "stm32f3xx_hal.h"
+#include <stdint.h>
+
+#define GFXFONT_RLE 0x01 ///< GFXfont flags: glyphs are run-length coded
 
 /// Font data stored PER GLYPH
 typedef struct {
@@ -25,6 +27,7 @@ typedef struct {
 	uint8_t   first;       ///< ASCII extents (first char)
         uint8_t   last;        ///< ASCII extents (last char)
 	uint8_t   yAdvance;    ///< Newline distance (y axis)
+	uint8_t   flags;       ///< GFXFONT_* bits, 0 for plain bitmaps
 } GFXfont;
 
 #endif // _GFXFONT_H_
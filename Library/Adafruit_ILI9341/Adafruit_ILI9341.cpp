@@ -14,6 +14,45 @@
 #define MADCTL_BGR 0x08  ///< Blue-Green-Red pixel order
 #define MADCTL_MH  0x04  ///< LCD refresh right to left
 
+// RX strip for readRect(): RGB666 as read, 3 bytes per pixel. Static and
+// word-aligned so it's DMA-reachable and pack666() can load whole words.
+static uint32_t readBuf[(ILI9341_READ_PIXELS * 3 + 3) / 4];
+
+/*!
+    @brief  Convert RGB666 pixels as read back from RAMRD (R, G, B bytes,
+            6 significant bits each at the top) to native RGB565. Four
+            pixels per iteration come in as three 32-bit loads, so there's
+            no per-byte load or color565() call. Safe to run in place
+            (dst == src): output is always behind input.
+    @param  src  Read-back bytes, 32-bit aligned.
+    @param  dst  Destination pixels.
+    @param  n    Number of pixels.
+*/
+static void pack666(const uint32_t *src, uint16_t *dst, uint32_t n) {
+    while(n >= 4) { // Little-endian: a = R0 G0 B0 R1, b = G1 B1 R2 G2 ...
+        uint32_t a = src[0], b = src[1], c = src[2];
+        src += 3;
+        uint16_t p0 = ((a & 0xF8) << 8) | ((a & 0xFC00) >> 5) |
+                      ((a >> 19) & 0x1F);
+        uint16_t p1 = ((a >> 16) & 0xF800) | ((b & 0xFC) << 3) |
+                      ((b >> 11) & 0x1F);
+        uint16_t p2 = ((b >> 8) & 0xF800) | ((b >> 21) & 0x7E0) |
+                      ((c & 0xF8) >> 3);
+        uint16_t p3 = (c & 0xF800) | ((c >> 13) & 0x7E0) | (c >> 27);
+        dst[0] = p0;
+        dst[1] = p1;
+        dst[2] = p2;
+        dst[3] = p3;
+        dst += 4;
+        n   -= 4;
+    }
+    const uint8_t *s8 = (const uint8_t *)src;
+    while(n--) {
+        *dst++ = ((s8[0] & 0xF8) << 8) | ((s8[1] & 0xFC) << 3) | (s8[2] >> 3);
+        s8 += 3;
+    }
+}
+
 /**************************************************************************/
 /*!
     @brief  Instantiate Adafruit ILI9341 driver with software SPI
@@ -73,17 +112,77 @@ static const uint8_t initcmd[] = {
 /**************************************************************************/
 /*!
     @brief   Initialize ILI9341 chip
-    Connects to the ILI9341 over SPI and sends initialization procedure commands
+    Connects to the ILI9341 over SPI and sends initialization procedure commands.
+    Blocks for the reset and sleep-out delays; see beginStart() to overlap them
+    with other work.
     @param    freq  Desired SPI clock frequency
 */
 /**************************************************************************/
 void Adafruit_ILI9341::begin(uint32_t freq) {
+    beginStart(freq);
+    while(!beginPoll());
+}
 
+/**************************************************************************/
+/*!
+    @brief   Start initializing the ILI9341: hardware reset and SWRESET. The
+             rest is done by beginPoll() once the controller's delays have
+             elapsed, so the caller can get on with other init meanwhile.
+    @param    freq  Desired SPI clock frequency
+*/
+/**************************************************************************/
+void Adafruit_ILI9341::beginStart(uint32_t freq) {
+    (void)freq;
     startWrite();
-	Reset();
-	// SOFTWARE RESET
-	writeCommand(0x01);
-	HAL_Delay(1000);
+    Reset();
+    writeCommand(ILI9341_SWRESET);
+    endWrite();
+    _initTick  = tftMillis();
+    _initState = ILI9341_INIT_RESET;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Advance initialization started by beginStart(). Never waits:
+             returns false straight away while a delay is still running.
+    @return  true once the display is on and ready for drawing.
+*/
+/**************************************************************************/
+bool Adafruit_ILI9341::beginPoll(void) {
+    uint32_t elapsed = tftMillis() - _initTick;
+    switch(_initState) {
+      case ILI9341_INIT_RESET: // 5 ms before commands, 120 ms before SLPOUT
+        if(elapsed < ILI9341_RESET_MS) return false;
+        startWrite();
+        initRegisters();
+        writeCommand(ILI9341_SLPOUT);
+        endWrite();
+        _initTick  = tftMillis();
+        _initState = ILI9341_INIT_SLEEPOUT;
+        return false;
+      case ILI9341_INIT_SLEEPOUT:
+        if(elapsed < ILI9341_SLPOUT_MS) return false;
+        startWrite();
+        writeCommand(ILI9341_DISPON);
+        endWrite();
+        invalidateAddrWindow();
+        _width     = ILI9341_TFTWIDTH;
+        _height    = ILI9341_TFTHEIGHT;
+        _initState = ILI9341_INIT_READY;
+        return true;
+      case ILI9341_INIT_READY:
+        return true;
+    }
+    return false; // beginStart() not called
+}
+
+/**************************************************************************/
+/*!
+    @brief   Send the power, timing, pixel format and gamma registers.
+             Part of beginPoll(); needs startWrite().
+*/
+/**************************************************************************/
+void Adafruit_ILI9341::initRegisters(void) {
 	// POWER CONTROL A
 	writeCommand(0xCB);
 	{
@@ -240,35 +339,6 @@ void Adafruit_ILI9341::begin(uint32_t freq) {
 		};
 		WriteData(data, sizeof(data));
 	}
-
-	// EXIT SLEEP
-	writeCommand(0x11);
-	HAL_Delay(120);
-
-	// TURN ON DISPLAY
-	writeCommand(0x29);
-/*#define ILI9341_ROTATION (MADCTL_MX | MADCTL_BGR)
-	// MADCTL
-	writeCommand(0x36);
-	{
-		
-		uint8_t data[] = { ILI9341_ROTATION };
-		WriteData(data, sizeof(data));
-	}*/
-    /*uint8_t        cmd, x, numArgs;
-    uint8_t addr = 0;
-    while((cmd = initcmd[addr++]) > 0) {
-        writeCommand(cmd);
-	    x = initcmd[addr++];
-        numArgs = x & 0x7F;
-	    while (numArgs--) spiWrite(initcmd[addr++]);
-	    if (x & 0x80) HAL_Delay(120);
-    }*/
-
-    endWrite();
-
-    _width  = ILI9341_TFTWIDTH;
-    _height = ILI9341_TFTHEIGHT;
 }
 
 
@@ -307,6 +377,7 @@ void Adafruit_ILI9341::setRotation(uint8_t m) {
     writeCommand(ILI9341_MADCTL);
     spiWrite(m);
     endWrite();
+    invalidateAddrWindow(); // Window coordinates mean something else now
 }
 
 /**************************************************************************/
@@ -335,13 +406,20 @@ void Adafruit_ILI9341::scrollTo(uint16_t y) {
 }
 
 /**************************************************************************/
-
+/*!
+    @brief   Define the hardware scroll area. Margins are in native panel
+             rows (0..319 along the long side) whatever the rotation, as
+             that's the only axis the controller can scroll.
+    @param   top     Fixed rows at the top of panel memory
+    @param   bottom  Fixed rows at the bottom of panel memory
+*/
+/**************************************************************************/
 void Adafruit_ILI9341::setScrollMargins(uint16_t top, uint16_t bottom)
 {
-  uint16_t height = _height - (top + bottom);
+  uint16_t height = ILI9341_TFTHEIGHT - (top + bottom);
 
   startWrite();
-  writeCommand(0x33);
+  writeCommand(ILI9341_VSCRDEF);
   SPI_WRITE16(top);
   SPI_WRITE16(height);
   SPI_WRITE16(bottom);
@@ -358,76 +436,159 @@ void Adafruit_ILI9341::setScrollMargins(uint16_t top, uint16_t bottom)
 */
 /**************************************************************************/
 void Adafruit_ILI9341::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
-    uint32_t xa = ((uint32_t)x << 16) | (x+w-1);
-    uint32_t ya = ((uint32_t)y << 16) | (y+h-1);
-    writeCommand(ILI9341_CASET); // Column addr set
-    SPI_WRITE32(xa);
-    writeCommand(ILI9341_PASET); // Row addr set
-    SPI_WRITE32(ya);
-    writeCommand(ILI9341_RAMWR); // write to RAM
+    setWindow(x, y, x + w - 1, y + h - 1, ILI9341_RAMWR);
 }
 
+/**************************************************************************/
+/*!
+    @brief   Set the address window by corner coordinates and open it for
+             writing or reading. Self-selecting: calls startWrite() but
+             leaves the transaction open for the pixel data that follows.
+    @param   x   Left column
+    @param   y   Top row
+    @param   w   Right column (inclusive, NOT a width)
+    @param   h   Bottom row (inclusive, NOT a height)
+    @param   RW  0 to write (RAMWR), nonzero to read (RAMRD + dummy byte)
+*/
+/**************************************************************************/
 void Adafruit_ILI9341::setAddrBlock(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t RW) {
 	startWrite();
-	// column address set
-	writeCommand(0x2A);    // CASET
-	{
-		uint8_t data[] = { (x >> 8) & 0xFF, x & 0xFF, (w >> 8) & 0xFF, w & 0xFF };
-		WriteData(data, sizeof(data));
-	}
-
-	// row address set
-	writeCommand(0x2B);    // RASET
-	{
-		uint8_t data[] = { (y >> 8) & 0xFF, y & 0xFF, (h >> 8) & 0xFF, h & 0xFF };
-		WriteData(data, sizeof(data));
-	}
 	if(RW == 0)
 		// write to RAM
-		writeCommand(0x2C);    // RAMWR
+		setWindow(x, y, w, h, ILI9341_RAMWR);
 	else
 	{
 		// read from RAM
-		writeCommand(0x2E);      // RAMRD
+		setWindow(x, y, w, h, ILI9341_RAMRD);
 		uint8_t dummy = ReadData8();     // dummy read
 	}
-		
+}
+
+/**************************************************************************/
+/*!
+    @brief   Forget the cached address window, so the next setAddrWindow()
+             sends CASET and PASET unconditionally. Call after writing
+             either register by hand or after a hardware reset.
+*/
+/**************************************************************************/
+void Adafruit_ILI9341::invalidateAddrWindow(void) {
+    _winValid = false;
+}
+
+/**************************************************************************/
+/*!
+    @brief   Program the address window, sending only what the controller
+             doesn't already have. CASET and PASET are skipped when their
+             range matches the last one sent (so e.g. a vertical run of
+             drawPixel() calls costs PASET + RAMWR per pixel, not CASET
+             too). If a RAMWR stream is still open in the same transaction,
+             the same columns are requested, and the new top row is exactly
+             where the controller's cursor has got to, nothing at all is
+             sent and the caller's pixels simply continue the stream.
+             Skipped commands are reported through bus->elided(). In
+             deferred mode the display list is flushed before the cache is
+             consulted, since flushing moves the window.
+    @param   x0   Left column
+    @param   y0   Top row
+    @param   x1   Right column (inclusive)
+    @param   y1   Bottom row (inclusive)
+    @param   cmd  ILI9341_RAMWR or ILI9341_RAMRD
+*/
+/**************************************************************************/
+void Adafruit_ILI9341::setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t cmd) {
+    flushDeferred();                 // Earlier pixels first, then the cache
+    bool sameX = _winValid && (x0 == _winX0) && (x1 == _winX1);
+
+    if(sameX && (cmd == ILI9341_RAMWR) && (_lastCommand == ILI9341_RAMWR) &&
+      !(_dataCount & 1)) {
+        uint32_t pixels = _dataCount / 2;
+        uint32_t cols   = _winX1 - _winX0 + 1;
+        if(!(pixels % cols) && (y0 == _winY0 + pixels / cols) &&
+          (y1 <= _winY1)) {
+            bus->elided(ILI9341_CASET);
+            bus->elided(ILI9341_PASET);
+            bus->elided(ILI9341_RAMWR);
+            return;
+        }
+    }
+
+    if(sameX) {
+        bus->elided(ILI9341_CASET);
+    } else {
+        writeCommand(ILI9341_CASET); // Column addr set
+        SPI_WRITE32(((uint32_t)x0 << 16) | x1);
+        _winX0 = x0;
+        _winX1 = x1;
+    }
+    if(_winValid && (y0 == _winY0) && (y1 == _winY1)) {
+        bus->elided(ILI9341_PASET);
+    } else {
+        writeCommand(ILI9341_PASET); // Row addr set
+        SPI_WRITE32(((uint32_t)y0 << 16) | y1);
+        _winY0 = y0;
+        _winY1 = y1;
+    }
+    _winValid = true;
+    writeCommand(cmd);               // Cursor back to (x0, y0)
 }
 
 uint8_t Adafruit_ILI9341::ReadData8()
 {
-	uint8_t buff[2];
-	HAL_SPI_Receive(&ILI9341_SPI_PORT, buff, 1, HAL_MAX_DELAY);
-	return buff[0];
+	return spiRead(); // Makes sure SPI is idle and in 8-bit frame mode
 }
 
+/**************************************************************************/
+/*!
+    @brief   Read pixels from an address window already opened for reading
+             with setAddrBlock(..., 1). Kept for older code; new code
+             should use readRect().
+    @param   buf  Destination, 2 bytes per pixel, big-endian RGB565
+    @param   n    Number of pixels
+*/
+/**************************************************************************/
 void Adafruit_ILI9341::readMemory(char *buf, uint16_t n)
 {
-	uint8_t red;
-	uint8_t green;
-	uint8_t blue;
-	uint16_t color;
-	int i, index = 0;
-	
-	for(i = 0 ; i < n ; i++)
-	{
-		
-		red = ReadData8();
-	
-		green= ReadData8();
-	
-		blue = ReadData8();
-		
-		color = color565(red, green, blue);
-		
-		buf[index] = (color >> 8) & 0xFF;
-		index++;
-		buf[index] = color & 0xFF;
-		index++;
-		
-		
+	while(n) {
+		uint16_t  count = (n < ILI9341_READ_PIXELS) ? n : ILI9341_READ_PIXELS;
+		uint16_t *pix   = (uint16_t *)readBuf;
+		bus->read((uint8_t *)readBuf, count * 3);
+		pack666(readBuf, pix, count); // In place, see pack666()
+		for(uint16_t i = 0 ; i < count ; i++) {
+			*buf++ = pix[i] >> 8;
+			*buf++ = pix[i] & 0xFF;
+		}
+		n -= count;
 	}
+}
+
+/**************************************************************************/
+/*!
+    @brief   Read a rectangle of display memory as native RGB565. One
+             RAMRD, then one (DMA, with the default bus) transfer per
+             ILI9341_READ_PIXELS pixels, each packed from RGB666 as soon
+             as it lands.
+    @param   x     Left column (MUST be on screen at current rotation)
+    @param   y     Top row
+    @param   w     Width (x + w MUST be within the display)
+    @param   h     Height (y + h MUST be within the display)
+    @param   dest  Destination, w * h pixels, row-major
+*/
+/**************************************************************************/
+void Adafruit_ILI9341::readRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *dest) {
+    if((w <= 0) || (h <= 0)) return;
 
+    uint32_t n = (uint32_t)w * h;
+    startWrite();
+    setWindow(x, y, x + w - 1, y + h - 1, ILI9341_RAMRD);
+    spiRead();                              // Dummy byte
+    while(n) {
+        uint32_t count = (n < ILI9341_READ_PIXELS) ? n : ILI9341_READ_PIXELS;
+        bus->read((uint8_t *)readBuf, count * 3);
+        pack666(readBuf, dest, count);
+        dest += count;
+        n    -= count;
+    }
+    endWrite();
 }
 
 /**************************************************************************/
@@ -73,6 +73,7 @@
 #define ILI9341_RAMRD      0x2E     ///< Memory Read
 
 #define ILI9341_PTLAR      0x30     ///< Partial Area
+#define ILI9341_VSCRDEF    0x33     ///< Vertical Scrolling Definition
 #define ILI9341_MADCTL     0x36     ///< Memory Access Control
 #define ILI9341_VSCRSADD   0x37     ///< Vertical Scrolling Start Address
 #define ILI9341_PIXFMT     0x3A     ///< COLMOD: Pixel Format Set
@@ -124,6 +125,15 @@
 #define ILI9341_WIDTH 320
 #define ILI9341_HEIGHT 240
 
+// Controller delays, ms: after (software) reset before SLPOUT, and after
+// SLPOUT before the next command
+#define ILI9341_RESET_MS   120      ///< SWRESET to SLPOUT
+#define ILI9341_SLPOUT_MS  120      ///< SLPOUT to next command
+
+#if !defined(ILI9341_READ_PIXELS)
+ #define ILI9341_READ_PIXELS 320 ///< readRect() pixels per RX transfer
+#endif
+
 ///< Class to manage hardware interface with ILI9341 chipset (also seems to work with ILI9340)
 class Adafruit_ILI9341 : public Adafruit_SPITFT {
     public:
@@ -131,11 +141,14 @@ class Adafruit_ILI9341 : public Adafruit_SPITFT {
         Adafruit_ILI9341(int8_t _CS, int8_t _DC, int8_t _RST = -1);
 
         void    begin(uint32_t freq=0);
+        void    beginStart(uint32_t freq=0);
+        bool    beginPoll(void);
         void    setRotation(uint8_t r);
         void    invertDisplay(bool i);
         void    scrollTo(uint16_t y);
 		uint8_t ReadData8();
 		void readMemory(char *buf, uint16_t n);
+		void    readRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t *dest);
 	
 
         void    setScrollMargins(uint16_t top, uint16_t bottom);
@@ -144,6 +157,22 @@ class Adafruit_ILI9341 : public Adafruit_SPITFT {
         void    setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h);
 		void    setAddrBlock(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint8_t RW = 0);
         uint8_t readcommand8(uint8_t reg, uint8_t index=0);
+        void    invalidateAddrWindow(void);
+
+    protected:
+        void    initRegisters(void);
+        void    setWindow(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint8_t cmd);
+
+        // Last window sent to the controller (see setWindow())
+        uint16_t _winX0 = 0, _winX1 = 0; ///< Cached CASET range
+        uint16_t _winY0 = 0, _winY1 = 0; ///< Cached PASET range
+        bool     _winValid = false;      ///< false until CASET/PASET sent
+
+        // beginStart()/beginPoll() progress
+        enum { ILI9341_INIT_IDLE, ILI9341_INIT_RESET, ILI9341_INIT_SLEEPOUT,
+               ILI9341_INIT_READY };
+        uint8_t  _initState = ILI9341_INIT_IDLE; ///< Init step reached
+        uint32_t _initTick  = 0;                 ///< When that step began
 };
 
 #endif // _ADAFRUIT_ILI9341H_
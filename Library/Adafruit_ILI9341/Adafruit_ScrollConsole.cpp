@@ -0,0 +1,195 @@
+/*!
+ * @file Adafruit_ScrollConsole.cpp
+ *
+ * Hardware-scrolled text console for the ILI9341. See
+ * Adafruit_ScrollConsole.h.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#include "Adafruit_ScrollConsole.h"
+
+#define CONSOLE_CHAR_W 6 ///< Classic font cell width incl. spacing
+#define CONSOLE_CHAR_H 8 ///< Classic font cell height
+
+/*!
+    @brief  Adafruit_ScrollConsole constructor. Nothing is drawn or
+            allocated until begin().
+    @param  tft  Display to draw on.
+*/
+Adafruit_ScrollConsole::Adafruit_ScrollConsole(Adafruit_ILI9341 *tft) :
+  _tft(tft), _line(NULL), _y0(0), _lineH(0), _lines(0), _cols(0),
+  _head(0), _col(0), _fg(0xFFFF), _bg(0x0000), _size(1), _rot(0),
+  _full(false) {
+}
+
+/*!
+    @brief  Adafruit_ScrollConsole destructor. Frees the line raster; the
+            display's scroll setup is left as is (call end() first).
+*/
+Adafruit_ScrollConsole::~Adafruit_ScrollConsole(void) {
+    delete _line;
+}
+
+/*!
+    @brief   Set up the scroll area and clear it. Coordinates are in the
+             portrait drawing rotation (display rotation & 2), where y runs
+             along the panel's 320-row axis.
+    @param   y     Top of the console.
+    @param   h     Height of the console, 0 for the rest of the panel.
+                   Rounded down to whole text lines.
+    @param   size  Text magnification.
+    @param   fg    Text color.
+    @param   bg    Background color.
+    @return  true on success, false if fewer than two lines fit or the line
+             raster could not be allocated.
+*/
+bool Adafruit_ScrollConsole::begin(int16_t y, int16_t h, uint8_t size,
+  uint16_t fg, uint16_t bg) {
+    if(!size) size = 1;
+    if((y < 0) || (y >= ILI9341_TFTHEIGHT)) return false;
+    if((h <= 0) || (y + h > ILI9341_TFTHEIGHT)) h = ILI9341_TFTHEIGHT - y;
+
+    _rot   = _tft->getRotation() & 2;
+    _y0    = y;
+    _size  = size;
+    _fg    = fg;
+    _bg    = bg;
+    _lineH = CONSOLE_CHAR_H * size;
+    _lines = h / _lineH;
+    _cols  = ILI9341_TFTWIDTH / (CONSOLE_CHAR_W * size);
+    if((_lines < 2) || !_cols) {
+        _lines = 0;
+        return false;
+    }
+
+    // Glyphs are rasterized at size 1; drawLine() scales while expanding
+    delete _line;
+    _line = new GFXcanvas1(_cols * CONSOLE_CHAR_W, CONSOLE_CHAR_H);
+    if(!_line || !_line->getBuffer()) {
+        _lines = 0;
+        return false;
+    }
+    _line->setTextWrap(false);
+
+    uint16_t v   = _lines * _lineH;
+    uint16_t top = (_rot == 0) ? _y0 : ILI9341_TFTHEIGHT - _y0 - v;
+    _tft->setScrollMargins(top, ILI9341_TFTHEIGHT - top - v);
+    clear();
+    return true;
+}
+
+/*!
+    @brief  Give the whole panel back: scroll area reset to all 320 rows
+            at offset 0. Whatever was in the console stays in panel memory
+            (un-scrolled), so the caller normally redraws the screen next.
+*/
+void Adafruit_ScrollConsole::end(void) {
+    if(!_lines) return;
+    _tft->setScrollMargins(0, 0);
+    _tft->scrollTo(0);
+    delete _line;
+    _line  = NULL;
+    _lines = 0;
+}
+
+/*!
+    @brief  Blank the console and start again from its first line.
+*/
+void Adafruit_ScrollConsole::clear(void) {
+    if(!_lines) return;
+    uint8_t r = _tft->getRotation();
+    if(r != _rot) _tft->setRotation(_rot);
+    _tft->fillRect(0, _y0, ILI9341_TFTWIDTH, _lines * _lineH, _bg);
+    if(r != _rot) _tft->setRotation(r);
+
+    _line->fillScreen(0);
+    _head = 0;
+    _col  = 0;
+    _full = false;
+    scroll();
+}
+
+/*!
+    @brief  Show the line being typed now rather than at its newline. It's
+            drawn again (in the same place) when it completes.
+*/
+void Adafruit_ScrollConsole::flush(void) {
+    if(_lines && _col) drawLine();
+}
+
+/*!
+    @brief   Print one character. '\n' ends the line, '\r' is ignored and
+             lines longer than columns() wrap.
+    @param   c  Character.
+    @return  1 (the character is always accepted).
+*/
+size_t Adafruit_ScrollConsole::write(uint8_t c) {
+    if(!_lines) return 1;
+    if(c == '\n') {
+        newLine();
+    } else if(c != '\r') {
+        if(_col >= _cols) newLine();
+        _line->drawChar(_col * CONSOLE_CHAR_W, 0, c, 1, 0, 1);
+        _col++;
+    }
+    return 1;
+}
+
+/*!
+    @brief  Commit the current line to its slot and move on to the next,
+            which is the oldest line once the area has filled.
+*/
+void Adafruit_ScrollConsole::newLine(void) {
+    drawLine();
+    if(++_head >= _lines) _head = 0;
+    _line->fillScreen(0);
+    _col = 0;
+}
+
+/*!
+    @brief  Draw the line raster into slot _head as a single window: each
+            raster row is expanded to fg/bg once and sent _size times, so
+            the whole line is one RAMWR of 240 x _lineH pixels. Then scroll
+            so that slot is the bottom line.
+*/
+void Adafruit_ScrollConsole::drawLine(void) {
+    const uint8_t *bits   = _line->getBuffer();
+    uint16_t       stride = (_line->width() + 7) / 8;
+    uint16_t       cw     = _line->width();
+    uint8_t        r      = _tft->getRotation();
+
+    if(r != _rot) _tft->setRotation(_rot);
+    _tft->startWrite();
+    _tft->setAddrWindow(0, _y0 + _head * _lineH, ILI9341_TFTWIDTH, _lineH);
+    for(uint8_t row=0; row<CONSOLE_CHAR_H; row++) {
+        const uint8_t *src = &bits[row * stride];
+        uint16_t x = 0;
+        for(uint16_t cx=0; cx<cw; cx++) {
+            uint16_t color = (src[cx >> 3] & (0x80 >> (cx & 7))) ? _fg : _bg;
+            for(uint8_t i=0; i<_size; i++) _rowBuf[x++] = color;
+        }
+        while(x < ILI9341_TFTWIDTH) _rowBuf[x++] = _bg;
+        for(uint8_t i=0; i<_size; i++) {
+            _tft->writePixels(_rowBuf, ILI9341_TFTWIDTH,
+              (row == CONSOLE_CHAR_H - 1) && (i == _size - 1));
+        }
+    }
+    _tft->endWrite();
+    if(r != _rot) _tft->setRotation(r);
+
+    if(_head == _lines - 1) _full = true;
+    if(_full) scroll();
+}
+
+/*!
+    @brief  Point VSCRSADD at the oldest line so the newest drawn slot sits
+            at the bottom of the area. Before the area first fills nothing
+            moves. Rotation 2 runs the slots backwards through panel memory.
+*/
+void Adafruit_ScrollConsole::scroll(void) {
+    uint16_t v   = _lines * _lineH;
+    uint16_t k   = _full ? ((_head + 1) % _lines) * _lineH : 0;
+    uint16_t top = (_rot == 0) ? _y0 : ILI9341_TFTHEIGHT - _y0 - v;
+    _tft->scrollTo(top + ((_rot == 0) ? k : (v - k) % v));
+}
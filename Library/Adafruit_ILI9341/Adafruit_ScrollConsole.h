@@ -0,0 +1,75 @@
+/*!
+ * @file Adafruit_ScrollConsole.h
+ *
+ * Text log console on the ILI9341's hardware vertical scroll. Each new line
+ * overwrites the oldest line of the scroll area in panel memory and then
+ * moves VSCRSADD, so appending a line costs one line of pixels on the wire
+ * instead of a full-region redraw.
+ *
+ * The controller only scrolls along the panel's native 320-row axis. In
+ * portrait rotations (0, 2) that's the user's vertical and the console
+ * behaves as expected; in landscape (1, 3) the console draws in the
+ * matching portrait rotation (rotation & 2) for the duration of each line,
+ * so on screen its text runs along the short side, rotated 90 degrees from
+ * the rest of the UI. The display's rotation is restored after every line.
+ *
+ * BSD license, all text here must be included in any redistribution.
+ */
+
+#ifndef _ADAFRUIT_SCROLLCONSOLE_H_
+#define _ADAFRUIT_SCROLLCONSOLE_H_
+
+#include "Adafruit_ILI9341.h"
+
+/*!
+  @brief  Scrolling text console using the classic 6x8 GFX font.
+*/
+class Adafruit_ScrollConsole : public Print {
+
+  public:
+
+    Adafruit_ScrollConsole(Adafruit_ILI9341 *tft);
+    ~Adafruit_ScrollConsole(void);
+
+    bool         begin(int16_t y = 0, int16_t h = 0, uint8_t size = 1,
+                   uint16_t fg = 0xFFFF, uint16_t bg = 0x0000);
+    void         end(void);
+    void         clear(void);
+    void         flush(void);
+
+    size_t       write(uint8_t c);
+    using Print::write;
+
+    /*!
+        @brief   Number of text lines the scroll area holds.
+        @return  Line count, 0 before begin().
+    */
+    uint16_t     lines(void) const { return _lines; }
+    /*!
+        @brief   Number of characters that fit on one line.
+        @return  Column count, 0 before begin().
+    */
+    uint16_t     columns(void) const { return _cols; }
+
+  private:
+
+    void         newLine(void);
+    void         drawLine(void);
+    void         scroll(void);
+
+    Adafruit_ILI9341 *_tft;   ///< Display the console draws on
+    GFXcanvas1 *_line;        ///< 1-bit raster of the line being typed
+    uint16_t  _rowBuf[ILI9341_TFTWIDTH]; ///< One expanded pixel row
+    int16_t   _y0;            ///< Top of scroll area, drawing rotation
+    uint16_t  _lineH;         ///< Pixel height of one text line
+    uint16_t  _lines;         ///< Lines in the scroll area
+    uint16_t  _cols;          ///< Characters per line
+    uint16_t  _head;          ///< Slot the current line is drawn into
+    uint16_t  _col;           ///< Characters on the current line
+    uint16_t  _fg, _bg;       ///< Text colors
+    uint8_t   _size;          ///< Text magnification
+    uint8_t   _rot;           ///< Drawing rotation (0 or 2)
+    bool      _full;          ///< Every slot has been used once
+};
+
+#endif // _ADAFRUIT_SCROLLCONSOLE_H_
@@ -510,12 +510,11 @@ ImageReturnCode Adafruit_ImageReader::coreBMP(
 #endif
                       if(transact) tft->startWrite(); // Start TFT SPI transact
                       if(destidx) {                   // If buffered TFT data
-                        // Non-blocking writes (DMA) have been temporarily
-                        // disabled until this can be rewritten with two
-                        // alternating 'dest' buffers (else the nonblocking
-                        // data out is overwritten in the dest[] write below).
-                        //tft->writePixels(dest, destidx, false); // Write it
-                        tft->writePixels(dest, destidx, true); // Write it
+                        // Non-blocking is safe here: writePixels() copies
+                        // dest[] into its own ping-pong DMA buffers before
+                        // returning, so the next dest[] fill overlaps the
+                        // transfer of this one.
+                        tft->writePixels(dest, destidx, false); // Write it
                         destidx = 0;                  // and reset dest index
                       }
                     } else {                          // Canvas is simpler,
@@ -558,8 +557,7 @@ ImageReturnCode Adafruit_ImageReader::coreBMP(
                 if(tft) {                            // Drawing to TFT?
                   if(destidx) {                      // Any remainders?
                     // See notes above re: DMA
-                    //tft->writePixels(dest, destidx, false); // Write it
-                    tft->writePixels(dest, destidx, true); // Write it
+                    tft->writePixels(dest, destidx, false); // Write it
                     destidx = 0;                     // and reset dest index
                   }
                   tft->dmaWait();
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+# addrst.py in.jpg out.jpg interval  -- re-encode a baseline JPEG's entropy
+# data with a DRI of `interval` MCUs (RSTn markers, DC predictors reset).
+import sys, struct
+src = open(sys.argv[1], 'rb').read(); interval = int(sys.argv[3])
+def segs(d):
+    i = 2; out = []
+    while i < len(d):
+        assert d[i] == 0xFF; m = d[i+1]
+        if m == 0xDA:
+            L = struct.unpack('>H', d[i+2:i+4])[0]
+            out.append((m, d[i+4:i+2+L])); i += 2 + L
+            j = i
+            while True:
+                if d[j] == 0xFF and d[j+1] != 0 and not (0xD0 <= d[j+1] <= 0xD7): break
+                j += 1
+            out.append(('scan', d[i:j])); i = j
+        elif m == 0xD9: out.append((m, b'')); break
+        else:
+            L = struct.unpack('>H', d[i+2:i+4])[0]; out.append((m, d[i+4:i+2+L])); i += 2 + L
+    return out
+S = segs(src)
+huff = {}; comps = []; 
+for m, p in S:
+    if m == 0xC4:
+        k = 0
+        while k < len(p):
+            tc = p[k]; counts = p[k+1:k+17]; vals = p[k+17:k+17+sum(counts)]; k += 17 + sum(counts)
+            code = 0; tab = {}; enc = {}; v = 0
+            for l in range(16):
+                for _ in range(counts[l]):
+                    tab[(l+1, code)] = vals[v]; enc[vals[v]] = (l+1, code); v += 1; code += 1
+                code <<= 1
+            huff[tc] = (tab, enc)
+    if m == 0xC0:
+        n = p[5]; comps = [(p[6+3*i], p[7+3*i] >> 4, p[7+3*i] & 15) for i in range(n)]
+        W = struct.unpack('>H', p[3:5])[0]; H = struct.unpack('>H', p[1:3])[0]
+    if m == 0xDA:
+        ns = p[0]; scomp = [(p[1+2*i], p[2+2*i] >> 4, p[2+2*i] & 15) for i in range(ns)]
+    if m == 'scan': scan = p
+# unstuff
+data = scan.replace(b'\xff\x00', b'\xff')
+bits = ''.join(format(b, '08b') for b in data); pos = 0
+def dec(tc):
+    global pos
+    tab = huff[tc][0]; code = 0
+    for l in range(1, 17):
+        code = (code << 1) | (bits[pos] == '1'); pos += 1
+        if (l, code) in tab: return tab[(l, code)]
+    raise Exception('bad code')
+def rd(n):
+    global pos
+    v = int(bits[pos:pos+n], 2) if n else 0; pos += n; return v
+def ext(v, s): return v - (1 << s) + 1 if s and v < (1 << (s-1)) else v
+hmax = max(c[1] for c in comps); vmax = max(c[2] for c in comps)
+mcux = (W + 8*hmax - 1) // (8*hmax); mcuy = (H + 8*vmax - 1) // (8*vmax)
+if len(scomp) == 1: hmax = vmax = 1; mcux = (W+7)//8; mcuy = (H+7)//8
+blocks = []
+for cid, td, ta in scomp:
+    c = [c for c in comps if c[0] == cid][0]
+    n = c[1]*c[2] if len(scomp) > 1 else 1
+    blocks += [(cid, td, ta)] * n
+# decode all MCUs to (dc absolute, ac symbol list)
+mcus = []; pred = {}
+for _ in range(mcux*mcuy):
+    mb = []
+    for cid, td, ta in blocks:
+        s = dec(td); dc = pred.get(cid, 0) + ext(rd(s), s); pred[cid] = dc
+        acs = []; k = 1
+        while k < 64:
+            rs = dec(0x10 | ta); r, s = rs >> 4, rs & 15
+            acs.append((rs, rd(s), s))
+            if s == 0 and r != 15: break
+            k += r + 1
+        mb.append((cid, td, ta, dc, acs))
+    mcus.append(mb)
+# re-encode
+out = []; cur = []
+def put(code, n):
+    for i in range(n-1, -1, -1): cur.append('1' if (code >> i) & 1 else '0')
+def flush():
+    global cur
+    while len(cur) % 8: cur.append('1')
+    b = bytes(int(''.join(cur[i:i+8]), 2) for i in range(0, len(cur), 8)); cur = []
+    return b.replace(b'\xff', b'\xff\x00')
+pred = {}; body = b''; rst = 0
+for i, mb in enumerate(mcus):
+    if interval and i and i % interval == 0:
+        body += flush() + bytes([0xFF, 0xD0 + rst]); rst = (rst + 1) & 7; pred = {}
+    for cid, td, ta, dc, acs in mb:
+        d = dc - pred.get(cid, 0); pred[cid] = dc
+        s = abs(d).bit_length(); v = d if d >= 0 else d + (1 << s) - 1
+        l, c = huff[td][1][s]; put(c, l); put(v, s)
+        for rs, v, s in acs:
+            l, c = huff[0x10 | ta][1][rs]; put(c, l); put(v, s)
+body += flush()
+res = src[:2]
+for m, p in S:
+    if m == 'scan': res += body
+    elif m == 0xDA:
+        if interval: res += b'\xff\xdd' + struct.pack('>HH', 4, interval)
+        res += b'\xff\xda' + struct.pack('>H', len(p)+2) + p
+    elif m == 0xDD: continue
+    elif m == 0xD9: res += b'\xff\xd9'
+    else: res += bytes([0xFF, m]) + struct.pack('>H', len(p)+2) + p
+open(sys.argv[2], 'wb').write(res)
+print(sys.argv[2], 'MCUs', len(mcus), 'interval', interval, 'bytes', len(res))
@@ -0,0 +1,71 @@
+//------------------------------------------------------------------------------
+// bench_decode.c - Decode time of each JPEG in reference.txt at every output
+// size, the best of several runs, and the totals. Nothing is checked here;
+// test_picojpeg does that. `make bench SRC=<dir>` times another picojpeg.c,
+// e.g. an older one, for comparison. Before the reduced IDCTs only full size
+// and 1/8 existed, so only those columns compare.
+//------------------------------------------------------------------------------
+#include "host_jpeg.h"
+
+#define RUNS 5
+//------------------------------------------------------------------------------
+// Best time of RUNS whole decodes of the current JPEG, in ms
+static double decodeTime(unsigned char reduce)
+{
+   double best = 0;
+   int run;
+   for (run = 0; run < RUNS; run++)
+   {
+      pjpeg_image_info_t info;
+      double t = seconds();
+      unsigned char status = beginJPEG(&info, reduce);
+      while (!status)
+         status = pjpeg_decode_mcu();
+      t = (seconds() - t) * 1000.0;
+      if ((run == 0) || (t < best))
+         best = t;
+   }
+   return best;
+}
+//------------------------------------------------------------------------------
+int main(void)
+{
+   // PJPG_REDUCE_NONE, _1_2, _1_4, _1_8; numbers so older picojpeg.h builds
+   static const unsigned char reduces[4] = { 0, 2, 3, 1 };
+   FILE *pRef = fopen("reference.txt", "r");
+   char line[512], name[400], last[400] = "";
+   double total[4] = { 0, 0, 0, 0 };
+   int i;
+
+   if (!pRef)
+   {
+      printf("can't open reference.txt\n");
+      return 1;
+   }
+   printf("%-44s %9s %9s %9s %9s\n", "ms, best of 5", "full", "1/2", "1/4", "1/8");
+   while (fgets(line, sizeof(line), pRef))
+   {
+      int reduce;
+      unsigned long mcus;
+      unsigned long long hash;
+      const char *pBase;
+
+      if ((line[0] == '#') || (sscanf(line, "%d %lu %llx %399[^\n]", &reduce, &mcus, &hash, name) != 4))
+         continue;
+      if ((reduce != 0) || !strcmp(name, last) || !loadJPEG(name))
+         continue;
+      strcpy(last, name);
+      pBase = strrchr(name, '/') ? strrchr(name, '/') + 1 : name;
+      printf("%-44s", pBase);
+      for (i = 0; i < 4; i++)
+      {
+         double t = decodeTime(reduces[i]);
+         total[i] += t;
+         printf(" %9.3f", t);
+      }
+      printf("\n");
+   }
+   fclose(pRef);
+   printf("%-44s %9.3f %9.3f %9.3f %9.3f\n", "total", total[0], total[1], total[2], total[3]);
+   return 0;
+}
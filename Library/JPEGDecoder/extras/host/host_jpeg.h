@@ -0,0 +1,100 @@
+//------------------------------------------------------------------------------
+// host_jpeg.h - Helpers shared by the picojpeg host tests: a file loaded into
+// memory and fed to pjpeg_decode_init() through the need-bytes callback, a
+// hash of the MCU buffers, a CHECK() that counts failures and a clock.
+//------------------------------------------------------------------------------
+#ifndef HOST_JPEG_H
+#define HOST_JPEG_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "picojpeg.h"
+//------------------------------------------------------------------------------
+static int gFailures;
+
+#define CHECK(cond) \
+   do { \
+      if (!(cond)) { \
+         printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+         gFailures++; \
+      } \
+   } while (0)
+//------------------------------------------------------------------------------
+// The JPEG being decoded; gPos is the next byte the callback hands out
+static unsigned char *gData;
+static unsigned long gSize, gPos;
+
+static inline unsigned char needBytes(unsigned char *pBuf, unsigned char buf_size, unsigned char *pBytes_actually_read, void *pCallback_data)
+{
+   unsigned long n = gSize - gPos;
+   (void)pCallback_data;
+   if (n > buf_size)
+      n = buf_size;
+   memcpy(pBuf, gData + gPos, n);
+   gPos += n;
+   *pBytes_actually_read = (unsigned char)n;
+   return 0;
+}
+//------------------------------------------------------------------------------
+// Load a file as the current JPEG; 0 if it can't be read
+static inline int loadJPEG(const char *pName)
+{
+   FILE *f = fopen(pName, "rb");
+   long size;
+   free(gData);
+   gData = NULL;
+   gSize = gPos = 0;
+   if (!f)
+      return 0;
+   fseek(f, 0, SEEK_END);
+   size = ftell(f);
+   fseek(f, 0, SEEK_SET);
+   gData = (unsigned char *)malloc(size > 0 ? size : 1);
+   if (fread(gData, 1, size, f) != (size_t)size)
+      size = 0;
+   fclose(f);
+   gSize = size;
+   return size > 0;
+}
+//------------------------------------------------------------------------------
+// Start decoding the current JPEG from its first byte
+static inline unsigned char beginJPEG(pjpeg_image_info_t *pInfo, unsigned char reduce)
+{
+   gPos = 0;
+   return pjpeg_decode_init(pInfo, needBytes, NULL, reduce);
+}
+//------------------------------------------------------------------------------
+// FNV-1a over all three 256-byte MCU buffers, continuing from hash
+static inline unsigned long long hashMCU(const pjpeg_image_info_t *pInfo, unsigned long long hash)
+{
+   const unsigned char *pBuf[3] = { pInfo->m_pMCUBufR, pInfo->m_pMCUBufG, pInfo->m_pMCUBufB };
+   int c, i;
+   for (c = 0; c < 3; c++)
+   {
+      for (i = 0; i < 256; i++)
+      {
+         hash ^= pBuf[c][i];
+         hash *= 1099511628211ULL;
+      }
+   }
+   return hash;
+}
+
+#define HASH_START 1469598103934665603ULL
+//------------------------------------------------------------------------------
+static inline double seconds(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + t.tv_nsec * 1e-9;
+}
+//------------------------------------------------------------------------------
+static inline int testResult(const char *pName)
+{
+   printf("%s: %s\n", pName, gFailures ? "FAILED" : "ok");
+   return gFailures ? 1 : 0;
+}
+
+#endif
@@ -0,0 +1,130 @@
+//------------------------------------------------------------------------------
+// test_checkpoint.c - Random access as JPEGDecoder's index uses it: for every
+// full size JPEG in reference.txt, an indexing pass records a checkpoint at
+// the start of each MCU row (pjpeg_skip_restart_interval(), i.e. skipToMarker(),
+// in files with restart markers, pjpeg_skip_mcu() otherwise), then every row
+// is decoded again from a fresh pjpeg_decode_init() and its checkpoint. Each
+// MCU must match the same MCU of a whole decode.
+//------------------------------------------------------------------------------
+#include "host_jpeg.h"
+//------------------------------------------------------------------------------
+// Resume every row of the current JPEG from its checkpoint; returns the number
+// of MCUs that differ from a whole decode, or -1 if something failed
+static long checkRows(const char *pName)
+{
+   pjpeg_image_info_t info;
+   pjpeg_checkpoint_t *pRow;
+   unsigned long long *pRef;
+   unsigned long *pRowMCU;
+   unsigned long mcu, total, interval;
+   long bad = 0;
+   double tWhole, tIndex;
+   int per, rows, r;
+   unsigned char status;
+
+   if (beginJPEG(&info, PJPG_REDUCE_NONE))
+      return -1;
+   per = info.m_MCUSPerRow;
+   rows = info.m_MCUSPerCol;
+   total = (unsigned long)per * rows;
+   interval = info.m_restartInterval;
+   pRef = (unsigned long long *)malloc(total * sizeof(*pRef));
+   pRow = (pjpeg_checkpoint_t *)malloc(rows * sizeof(*pRow));
+   pRowMCU = (unsigned long *)malloc(rows * sizeof(*pRowMCU));
+
+   // Whole decode, for reference
+   tWhole = seconds();
+   for (mcu = 0, status = 0; (mcu < total) && !status; mcu++)
+   {
+      status = pjpeg_decode_mcu();
+      pRef[mcu] = hashMCU(&info, HASH_START);
+   }
+   tWhole = seconds() - tWhole;
+
+   // Index pass, as JPEGDecoder::indexSdFile()
+   tIndex = seconds();
+   if (!status)
+      status = beginJPEG(&info, PJPG_REDUCE_NONE);
+   for (r = 0, mcu = 0; (r < rows) && !status; r++)
+   {
+      unsigned long first = (unsigned long)r * per;
+      if (interval)
+      {
+         while ((mcu + interval <= first) && !(status = pjpeg_skip_restart_interval()))
+            mcu += interval;
+      }
+      else
+      {
+         while ((mcu < first) && !(status = pjpeg_skip_mcu()))
+            mcu++;
+      }
+      pjpeg_get_checkpoint(&pRow[r]);
+      pRowMCU[r] = mcu;
+   }
+   tIndex = seconds() - tIndex;
+
+   // Each row from its checkpoint, as JPEGDecoder::seekIndex()
+   for (r = 0; (r < rows) && !status; r++)
+   {
+      if ((status = beginJPEG(&info, PJPG_REDUCE_NONE)))
+         break;
+      pjpeg_set_checkpoint(&pRow[r]);
+      gPos = pRow[r].m_ofs;
+      for (mcu = pRowMCU[r]; (mcu < (unsigned long)r * per) && !status; mcu++)
+         status = pjpeg_skip_mcu();
+      for (; (mcu < (unsigned long)(r + 1) * per) && !status; mcu++)
+      {
+         status = pjpeg_decode_mcu();
+         if (!status && (hashMCU(&info, HASH_START) != pRef[mcu]))
+            bad++;
+      }
+   }
+
+   printf("%-20s %4dx%-4d DRI %-3lu %3d rows: whole %7.2f ms, index %6.2f ms, %ld MCUs differ\n",
+      strrchr(pName, '/') ? strrchr(pName, '/') + 1 : pName, info.m_width, info.m_height,
+      interval, rows, tWhole * 1000.0, tIndex * 1000.0, bad);
+   free(pRef);
+   free(pRow);
+   free(pRowMCU);
+   return status ? -1 : bad;
+}
+//------------------------------------------------------------------------------
+int main(void)
+{
+   FILE *pRef = fopen("reference.txt", "r");
+   char line[512], name[400], last[400] = "";
+   int files = 0, restarts = 0;
+
+   if (!pRef)
+   {
+      printf("can't open reference.txt\n");
+      return 1;
+   }
+   while (fgets(line, sizeof(line), pRef))
+   {
+      int reduce;
+      unsigned long mcus;
+      unsigned long long hash;
+
+      if ((line[0] == '#') || (sscanf(line, "%d %lu %llx %399[^\n]", &reduce, &mcus, &hash, name) != 4))
+         continue;
+      if ((reduce != PJPG_REDUCE_NONE) || !strcmp(name, last))
+         continue;
+      strcpy(last, name);
+      if (!loadJPEG(name))
+      {
+         printf("FAIL can't read %s\n", name);
+         gFailures++;
+         continue;
+      }
+      CHECK(checkRows(name) == 0);
+      if (strstr(name, "dri/"))
+         restarts++;
+      files++;
+   }
+   fclose(pRef);
+
+   printf("%d files resumed at every row, %d with restart markers\n", files, restarts);
+   CHECK(restarts > 0);
+   return testResult("test_checkpoint");
+}
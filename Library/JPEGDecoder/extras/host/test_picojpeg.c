@@ -0,0 +1,77 @@
+//------------------------------------------------------------------------------
+// test_picojpeg.c - Decodes every JPEG listed in reference.txt and checks the
+// MCU buffers hash the same as recorded. The hashes were recorded with the
+// original picojpeg (before the lookup-table Huffman decoder), so full size
+// and 1/8 decodes must stay bit-exact with it. The dri/ fixtures are two of
+// the samples re-encoded by addrst.py with restart intervals of 1, 7 and 20
+// MCUs; they must decode exactly as the samples do.
+//
+// ./test_picojpeg -w prints reference.txt again with the hashes of this
+// build, e.g. to add a file.
+//------------------------------------------------------------------------------
+#include "host_jpeg.h"
+//------------------------------------------------------------------------------
+int main(int argc, char **argv)
+{
+   int write = (argc > 1) && !strcmp(argv[1], "-w");
+   FILE *pRef = fopen("reference.txt", "r");
+   char line[512], name[400];
+   int files = 0;
+
+   if (!pRef)
+   {
+      printf("can't open reference.txt\n");
+      return 1;
+   }
+   while (fgets(line, sizeof(line), pRef))
+   {
+      unsigned long long want, hash = HASH_START;
+      unsigned long wantMCUs, mcus = 0;
+      int reduce;
+      pjpeg_image_info_t info;
+      unsigned char status;
+
+      if ((line[0] == '#') || (sscanf(line, "%d %lu %llx %399[^\n]", &reduce, &wantMCUs, &want, name) != 4))
+      {
+         if (write)
+            fputs(line, stdout);
+         continue;
+      }
+      if (!loadJPEG(name))
+      {
+         printf("FAIL can't read %s\n", name);
+         gFailures++;
+         continue;
+      }
+
+      status = beginJPEG(&info, (unsigned char)reduce);
+      while (!status)
+      {
+         status = pjpeg_decode_mcu();
+         if (!status)
+         {
+            hash = hashMCU(&info, hash);
+            mcus++;
+         }
+      }
+
+      if (write)
+      {
+         printf("%d %lu %016llx %s\n", reduce, mcus, hash, name);
+         continue;
+      }
+      if ((status != PJPG_NO_MORE_BLOCKS) || (mcus != wantMCUs) || (hash != want))
+      {
+         printf("FAIL %s at reduce %d: status %d, %lu MCUs, hash %016llx\n", name, reduce, status, mcus, hash);
+         gFailures++;
+      }
+      files++;
+   }
+   fclose(pRef);
+   if (write)
+      return 0;
+
+   printf("%d decodes checked\n", files);
+   CHECK(files > 0);
+   return testResult("test_picojpeg");
+}
@@ -39,14 +39,70 @@ Bodmer (24/1/17): Correct greyscale images, update examples
 #include "JPEGDecoder.h"
 #include "picojpeg.h"
 
-#define SWAP_BYTES
+// read() returns native RGB565; the display driver sends pixel data as 16-bit
+// SPI frames (USE_SPI_16BIT_PIXELS) so no byte swap is needed here.
+//#define SWAP_BYTES
 
 JPEGDecoder JpegDec;
 
+// Random access index (indexSdFile()): this header, then an entry for each
+// MCU row. An entry is the decoder's checkpoint at the row's first MCU or, in
+// a file with restart markers, at the start of the restart interval the row
+// starts in: those are found without decoding anything.
+#define JPEG_INDEX_MAGIC 0x3258494AUL // "JIX2"
+
+// Bytes of the JPEG in its fingerprint (see fingerprintSdFile()): before the
+// scan, from its start, and at the end of the file
+#define JPEG_INDEX_HEAD 1024
+#define JPEG_INDEX_SCAN 256
+#define JPEG_INDEX_TAIL 256
+
+typedef struct {
+	uint32_t magic;
+	uint32_t fileSize;				// Of the JPEG, to spot a stale index
+	uint32_t fingerprint;			// And a CRC-32 of parts of it
+	uint16_t MCUSPerRow;
+	uint16_t MCUSPerCol;
+	uint16_t entrySize;
+	uint16_t restartInterval;
+} jpeg_index_header_t;
+
+typedef struct {
+	uint32_t mcu;					// MCU number the checkpoint is before
+	pjpeg_checkpoint_t checkpoint;
+} jpeg_index_entry_t;
+
+static void indexHeader(jpeg_index_header_t *header, uint32_t fileSize, uint32_t fingerprint, const pjpeg_image_info_t *info) {
+	header->magic = JPEG_INDEX_MAGIC;
+	header->fileSize = fileSize;
+	header->fingerprint = fingerprint;
+	header->MCUSPerRow = info->m_MCUSPerRow;
+	header->MCUSPerCol = info->m_MCUSPerCol;
+	header->entrySize = sizeof(jpeg_index_entry_t);
+	header->restartInterval = info->m_restartInterval;
+}
+
+// CRC-32 (IEEE), continuing from crc: 0 to start
+uint32_t jpegCRC32(uint32_t crc, const uint8_t *pBuf, uint32_t len) {
+	crc = ~crc;
+	while (len--) {
+		crc ^= *pBuf++;
+		for (int k = 0; k < 8; k++)
+			crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+	}
+	return ~crc;
+}
+
 JPEGDecoder::JPEGDecoder(){
 	mcu_x = 0 ;
 	mcu_y = 0 ;
 	is_available = 0;
+	jpg_scale = JPEG_SCALE_1;
+	fit_width = 0;
+	fit_height = 0;
+	crop_w = 0;
+	crop_h = 0;
+	index_name = NULL;
 	thisPtr = this;
 }
 
@@ -93,7 +149,30 @@ uint8_t JPEGDecoder::pjpeg_need_bytes_callback(uint8_t* pBuf, uint8_t buf_size,
 
 int JPEGDecoder::decode_mcu(void) {
 
-	status = pjpeg_decode_mcu();
+	// Stop after the crop's last MCU: the rest of its row and the rows below
+	// aren't even entropy decoded
+	if (mcu_y > crop_mcu_y1 || (mcu_y == crop_mcu_y1 && mcu_x > crop_mcu_x1)) {
+		is_available = 0;
+		return 1;
+	}
+
+	// Entropy decode past the MCUs outside the crop
+	status = 0;
+	while (!status && mcu_y <= crop_mcu_y1 &&
+		   (mcu_y < crop_mcu_y0 || mcu_x < crop_mcu_x0 || mcu_x > crop_mcu_x1)) {
+		status = pjpeg_skip_mcu();
+		mcu_x++;
+		if (mcu_x == image_info.m_MCUSPerRow) {
+			mcu_x = 0;
+			mcu_y++;
+		}
+	}
+	if (mcu_y > crop_mcu_y1) {
+		is_available = 0;
+		return 1;
+	}
+	if (!status)
+		status = pjpeg_decode_mcu();
 
 	if (status) {
 		is_available = 0 ;
@@ -113,6 +192,7 @@ int JPEGDecoder::decode_mcu(void) {
 
 int JPEGDecoder::read(void) {
 	int y, x;
+	const int block = 8 >> jpg_scale; // Pixels per 8x8 block side at this scale
 	uint16_t *pDst_row;
 
 	if(is_available == 0 || mcu_y >= image_info.m_MCUSPerCol) {
@@ -122,20 +202,20 @@ int JPEGDecoder::read(void) {
 	
 	// Copy MCU's pixel blocks into the destination bitmap.
 	pDst_row = pImage;
-	for (y = 0; y < image_info.m_MCUHeight; y += 8) {
+	for (y = 0; y < MCUHeight; y += block) {
 
-		const int by_limit = jpg_min(8, image_info.m_height - (mcu_y * image_info.m_MCUHeight + y));
+		const int by_limit = jpg_min(block, (int)decoded_height - (mcu_y * MCUHeight + y));
 
-		for (x = 0; x < image_info.m_MCUWidth; x += 8) {
+		for (x = 0; x < MCUWidth; x += block) {
 			uint16_t *pDst_block = pDst_row + x;
 
 			// Compute source byte offset of the block in the decoder's MCU buffer.
-			uint src_ofs = (x * 8U) + (y * 16U);
+			uint src_ofs = ((x << jpg_scale) * 8U) + ((y << jpg_scale) * 16U);
 			const uint8_t *pSrcR = image_info.m_pMCUBufR + src_ofs;
 			const uint8_t *pSrcG = image_info.m_pMCUBufG + src_ofs;
 			const uint8_t *pSrcB = image_info.m_pMCUBufB + src_ofs;
 
-			const int bx_limit = jpg_min(8, image_info.m_width - (mcu_x * image_info.m_MCUWidth + x));
+			const int bx_limit = jpg_min(block, (int)decoded_width - (mcu_x * MCUWidth + x));
 
 			if (image_info.m_scanType == PJPG_GRAYSCALE) {
 				int bx, by;
@@ -178,7 +258,7 @@ int JPEGDecoder::read(void) {
 				}
 			}
 		}
-		pDst_row += (row_pitch * 8);
+		pDst_row += (row_pitch * block);
 	}
 
 	MCUx = mcu_x;
@@ -197,6 +277,7 @@ int JPEGDecoder::read(void) {
 
 int JPEGDecoder::readSwappedBytes(void) {
 	int y, x;
+	const int block = 8 >> jpg_scale; // Pixels per 8x8 block side at this scale
 	uint16_t *pDst_row;
 
 	if(is_available == 0 || mcu_y >= image_info.m_MCUSPerCol) {
@@ -206,20 +287,20 @@ int JPEGDecoder::readSwappedBytes(void) {
 	
 	// Copy MCU's pixel blocks into the destination bitmap.
 	pDst_row = pImage;
-	for (y = 0; y < image_info.m_MCUHeight; y += 8) {
+	for (y = 0; y < MCUHeight; y += block) {
 
-		const int by_limit = jpg_min(8, image_info.m_height - (mcu_y * image_info.m_MCUHeight + y));
+		const int by_limit = jpg_min(block, (int)decoded_height - (mcu_y * MCUHeight + y));
 
-		for (x = 0; x < image_info.m_MCUWidth; x += 8) {
+		for (x = 0; x < MCUWidth; x += block) {
 			uint16_t *pDst_block = pDst_row + x;
 
 			// Compute source byte offset of the block in the decoder's MCU buffer.
-			uint src_ofs = (x * 8U) + (y * 16U);
+			uint src_ofs = ((x << jpg_scale) * 8U) + ((y << jpg_scale) * 16U);
 			const uint8_t *pSrcR = image_info.m_pMCUBufR + src_ofs;
 			const uint8_t *pSrcG = image_info.m_pMCUBufG + src_ofs;
 			const uint8_t *pSrcB = image_info.m_pMCUBufB + src_ofs;
 
-			const int bx_limit = jpg_min(8, image_info.m_width - (mcu_x * image_info.m_MCUWidth + x));
+			const int bx_limit = jpg_min(block, (int)decoded_width - (mcu_x * MCUWidth + x));
 
 			if (image_info.m_scanType == PJPG_GRAYSCALE) {
 				int bx, by;
@@ -254,7 +335,7 @@ int JPEGDecoder::readSwappedBytes(void) {
 				}
 			}
 		}
-		pDst_row += (row_pitch * 8);
+		pDst_row += (row_pitch * block);
 	}
 
 	MCUx = mcu_x;
@@ -273,33 +354,33 @@ int JPEGDecoder::readSwappedBytes(void) {
 
 
 // Generic file call for SD or SPIFFS, uses leading / to distinguish SPIFFS files
-int JPEGDecoder::decodeFile(const char *pFilename){
+int JPEGDecoder::decodeFile(const char *pFilename, uint8_t scale){
 
 #if defined (ESP8266) || defined (ESP32)
 #if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
 	if (*pFilename == '/')
 #endif
-	return decodeFsFile(pFilename);
+	return decodeFsFile(pFilename, scale);
 #endif
 
 #if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
-	return decodeSdFile(pFilename);
+	return decodeSdFile(pFilename, scale);
 #endif
 
 	return -1;
 }
 
-int JPEGDecoder::decodeFile(const String& pFilename){
+int JPEGDecoder::decodeFile(const String& pFilename, uint8_t scale){
 
 #if defined (ESP8266) || defined (ESP32)
 #if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
 	if (pFilename.charAt(0) == '/')
 #endif
-	return decodeFsFile(pFilename);
+	return decodeFsFile(pFilename, scale);
 #endif
 
 #if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
-	return decodeSdFile(pFilename);
+	return decodeSdFile(pFilename, scale);
 #endif
 
 	return -1;
@@ -309,21 +390,21 @@ int JPEGDecoder::decodeFile(const String& pFilename){
 #ifdef LOAD_SPIFFS
 
 // Call specific to SPIFFS
-int JPEGDecoder::decodeFsFile(const char *pFilename) {
+int JPEGDecoder::decodeFsFile(const char *pFilename, uint8_t scale) {
 
 	fs::File pInFile = SPIFFS.open( pFilename, "r");
 
-	return decodeFsFile(pInFile);
+	return decodeFsFile(pInFile, scale);
 }
 
-int JPEGDecoder::decodeFsFile(const String& pFilename) {
+int JPEGDecoder::decodeFsFile(const String& pFilename, uint8_t scale) {
 
 	fs::File pInFile = SPIFFS.open( pFilename, "r");
 
-	return decodeFsFile(pInFile);
+	return decodeFsFile(pInFile, scale);
 }
 
-int JPEGDecoder::decodeFsFile(fs::File jpgFile) { // This is for the SPIFFS library
+int JPEGDecoder::decodeFsFile(fs::File jpgFile, uint8_t scale) { // This is for the SPIFFS library
 
 	g_pInFileFs = jpgFile;
 
@@ -341,7 +422,7 @@ int JPEGDecoder::decodeFsFile(fs::File jpgFile) { // This is for the SPIFFS libr
 
 	g_nInFileSize = g_pInFileFs.size();
 
-	return decodeCommon();
+	return decodeCommon(scale);
 
 }
 #endif
@@ -350,26 +431,26 @@ int JPEGDecoder::decodeFsFile(fs::File jpgFile) { // This is for the SPIFFS libr
 #if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
 
 // Call specific to SD filing system in case leading / is used
-int JPEGDecoder::decodeSdFile(const char *pFilename) {
+int JPEGDecoder::decodeSdFile(const char *pFilename, uint8_t scale) {
 
 	File pInFile = SD.open( pFilename, FILE_READ);
 
-	return decodeSdFile(pInFile);
+	return decodeSdFile(pInFile, scale);
 }
 
 
-int JPEGDecoder::decodeSdFile(const String& pFilename) {
+int JPEGDecoder::decodeSdFile(const String& pFilename, uint8_t scale) {
 #if !defined (ARDUINO_ARCH_SAM)
 	File pInFile = SD.open( pFilename, FILE_READ);
 
-	return decodeSdFile(pInFile);
+	return decodeSdFile(pInFile, scale);
 #else
 	return -1;
 #endif
 }
 
 
-int JPEGDecoder::decodeSdFile(File jpgFile) { // This is for the SD library
+int JPEGDecoder::decodeSdFile(File jpgFile, uint8_t scale) { // This is for the SD library
 
 	g_pInFileSd = jpgFile;
 
@@ -387,13 +468,154 @@ int JPEGDecoder::decodeSdFile(File jpgFile) { // This is for the SD library
 
 	g_nInFileSize = g_pInFileSd.size();
 
-	return decodeCommon();
+	return decodeCommon(scale);
+
+}
+
+
+// Fingerprint of the SD file being decoded, right after pjpeg_decode_init(),
+// for its index: a CRC-32 of the tables and headers before the scan, the
+// start of the scan and the end of the file. A photo saved again at the same
+// size differs there. The file is left where the decoder expects it.
+uint32_t JPEGDecoder::fingerprintSdFile(void) {
+	pjpeg_checkpoint_t start;
+	uint8_t buf[64];
+	uint32_t crc = 0;
+
+	pjpeg_get_checkpoint(&start);
+	uint32_t from = (start.m_ofs > JPEG_INDEX_HEAD) ? start.m_ofs - JPEG_INDEX_HEAD : 0;
+	uint32_t to = jpg_min(g_nInFileSize, start.m_ofs + JPEG_INDEX_SCAN);
+	uint32_t tail = (g_nInFileSize > JPEG_INDEX_TAIL) ? g_nInFileSize - JPEG_INDEX_TAIL : 0;
+	if (tail < to) tail = to;
+
+	for (int part = 0; part < 2; part++) {
+		uint32_t left = to - from;
+		g_pInFileSd.seek(from);
+		while (left) {
+			int n = g_pInFileSd.read(buf, jpg_min(left, (uint32_t)sizeof(buf)));
+			if (n <= 0) break;
+			crc = jpegCRC32(crc, buf, n);
+			left -= n;
+		}
+		from = tail;
+		to = g_nInFileSize;
+	}
+	g_pInFileSd.seek(g_nInFileOfs);
+	return crc;
+}
+
+
+// Jump to the index's checkpoint for the crop's first MCU row. Nothing
+// changes, and the rows above are decoded as without an index, if the index
+// can't be read, is of another file or of an older version of this one, or
+// its entry doesn't fit the image.
+void JPEGDecoder::seekIndex(void) {
+	jpeg_index_header_t header, expected;
+	jpeg_index_entry_t entry;
+	const uint32_t total = image_info.m_MCUSPerRow * image_info.m_MCUSPerCol;
+
+	File indexFile = SD.open(index_name, FILE_READ);
+	if (!indexFile) return;
+
+	bool found = indexFile.read(&header, sizeof(header)) == sizeof(header) &&
+		header.magic == JPEG_INDEX_MAGIC && header.fileSize == g_nInFileSize;
+	if (found) {
+		indexHeader(&expected, g_nInFileSize, fingerprintSdFile(), &image_info);
+		found = !memcmp(&header, &expected, sizeof(header)) &&
+			indexFile.seek(sizeof(header) + crop_mcu_y0 * sizeof(entry)) &&
+			indexFile.read(&entry, sizeof(entry)) == sizeof(entry) &&
+			entry.mcu <= (uint32_t)crop_mcu_y0 * image_info.m_MCUSPerRow &&
+			entry.checkpoint.m_ofs < g_nInFileSize &&
+			entry.checkpoint.m_MCUSRemaining == (uint16_t)(total - entry.mcu);
+	}
+	indexFile.close();
+
+	if (!found) return;
+	if (!g_pInFileSd.seek(entry.checkpoint.m_ofs)) {
+		g_pInFileSd.seek(g_nInFileOfs);
+		return;
+	}
 
+	g_nInFileOfs = entry.checkpoint.m_ofs;
+	pjpeg_set_checkpoint(&entry.checkpoint);
+	mcu_x = entry.mcu % image_info.m_MCUSPerRow;
+	mcu_y = entry.mcu / image_info.m_MCUSPerRow;
+}
+
+
+// Index pass: a checkpoint at the start of each MCU row. With restart markers
+// the file is only scanned for them; otherwise every MCU is entropy decoded.
+int JPEGDecoder::indexSdFile(const char *pFilename, const char *pIndexName) {
+	jpeg_index_header_t header, old;
+	jpeg_index_entry_t entry;
+
+	abort();
+
+	g_pInFileSd = SD.open(pFilename, FILE_READ);
+	jpg_source = JPEG_SD_FILE;
+	if (!g_pInFileSd) return -1;
+
+	g_nInFileOfs = 0;
+	g_nInFileSize = g_pInFileSd.size();
+
+	status = pjpeg_decode_init(&image_info, pjpeg_callback, NULL, PJPG_REDUCE_NONE);
+	if (status) {
+		g_pInFileSd.close();
+		return 0;
+	}
+	indexHeader(&header, g_nInFileSize, fingerprintSdFile(), &image_info);
+
+	if (SD.exists(pIndexName)) {
+		File oldFile = SD.open(pIndexName, FILE_READ);
+		bool current = oldFile && oldFile.read(&old, sizeof(old)) == sizeof(old) &&
+			!memcmp(&old, &header, sizeof(header)) &&
+			oldFile.size() == sizeof(header) + header.MCUSPerCol * sizeof(entry);
+		if (oldFile) oldFile.close();
+		if (current) {
+			g_pInFileSd.close();
+			return 1;
+		}
+		SD.remove(pIndexName);
+	}
+
+	File indexFile = SD.open(pIndexName, FILE_WRITE);
+	if (!indexFile) {
+		g_pInFileSd.close();
+		return -1;
+	}
+	indexFile.write((const uint8_t *)&header, sizeof(header));
+
+	const uint32_t interval = image_info.m_restartInterval;
+	uint32_t mcu = 0;
+	status = 0;
+	for (int row = 0; row < image_info.m_MCUSPerCol && !status; row++) {
+		const uint32_t first = row * image_info.m_MCUSPerRow;
+		if (interval) {
+			while (mcu + interval <= first && !(status = pjpeg_skip_restart_interval()))
+				mcu += interval;
+		}
+		else {
+			while (mcu < first && !(status = pjpeg_skip_mcu()))
+				mcu++;
+		}
+		entry.mcu = mcu;
+		pjpeg_get_checkpoint(&entry.checkpoint);
+		if (indexFile.write((const uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+			status = PJPG_STREAM_READ_ERROR;
+	}
+
+	indexFile.close();
+	g_pInFileSd.close();
+	if (status) {
+		SD.remove(pIndexName);
+		return 0;
+	}
+	return 1;
 }
 #endif
 
 
-int JPEGDecoder::decodeArray(const uint8_t array[], uint32_t  array_size) {
+int JPEGDecoder::decodeArray(const uint8_t array[], uint32_t  array_size, uint8_t scale) {
 
 	jpg_source = JPEG_ARRAY; // We are not processing a file, use arrays
 
@@ -403,12 +625,14 @@ int JPEGDecoder::decodeArray(const uint8_t array[], uint32_t  array_size) {
 
 	g_nInFileSize = array_size;
 
-	return decodeCommon();
+	return decodeCommon(scale);
 }
 
 
-int JPEGDecoder::decodeCommon(void) {
+int JPEGDecoder::decodeCommon(uint8_t scale) {
 
+	mcu_x = 0;
+	mcu_y = 0;
 	width = 0;
 	height = 0;
 	comps = 0;
@@ -418,7 +642,16 @@ int JPEGDecoder::decodeCommon(void) {
 	MCUWidth = 0;
 	MCUHeight = 0;
 
-	status = pjpeg_decode_init(&image_info, pjpeg_callback, NULL, 0);
+	// picojpeg's output size for each scale. At 1/8 only each block's DC
+	// coefficient, the block's average, is decoded into its first pixel; at
+	// 1/2 and 1/4 a smaller IDCT fills the top left of each block.
+	static const uint8 reduce[] = {
+		PJPG_REDUCE_NONE, PJPG_REDUCE_1_2, PJPG_REDUCE_1_4, PJPG_REDUCE_1_8
+	};
+
+	// The fit is chosen once the header has given the size
+	status = pjpeg_decode_init(&image_info, pjpeg_callback, NULL,
+		(scale <= JPEG_SCALE_1_8) ? reduce[scale] : (uint8)PJPG_REDUCE_NONE);
 
 	if (status) {
 		#ifdef DEBUG
@@ -433,13 +666,26 @@ int JPEGDecoder::decodeCommon(void) {
 		return 0;
 	}
 
-	decoded_width =  image_info.m_width;
-	decoded_height =  image_info.m_height;
+	if (scale == JPEG_SCALE_FIT) {
+		scale = JPEG_SCALE_1;
+		if (fit_width && fit_height) {
+			while (scale < JPEG_SCALE_1_8 &&
+				   (((image_info.m_width + (1 << scale) - 1) >> scale) > fit_width ||
+					((image_info.m_height + (1 << scale) - 1) >> scale) > fit_height))
+				scale++;
+		}
+		pjpeg_set_reduce(reduce[scale]);
+	}
+	else if (scale > JPEG_SCALE_1_8) scale = JPEG_SCALE_1;
+	jpg_scale = scale;
+
+	decoded_width =  (image_info.m_width + (1 << scale) - 1) >> scale;
+	decoded_height =  (image_info.m_height + (1 << scale) - 1) >> scale;
 	
-	row_pitch = image_info.m_MCUWidth;
-	pImage = new uint16_t[image_info.m_MCUWidth * image_info.m_MCUHeight];
+	row_pitch = image_info.m_MCUWidth >> scale;
+	pImage = new uint16_t[row_pitch * (image_info.m_MCUHeight >> scale)];
 
-	memset(pImage , 0 , image_info.m_MCUWidth * image_info.m_MCUHeight * sizeof(*pImage));
+	memset(pImage , 0 , row_pitch * (image_info.m_MCUHeight >> scale) * sizeof(*pImage));
 
 	row_blocks_per_mcu = image_info.m_MCUWidth >> 3;
 	col_blocks_per_mcu = image_info.m_MCUHeight >> 3;
@@ -452,8 +698,32 @@ int JPEGDecoder::decodeCommon(void) {
 	MCUSPerRow = image_info.m_MCUSPerRow;
 	MCUSPerCol = image_info.m_MCUSPerCol;
 	scanType = image_info.m_scanType;
-	MCUWidth = image_info.m_MCUWidth;
-	MCUHeight = image_info.m_MCUHeight;
+	MCUWidth = image_info.m_MCUWidth >> scale;
+	MCUHeight = image_info.m_MCUHeight >> scale;
+
+	// MCUs the crop covers, all of them without one. It's used up: the next
+	// decode is whole unless setCrop() is called again.
+	crop_mcu_x0 = 0;
+	crop_mcu_y0 = 0;
+	crop_mcu_x1 = MCUSPerRow - 1;
+	crop_mcu_y1 = MCUSPerCol - 1;
+	if (crop_w > 0 && crop_h > 0) {
+		if (crop_x > 0) crop_mcu_x0 = crop_x / MCUWidth;
+		if (crop_y > 0) crop_mcu_y0 = crop_y / MCUHeight;
+		crop_mcu_x1 = jpg_min(crop_mcu_x1, (crop_x + crop_w - 1) / MCUWidth);
+		crop_mcu_y1 = jpg_min(crop_mcu_y1, (crop_y + crop_h - 1) / MCUHeight);
+		if (crop_x + crop_w <= 0 || crop_y + crop_h <= 0 ||
+			crop_mcu_x1 < crop_mcu_x0 || crop_mcu_y1 < crop_mcu_y0)
+			crop_mcu_y1 = -1; // Nothing to decode
+		crop_w = 0;
+		crop_h = 0;
+	}
+
+#if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
+	if (index_name && jpg_source == JPEG_SD_FILE && crop_mcu_y0 > 0 && crop_mcu_y1 >= crop_mcu_y0)
+		seekIndex();
+#endif
+	index_name = NULL;
 
 	return decode_mcu();
 }
@@ -37,6 +37,16 @@ enum {
 	JPEG_SD_FILE
 };
 
+// Output scale of a decode, as a power of two: width, height and MCU size
+// are divided by 1 << scale
+enum {
+	JPEG_SCALE_1 = 0,	// Full size
+	JPEG_SCALE_1_2 = 1,	// 4x4 IDCT per 8x8 block
+	JPEG_SCALE_1_4 = 2,	// 2x2 IDCT per 8x8 block
+	JPEG_SCALE_1_8 = 3,	// Preview: one pixel per 8x8 block, DC only (no IDCT)
+	JPEG_SCALE_FIT = 0xFF	// Largest of the above that fits setFitSize()
+};
+
 //#define DEBUG
 
 //------------------------------------------------------------------------------
@@ -74,13 +84,23 @@ private:
 	uint decoded_width, decoded_height;
 	uint row_blocks_per_mcu, col_blocks_per_mcu;
 	uint8 status;
+	uint8 jpg_scale;
+	uint16_t fit_width, fit_height;
+	int crop_x, crop_y, crop_w, crop_h;	// setCrop(), for the next decode
+	int crop_mcu_x0, crop_mcu_x1;		// MCUs the crop covers, inclusive
+	int crop_mcu_y0, crop_mcu_y1;
+	const char *index_name;				// setIndexFile(), for the next decode
 	uint8 jpg_source = 0;
 	uint8_t* jpg_data;
 	
 	static uint8 pjpeg_callback(unsigned char* pBuf, unsigned char buf_size, unsigned char *pBytes_actually_read, void *pCallback_data);
 	uint8 pjpeg_need_bytes_callback(unsigned char* pBuf, unsigned char buf_size, unsigned char *pBytes_actually_read, void *pCallback_data);
 	int decode_mcu(void);
-	int decodeCommon(void);
+	int decodeCommon(uint8_t scale);
+#if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
+	uint32_t fingerprintSdFile(void);
+	void seekIndex(void);
+#endif
 public:
 
 	uint16_t *pImage;
@@ -104,26 +124,50 @@ public:
 	int read(void);
 	int readSwappedBytes(void);
 	
-	int decodeFile (const char *pFilename);
-	int decodeFile (const String& pFilename);
+	int decodeFile (const char *pFilename, uint8_t scale = JPEG_SCALE_1);
+	int decodeFile (const String& pFilename, uint8_t scale = JPEG_SCALE_1);
 	
 #if defined (LOAD_SD_LIBRARY) || defined (LOAD_SDFAT_LIBRARY)
-	int decodeSdFile (const char *pFilename);
-	int decodeSdFile (const String& pFilename);
-	int decodeSdFile (File g_pInFile);
+	int decodeSdFile (const char *pFilename, uint8_t scale = JPEG_SCALE_1);
+	int decodeSdFile (const String& pFilename, uint8_t scale = JPEG_SCALE_1);
+	int decodeSdFile (File g_pInFile, uint8_t scale = JPEG_SCALE_1);
+
+	// Write a random access index of a JPEG to a sidecar file, for
+	// setIndexFile(). An index that's already up to date is kept.
+	int indexSdFile (const char *pFilename, const char *pIndexName);
 #endif
 
 #ifdef LOAD_SPIFFS
-	int decodeFsFile (const char *pFilename);
-	int decodeFsFile (const String& pFilename);
-	int decodeFsFile (fs::File g_pInFile);
+	int decodeFsFile (const char *pFilename, uint8_t scale = JPEG_SCALE_1);
+	int decodeFsFile (const String& pFilename, uint8_t scale = JPEG_SCALE_1);
+	int decodeFsFile (fs::File g_pInFile, uint8_t scale = JPEG_SCALE_1);
 #endif
 
-	int decodeArray(const uint8_t array[], uint32_t  array_size);
+	int decodeArray(const uint8_t array[], uint32_t  array_size, uint8_t scale = JPEG_SCALE_1);
 	void abort(void);
 
+	// Box a JPEG_SCALE_FIT decode is reduced to fit, e.g. the screen
+	void setFitSize(uint16_t maxWidth, uint16_t maxHeight) { fit_width = maxWidth; fit_height = maxHeight; }
+
+	// Limit the next decode to a rectangle of the image, in pixels at the
+	// decode's scale: read() returns only the MCUs that overlap it. The others
+	// are only entropy decoded, and decoding ends after the crop's last MCU.
+	void setCrop(int x, int y, int w, int h) { crop_x = x; crop_y = y; crop_w = w; crop_h = h; }
+
+	// Index from indexSdFile() for the next SD file decode: with a crop, it
+	// starts at the crop's first MCU row instead of entropy decoding the rows
+	// above. An index that isn't of the file (by size and a CRC of its tables,
+	// scan start and end) is ignored and the decode runs from the top.
+	void setIndexFile(const char *pIndexName) { index_name = pIndexName; }
+
+	// JPEG_SCALE_ of the last decode, as chosen for JPEG_SCALE_FIT
+	uint8_t decodedScale(void) const { return jpg_scale; }
+
 };
 
 extern JPEGDecoder JpegDec;
 
+// CRC-32 (IEEE) of len bytes, continuing from crc: 0 to start
+uint32_t jpegCRC32(uint32_t crc, const uint8_t *pBuf, uint32_t len);
+
 #endif // JPEGDECODER_H
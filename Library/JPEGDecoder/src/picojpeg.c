@@ -4,6 +4,7 @@
 // Feb. 9, 2013 - Added H1V2/H2V1 support, cleaned up macros, signed shift fixes 
 // Also integrated and tested changes from Chris Phoenix <cphoenix@gmail.com>.
 //------------------------------------------------------------------------------
+#include <stdint.h>
 #include "picojpeg.h"
 //------------------------------------------------------------------------------
 // Set to 1 if right shifts on signed ints are always unsigned (logical) shifts
@@ -13,11 +14,19 @@
 
 // Define PJPG_INLINE to "inline" if your C compiler supports explicit inlining
 #define PJPG_INLINE
+
+// Huffman codes up to this many bits long (8 or 9 is sensible) decode with one
+// table lookup; longer ones fall back to searching mMaxCode[]. The tables cost
+// 2 bytes per entry, 4 tables.
+#ifndef PJPG_HUFF_LOOKUP_BITS
+#define PJPG_HUFF_LOOKUP_BITS 8
+#endif
 //------------------------------------------------------------------------------
 typedef unsigned char   uint8;
 typedef unsigned short  uint16;
 typedef signed char     int8;
 typedef signed short    int16;
+typedef uint32_t        uint32;
 //------------------------------------------------------------------------------
 #if PJPG_RIGHT_SHIFT_IS_ALWAYS_UNSIGNED
 static int16 replicateSignBit16(int8 n)
@@ -158,9 +167,12 @@ typedef struct HuffTableT
    uint16 mMinCode[16];
    uint16 mMaxCode[16];
    uint8 mValPtr[16];
+   // Indexed by the next PJPG_HUFF_LOOKUP_BITS bits: code length << 8 | index
+   // into the values, or 0 if no code that short matches
+   uint16 mLookup[1 << PJPG_HUFF_LOOKUP_BITS];
 } HuffTable;
 
-// DC - 192
+// DC - 192 + 2 lookup tables
 static HuffTable gHuffTab0;
 
 static uint8 gHuffVal0[16];
@@ -168,7 +180,7 @@ static uint8 gHuffVal0[16];
 static HuffTable gHuffTab1;
 static uint8 gHuffVal1[16];
 
-// AC - 672
+// AC - 672 + 2 lookup tables
 static HuffTable gHuffTab2;
 static uint8 gHuffVal2[256];
 
@@ -183,9 +195,15 @@ static uint8 gTemFlag;
 static uint8 gInBuf[PJPG_MAX_IN_BUF_SIZE];
 static uint8 gInBufOfs;
 static uint8 gInBufLeft;
+static uint32 gInBytes;          // Input bytes read from the callback, to give checkpoints their offset
 
 static uint16 gBitBuf;
 static uint8 gBitsLeft;
+
+// Entropy-coded data: next bit in bit 31, gScanBitCount bits valid
+static uint32 gScanBitBuf;
+static uint8 gScanBitCount;
+static uint8 gScanMarker;
 //------------------------------------------------------------------------------
 static uint16 gImageXSize;
 static uint16 gImageYSize;
@@ -228,6 +246,7 @@ static void fillInBuf(void)
    gInBufLeft = 0;
 
    status = (*g_pNeedBytesCallback)(gInBuf + gInBufOfs, PJPG_MAX_IN_BUF_SIZE - gInBufOfs, &gInBufLeft, g_pCallback_data);
+   gInBytes += gInBufLeft;
    if (status)
    {
       // The user provided need bytes callback has indicated an error, so record the error and continue trying to decode.
@@ -319,27 +338,62 @@ static PJPG_INLINE uint16 getBits1(uint8 numBits)
    return getBits(numBits, 0);
 }
 //------------------------------------------------------------------------------
-static PJPG_INLINE uint16 getBits2(uint8 numBits)
-{
-   return getBits(numBits, 1);
+// Entropy-coded data is read through a 32-bit bit buffer, topped up a byte at
+// a time. 0xFF00 is unstuffed to 0xFF. Any other 0xFFxx is a marker: it's put
+// back for processRestart() and the buffer is padded with 1 bits from then on,
+// as getOctet() would.
+static void resetScanBits(void)
+{
+   gScanBitBuf = 0;
+   gScanBitCount = 0;
+   gScanMarker = 0;
 }
 //------------------------------------------------------------------------------
-static PJPG_INLINE uint8 getBit(void)
+static void fillScanBits(void)
 {
-   uint8 ret = 0;
-   if (gBitBuf & 0x8000) 
-      ret = 1;
-   
-   if (!gBitsLeft)
+   while (gScanBitCount <= 24)
    {
-      gBitBuf |= getOctet(1);
+      uint8 c = 0xFF;
 
-      gBitsLeft += 8;
+      if (!gScanMarker)
+      {
+         c = getChar();
+
+         if (c == 0xFF)
+         {
+            uint8 n = getChar();
+
+            if (n)
+            {
+               stuffChar(n);
+               stuffChar(0xFF);
+               gScanMarker = 1;
+            }
+         }
+      }
+
+      gScanBitBuf |= (uint32)c << (24 - gScanBitCount);
+      gScanBitCount += 8;
    }
-   
-   gBitsLeft--;
-   gBitBuf <<= 1;
-   
+}
+//------------------------------------------------------------------------------
+static PJPG_INLINE void skipScanBits(uint8 numBits)
+{
+   gScanBitBuf <<= numBits;
+   gScanBitCount -= numBits;
+}
+//------------------------------------------------------------------------------
+// 1 to 16 bits of entropy-coded data
+static PJPG_INLINE uint16 getBits2(uint8 numBits)
+{
+   uint16 ret;
+
+   if (gScanBitCount < numBits)
+      fillScanBits();
+
+   ret = (uint16)(gScanBitBuf >> (32 - numBits));
+   skipScanBits(numBits);
+
    return ret;
 }
 //------------------------------------------------------------------------------
@@ -398,39 +452,42 @@ static PJPG_INLINE int16 huffExtend(uint16 x, uint8 s)
 //------------------------------------------------------------------------------
 static PJPG_INLINE uint8 huffDecode(const HuffTable* pHuffTable, const uint8* pHuffVal)
 {
-   uint8 i = 0;
-   uint8 j;
-   uint16 code = getBit();
+   uint8 i;
+   uint16 e;
 
-   // This func only reads a bit at a time, which on modern CPU's is not terribly efficient.
-   // But on microcontrollers without strong integer shifting support this seems like a 
-   // more reasonable approach.
-   for ( ; ; )
+   if (gScanBitCount < 16)
+      fillScanBits();
+
+   // Short codes (nearly all of them): one lookup on the next bits
+   e = pHuffTable->mLookup[gScanBitBuf >> (32 - PJPG_HUFF_LOOKUP_BITS)];
+   if (e)
    {
-      uint16 maxCode;
+      skipScanBits((uint8)(e >> 8));
+      return pHuffVal[(uint8)e];
+   }
 
-      if (i == 16)
-         return 0;
+   // Longer codes: try each remaining length in turn
+   for (i = PJPG_HUFF_LOOKUP_BITS; i < 16; i++)
+   {
+      uint16 code = (uint16)(gScanBitBuf >> (31 - i));
+      uint16 maxCode = pHuffTable->mMaxCode[i];
 
-      maxCode = pHuffTable->mMaxCode[i];
       if ((code <= maxCode) && (maxCode != 0xFFFF))
-         break;
-
-      i++;
-      code <<= 1;
-      code |= getBit();
+      {
+         skipScanBits(i + 1);
+         return pHuffVal[(uint8)(pHuffTable->mValPtr[i] + (code - pHuffTable->mMinCode[i]))];
+      }
    }
 
-   j = pHuffTable->mValPtr[i];
-   j = (uint8)(j + (code - pHuffTable->mMinCode[i]));
-
-   return pHuffVal[j];
+   skipScanBits(16);
+   return 0;
 }
 //------------------------------------------------------------------------------
 static void huffCreate(const uint8* pBits, HuffTable* pHuffTable)
 {
    uint8 i = 0;
    uint8 j = 0;
+   uint16 p;
 
    uint16 code = 0;
       
@@ -461,6 +518,27 @@ static void huffCreate(const uint8* pBits, HuffTable* pHuffTable)
       if (i > 15)
          break;
    }
+
+   // Fast lookup: for each bit pattern, the first code length (up to
+   // PJPG_HUFF_LOOKUP_BITS) it matches, tested as huffDecode()'s search does
+   for (p = 0; p < (1 << PJPG_HUFF_LOOKUP_BITS); p++)
+   {
+      uint16 e = 0;
+
+      for (i = 0; i < PJPG_HUFF_LOOKUP_BITS; i++)
+      {
+         uint16 c = p >> (PJPG_HUFF_LOOKUP_BITS - 1 - i);
+         uint16 maxCode = pHuffTable->mMaxCode[i];
+
+         if ((c <= maxCode) && (maxCode != 0xFFFF))
+         {
+            e = (uint16)(((i + 1) << 8) | (uint8)(pHuffTable->mValPtr[i] + (c - pHuffTable->mMinCode[i])));
+            break;
+         }
+      }
+
+      pHuffTable->mLookup[p] = e;
+   }
 }
 //------------------------------------------------------------------------------
 static HuffTable* getHuffTable(uint8 index)
@@ -954,6 +1032,7 @@ static uint8 init(void)
    gTemFlag = 0;
    gInBufOfs = 0;
    gInBufLeft = 0;
+   gInBytes = 0;
    gBitBuf = 0;
    gBitsLeft = 8;
 
@@ -974,9 +1053,7 @@ static void fixInBuffer(void)
    
    stuffChar((uint8)(gBitBuf >> 8));
    
-   gBitsLeft = 8;
-   getBits2(8);
-   getBits2(8);
+   resetScanBits();
 }
 //------------------------------------------------------------------------------
 // Restart interval processing.
@@ -1015,14 +1092,38 @@ static uint8 processRestart(void)
    gNextRestartNum = (gNextRestartNum + 1) & 7;
 
    // Get the bit buffer going again
-
-   gBitsLeft = 8;
-   getBits2(8);
-   getBits2(8);
+   resetScanBits();
    
    return 0;
 }
 //------------------------------------------------------------------------------
+// Moves the input on to the next marker without decoding the entropy-coded
+// bytes before it, and puts the marker back for processRestart(). Bits already
+// in the bit buffer come before the input, so this works from anywhere in a
+// restart interval. Stops at the EOI getChar() makes up at the end of the
+// input too.
+static void skipToMarker(void)
+{
+   uint8 c;
+
+   for ( ; ; )
+   {
+      if (getChar() != 0xFF)
+         continue;
+
+      do
+         c = getChar();
+      while (c == 0xFF);
+
+      // 0xFF00 is a stuffed 0xFF data byte
+      if (c)
+         break;
+   }
+
+   stuffChar(c);
+   stuffChar(0xFF);
+}
+//------------------------------------------------------------------------------
 // FIXME: findEOI() is not actually called at the end of the image 
 // (it's optional, and probably not needed on embedded devices)
 static uint8 findEOI(void)
@@ -1278,6 +1379,47 @@ static PJPG_INLINE int16 imul_b5(int16 w)
    return (int16)(PJPG_ARITH_SHIFT_RIGHT_8_L(x));
 }
 
+// Constants of the reduced-size IDCTs
+// cos(4*pi/16)
+static PJPG_INLINE int16 imul_c4(int16 w)
+{
+   long x = (w * 181L);
+   x += 128L;
+   return (int16)(PJPG_ARITH_SHIFT_RIGHT_8_L(x));
+}
+
+// cos(2*pi/16)
+static PJPG_INLINE int16 imul_c2(int16 w)
+{
+   long x = (w * 237L);
+   x += 128L;
+   return (int16)(PJPG_ARITH_SHIFT_RIGHT_8_L(x));
+}
+
+// cos(6*pi/16)
+static PJPG_INLINE int16 imul_c6(int16 w)
+{
+   long x = (w * 98L);
+   x += 128L;
+   return (int16)(PJPG_ARITH_SHIFT_RIGHT_8_L(x));
+}
+
+// cos(2*pi/16)*cos(4*pi/16)
+static PJPG_INLINE int16 imul_c2c4(int16 w)
+{
+   long x = (w * 167L);
+   x += 128L;
+   return (int16)(PJPG_ARITH_SHIFT_RIGHT_8_L(x));
+}
+
+// cos(6*pi/16)*cos(4*pi/16)
+static PJPG_INLINE int16 imul_c6c4(int16 w)
+{
+   long x = (w * 69L);
+   x += 128L;
+   return (int16)(PJPG_ARITH_SHIFT_RIGHT_8_L(x));
+}
+
 static PJPG_INLINE uint8 clamp(int16 s)
 {
    if ((uint16)s > 255U)
@@ -1443,6 +1585,149 @@ static void idctCols(void)
    }      
 }
 
+// Reduced-size IDCTs, for decoding at 1/2 and 1/4.
+//
+// The coefficients are dequantized with the Winograd scale factors folded in
+// (createWinogradQuant), so coefficient k of a row is F(k)*cos(k*pi/16)*sqrt(2)
+// and the 8-point IDCT is x(n) = sum G(k)*cos((2n+1)*k*pi/16)/cos(k*pi/16).
+// Averaging outputs 2m and 2m+1 of it gives exactly
+//    y(m) = sum G(k)*cos((2m+1)*k*pi/8), k = 0..7
+// where G(4)'s term is 0 and G(8-k)'s is -G(k)'s, a 4-point IDCT of
+// G(0), G(1)-G(7), G(2)-G(6), G(3)-G(5). Averaging again gives
+//    z(p) = y0 +/- (cos(2*pi/16)*y1 - cos(6*pi/16)*y3)*cos(4*pi/16)
+// on those same 4 folded coefficients. So a 4x4 or 2x2 result is the 2x2 or
+// 4x4 box average of the full IDCT, before rounding, for a fraction of the
+// multiplies. Results are left at the top left of gCoeffBuf, rows 8 apart.
+
+// Fold the high frequencies onto the low 4x4, see above. Not needed if every
+// coefficient in row or column 5 to 7 is 0: zag order reaches them at 15.
+#define PJPG_FOLD_ZAG 15
+// Zag index past the last coefficient of the low 4x4
+#define PJPG_LOW_ZAG 25
+
+
+static void idctFold(void)
+{
+   uint8 i;
+   int16* pSrc = gCoeffBuf;
+
+   for (i = 0; i < 8; i++)
+   {
+      pSrc[1] -= pSrc[7];
+      pSrc[2] -= pSrc[6];
+      pSrc[3] -= pSrc[5];
+      pSrc += 8;
+   }
+
+   pSrc = gCoeffBuf;
+   for (i = 0; i < 4; i++)
+   {
+      pSrc[1*8] -= pSrc[7*8];
+      pSrc[2*8] -= pSrc[6*8];
+      pSrc[3*8] -= pSrc[5*8];
+      pSrc++;
+   }
+}
+
+// 4x4 output per block
+static void idctReduce4(void)
+{
+   uint8 i;
+   int16* pSrc = gCoeffBuf;
+
+   for (i = 0; i < 4; i++)
+   {
+      if ((pSrc[1] | pSrc[2] | pSrc[3]) == 0)
+      {
+         int16 src0 = *pSrc;
+
+         *(pSrc+1) = src0;
+         *(pSrc+2) = src0;
+         *(pSrc+3) = src0;
+      }
+      else
+      {
+         int16 src1 = *(pSrc+1);
+         int16 src3 = *(pSrc+3);
+         int16 x2 = imul_c4(*(pSrc+2));
+         int16 e0 = *(pSrc+0) + x2;
+         int16 e1 = *(pSrc+0) - x2;
+         int16 o0 = imul_c2(src1) + imul_c6(src3);
+         int16 o1 = imul_c6(src1) - imul_c2(src3);
+
+         *(pSrc+0) = e0 + o0;
+         *(pSrc+1) = e1 + o1;
+         *(pSrc+2) = e1 - o1;
+         *(pSrc+3) = e0 - o0;
+      }
+
+      pSrc += 8;
+   }
+
+   pSrc = gCoeffBuf;
+   for (i = 0; i < 4; i++)
+   {
+      if ((pSrc[1*8] | pSrc[2*8] | pSrc[3*8]) == 0)
+      {
+         uint8 c = clamp(PJPG_DESCALE(*pSrc) + 128);
+         *(pSrc+0*8) = c;
+         *(pSrc+1*8) = c;
+         *(pSrc+2*8) = c;
+         *(pSrc+3*8) = c;
+      }
+      else
+      {
+         int16 src1 = *(pSrc+1*8);
+         int16 src3 = *(pSrc+3*8);
+         int16 x2 = imul_c4(*(pSrc+2*8));
+         int16 e0 = *(pSrc+0*8) + x2;
+         int16 e1 = *(pSrc+0*8) - x2;
+         int16 o0 = imul_c2(src1) + imul_c6(src3);
+         int16 o1 = imul_c6(src1) - imul_c2(src3);
+
+         *(pSrc+0*8) = clamp(PJPG_DESCALE(e0 + o0) + 128);
+         *(pSrc+1*8) = clamp(PJPG_DESCALE(e1 + o1) + 128);
+         *(pSrc+2*8) = clamp(PJPG_DESCALE(e1 - o1) + 128);
+         *(pSrc+3*8) = clamp(PJPG_DESCALE(e0 - o0) + 128);
+      }
+
+      pSrc++;
+   }
+}
+
+// 2x2 output per block. Row 2 of the folded coefficients drops out.
+static void idctReduce2(void)
+{
+   uint8 i;
+   int16* pSrc = gCoeffBuf;
+
+   for (i = 0; i < 4; i++)
+   {
+      if (i != 2)
+      {
+         int16 o = imul_c2c4(pSrc[1]) - imul_c6c4(pSrc[3]);
+         int16 src0 = pSrc[0];
+
+         pSrc[0] = src0 + o;
+         pSrc[1] = src0 - o;
+      }
+
+      pSrc += 8;
+   }
+
+   pSrc = gCoeffBuf;
+   for (i = 0; i < 2; i++)
+   {
+      int16 o = imul_c2c4(pSrc[1*8]) - imul_c6c4(pSrc[3*8]);
+      int16 src0 = pSrc[0];
+
+      pSrc[0*8] = clamp(PJPG_DESCALE(src0 + o) + 128);
+      pSrc[1*8] = clamp(PJPG_DESCALE(src0 - o) + 128);
+
+      pSrc++;
+   }
+}
+
 /*----------------------------------------------------------------------------*/
 static PJPG_INLINE uint8 addAndClamp(uint8 a, int16 b)
 {
@@ -1759,6 +2044,103 @@ static void convertCr(uint8 dstOfs)
       }
 }
 /*----------------------------------------------------------------------------*/
+// Reduced-size blocks: n x n pixels (4 or 2) at the top left of each 8x8, rows 8 apart.
+// Convert Y to RGB
+static void copyYReduce(uint8 dstOfs, uint8 n)
+{
+   uint8 x, y;
+   uint8* pRDst = gMCUBufR + dstOfs;
+   uint8* pGDst = gMCUBufG + dstOfs;
+   uint8* pBDst = gMCUBufB + dstOfs;
+   int16* pSrc = gCoeffBuf;
+
+   for (y = 0; y < n; y++)
+   {
+      for (x = 0; x < n; x++)
+      {
+         uint8 c = (uint8)pSrc[x];
+
+         pRDst[x] = c;
+         pGDst[x] = c;
+         pBDst[x] = c;
+      }
+
+      pSrc += 8;
+      pRDst += 8;
+      pGDst += 8;
+      pBDst += 8;
+   }
+}
+/*----------------------------------------------------------------------------*/
+// Cb convert to RGB and accumulate, each sample over sx by sy pixels
+// (1 or 2: the upsampling factors) of an n x n block
+static void upsampleCbReduce(uint8 srcOfs, uint8 dstOfs, uint8 n, uint8 sx, uint8 sy)
+{
+   // Cb - affects G and B
+   uint8 x, y, i, j;
+   int16* pSrc = gCoeffBuf + srcOfs;
+   uint8* pDstG = gMCUBufG + dstOfs;
+   uint8* pDstB = gMCUBufB + dstOfs;
+
+   for (y = 0; y < n; y += sy)
+   {
+      for (x = 0; x < n; x += sx)
+      {
+         uint8 cb = (uint8)pSrc[x >> (sx - 1)];
+         int16 cbG, cbB;
+
+         cbG = ((cb * 88U) >> 8U) - 44U;
+         cbB = (cb + ((cb * 198U) >> 8U)) - 227U;
+
+         for (j = 0; j < sy; j++)
+            for (i = 0; i < sx; i++)
+            {
+               uint8 o = (uint8)(j * 8 + x + i);
+               pDstG[o] = subAndClamp(pDstG[o], cbG);
+               pDstB[o] = addAndClamp(pDstB[o], cbB);
+            }
+      }
+
+      pSrc += 8;
+      pDstG += 8 * sy;
+      pDstB += 8 * sy;
+   }
+}
+/*----------------------------------------------------------------------------*/
+// Cr convert to RGB and accumulate, as upsampleCbReduce()
+static void upsampleCrReduce(uint8 srcOfs, uint8 dstOfs, uint8 n, uint8 sx, uint8 sy)
+{
+   // Cr - affects R and G
+   uint8 x, y, i, j;
+   int16* pSrc = gCoeffBuf + srcOfs;
+   uint8* pDstR = gMCUBufR + dstOfs;
+   uint8* pDstG = gMCUBufG + dstOfs;
+
+   for (y = 0; y < n; y += sy)
+   {
+      for (x = 0; x < n; x += sx)
+      {
+         uint8 cr = (uint8)pSrc[x >> (sx - 1)];
+         int16 crR, crG;
+
+         crR = (cr + ((cr * 103U) >> 8U)) - 179;
+         crG = ((cr * 183U) >> 8U) - 91;
+
+         for (j = 0; j < sy; j++)
+            for (i = 0; i < sx; i++)
+            {
+               uint8 o = (uint8)(j * 8 + x + i);
+               pDstR[o] = addAndClamp(pDstR[o], crR);
+               pDstG[o] = subAndClamp(pDstG[o], crG);
+            }
+      }
+
+      pSrc += 8;
+      pDstR += 8 * sy;
+      pDstG += 8 * sy;
+   }
+}
+/*----------------------------------------------------------------------------*/
 static void transformBlock(uint8 mcuBlock)
 {
    idctRows();
@@ -1906,6 +2288,116 @@ static void transformBlock(uint8 mcuBlock)
    }      
 }
 //------------------------------------------------------------------------------
+// transformBlock() at 1/2 or 1/4: n x n pixels per block. last is the zag
+// index past the block's last coded coefficient.
+static void transformBlockScaled(uint8 mcuBlock, uint8 last)
+{
+   uint8 n, h;
+
+   if (last > PJPG_FOLD_ZAG)
+      idctFold();
+
+   if (gReduce == PJPG_REDUCE_1_2)
+   {
+      idctReduce4();
+      n = 4;
+   }
+   else
+   {
+      idctReduce2();
+      n = 2;
+   }
+   h = n >> 1;
+
+   switch (gScanType)
+   {
+      case PJPG_GRAYSCALE:
+      {
+         copyYReduce(0, n);
+         break;
+      }
+      case PJPG_YH1V1:
+      {
+         switch (mcuBlock)
+         {
+            case 0: copyYReduce(0, n); break;
+            case 1: upsampleCbReduce(0, 0, n, 1, 1); break;
+            case 2: upsampleCrReduce(0, 0, n, 1, 1); break;
+         }
+         break;
+      }
+      case PJPG_YH1V2:
+      {
+         switch (mcuBlock)
+         {
+            case 0: copyYReduce(0, n); break;
+            case 1: copyYReduce(128, n); break;
+            case 2:
+            {
+               upsampleCbReduce(0, 0, n, 1, 2);
+               upsampleCbReduce(h*8, 128, n, 1, 2);
+               break;
+            }
+            case 3:
+            {
+               upsampleCrReduce(0, 0, n, 1, 2);
+               upsampleCrReduce(h*8, 128, n, 1, 2);
+               break;
+            }
+         }
+         break;
+      }
+      case PJPG_YH2V1:
+      {
+         switch (mcuBlock)
+         {
+            case 0: copyYReduce(0, n); break;
+            case 1: copyYReduce(64, n); break;
+            case 2:
+            {
+               upsampleCbReduce(0, 0, n, 2, 1);
+               upsampleCbReduce(h, 64, n, 2, 1);
+               break;
+            }
+            case 3:
+            {
+               upsampleCrReduce(0, 0, n, 2, 1);
+               upsampleCrReduce(h, 64, n, 2, 1);
+               break;
+            }
+         }
+         break;
+      }
+      case PJPG_YH2V2:
+      {
+         switch (mcuBlock)
+         {
+            case 0: copyYReduce(0, n); break;
+            case 1: copyYReduce(64, n); break;
+            case 2: copyYReduce(128, n); break;
+            case 3: copyYReduce(192, n); break;
+            case 4:
+            {
+               upsampleCbReduce(0, 0, n, 2, 2);
+               upsampleCbReduce(h, 64, n, 2, 2);
+               upsampleCbReduce(h*8, 128, n, 2, 2);
+               upsampleCbReduce(h+h*8, 192, n, 2, 2);
+               break;
+            }
+            case 5:
+            {
+               upsampleCrReduce(0, 0, n, 2, 2);
+               upsampleCrReduce(h, 64, n, 2, 2);
+               upsampleCrReduce(h*8, 128, n, 2, 2);
+               upsampleCrReduce(h+h*8, 192, n, 2, 2);
+               break;
+            }
+         }
+         break;
+      }
+   }
+}
+//------------------------------------------------------------------------------
 static void transformBlockReduce(uint8 mcuBlock)
 {
    uint8 c = clamp(PJPG_DESCALE(gCoeffBuf[0]) + 128);
@@ -2116,7 +2608,9 @@ static void transformBlockReduce(uint8 mcuBlock)
    }
 }
 //------------------------------------------------------------------------------
-static uint8 decodeNextMCU(void)
+// With skip set the MCU is entropy decoded only, to move the bit stream and
+// the DC predictors on, and the MCU buffers are left as they were.
+static uint8 decodeNextMCU(uint8 skip)
 {
    uint8 status;
    uint8 mcuBlock;   
@@ -2137,7 +2631,7 @@ static uint8 decodeNextMCU(void)
       uint8 componentID = gMCUOrg[mcuBlock];
       uint8 compQuant = gCompQuant[componentID];	
       uint8 compDCTab = gCompDCTab[componentID];
-      uint8 numExtraBits, compACTab, k;
+      uint8 numExtraBits, compACTab, k, last;
       const int16* pQ = compQuant ? gQuant1 : gQuant0;
       uint16 r, dc;
 
@@ -2152,13 +2646,14 @@ static uint8 decodeNextMCU(void)
       dc = dc + gLastDC[componentID];
       gLastDC[componentID] = dc;
             
-      gCoeffBuf[0] = dc * pQ[0];
+      if (!skip)
+         gCoeffBuf[0] = dc * pQ[0]; // Skipped MCUs leave the buffers alone
 
       compACTab = gCompACTab[componentID];
 
-      if (gReduce)
+      if ((gReduce == PJPG_REDUCE_1_8) || (skip))
       {
-         // Decode, but throw out the AC coefficients in reduce mode.
+         // Decode, but throw out the AC coefficients in reduce and skip mode.
          for (k = 1; k < 64; k++)
          {
             s = huffDecode(compACTab ? &gHuffTab3 : &gHuffTab2, compACTab ? gHuffVal3 : gHuffVal2);
@@ -2194,7 +2689,8 @@ static uint8 decodeNextMCU(void)
             }
          }
 
-         transformBlockReduce(mcuBlock); 
+         if (!skip)
+            transformBlockReduce(mcuBlock); 
       }
       else
       {
@@ -2250,10 +2746,16 @@ static uint8 decodeNextMCU(void)
             }
          }
          
-         while (k < 64)
+         // A reduced IDCT with nothing to fold reads only the low 4x4
+         last = k;
+         r = (gReduce && last <= PJPG_FOLD_ZAG) ? PJPG_LOW_ZAG : 64;
+         while (k < r)
             gCoeffBuf[ZAG[k++]] = 0;
 
-         transformBlock(mcuBlock); 
+         if (gReduce)
+            transformBlockScaled(mcuBlock, last);
+         else
+            transformBlock(mcuBlock); 
       }
    }
          
@@ -2270,7 +2772,26 @@ unsigned char pjpeg_decode_mcu(void)
    if (!gNumMCUSRemaining)
       return PJPG_NO_MORE_BLOCKS;
       
-   status = decodeNextMCU();
+   status = decodeNextMCU(0);
+   if ((status) || (gCallbackStatus))
+      return gCallbackStatus ? gCallbackStatus : status;
+      
+   gNumMCUSRemaining--;
+   
+   return 0;
+}
+//------------------------------------------------------------------------------
+unsigned char pjpeg_skip_mcu(void)
+{
+   uint8 status;
+   
+   if (gCallbackStatus)
+      return gCallbackStatus;
+   
+   if (!gNumMCUSRemaining)
+      return PJPG_NO_MORE_BLOCKS;
+      
+   status = decodeNextMCU(1);
    if ((status) || (gCallbackStatus))
       return gCallbackStatus ? gCallbackStatus : status;
       
@@ -2287,6 +2808,7 @@ unsigned char pjpeg_decode_init(pjpeg_image_info_t *pInfo, pjpeg_need_bytes_call
    pInfo->m_MCUSPerRow = 0; pInfo->m_MCUSPerCol = 0;
    pInfo->m_scanType = PJPG_GRAYSCALE;
    pInfo->m_MCUWidth = 0; pInfo->m_MCUHeight = 0;
+   pInfo->m_restartInterval = 0;
    pInfo->m_pMCUBufR = (unsigned char*)0; pInfo->m_pMCUBufG = (unsigned char*)0; pInfo->m_pMCUBufB = (unsigned char*)0;
 
    g_pNeedBytesCallback = pNeed_bytes_callback;
@@ -2314,7 +2836,68 @@ unsigned char pjpeg_decode_init(pjpeg_image_info_t *pInfo, pjpeg_need_bytes_call
    pInfo->m_scanType = gScanType;
    pInfo->m_MCUSPerRow = gMaxMCUSPerRow; pInfo->m_MCUSPerCol = gMaxMCUSPerCol;
    pInfo->m_MCUWidth = gMaxMCUXSize; pInfo->m_MCUHeight = gMaxMCUYSize;
+   pInfo->m_restartInterval = gRestartInterval;
    pInfo->m_pMCUBufR = gMCUBufR; pInfo->m_pMCUBufG = gMCUBufG; pInfo->m_pMCUBufB = gMCUBufB;
       
    return 0;
 }
+//------------------------------------------------------------------------------
+void pjpeg_set_reduce(unsigned char reduce)
+{
+   gReduce = reduce;
+}
+//------------------------------------------------------------------------------
+unsigned char pjpeg_skip_restart_interval(void)
+{
+   uint8 status;
+
+   if (gCallbackStatus)
+      return gCallbackStatus;
+
+   // Nothing to skip to without restart markers, or in the last interval
+   if ((!gRestartInterval) || (gNumMCUSRemaining <= gRestartsLeft))
+      return PJPG_NO_MORE_BLOCKS;
+
+   gNumMCUSRemaining -= gRestartsLeft;
+
+   skipToMarker();
+
+   status = processRestart();
+   if ((status) || (gCallbackStatus))
+      return gCallbackStatus ? gCallbackStatus : status;
+   
+   return 0;
+}
+//------------------------------------------------------------------------------
+void pjpeg_get_checkpoint(pjpeg_checkpoint_t *pCheckpoint)
+{
+   pCheckpoint->m_ofs = gInBytes - gInBufLeft;
+   pCheckpoint->m_bitBuf = gScanBitBuf;
+   pCheckpoint->m_bitCount = gScanBitCount;
+   pCheckpoint->m_marker = gScanMarker;
+   pCheckpoint->m_nextRestartNum = (unsigned char)gNextRestartNum;
+   pCheckpoint->m_reserved = 0;
+   pCheckpoint->m_restartsLeft = gRestartsLeft;
+   pCheckpoint->m_MCUSRemaining = gNumMCUSRemaining;
+   pCheckpoint->m_lastDC[0] = gLastDC[0];
+   pCheckpoint->m_lastDC[1] = gLastDC[1];
+   pCheckpoint->m_lastDC[2] = gLastDC[2];
+}
+//------------------------------------------------------------------------------
+void pjpeg_set_checkpoint(const pjpeg_checkpoint_t *pCheckpoint)
+{
+   // Whatever is left in the input buffer came from before the seek
+   gInBufOfs = 0;
+   gInBufLeft = 0;
+   gInBytes = pCheckpoint->m_ofs;
+
+   gScanBitBuf = pCheckpoint->m_bitBuf;
+   gScanBitCount = pCheckpoint->m_bitCount;
+   gScanMarker = pCheckpoint->m_marker;
+   gNextRestartNum = pCheckpoint->m_nextRestartNum;
+   gRestartsLeft = pCheckpoint->m_restartsLeft;
+   gNumMCUSRemaining = pCheckpoint->m_MCUSRemaining;
+   gLastDC[0] = pCheckpoint->m_lastDC[0];
+   gLastDC[1] = pCheckpoint->m_lastDC[1];
+   gLastDC[2] = pCheckpoint->m_lastDC[2];
+}
@@ -80,6 +80,9 @@ typedef struct
    int m_MCUWidth;
    int m_MCUHeight;
 
+   // MCUs per restart interval, or 0 if the image has no restart markers (DRI/RSTn).
+   int m_restartInterval;
+
    // m_pMCUBufR, m_pMCUBufG, and m_pMCUBufB are pointers to internal MCU Y or RGB pixel component buffers.
    // Each time pjpegDecodeMCU() is called successfully these buffers will be filled with 8x8 pixel blocks of Y or RGB pixels.
    // Each MCU consists of (m_MCUWidth/8)*(m_MCUHeight/8) Y/RGB blocks: 1 for greyscale/no subsampling, 2 for H1V2/H2V1, or 4 blocks for H2V2 sampling factors. 
@@ -109,11 +112,37 @@ typedef struct
    unsigned char *m_pMCUBufB;
 } pjpeg_image_info_t;
 
+// Output sizes, for pjpeg_decode_init()'s reduce
+enum
+{
+   PJPG_REDUCE_NONE = 0,   // Full size
+   PJPG_REDUCE_1_8,        // 1/8: the first pixel of each block only, from its DC coefficient
+   PJPG_REDUCE_1_2,        // 1/2: a 4x4 IDCT per block, to the top left 4x4 of each 8x8
+   PJPG_REDUCE_1_4         // 1/4: a 2x2 IDCT per block, to the top left 2x2 of each 8x8
+};
+
+// Decoder state between two MCUs: what pjpeg_set_checkpoint() needs to resume decoding there.
+// It belongs to one image (and one build of picojpeg, if it's saved to a file).
+typedef struct
+{
+   unsigned long m_ofs;             // Offset of the next input byte, from the first byte given to pNeed_bytes_callback
+   unsigned long m_bitBuf;          // Entropy-coded bits read ahead of m_ofs, left aligned
+   unsigned char m_bitCount;
+   unsigned char m_marker;          // The bits read ahead end at a marker
+   unsigned char m_nextRestartNum;
+   unsigned char m_reserved;
+   unsigned short m_restartsLeft;   // MCUs left in the restart interval
+   unsigned short m_MCUSRemaining;  // MCUs left in the image
+   short m_lastDC[3];               // DC predictors
+} pjpeg_checkpoint_t;
+
 typedef unsigned char (*pjpeg_need_bytes_callback_t)(unsigned char* pBuf, unsigned char buf_size, unsigned char *pBytes_actually_read, void *pCallback_data);
 
 // Initializes the decompressor. Returns 0 on success, or one of the above error codes on failure.
 // pNeed_bytes_callback will be called to fill the decompressor's internal input buffer.
-// If reduce is 1, only the first pixel of each block will be decoded. This mode is much faster because it skips the AC dequantization, IDCT and chroma upsampling of every image pixel.
+// If reduce is 1 (PJPG_REDUCE_1_8), only the first pixel of each block will be decoded. This mode is much faster because it skips the AC dequantization, IDCT and chroma upsampling of every image pixel.
+// PJPG_REDUCE_1_2 and PJPG_REDUCE_1_4 decode every coefficient but run a smaller IDCT and convert a quarter or a sixteenth of the pixels; each output pixel is the average of the 2x2 or 4x4 pixels of a full decode.
+// The MCU buffers keep their 8x8 block layout at every size: a reduced block is at the top left of its 8x8, rows 8 bytes apart.
 // Not thread safe.
 unsigned char pjpeg_decode_init(pjpeg_image_info_t *pInfo, pjpeg_need_bytes_callback_t pNeed_bytes_callback, void *pCallback_data, unsigned char reduce);
 
@@ -122,6 +151,30 @@ unsigned char pjpeg_decode_init(pjpeg_image_info_t *pInfo, pjpeg_need_bytes_call
 // Not thread safe.
 unsigned char pjpeg_decode_mcu(void);
 
+// Skips the file's next MCU, as pjpeg_decode_mcu() but without dequantization, IDCT or color conversion:
+// only its Huffman codes are decoded, to reach the MCUs after it. The MCU buffers are left unchanged.
+// Not thread safe.
+unsigned char pjpeg_skip_mcu(void);
+
+// Skips the rest of the current restart interval: the input is scanned for the next RSTn marker without decoding
+// anything, so this is much faster than pjpeg_skip_mcu(). The next MCU is the first of the following interval,
+// m_restartInterval MCUs on from the start of this one. Returns PJPG_NO_MORE_BLOCKS if the image has no restart
+// markers or this is the last interval.
+// Not thread safe.
+unsigned char pjpeg_skip_restart_interval(void);
+
+// Records where decoding is between MCUs, e.g. at the start of every MCU row in an indexing pass.
+void pjpeg_get_checkpoint(pjpeg_checkpoint_t *pCheckpoint);
+
+// Resumes decoding at a checkpoint of the same image, any time after its pjpeg_decode_init(): the next MCU is the
+// one after the checkpoint. Whatever feeds pNeed_bytes_callback has to seek to m_ofs first, as the input buffer
+// is emptied.
+void pjpeg_set_checkpoint(const pjpeg_checkpoint_t *pCheckpoint);
+
+// Changes the output size (see pjpeg_decode_init()), e.g. to fit the image once its size is known.
+// Only valid after pjpeg_decode_init() and before the first pjpeg_decode_mcu().
+void pjpeg_set_reduce(unsigned char reduce);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 #define Print_h
 
 //#include <inttypes.h>
+#include <stdint.h>
 #include <stdio.h> // for size_t
 
 #include "WString.h"
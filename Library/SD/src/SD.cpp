@@ -368,6 +368,19 @@ namespace SDLib {
 		       root.openRoot(volume);
 	}
 
+	void SDClass::beginStart() {
+		if (root.isOpen()) root.close();
+		card.initStart(SPI_HALF_SPEED);
+	}
+
+	uint8_t SDClass::beginPoll() {
+		if (root.isOpen()) return SD_INIT_OK;
+		uint8_t r = card.initPoll();
+		if (r != SD_INIT_OK) return r;
+		// Card is up: mount in this call (a few block reads)
+		return (volume.init(card) && root.openRoot(volume)) ? SD_INIT_OK : SD_INIT_FAIL;
+	}
+
 	//call this when a card is removed. It will allow you to insert and initialise a new card.
 	void SDClass::end()
 	{
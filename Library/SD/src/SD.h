@@ -70,6 +70,12 @@ namespace SDLib {
 		// before other methods are used.
 		bool begin();
 		bool begin(uint32_t clock);
+
+		// Non-blocking begin(): beginStart(), then call beginPoll() until
+		// it returns SD_INIT_OK or SD_INIT_FAIL. The card powers up and the
+		// volume is mounted while the caller does other work in between.
+		void beginStart();
+		uint8_t beginPoll();
   
 		//call this when a card is removed. It will allow you to insert and initialise a new card.
 		void end();
@@ -180,86 +180,114 @@ uint8_t Sd2Card::eraseSingleBlockEnable(void) {
  * Initialize an SD flash memory card.
  *
  * \param[in] sckRateID SPI clock rate selector. See setSckRate().
- * \param[in] chipSelectPin SD chip select pin number.
  *
  * \return The value one, true, is returned for success and
  * the value zero, false, is returned for failure.  The reason for failure
  * can be determined by calling errorCode() and errorData().
  */
 uint8_t Sd2Card::init(uint8_t sckRateID) {
+  uint8_t r;
+  initStart(sckRateID);
+  while ((r = initPoll()) == SD_INIT_BUSY) {}
+  return r == SD_INIT_OK;
+}
+//------------------------------------------------------------------------------
+/**
+ * Start initializing an SD flash memory card.  Sends the wake-up clocks
+ * and leaves the rest to initPoll(), so the card's power-up (which can take
+ * hundreds of milliseconds of ACMD41 polling) can overlap other work.
+ *
+ * \param[in] sckRateID SPI clock rate selector to switch to once the card
+ * is ready. See setSckRate().
+ */
+void Sd2Card::initStart(uint8_t sckRateID) {
   errorCode_ = inBlock_ = partialBlockRead_ = type_ = 0;
-  //chipSelectPin_ = chipSelectPin;
-  // 16-bit init start time allows over a minute
-  unsigned int t0 = HAL_GetTick();
-  uint32_t arg;
+  initRate_ = sckRateID;
+  initT0_ = HAL_GetTick();
 
 	HAL_GPIO_WritePin(SD_CS_GPIO_Port, SD_CS_Pin, GPIO_PIN_SET);
 	HAL_Delay(1);
-	
-
-
-
-  //SDCARD_SPI.begin();
- // settings = SPISettings(250000, MSBFIRST, SPI_MODE0);
-
 
   // must supply min of 74 clock cycles with CS high.
-
   for (uint8_t i = 0; i < 10; i++) spiSend(0XFF);
 
-
   chipSelectLow();
-
-  // command to go idle in SPI mode
-  while ((status_ = cardCommand(CMD0, 0)) != R1_IDLE_STATE) {
-	  unsigned int d = HAL_GetTick() - t0;
-    if (d > SD_INIT_TIMEOUT) {
-      error(SD_CARD_ERROR_CMD0);
-      goto fail;
-    }
-  }
-  // check SD version
-  if ((cardCommand(CMD8, 0x1AA) & R1_ILLEGAL_COMMAND)) {
-    type(SD_CARD_TYPE_SD1);
-  } else {
-    // only need last byte of r7 response
-    for (uint8_t i = 0; i < 4; i++) status_ = spiRec();
-    if (status_ != 0XAA) {
-      error(SD_CARD_ERROR_CMD8);
-      goto fail;
-    }
-    type(SD_CARD_TYPE_SD2);
-  }
-  // initialize card and send host supports SDHC if SD2
-  arg = type() == SD_CARD_TYPE_SD2 ? 0X40000000 : 0;
-
-  while ((status_ = cardAcmd(ACMD41, arg)) != R1_READY_STATE) {
-    // check for timeout
-    unsigned int d = HAL_GetTick() - t0;
-    if (d > SD_INIT_TIMEOUT) {
-      error(SD_CARD_ERROR_ACMD41);
-      goto fail;
-    }
-  }
-  // if SD2 read OCR register to check for SDHC card
-  if (type() == SD_CARD_TYPE_SD2) {
-    if (cardCommand(CMD58, 0)) {
-      error(SD_CARD_ERROR_CMD58);
-      goto fail;
-    }
-    if ((spiRec() & 0XC0) == 0XC0) type(SD_CARD_TYPE_SDHC);
-    // discard rest of ocr - contains allowed voltage range
-    for (uint8_t i = 0; i < 3; i++) spiRec();
+  initState_ = SD_INIT_STATE_CMD0;
+}
+//------------------------------------------------------------------------------
+/**
+ * Advance initialization started by initStart().  Each call sends at most
+ * one command (plus the one-off CMD8 and CMD58 steps), so it returns
+ * quickly while the card is still powering up.
+ *
+ * \return SD_INIT_BUSY while the card isn't ready yet, SD_INIT_OK once it
+ * is, SD_INIT_FAIL on error or timeout (see errorCode() and errorData()).
+ */
+uint8_t Sd2Card::initPoll(void) {
+  switch (initState_) {
+    case SD_INIT_STATE_CMD0:
+      // command to go idle in SPI mode
+      if ((status_ = cardCommand(CMD0, 0)) != R1_IDLE_STATE) {
+        if (HAL_GetTick() - initT0_ > SD_INIT_TIMEOUT) {
+          error(SD_CARD_ERROR_CMD0);
+          goto fail;
+        }
+        return SD_INIT_BUSY;
+      }
+      // check SD version
+      if ((cardCommand(CMD8, 0x1AA) & R1_ILLEGAL_COMMAND)) {
+        type(SD_CARD_TYPE_SD1);
+      } else {
+        // only need last byte of r7 response
+        for (uint8_t i = 0; i < 4; i++) status_ = spiRec();
+        if (status_ != 0XAA) {
+          error(SD_CARD_ERROR_CMD8);
+          goto fail;
+        }
+        type(SD_CARD_TYPE_SD2);
+      }
+      initState_ = SD_INIT_STATE_ACMD41;
+      return SD_INIT_BUSY;
+
+    case SD_INIT_STATE_ACMD41:
+      // initialize card and send host supports SDHC if SD2
+      if ((status_ = cardAcmd(ACMD41,
+          type() == SD_CARD_TYPE_SD2 ? 0X40000000 : 0)) != R1_READY_STATE) {
+        if (HAL_GetTick() - initT0_ > SD_INIT_TIMEOUT) {
+          error(SD_CARD_ERROR_ACMD41);
+          goto fail;
+        }
+        return SD_INIT_BUSY;
+      }
+      // if SD2 read OCR register to check for SDHC card
+      if (type() == SD_CARD_TYPE_SD2) {
+        if (cardCommand(CMD58, 0)) {
+          error(SD_CARD_ERROR_CMD58);
+          goto fail;
+        }
+        if ((spiRec() & 0XC0) == 0XC0) type(SD_CARD_TYPE_SDHC);
+        // discard rest of ocr - contains allowed voltage range
+        for (uint8_t i = 0; i < 3; i++) spiRec();
+      }
+      chipSelectHigh();
+      if (!setSckRate(initRate_)) {
+        initState_ = SD_INIT_STATE_FAILED;
+        return SD_INIT_FAIL;
+      }
+      initState_ = SD_INIT_STATE_READY;
+      return SD_INIT_OK;
+
+    case SD_INIT_STATE_READY:
+      return SD_INIT_OK;
+
+    default:
+      return SD_INIT_FAIL;
   }
-  chipSelectHigh();
-
-
-  return setSckRate(sckRateID);
-
 
  fail:
   chipSelectHigh();
-  return false;
+  initState_ = SD_INIT_STATE_FAILED;
+  return SD_INIT_FAIL;
 }
 //------------------------------------------------------------------------------
 /**
@@ -43,6 +43,12 @@ uint8_t const SPI_QUARTER_SPEED = 2;
 #define SD_PROTECT_BLOCK_ZERO 1
 /** init timeout ms */
 unsigned int const SD_INIT_TIMEOUT = 2000;
+/** Sd2Card::initPoll() result: card still powering up */
+uint8_t const SD_INIT_BUSY = 0;
+/** Sd2Card::initPoll() result: card ready */
+uint8_t const SD_INIT_OK = 1;
+/** Sd2Card::initPoll() result: init failed, see errorCode() */
+uint8_t const SD_INIT_FAIL = 2;
 /** erase timeout ms */
 unsigned int const SD_ERASE_TIMEOUT = 10000;
 /** read timeout ms */
@@ -118,9 +124,16 @@ class Sd2Card {
   uint8_t partialBlockRead_;
   uint8_t status_;
   uint8_t type_;
+  // initStart()/initPoll() progress
+  enum {SD_INIT_STATE_IDLE, SD_INIT_STATE_CMD0, SD_INIT_STATE_ACMD41,
+        SD_INIT_STATE_READY, SD_INIT_STATE_FAILED};
+  uint8_t initState_;
+  uint8_t initRate_;
+  uint32_t initT0_;
  public:
   /** Construct an instance of Sd2Card. */
-  Sd2Card(void) : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0) {}
+  Sd2Card(void) : errorCode_(0), inBlock_(0), partialBlockRead_(0), type_(0),
+    initState_(SD_INIT_STATE_IDLE) {}
   uint32_t cardSize(void);
   uint8_t erase(uint32_t firstBlock, uint32_t lastBlock);
   uint8_t eraseSingleBlockEnable(void);
@@ -136,6 +149,8 @@ class Sd2Card {
    */
 	
 	uint8_t init(uint8_t sckRateID);
+  void initStart(uint8_t sckRateID);
+  uint8_t initPoll(void);
   uint8_t init(void) {
 	  return init(SPI_FULL_SPEED);
 